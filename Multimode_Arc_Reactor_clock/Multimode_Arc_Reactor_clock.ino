@@ -9,15 +9,34 @@
 #include "Adafruit_NeoPixel.h"
 #include <WiFi.h>
 #include <time.h>
-#include <SPIFFS.h>
 #include <TJpg_Decoder.h>
 #include "simple_storage.h"
 #include "gif_digital.h"
+#include "frame_buffer.h"
+#include "draw_queue.h"
+#include "strip_compositor.h"
+#include "glyph_cache.h"
+#include "frame_governor.h"
+#include "log_buffer.h"
+#include "mem_alloc.h"
+#include "storage.h"
+#include "asset_reader.h"
+#include "fs_maintenance.h"
+#include "fs_benchmark.h"
+#include "wifi_manager.h"
+#include "net_connect.h"
+#include "mqtt_link.h"
+#include "metrics.h"
+#include "asset_upload.h"
+#include "asset_sync.h"
+#include "asset_partition.h"
+#include "theme_pack.h"
 
 // Project specific header files
 #include "config.h"
 #include "weather_data.h"
 #include "utils.h"
+#include "clock_state.h"
 #include "theme_manager.h"
 #include "theme_color_memory.h"
 #include "led_controls.h"
@@ -45,6 +64,7 @@ int led_ring_brightness_flash = 250;
 #define POS_CENTER 0
 #define POS_BOTTOM 80
 #define POS_HIDDEN 999  // Special value to hide the clock
+#define POS_AUTO 998    // Choose the calmest part of the background
 
 // Vertical position variable
 int CLOCK_VERTICAL_OFFSET = 0;
@@ -70,12 +90,11 @@ int screenCenterX;
 int screenCenterY;
 int screenRadius;
 
-// Time and date variables
+// Time and date - the loop task view of the published ClockState
 int hours = 12, minutes = 0, seconds = 0;
 int day = 1, month = 1, year = 2025;
 String dayOfWeek = "WEDNESDAY";
 bool is24Hour = false;
-bool needClockRefresh = false;
 
 // Settings variables
 int currentBgIndex = 0;
@@ -97,7 +116,14 @@ int numBgImages = 0;
 
 // Initialize hardware
 Adafruit_NeoPixel pixels(NUMPIXELS, LED_PIN, NEO_GRB + NEO_KHZ800);
-TFT_eSPI tft = TFT_eSPI();
+TFT_eSPI tftPanel = TFT_eSPI();
+
+// All modes draw through 'tft' - the panel itself, or the shadow canvas
+// once frameBufferBegin() has allocated it
+#if USE_SHADOW_FRAMEBUFFER
+ShadowCanvas shadowCanvas(&tftPanel);
+#endif
+TFT_eSPI* tft = &tftPanel;
 
 // Weather data initialization
 WeatherData currentWeather = { "", "", 0, 0, 0, 0, 0, 0, 0, false };
@@ -107,6 +133,9 @@ int currentMode = MODE_ARC_DIGITAL;
 
 // Function declarations
 void checkForImageFiles();
+bool isBackgroundFile(const String& fileName);
+void addBackgroundImage(const String& fileName);
+void removeBackgroundImage(const String& fileName);
 void cycleBgImage();
 void cycleVerticalPosition();
 void checkButtonPress();
@@ -115,13 +144,17 @@ void updateClockDisplay();
 void saveSettings();
 void loadSettings();
 void switchMode(int mode);
-
-// Helper function to list files in SPIFFS
-void listSPIFFSFiles() {
-  File root = SPIFFS.open("/");
+void applyVerticalPosition();
+void applyAmbientLedColor();
+void applyThemeSettings(const String& bgFile, bool applyPosition);
+void serviceMqtt();
+
+// Helper function to list stored files
+void listStorageFiles() {
+  File root = clockFS().open("/");
   File file = root.openNextFile();
 
-  Serial.println("Files in SPIFFS:");
+  Serial.printf("Files in %s:\n", storageName());
   while (file) {
     Serial.print("  ");
     Serial.print(file.name());
@@ -140,9 +173,9 @@ String getCurrentBackgroundFilename() {
   return "";  // Return empty string if no valid background
 }
 
-// Check for image files in SPIFFS and index them
+// Check for image files in storage and index them
 void checkForImageFiles() {
-  File root = SPIFFS.open("/");
+  File root = clockFS().open("/");
   File file = root.openNextFile();
 
   numBgImages = 0;
@@ -154,7 +187,7 @@ void checkForImageFiles() {
       fileName = "/" + fileName;
     }
 
-    if (fileName.endsWith(".jpg") || fileName.endsWith(".jpeg") || fileName.endsWith(".gif")) {
+    if (isBackgroundFile(fileName)) {
       backgroundImages[numBgImages] = fileName;
       numBgImages++;
     }
@@ -162,8 +195,98 @@ void checkForImageFiles() {
     file = root.openNextFile();
   }
 
+  // Packed backgrounds that are not also stored as files
+  for (int i = 0; i < assetCount() && numBgImages < MAX_BACKGROUNDS; i++) {
+    String fileName = assetName(i);
+    if (!(fileName.endsWith(".jpg") || fileName.endsWith(".jpeg") || fileName.endsWith(".gif"))) continue;
+
+    bool listed = false;
+    for (int j = 0; j < numBgImages && !listed; j++) {
+      listed = (backgroundImages[j] == fileName);
+    }
+    if (!listed) {
+      backgroundImages[numBgImages] = fileName;
+      numBgImages++;
+    }
+  }
+
   if (numBgImages == 0) {
-    Serial.println("No background images found in SPIFFS");
+    Serial.println("No background images found in storage");
+  }
+}
+
+// Images and valid theme files can be backgrounds (scans theme headers)
+bool isBackgroundFile(const String& fileName) {
+  if (fileName.endsWith(".jpg") || fileName.endsWith(".jpeg") || fileName.endsWith(".gif")) return true;
+  return isThemeFile(fileName) && themeScan(fileName.c_str());
+}
+
+// Add a file that arrived while running, without rescanning storage
+void addBackgroundImage(const String& fileName) {
+  if (!isBackgroundFile(fileName)) return;
+
+  String current = (currentBgIndex >= 0 && currentBgIndex < numBgImages) ? backgroundImages[currentBgIndex] : "";
+
+  bool listed = false;
+  for (int i = 0; i < numBgImages && !listed; i++) {
+    listed = (backgroundImages[i] == fileName);
+  }
+
+  if (listed) {
+    // The background on screen was replaced - show the new one
+    if (fileName == current) {
+      applyThemeSettings(fileName, false);
+      clockRequestRefresh();
+    }
+    return;
+  }
+
+  if (numBgImages >= MAX_BACKGROUNDS) {
+    LOG_WARN("Background list full, %s not added", fileName.c_str());
+    return;
+  }
+
+  backgroundImages[numBgImages] = fileName;
+  numBgImages++;
+  sortBackgroundImages();
+
+  // Stay on the same background after sorting
+  for (int i = 0; i < numBgImages; i++) {
+    if (backgroundImages[i] == current) currentBgIndex = i;
+  }
+  if (current.length() == 0) {
+    currentBgIndex = 0;
+    clockRequestRefresh();  // First background
+  }
+  LOG_INFO("Added background %s (%d total)", fileName.c_str(), numBgImages);
+}
+
+// Drop a deleted file from the background list, moving on if it was showing
+void removeBackgroundImage(const String& fileName) {
+  int index = -1;
+  for (int i = 0; i < numBgImages && index < 0; i++) {
+    if (backgroundImages[i] == fileName) index = i;
+  }
+  if (index < 0) return;
+
+  for (int i = index; i < numBgImages - 1; i++) {
+    backgroundImages[i] = backgroundImages[i + 1];
+  }
+  numBgImages--;
+  backgroundImages[numBgImages] = "";
+  LOG_INFO("Removed background %s (%d left)", fileName.c_str(), numBgImages);
+
+  if (index < currentBgIndex) {
+    currentBgIndex--;
+  } else if (index == currentBgIndex) {
+    if (numBgImages == 0) {
+      currentBgIndex = 0;
+      clockRequestRefresh();
+      return;
+    }
+    // cycleBgImage() steps onto the entry that moved into its place
+    currentBgIndex = (index + numBgImages - 1) % numBgImages;
+    cycleBgImage();
   }
 }
 
@@ -202,11 +325,11 @@ void switchMode(int mode) {
     cleanupAppleRingsMode();
   }
 
-  tft.fillScreen(TFT_BLACK);
-  currentMode = mode;
+  tft->fillScreen(TFT_BLACK);
+  compositorClearLayers();
+  clockSetMode(mode);
 
-  Serial.print("Switched to mode: ");
-  Serial.println(currentMode);
+  LOG_INFO("Switched to mode: %d", currentMode);
 
   // Load background-specific LED color (unless weather mode)
   if (mode != MODE_WEATHER && currentBgIndex >= 0 && currentBgIndex < numBgImages) {
@@ -214,10 +337,7 @@ void switchMode(int mode) {
     if (justFilename.length() > 0) {
       int savedColor = getThemeColorPreference(justFilename.c_str());
       updateModeColorsFromLedColor(savedColor);
-      Serial.print("Applied LED color for '");
-      Serial.print(justFilename);
-      Serial.print("': ");
-      Serial.println(savedColor);
+      LOG_INFO("Applied LED color for '%s': %d", justFilename, savedColor);
     }
   }
 
@@ -227,7 +347,7 @@ void switchMode(int mode) {
       setWeatherLEDColorDirectly();
     }
   } else if (mode == MODE_APPLE_RINGS) {
-    Serial.println("Initializing Apple Rings Theme");
+    LOG_INFO("Initializing Apple Rings Theme");
     initAppleRingsTheme();
   }
 
@@ -259,14 +379,21 @@ void cycleBgImage() {
   lowerBgFile.toLowerCase();
 
   // Debug info
-  Serial.print("Current file: ");
-  Serial.println(bgFile);
+  LOG_DEBUG("Current file: %s", bgFile);
 
   int newMode = currentMode;
+  const ThemeHeader* theme = themeLookup(bgFile.c_str());
 
+  // Theme files name their mode; analog and digital share JPEG backgrounds
+  if (theme != NULL) {
+    newMode = theme->mode;
+    if (newMode == MODE_ARC_DIGITAL && currentMode == MODE_ARC_ANALOG) {
+      newMode = MODE_ARC_ANALOG;
+    }
+  }
   // Check for apple rings mode trigger
-  if (lowerBgFile.indexOf("apple_rings") >= 0) {
-    Serial.println("Detected Apple Rings trigger");
+  else if (lowerBgFile.indexOf("apple_rings") >= 0) {
+    LOG_INFO("Detected Apple Rings trigger");
     newMode = MODE_APPLE_RINGS;
   }
   // Then handle other modes
@@ -288,26 +415,25 @@ void cycleBgImage() {
 
   // Get clean filename for this background
   String justFilename = getFilenameFromPath(bgFile);
+  applyThemeSettings(bgFile, true);
 
   // Load background-specific LED color before switching mode
   if (newMode != MODE_WEATHER) {
     // Get color preference using just the filename
     int savedColor = getThemeColorPreference(justFilename.c_str());
     updateModeColorsFromLedColor(savedColor);
-    Serial.print("Setting LED color to: ");
-    Serial.println(savedColor);
+    LOG_INFO("Setting LED color to: %d", savedColor);
 
     // IMPORTANT: Update the physical LEDs with the new color
     updateLEDs();  // THIS LINE WAS MISSING!
   }
 
-  Serial.print("Switching to mode: ");
-  Serial.println(newMode);
+  LOG_INFO("Switching to mode: %d", newMode);
 
   if (newMode != currentMode) {
     switchMode(newMode);
   } else {
-    tft.fillScreen(TFT_BLACK);
+    tft->fillScreen(TFT_BLACK);
     drawBackground();
 
     if (currentMode == MODE_GIF_DIGITAL) {
@@ -354,32 +480,34 @@ void cycleVerticalPosition() {
       } else if (currentVertPos == POS_CENTER) {
         currentVertPos = POS_BOTTOM;
       } else if (currentVertPos == POS_BOTTOM) {
+        currentVertPos = POS_AUTO;
+      } else if (currentVertPos == POS_AUTO) {
         currentVertPos = POS_HIDDEN;
         isClockHidden = true;
       } else {
-        currentMode = MODE_ARC_ANALOG;
+        clockSetMode(MODE_ARC_ANALOG);
         currentVertPos = POS_TOP;
         isClockHidden = false;
 
-        CLOCK_VERTICAL_OFFSET = currentVertPos;
+        applyVerticalPosition();
         saveSettings();
         switchMode(MODE_ARC_ANALOG);
         return;
       }
     } else if (currentMode == MODE_ARC_ANALOG) {
       String bgFile = backgroundImages[currentBgIndex];
-      currentMode = bgFile.endsWith(".gif") ? MODE_GIF_DIGITAL : MODE_ARC_DIGITAL;
+      clockSetMode(isGifFile(bgFile) ? MODE_GIF_DIGITAL : MODE_ARC_DIGITAL);
       currentVertPos = POS_TOP;
       isClockHidden = false;
 
-      CLOCK_VERTICAL_OFFSET = currentVertPos;
+      applyVerticalPosition();
       saveSettings();
       switchMode(currentMode);
       return;
     }
   }
 
-  CLOCK_VERTICAL_OFFSET = currentVertPos;
+  applyVerticalPosition();
   drawBackground();
   if (!isClockHidden) {
     updateClockDisplay();
@@ -403,6 +531,7 @@ void checkButtonPress() {
     if (millis() - lastBgButtonPress > debounceDelay) {
       cycleBgImage();
       lastBgButtonPress = millis();
+      metricsButtonEvents[METRICS_BUTTON_BACKGROUND]++;
 
       if (currentMode == MODE_WEATHER) {
         useWeatherColors = true;
@@ -415,6 +544,7 @@ void checkButtonPress() {
     if (millis() - lastPosButtonPress > debounceDelay) {
       cycleVerticalPosition();
       lastPosButtonPress = millis();
+      metricsButtonEvents[METRICS_BUTTON_POSITION]++;
     }
   }
 
@@ -448,6 +578,7 @@ void checkButtonPress() {
       updateLEDs();
       saveSettings();
       lastClrButtonPress = millis();
+      metricsButtonEvents[METRICS_BUTTON_COLOR]++;
     }
   }
 
@@ -458,9 +589,10 @@ void checkButtonPress() {
       appleButtonsActive = true;
     } else if (millis() - appleButtonsStartTime > 1000) {  // Hold for 1 second
       Serial.println("Force switching to Apple Rings mode");
-      currentMode = MODE_APPLE_RINGS;
+      clockSetMode(MODE_APPLE_RINGS);
       initAppleRingsTheme();
       drawAppleRingsInterface();
+      frameFlush();
 
       // Wait until buttons are released to avoid immediate switching
       while (digitalRead(BG_BUTTON_PIN) == LOW || digitalRead(POS_BUTTON_PIN) == LOW) {
@@ -520,10 +652,9 @@ void checkButtonPress() {
 
 // Draw the background based on current settings
 void drawBackground() {
-  tft.fillScreen(TFT_BLACK);
+  tft->fillScreen(TFT_BLACK);
 
-  Serial.print("Drawing background for mode: ");
-  Serial.println(currentMode);
+  LOG_DEBUG("Drawing background for mode: %d", currentMode);
 
   if (numBgImages <= 0 || currentBgIndex < 0 || currentBgIndex >= numBgImages) {
     return;
@@ -537,13 +668,67 @@ void drawBackground() {
     drawWeatherInterface();
   } else if (currentMode == MODE_APPLE_RINGS) {
     // Explicitly draw Apple Rings instead of JPEG background
-    Serial.println("Drawing Apple Rings interface");
+    LOG_DEBUG("Drawing Apple Rings interface");
     drawAppleRingsInterface();
   } else if (currentMode == MODE_GIF_DIGITAL) {
     drawGifDigitalBackground(bgFile.c_str());
-  } else if (bgFile.endsWith(".jpg") || bgFile.endsWith(".jpeg")) {
+  } else if (isJpegFile(bgFile)) {
     displayJPEGBackground(bgFile.c_str());
+
+    // The decode has just analyzed this background
+    if (currentVertPos == POS_AUTO) {
+      applyVerticalPosition();
+    }
   }
+
+  applyAmbientLedColor();
+}
+
+// Switch the LEDs to a newly derived ambient color unless one was chosen
+void applyAmbientLedColor() {
+#if AMBIENT_LED
+  if (!ambientColorReady) return;
+  ambientColorReady = false;
+
+  if (currentMode == MODE_WEATHER) return;
+
+  String justFilename = getCurrentBackgroundFilename();
+  int index = findThemeColorMapping(justFilename.c_str());
+  if (index >= 0 && colorMappings[index].colorIndex != COLOR_AMBIENT) return;
+
+  updateModeColorsFromLedColor(COLOR_AMBIENT);
+  updateLEDs();
+#endif
+}
+
+// Font and clock position packed into a theme file
+void applyThemeSettings(const String& bgFile, bool applyPosition) {
+  const ThemeHeader* theme = themeLookup(bgFile.c_str());
+  smoothFontEnabled = (theme == NULL || theme->font != THEME_FONT_BUILTIN);
+
+  if (theme == NULL || !applyPosition || theme->clockPosition == THEME_UNSET) return;
+
+  currentVertPos = theme->clockPosition;
+  isClockHidden = (currentVertPos == POS_HIDDEN);
+  applyVerticalPosition();
+}
+
+// Turn the selected position into the clock offset and digit colors
+void applyVerticalPosition() {
+  if (currentVertPos == POS_AUTO) {
+    if (autoPlacementValid) {
+      CLOCK_VERTICAL_OFFSET = autoPlacementOffset;
+      arcDigitColor = autoDigitColor;
+      arcDigitBackground = autoDigitBackground;
+    } else {
+      CLOCK_VERTICAL_OFFSET = POS_CENTER;
+    }
+    return;
+  }
+
+  CLOCK_VERTICAL_OFFSET = currentVertPos;
+  arcDigitColor = CYAN_COLOR;
+  arcDigitBackground = TEXT_BACKGROUND_COLOR;
 }
 
 // Update the clock display based on current settings
@@ -610,13 +795,13 @@ void loadSettings() {
   }
 
   if (savedMode >= 0 && savedMode < MODE_TOTAL) {
-    currentMode = savedMode;
+    clockSetMode(savedMode);
   }
 
-  if (savedVertPos == POS_TOP || savedVertPos == POS_CENTER || savedVertPos == POS_BOTTOM || savedVertPos == POS_HIDDEN) {
+  if (savedVertPos == POS_TOP || savedVertPos == POS_CENTER || savedVertPos == POS_BOTTOM || savedVertPos == POS_AUTO || savedVertPos == POS_HIDDEN) {
     currentVertPos = savedVertPos;
     isClockHidden = (savedVertPos == POS_HIDDEN);
-    CLOCK_VERTICAL_OFFSET = currentVertPos;
+    applyVerticalPosition();
   }
 
   if (savedLedColor >= 0 && savedLedColor < COLOR_TOTAL) {
@@ -624,10 +809,51 @@ void loadSettings() {
   }
 }
 
+// Run the MQTT link, apply received commands and publish our state
+void serviceMqtt() {
+  mqttService();
+
+  MqttCommand command;
+  if (mqttTakeCommand(command)) {
+    LOG_INFO("MQTT command %d: %d", command.type, command.value);
+
+    if (command.type == MQTT_CMD_MODE && command.value >= 0 && command.value < MODE_TOTAL) {
+      switchMode(command.value);
+      saveSettings();
+    } else if (command.type == MQTT_CMD_THEME && numBgImages > 0) {
+      // cycleBgImage() moves to the next one, so start just before it
+      if (command.value >= 0 && command.value < numBgImages) {
+        currentBgIndex = (command.value + numBgImages - 1) % numBgImages;
+      }
+      cycleBgImage();
+    } else if (command.type == MQTT_CMD_COLOR && command.value >= 0 && command.value < COLOR_TOTAL) {
+      updateModeColorsFromLedColor(command.value);
+      updateLEDs();
+      saveSettings();
+    } else if (command.type == MQTT_CMD_BRIGHTNESS && command.value >= 0 && command.value <= 255) {
+      led_ring_brightness = command.value;
+      updateLEDs();
+    }
+  }
+
+  if (mqttTelemetryDue()) {
+    char line[64];
+    snprintf(line, sizeof(line), "%d,%d,%d,%d,%u,%d,%lu", currentMode, currentBgIndex, currentLedColor,
+             led_ring_brightness, (unsigned int)ESP.getFreeHeap(), (int)WiFi.RSSI(), millis() / 1000);
+    mqttPublishTelemetry(line);
+  }
+}
+
 void setup() {
   Serial.begin(115200);
   Serial.println("\nStarting Multi-Mode Digital Clock");
 
+  // Deferred logging (prints anything kept from before a crash)
+  logBegin();
+
+  // Publish the initial clock state before anything reads it
+  clockStateBegin();
+
   // Configure buttons with pull-up resistors
   pinMode(BG_BUTTON_PIN, INPUT_PULLUP);
   pinMode(POS_BUTTON_PIN, INPUT_PULLUP);
@@ -639,12 +865,19 @@ void setup() {
 
   currentWeather.valid = false;
 
-  // Initialize SPIFFS for image storage and settings storage
-  if (!SPIFFS.begin(true)) {
-    Serial.println("SPIFFS Mount Failed");
+  // Mount LittleFS or SPIFFS for image storage and settings storage
+  if (!storageBegin()) {
+    Serial.println("Storage Mount Failed");
   } else {
-    Serial.println("SPIFFS Mounted");
-    listSPIFFSFiles();
+    listStorageFiles();
+
+#if STORAGE_BENCHMARK
+    // Read, open, exists() and write timings before anything else touches the files
+    storageBenchmark();
+#endif
+
+    // Smooth font for labels, if one has been uploaded
+    glyphFontBegin();
   }
 
   // Turn on all LEDs
@@ -661,14 +894,20 @@ void setup() {
   SPI.begin(18, 19, 23, 5);  // SCK, MISO, MOSI, SS
 
   // Initialize TFT display
-  tft.init();
-  tft.setRotation(0);
+  tftPanel.init();
+  tftPanel.setRotation(0);
   SPI.setFrequency(27000000);
-  tft.fillScreen(TFT_BLACK);
+  tftPanel.fillScreen(TFT_BLACK);
+
+  // Optional shadow framebuffer (all drawing then goes to PSRAM, else to the panel)
+  frameBufferBegin();
+
+  // Optional strip compositor for migrated modes
+  compositorBegin();
 
   // Get display dimensions
-  screenCenterX = tft.width() / 2;
-  screenCenterY = tft.height() / 2;
+  screenCenterX = tft->width() / 2;
+  screenCenterY = tft->height() / 2;
   screenRadius = min(screenCenterX, screenCenterY) - 10;
 
   // Initialize TJpg_Decoder
@@ -677,42 +916,46 @@ void setup() {
   TJpgDec.setCallback(tft_output);
 
   // Connect to WiFi
-  Serial.print("Connecting to WiFi");
-  WiFi.begin(ssid, password);
-
-  // Wait for connection with timeout
-  int timeout = 0;
-  while (WiFi.status() != WL_CONNECTED && timeout < 20) {
-    delay(500);
-    Serial.print(".");
-    timeout++;
-  }
+  Serial.println("Connecting to WiFi");
+  bool wifiConnected = wifiBegin(ssid, password);
+  metricsBegin();
+  uploadBegin();
+  syncBegin();
 
-  if (WiFi.status() == WL_CONNECTED) {
+  if (wifiConnected) {
     Serial.println("\nWiFi connected!");
     configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
 
-    tft.fillScreen(TFT_BLACK);
-    tft.setTextSize(2);
-    tft.setTextColor(TFT_GREEN);
-    tft.setCursor(40, 80);
-    tft.println("WiFi Connected");
-    tft.setCursor(40, 110);
-    tft.println("Getting Time...");
+    tft->fillScreen(TFT_BLACK);
+    tft->setTextSize(2);
+    tft->setTextColor(TFT_GREEN);
+    tft->setCursor(40, 80);
+    tft->println("WiFi Connected");
+    tft->setCursor(40, 110);
+    tft->println("Getting Time...");
+    frameFlush();
     delay(1000);
   } else {
     Serial.println("\nWiFi connection failed");
 
-    tft.fillScreen(TFT_BLACK);
-    tft.setTextSize(2);
-    tft.setTextColor(TFT_RED);
-    tft.setCursor(40, 100);
-    tft.println("WiFi Failed");
-    tft.setCursor(30, 130);
-    tft.println("Using Default Time");
+    tft->fillScreen(TFT_BLACK);
+    tft->setTextSize(2);
+    tft->setTextColor(TFT_RED);
+    tft->setCursor(40, 100);
+    tft->println("WiFi Failed");
+    tft->setCursor(30, 130);
+    tft->println("Using Default Time");
+    frameFlush();
     delay(1000);
   }
 
+  // Optional packed backgrounds in their own flash partition
+  assetPartitionBegin();
+
+  // Cached per-background analysis only ever grows - drop what is stale
+  compactImageSummaries();
+  ambientCacheBegin();
+
   // Check for available images before loading settings
   checkForImageFiles();
 
@@ -727,6 +970,11 @@ void setup() {
   // Load theme-specific color mappings
   loadThemeColorMappings();
 
+  // Font of a theme file background (the saved clock position stays)
+  if (currentBgIndex >= 0 && currentBgIndex < numBgImages) {
+    applyThemeSettings(backgroundImages[currentBgIndex], false);
+  }
+
   // Apply the background-specific LED color
   if (currentMode != MODE_WEATHER && currentBgIndex >= 0 && currentBgIndex < numBgImages) {
     String justFilename = getCurrentBackgroundFilename();
@@ -751,10 +999,22 @@ void setup() {
 
   // Update LEDs with current color
   updateLEDs();
+
+  // Push the first complete frame
+  frameFlush();
+
+  // Where the large buffers ended up, what the first screen read and how WiFi connected
+  memPrintStats();
+  assetReaderPrintStats();
+  wifiPrintStats();
 }
 
 void loop() {
   unsigned long currentMillis = millis();
+  governorBeginFrame();
+
+  // One consistent copy of time, mode and LED color for this frame
+  clockStateSnapshot();
 
   // Check for button presses
   checkButtonPress();
@@ -763,8 +1023,7 @@ void loop() {
   checkColorNameTimeout();
 
   // Check if screen needs refresh from color name timeout
-  if (needClockRefresh) {
-    needClockRefresh = false;
+  if (clockTakeRefresh()) {
     drawBackground();
 
     if (currentMode == MODE_GIF_DIGITAL) {
@@ -823,8 +1082,7 @@ void loop() {
         lastTimeCheck = currentMillis;
         updateTimeAndDate();
 
-        if (needClockRefresh) {
-          needClockRefresh = false;
+        if (clockTakeRefresh()) {
           drawBackground();
           initAnalogClock();
           drawAnalogClock();
@@ -856,4 +1114,38 @@ void loop() {
   if (seconds == 0 && (minutes == 0 || minutes == 30) && (currentMillis - lastTimeCheck < 1000)) {
     flashEffect();
   }
+
+  // Send any queued primitives, then push whatever changed on the shadow canvas
+  drawQueueEndFrame();
+  frameFlush();
+
+  // Adjust quality for the next frames if this one ran over budget
+  governorEndFrame();
+  metricsEndFrame(currentMode, micros() - frameStartMicros);
+
+  // Network: WiFi reconnects, MQTT, metrics scrapes, uploads and asset sync
+  wifiService();
+  serviceMqtt();
+  metricsService();
+  uploadService();
+  syncService();
+
+  // Backgrounds that arrived or were deleted while running
+  char changedPath[UPLOAD_PATH_LENGTH];
+  bool removed = false;
+  if (uploadTakeCompleted(changedPath)) {
+    addBackgroundImage(changedPath);
+  } else if (syncTakeChange(changedPath, &removed)) {
+    if (removed) {
+      removeBackgroundImage(changedPath);
+    } else {
+      addBackgroundImage(changedPath);
+    }
+  }
+
+  // Reclaim file system space while there is time to spare
+  storageMaintenance();
+
+  // Print queued log records if there is no drain task
+  logService();
 }
\ No newline at end of file
@@ -0,0 +1,281 @@
+/*
+ * ambient_color.h - Background-derived LED ambient color
+ * For Multi-Mode Digital Clock project
+ * The JPEG and GIF draw callbacks pass their pixels through
+ * ambientSampleBlock() on the way to the panel. A coarse hue histogram
+ * weighted by chroma gives the dominant saturated color, which is cached
+ * per asset in /bgambient.txt and used for the LED ring when no color was
+ * chosen for that background. The file is compacted and read into RAM once
+ * at boot; lookups never touch storage.
+ */
+
+#ifndef AMBIENT_COLOR_H
+#define AMBIENT_COLOR_H
+
+#include <Arduino.h>
+#include "storage.h"
+#include "config.h"
+#include "theme_manager.h"
+#include "log_buffer.h"
+
+// File holding one "name:r,g,b" line per background
+#define AMBIENT_COLOR_FILE "/bgambient.txt"
+
+// In-memory copy of the file
+#define AMBIENT_CACHE_ENTRIES 100
+#define AMBIENT_NAME_LENGTH 32
+
+// Hue histogram - 12 bins of 30 degrees
+#define AMBIENT_HUE_BINS 12
+#define AMBIENT_HUE_RANGE 1536  // Fixed point hue, 256 steps per 60 degrees
+
+// Pixels darker or greyer than this do not vote
+#define AMBIENT_MIN_VALUE 48
+#define AMBIENT_MIN_CHROMA 40
+
+// Below this share of saturated pixels (in 1/256) the image counts as neutral
+#define AMBIENT_MIN_SATURATED 12
+
+// Chroma-weighted color totals for one hue bin
+struct AmbientBin {
+  uint32_t weight;
+  uint32_t red, green, blue;
+};
+
+// One cached color
+struct AmbientEntry {
+  char name[AMBIENT_NAME_LENGTH];
+  uint8_t r, g, b;
+};
+
+AmbientBin ambientBins[AMBIENT_HUE_BINS];
+AmbientEntry ambientCache[AMBIENT_CACHE_ENTRIES];
+int ambientCacheCount = 0;
+bool ambientCacheLoaded = false;
+uint32_t ambientSampled = 0;
+uint32_t ambientSaturated = 0;
+bool ambientRunning = false;
+bool ambientColorReady = false;  // A new ambient color waits to be applied
+
+// Function prototypes
+void ambientCacheBegin();
+void ambientBegin(const char* filename);
+void ambientSampleBlock(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t* bitmap);
+void ambientFinish(const char* filename, bool decoded);
+bool loadAmbientColor(const char* filename);
+int findAmbientEntry(const char* filename);
+void forgetAmbientColor(const char* filename);
+void setAmbientColor(uint8_t r, uint8_t g, uint8_t b);
+
+// Store the color in the COLOR_AMBIENT slot of the LED color table
+void setAmbientColor(uint8_t r, uint8_t g, uint8_t b) {
+  ledColors[COLOR_AMBIENT].r = r;
+  ledColors[COLOR_AMBIENT].g = g;
+  ledColors[COLOR_AMBIENT].b = b;
+  ledColors[COLOR_AMBIENT].tft_color = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+// Compact the file and read it into RAM - call once the asset partition is up
+void ambientCacheBegin() {
+  compactNameIndex(AMBIENT_COLOR_FILE);
+  ambientCacheCount = 0;
+  ambientCacheLoaded = true;
+
+  File file = clockFS().open(AMBIENT_COLOR_FILE, "r");
+  if (!file) return;
+
+  while (file.available() && ambientCacheCount < AMBIENT_CACHE_ENTRIES) {
+    String line = file.readStringUntil('\n');
+    line.trim();
+
+    int colon = line.indexOf(':');
+    int r, g, b;
+    if (colon <= 0 || colon >= AMBIENT_NAME_LENGTH) continue;
+    if (sscanf(line.c_str() + colon + 1, "%d,%d,%d", &r, &g, &b) != 3) continue;
+
+    AmbientEntry& entry = ambientCache[ambientCacheCount++];
+    memcpy(entry.name, line.c_str(), colon);
+    entry.name[colon] = '\0';
+    entry.r = r;
+    entry.g = g;
+    entry.b = b;
+  }
+  file.close();
+
+  LOG_INFO("Ambient colors: %d cached", ambientCacheCount);
+}
+
+// Index of a background in the cache, or -1
+int findAmbientEntry(const char* filename) {
+  if (!ambientCacheLoaded) ambientCacheBegin();
+
+  for (int i = 0; i < ambientCacheCount; i++) {
+    if (strcmp(ambientCache[i].name, filename) == 0) return i;
+  }
+  return -1;
+}
+
+// Drop the cached color of a background that was replaced or deleted
+void forgetAmbientColor(const char* filename) {
+  if (filename[0] == '/') filename++;  // Colors are stored by bare name
+
+  int index = findAmbientEntry(filename);
+  if (index < 0) return;
+  ambientCacheCount--;
+  memmove(&ambientCache[index], &ambientCache[index + 1], (ambientCacheCount - index) * sizeof(AmbientEntry));
+
+  // The cache holds everything the file needs, so write it back from there
+  String tempName = String(AMBIENT_COLOR_FILE) + ".tmp";
+  File file = clockFS().open(tempName, "w");
+  if (!file) {
+    LOG_ERROR("Failed to open %s", tempName.c_str());
+    return;
+  }
+  for (int i = 0; i < ambientCacheCount; i++) {
+    const AmbientEntry& entry = ambientCache[i];
+    file.printf("%s:%d,%d,%d\n", entry.name, entry.r, entry.g, entry.b);
+  }
+  file.close();
+
+  if (!storageReplace(tempName, AMBIENT_COLOR_FILE)) clockFS().remove(tempName);
+}
+
+// Start sampling a background unless its color is already cached
+void ambientBegin(const char* filename) {
+  ambientColorReady = false;
+
+  if (loadAmbientColor(filename)) {
+    ambientRunning = false;
+    ambientColorReady = true;
+    return;
+  }
+
+  memset(ambientBins, 0, sizeof(ambientBins));
+  ambientSampled = 0;
+  ambientSaturated = 0;
+  ambientRunning = true;
+}
+
+// Add a block of byte-swapped panel pixels, every other pixel and row
+void ambientSampleBlock(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t* bitmap) {
+  if (!ambientRunning) return;
+
+  for (int row = (y & 1); row < h; row += 2) {
+    const uint16_t* line = bitmap + row * w;
+
+    for (int col = (x & 1); col < w; col += 2) {
+      uint16_t color = __builtin_bswap16(line[col]);
+      int r = ((color >> 8) & 0xF8) | (color >> 13);
+      int g = ((color >> 3) & 0xFC) | ((color >> 9) & 0x03);
+      int b = ((color << 3) & 0xF8) | ((color >> 2) & 0x07);
+
+      ambientSampled++;
+
+      int maxC = max(r, max(g, b));
+      int minC = min(r, min(g, b));
+      int chroma = maxC - minC;
+      if (maxC < AMBIENT_MIN_VALUE || chroma < AMBIENT_MIN_CHROMA) continue;
+
+      // Integer hue, 0 to AMBIENT_HUE_RANGE - 1
+      int hue;
+      if (maxC == r) {
+        hue = (g - b) * 256 / chroma;
+        if (hue < 0) hue += AMBIENT_HUE_RANGE;
+      } else if (maxC == g) {
+        hue = 512 + (b - r) * 256 / chroma;
+      } else {
+        hue = 1024 + (r - g) * 256 / chroma;
+      }
+
+      AmbientBin& bin = ambientBins[(hue * AMBIENT_HUE_BINS / AMBIENT_HUE_RANGE) % AMBIENT_HUE_BINS];
+      bin.weight += chroma;
+      bin.red += r * chroma;
+      bin.green += g * chroma;
+      bin.blue += b * chroma;
+      ambientSaturated++;
+    }
+  }
+}
+
+// Find a cached color for this background
+bool loadAmbientColor(const char* filename) {
+  int index = findAmbientEntry(filename);
+  if (index < 0) return false;
+
+  const AmbientEntry& entry = ambientCache[index];
+  setAmbientColor(entry.r, entry.g, entry.b);
+  return true;
+}
+
+// Pick the dominant saturated color and cache it
+void ambientFinish(const char* filename, bool decoded) {
+  if (!ambientRunning) return;
+  ambientRunning = false;
+
+  if (!decoded || ambientSampled == 0) return;
+
+  int r, g, b;
+  if (ambientSaturated * 256 < ambientSampled * AMBIENT_MIN_SATURATED) {
+    // Mostly grey or dark - use plain white
+    r = ledColors[COLOR_WHITE].r;
+    g = ledColors[COLOR_WHITE].g;
+    b = ledColors[COLOR_WHITE].b;
+  } else {
+    // Strongest hue, counting its neighbours so a peak on a bin edge is not split
+    int peak = 0;
+    uint32_t peakWeight = 0;
+    for (int i = 0; i < AMBIENT_HUE_BINS; i++) {
+      uint32_t weight = ambientBins[(i + AMBIENT_HUE_BINS - 1) % AMBIENT_HUE_BINS].weight +
+                        ambientBins[i].weight * 2 +
+                        ambientBins[(i + 1) % AMBIENT_HUE_BINS].weight;
+      if (weight > peakWeight) {
+        peakWeight = weight;
+        peak = i;
+      }
+    }
+
+    uint32_t weight = 0, red = 0, green = 0, blue = 0;
+    for (int offset = -1; offset <= 1; offset++) {
+      const AmbientBin& bin = ambientBins[(peak + offset + AMBIENT_HUE_BINS) % AMBIENT_HUE_BINS];
+      weight += bin.weight;
+      red += bin.red;
+      green += bin.green;
+      blue += bin.blue;
+    }
+
+    r = red / weight;
+    g = green / weight;
+    b = blue / weight;
+
+    // LEDs look best at full brightness - the ring brightness setting scales them
+    int maxC = max(r, max(g, b));
+    r = r * 255 / maxC;
+    g = g * 255 / maxC;
+    b = b * 255 / maxC;
+  }
+
+  setAmbientColor(r, g, b);
+  ambientColorReady = true;
+
+  // A full cache is not written either, so the file cannot outgrow it
+  if (findAmbientEntry(filename) < 0 && ambientCacheCount < AMBIENT_CACHE_ENTRIES &&
+      strlen(filename) < AMBIENT_NAME_LENGTH) {
+    AmbientEntry& entry = ambientCache[ambientCacheCount++];
+    strcpy(entry.name, filename);
+    entry.r = r;
+    entry.g = g;
+    entry.b = b;
+
+    File file = clockFS().open(AMBIENT_COLOR_FILE, "a");
+    if (file) {
+      file.printf("%s:%d,%d,%d\n", filename, r, g, b);
+      file.close();
+    } else {
+      LOG_ERROR("Failed to open %s", AMBIENT_COLOR_FILE);
+    }
+  }
+
+  LOG_INFO("Ambient color for '%s': %d,%d,%d", filename, r, g, b);
+}
+
+#endif  // AMBIENT_COLOR_H
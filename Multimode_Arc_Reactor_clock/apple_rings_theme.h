@@ -11,6 +11,10 @@
 #include <TFT_eSPI.h>
 #include "utils.h"
 #include "led_controls.h"
+#include "draw_queue.h"
+#include "strip_compositor.h"
+#include "frame_governor.h"
+#include "log_buffer.h"
 
 // Define a constant for the Apple Rings mode
 #define MODE_APPLE_RINGS 5  // Add a new mode for Apple Rings
@@ -32,6 +36,27 @@
 #define SECONDS_RING_RADIUS 105   // Outer ring (seconds) radius - near screen edge but fully visible
 #define RING_THICKNESS 16         // Thickness of each ring
 
+// Anti-aliasing - on by default, can be turned off at runtime to save time
+#ifndef APPLE_RINGS_AA
+#define APPLE_RINGS_AA 1
+#endif
+
+// Edge coverage table covers distances of -1..+1 pixel in 1/16 pixel steps
+#define RING_AA_SUBSTEPS 16
+#define RING_AA_TABLE_SIZE (2 * RING_AA_SUBSTEPS + 1)
+
+// Ring geometry prepared once per draw
+struct RingShape {
+  int cx, cy;
+  float radius;
+  float halfWidth;
+  float sweep;                   // Degrees clockwise from 12 o'clock, 360 = full ring
+  float sinSweep, cosSweep;
+  float endCapX, endCapY;        // End cap center relative to the ring center
+  long fullInner2, fullOuter2;   // Squared radii where coverage is always full
+  long edgeInner2, edgeOuter2;   // Squared radii where there is any coverage
+};
+
 // Track previous time values for optimized updating
 int prevRingHours = -1;
 int prevRingMinutes = -1;
@@ -40,15 +65,29 @@ int prevRingSeconds = -1;
 // Flag to avoid excessive redraws and reduce flickering
 bool fullRedrawDone = false;
 
+// Alpha for a pixel whose center is the given distance outside an edge
+uint8_t ringEdgeCoverage[RING_AA_TABLE_SIZE];
+bool ringCoverageReady = false;
+bool ringAntiAliasing = APPLE_RINGS_AA;
+
+// Ring progress in degrees as last composed (compositor path)
+float ringSweepHours = 0;
+float ringSweepMinutes = 0;
+float ringSweepSeconds = 0;
+
 // Function prototypes
 void initAppleRingsTheme();
 void drawAppleRingsInterface();
 void updateAppleRingsTime();
-void drawRing(int x, int y, int radius, int thickness, float startAngle, float endAngle, uint16_t color);
+void drawRing(int x, int y, int radius, int thickness, float startAngle, float endAngle, uint16_t color, bool progress);
 void drawTimeDigits();
 void updateTimeDigits();
 void cleanupAppleRingsMode();
 void forceCorrectRingDisplay();
+void composeAppleRings(bool fullRedraw);
+bool ringsUseAA();
+void drawRingAA(int cx, int cy, int radius, float sweep, uint16_t color, uint16_t trackColor);
+uint16_t ringTrackColor(int radius);
 
 // Initialize the Apple Rings theme - call when switching to this mode
 void initAppleRingsTheme() {
@@ -62,11 +101,21 @@ void initAppleRingsTheme() {
 }
 
 // Draw a ring segment with highly optimized smoothing techniques
-void drawRing(int x, int y, int radius, int thickness, float startAngle, float endAngle, uint16_t color) {
+// Geometry is queued - callers flush with flushDrawQueue()
+// 'progress' marks a time arc drawn over its dark track; tracks and erasures
+// are blended against the plain background instead
+void drawRing(int x, int y, int radius, int thickness, float startAngle, float endAngle, uint16_t color, bool progress) {
+  // Rings drawn from 12 o'clock (or full circles) use the anti-aliased renderer
+  if (ringsUseAA() && thickness == RING_THICKNESS && (startAngle == -90 || endAngle - startAngle >= 360)) {
+    uint16_t trackColor = progress ? ringTrackColor(radius) : APPLE_RINGS_BG;
+    drawRingAA(x, y, radius, endAngle - startAngle, color, trackColor);
+    return;
+  }
+
   // Handle case where endAngle < startAngle (crossing 0/360 boundary)
   if (endAngle < startAngle) {
-    drawRing(x, y, radius, thickness, startAngle, 360, color);
-    drawRing(x, y, radius, thickness, 0, endAngle, color);
+    drawRing(x, y, radius, thickness, startAngle, 360, color, progress);
+    drawRing(x, y, radius, thickness, 0, endAngle, color, progress);
     return;
   }
   
@@ -83,46 +132,30 @@ void drawRing(int x, int y, int radius, int thickness, float startAngle, float e
   float innerRadiusF = radius - thickness/2.0;
   float outerRadiusF = radius + thickness/2.0;
   
-  // Create temporary arrays to store points for a more consistent curve
-  float* innerX = new float[segments+1];
-  float* innerY = new float[segments+1];
-  float* outerX = new float[segments+1];
-  float* outerY = new float[segments+1];
-  
-  // Pre-compute all points with floating-point precision
-  for (int i = 0; i <= segments; i++) {
+  // Walk the arc keeping only the previous edge points - no per-draw buffer
+  int prevInnerX = round(x + cos(startRad) * innerRadiusF);
+  int prevInnerY = round(y + sin(startRad) * innerRadiusF);
+  int prevOuterX = round(x + cos(startRad) * outerRadiusF);
+  int prevOuterY = round(y + sin(startRad) * outerRadiusF);
+
+  // Queue triangles with consistent direction to reduce visual artifacts
+  for (int i = 1; i <= segments; i++) {
     float angle = startRad + i * angleStep;
-    
-    innerX[i] = x + cos(angle) * innerRadiusF;
-    innerY[i] = y + sin(angle) * innerRadiusF;
-    outerX[i] = x + cos(angle) * outerRadiusF;
-    outerY[i] = y + sin(angle) * outerRadiusF;
-  }
-  
-  // Draw optimized triangles with consistent direction to reduce visual artifacts
-  for (int i = 0; i < segments; i++) {
+    int innerX = round(x + cos(angle) * innerRadiusF);
+    int innerY = round(y + sin(angle) * innerRadiusF);
+    int outerX = round(x + cos(angle) * outerRadiusF);
+    int outerY = round(y + sin(angle) * outerRadiusF);
+
     // Use consistent winding order for triangles
-    tft.fillTriangle(
-      round(innerX[i]), round(innerY[i]),
-      round(outerX[i]), round(outerY[i]),
-      round(outerX[i+1]), round(outerY[i+1]),
-      color
-    );
-    
-    tft.fillTriangle(
-      round(innerX[i]), round(innerY[i]),
-      round(outerX[i+1]), round(outerY[i+1]),
-      round(innerX[i+1]), round(innerY[i+1]),
-      color
-    );
+    queueFillTriangle(prevInnerX, prevInnerY, prevOuterX, prevOuterY, outerX, outerY, color);
+    queueFillTriangle(prevInnerX, prevInnerY, outerX, outerY, innerX, innerY, color);
+
+    prevInnerX = innerX;
+    prevInnerY = innerY;
+    prevOuterX = outerX;
+    prevOuterY = outerY;
   }
   
-  // Clean up memory
-  delete[] innerX;
-  delete[] innerY;
-  delete[] outerX;
-  delete[] outerY;
-  
   // Draw smoother end caps using multi-circle technique for better anti-aliasing effect
   if ((endAngle - startAngle) < 360) {
     // Calculate cap centers
@@ -135,32 +168,394 @@ void drawRing(int x, int y, int radius, int thickness, float startAngle, float e
     float capRadius = thickness/2.0;
     
     // Draw the main cap
-    tft.fillCircle(round(startX_mid), round(startY_mid), round(capRadius), color);
-    tft.fillCircle(round(endX_mid), round(endY_mid), round(capRadius), color);
+    queueFillCircle(round(startX_mid), round(startY_mid), round(capRadius), color);
+    queueFillCircle(round(endX_mid), round(endY_mid), round(capRadius), color);
     
     // Draw slightly smaller caps to fill potential gaps
-    tft.fillCircle(round(startX_mid), round(startY_mid), round(capRadius*0.9), color);
-    tft.fillCircle(round(endX_mid), round(endY_mid), round(capRadius*0.9), color);
+    queueFillCircle(round(startX_mid), round(startY_mid), round(capRadius*0.9), color);
+    queueFillCircle(round(endX_mid), round(endY_mid), round(capRadius*0.9), color);
+  }
+}
+
+// Anti-aliasing is on and the frame governor has not dropped it
+bool ringsUseAA() {
+  return ringAntiAliasing && governorAllowsAA();
+}
+
+// Dark track color under a progress ring
+uint16_t ringTrackColor(int radius) {
+  if (radius == HOURS_RING_RADIUS) return APPLE_BLUE_BG;
+  if (radius == MINUTES_RING_RADIUS) return APPLE_GREEN_BG;
+  return APPLE_RED_BG;
+}
+
+// Build the edge coverage table by supersampling a straight edge at several
+// angles - curvature is small at these radii, so a straight edge is close enough
+void initRingCoverageTable() {
+  const int samples = 8;
+  const int angles = 5;
+
+  for (int i = 0; i < RING_AA_TABLE_SIZE; i++) {
+    float distance = (float)(i - RING_AA_SUBSTEPS) / RING_AA_SUBSTEPS;
+    int inside = 0;
+
+    for (int a = 0; a < angles; a++) {
+      float theta = a * (PI / 4) / (angles - 1);
+      float nx = cos(theta);
+      float ny = sin(theta);
+
+      for (int sy = 0; sy < samples; sy++) {
+        for (int sx = 0; sx < samples; sx++) {
+          float px = (sx + 0.5f) / samples - 0.5f;
+          float py = (sy + 0.5f) / samples - 0.5f;
+          if (distance + px * nx + py * ny < 0) inside++;
+        }
+      }
+    }
+
+    ringEdgeCoverage[i] = (inside * 255 + (angles * samples * samples) / 2) / (angles * samples * samples);
+  }
+
+  ringCoverageReady = true;
+}
+
+// Look up coverage for a signed distance to the ring edge (negative = inside)
+uint8_t ringCoverageAt(float distance) {
+  int index = (int)((distance + 1.0f) * RING_AA_SUBSTEPS + 0.5f);
+  if (index <= 0) return 255;
+  if (index >= RING_AA_TABLE_SIZE) return 0;
+  return ringEdgeCoverage[index];
+}
+
+// Prepare a ring (or an arc with round caps) for coverage queries
+void setupRingShape(RingShape& ring, int cx, int cy, int radius, float sweep) {
+  if (!ringCoverageReady) initRingCoverageTable();
+
+  ring.cx = cx;
+  ring.cy = cy;
+  ring.radius = radius;
+  ring.halfWidth = RING_THICKNESS / 2.0;
+  ring.sweep = sweep;
+
+  float endRad = sweep * DEG_TO_RAD;
+  ring.sinSweep = sin(endRad);
+  ring.cosSweep = cos(endRad);
+  ring.endCapX = ring.sinSweep * radius;
+  ring.endCapY = -ring.cosSweep * radius;
+
+  float inner = radius - ring.halfWidth;
+  float outer = radius + ring.halfWidth;
+  ring.fullInner2 = (long)ceil((inner + 1) * (inner + 1));
+  ring.fullOuter2 = (long)floor((outer - 1) * (outer - 1));
+  ring.edgeInner2 = (long)floor((inner - 1) * (inner - 1));
+  ring.edgeOuter2 = (long)ceil((outer + 1) * (outer + 1));
+}
+
+// True when a point lies between 12 o'clock and the end of the sweep
+bool ringInSector(const RingShape& ring, int dx, int dy) {
+  if (ring.sweep >= 360) return true;
+
+  bool afterStart = dx >= 0;
+  bool beforeEnd = -dx * ring.cosSweep - dy * ring.sinSweep >= 0;
+  return (ring.sweep <= 180) ? (afterStart && beforeEnd) : (afterStart || beforeEnd);
+}
+
+// Coverage of one pixel - only pixels near an edge pay for sqrt and the table
+uint8_t ringCoverage(const RingShape& ring, int dx, int dy) {
+  long d2 = (long)dx * dx + (long)dy * dy;
+  if (d2 < ring.edgeInner2 || d2 > ring.edgeOuter2) return 0;
+
+  bool inSector = ringInSector(ring, dx, dy);
+  if (inSector && d2 >= ring.fullInner2 && d2 <= ring.fullOuter2) return 255;
+
+  float distance;
+  if (inSector) {
+    distance = fabsf(sqrtf(d2) - ring.radius) - ring.halfWidth;
+  } else {
+    // Outside the sector only the round caps can cover the pixel
+    float sy = dy + ring.radius;
+    float ex = dx - ring.endCapX;
+    float ey = dy - ring.endCapY;
+    float cap2 = min(dx * dx + sy * sy, ex * ex + ey * ey);
+
+    float reach = ring.halfWidth + 1;
+    if (cap2 > reach * reach) return 0;
+    distance = sqrtf(cap2) - ring.halfWidth;
+  }
+
+  return ringCoverageAt(distance);
+}
+
+// Screen box around the part of a ring between two sweeps (whole ring if it went backwards)
+void ringSweepBounds(int radius, float fromSweep, float toSweep, int margin, int* x, int* y, int* w, int* h) {
+  if (toSweep < fromSweep || toSweep - fromSweep >= 360) {
+    int outer = radius + margin;
+    *x = screenCenterX - outer;
+    *y = screenCenterY - outer;
+    *w = *h = 2 * outer + 1;
+    return;
+  }
+
+  int minX = STRIP_WIDTH, minY = STRIP_HEIGHT, maxX = 0, maxY = 0;
+  for (float angle = fromSweep;; angle += 3) {
+    if (angle > toSweep) angle = toSweep;
+
+    float rad = angle * DEG_TO_RAD;
+    int px = screenCenterX + round(sin(rad) * radius);
+    int py = screenCenterY - round(cos(rad) * radius);
+    minX = min(minX, px);
+    minY = min(minY, py);
+    maxX = max(maxX, px);
+    maxY = max(maxY, py);
+
+    if (angle >= toSweep) break;
   }
+
+  *x = minX - margin;
+  *y = minY - margin;
+  *w = maxX - minX + 2 * margin + 1;
+  *h = maxY - minY + 2 * margin + 1;
+}
+
+// Draw an anti-aliased ring straight to the display. Full-coverage spans are
+// plain line fills; edge pixels are blended over the track and background.
+void drawRingAA(int cx, int cy, int radius, float sweep, uint16_t color, uint16_t trackColor) {
+  if (sweep <= 0) return;
+
+  RingShape ring, track;
+  setupRingShape(ring, cx, cy, radius, sweep);
+  setupRingShape(track, cx, cy, radius, 360);
+
+  int boxX, boxY, boxW, boxH;
+  ringSweepBounds(radius, 0, min(sweep, 360.0f), RING_THICKNESS / 2 + 2, &boxX, &boxY, &boxW, &boxH);
+  int boxX1 = min(boxX + boxW, (int)tft->width());
+  int boxY1 = min(boxY + boxH, (int)tft->height());
+  boxX = max(boxX, 0);
+  boxY = max(boxY, 0);
+
+  // Anything queued underneath must reach the display first
+  flushDrawQueue();
+
+  bool useTransaction = !frameBufferActive();
+  if (useTransaction) tft->startWrite();
+
+  for (int y = boxY; y < boxY1; y++) {
+    int dy = y - cy;
+    int runStart = -1;
+
+    for (int x = boxX; x <= boxX1; x++) {
+      uint8_t alpha = (x < boxX1) ? ringCoverage(ring, x - cx, dy) : 0;
+
+      if (alpha == 255) {
+        if (runStart < 0) runStart = x;
+        continue;
+      }
+
+      if (runStart >= 0) {
+        tft->drawFastHLine(runStart, y, x - runStart, color);
+        runStart = -1;
+      }
+
+      if (alpha > 0) {
+        uint16_t under = tft->alphaBlend(ringCoverage(track, x - cx, dy), trackColor, APPLE_RINGS_BG);
+        tft->drawPixel(x, y, tft->alphaBlend(alpha, color, under));
+      }
+    }
+  }
+
+  if (useTransaction) tft->endWrite();
+}
+
+// Ring progress for the current time, in degrees clockwise from 12 o'clock
+void calculateRingSweeps(float* hoursSweep, float* minutesSweep, float* secondsSweep) {
+  float hourDegrees = is24Hour ? 15.0 : 30.0;
+  int displayHours = is24Hour ? hours : (hours % 12);
+  if (!is24Hour && displayHours == 0) displayHours = 12;
+
+  *hoursSweep = displayHours * hourDegrees;
+  *minutesSweep = minutes * 6.0;
+  *secondsSweep = seconds * 6.0;
+
+  // Seconds ring holds still while the governor has the sweep disabled
+  if (!governorAllowsSweep()) {
+    *secondsSweep = ringSweepSeconds;
+  }
+}
+
+// Paint an anti-aliased ring into a compositor strip, blending edges over
+// whatever the lower layers left there
+void stripDrawRingAA(const StripTarget& strip, int radius, float sweep, uint16_t color) {
+  RingShape ring;
+  setupRingShape(ring, screenCenterX, screenCenterY, radius, sweep);
+
+  int reach = radius + RING_THICKNESS / 2 + 1;
+  uint16_t c = STRIP_COLOR(color);
+
+  for (int row = 0; row < strip.lines; row++) {
+    int dy = strip.y0 + row - screenCenterY;
+    if (abs(dy) > reach) continue;
+
+    uint16_t* dst = strip.pixels + row * STRIP_WIDTH;
+    int xs = max(strip.x0, screenCenterX - reach);
+    int xe = min(strip.x1, screenCenterX + reach + 1);
+
+    for (int x = xs; x < xe; x++) {
+      uint8_t alpha = ringCoverage(ring, x - screenCenterX, dy);
+      if (alpha == 255) {
+        dst[x] = c;
+      } else if (alpha > 0) {
+        dst[x] = STRIP_COLOR(tft->alphaBlend(alpha, color, STRIP_COLOR(dst[x])));
+      }
+    }
+  }
+}
+
+// Paint a ring into a compositor strip - a sweep of 360 or more is the full ring
+void stripDrawRing(const StripTarget& strip, int radius, float sweep, uint16_t color) {
+  if (sweep <= 0) return;
+
+  if (ringsUseAA()) {
+    stripDrawRingAA(strip, radius, sweep, color);
+    return;
+  }
+
+  int inner = radius - RING_THICKNESS / 2;
+  int outer = radius + RING_THICKNESS / 2;
+  long inner2 = (long)inner * inner;
+  long outer2 = (long)outer * outer;
+  long cap2 = (long)(RING_THICKNESS / 2) * (RING_THICKNESS / 2);
+  bool fullRing = sweep >= 360;
+
+  // Sector test and cap positions come from the shape, not per-pixel trig
+  RingShape ring;
+  setupRingShape(ring, screenCenterX, screenCenterY, radius, sweep);
+  int endCapX = round(ring.endCapX);
+  int endCapY = round(ring.endCapY);
+
+  uint16_t c = STRIP_COLOR(color);
+
+  for (int row = 0; row < strip.lines; row++) {
+    int dy = strip.y0 + row - screenCenterY;
+    if (abs(dy) > outer) continue;
+
+    uint16_t* dst = strip.pixels + row * STRIP_WIDTH;
+    int xs = max(strip.x0, screenCenterX - outer);
+    int xe = min(strip.x1, screenCenterX + outer + 1);
+
+    for (int x = xs; x < xe; x++) {
+      int dx = x - screenCenterX;
+      long d2 = (long)dx * dx + (long)dy * dy;
+      if (d2 < inner2 || d2 > outer2) continue;
+
+      if (!fullRing) {
+        if (!ringInSector(ring, dx, dy)) {
+          long startDy = dy + radius;
+          bool inStartCap = (long)dx * dx + startDy * startDy <= cap2;
+          bool inEndCap = (long)(dx - endCapX) * (dx - endCapX) + (long)(dy - endCapY) * (dy - endCapY) <= cap2;
+          if (!inStartCap && !inEndCap) continue;
+        }
+      }
+
+      dst[x] = c;
+    }
+  }
+}
+
+// Compositor layer: solid background
+void appleRingsBackgroundLayer(const StripTarget& strip) {
+  stripFillRect(strip, strip.x0, strip.y0, strip.x1 - strip.x0, strip.lines, APPLE_RINGS_BG);
+}
+
+// Compositor layer: the dark ring tracks (static face)
+void appleRingsTrackLayer(const StripTarget& strip) {
+  stripDrawRing(strip, HOURS_RING_RADIUS, 360, APPLE_BLUE_BG);
+  stripDrawRing(strip, MINUTES_RING_RADIUS, 360, APPLE_GREEN_BG);
+  stripDrawRing(strip, SECONDS_RING_RADIUS, 360, APPLE_RED_BG);
+}
+
+// Compositor layer: ring progress and the digital time in the center
+void appleRingsProgressLayer(const StripTarget& strip) {
+  stripDrawRing(strip, HOURS_RING_RADIUS, ringSweepHours, APPLE_BLUE);
+  stripDrawRing(strip, MINUTES_RING_RADIUS, ringSweepMinutes, APPLE_GREEN);
+  stripDrawRing(strip, SECONDS_RING_RADIUS, ringSweepSeconds, APPLE_RED);
+
+  char timeStr[10];
+  char secStr[3];
+  int displayHours = is24Hour ? hours : (hours > 12 ? hours - 12 : (hours == 0 ? 12 : hours));
+  sprintf(timeStr, "%02d:%02d", displayHours, minutes);
+  sprintf(secStr, "%02d", seconds);
+
+  stripDrawText(strip, screenCenterX - 6, screenCenterY - 22, secStr, 1, TFT_WHITE, APPLE_RINGS_BG, false);
+  stripDrawText(strip, screenCenterX - 30, screenCenterY - 8, timeStr, 2, TFT_WHITE, APPLE_RINGS_BG, false);
+  if (!is24Hour) {
+    stripDrawText(strip, screenCenterX - 6, screenCenterY + 16, (hours >= 12 ? "PM" : "AM"), 1, TFT_WHITE, APPLE_RINGS_BG, false);
+  }
+}
+
+// Mark the part of a ring between two sweeps as dirty
+void invalidateRingSweep(int radius, float fromSweep, float toSweep) {
+  int x, y, w, h;
+  ringSweepBounds(radius, fromSweep, toSweep, RING_THICKNESS / 2 + 2, &x, &y, &w, &h);
+  compositorInvalidate(x, y, w, h);
+}
+
+// Compositor version of the ring update - only changed arcs are recomposed
+void composeAppleRings(bool fullRedraw) {
+  compositorSetLayer(LAYER_BACKGROUND, appleRingsBackgroundLayer);
+  compositorSetLayer(LAYER_FACE, appleRingsTrackLayer);
+  compositorSetLayer(LAYER_WIDGETS, appleRingsProgressLayer);
+
+  float hoursSweep, minutesSweep, secondsSweep;
+  calculateRingSweeps(&hoursSweep, &minutesSweep, &secondsSweep);
+
+  if (fullRedraw) {
+    compositorInvalidateAll();
+  } else {
+    if (hoursSweep != ringSweepHours) invalidateRingSweep(HOURS_RING_RADIUS, ringSweepHours, hoursSweep);
+    if (minutesSweep != ringSweepMinutes) invalidateRingSweep(MINUTES_RING_RADIUS, ringSweepMinutes, minutesSweep);
+    if (secondsSweep != ringSweepSeconds) invalidateRingSweep(SECONDS_RING_RADIUS, ringSweepSeconds, secondsSweep);
+
+    // Digital time in the center
+    compositorInvalidate(screenCenterX - 30, screenCenterY - 22, 60, 46);
+  }
+
+  ringSweepHours = hoursSweep;
+  ringSweepMinutes = minutesSweep;
+  ringSweepSeconds = secondsSweep;
+
+  prevRingHours = hours;
+  prevRingMinutes = minutes;
+  prevRingSeconds = seconds;
+
+  compositorRender();
 }
 
 // Force correct display of all rings - improved initialization
 void forceCorrectRingDisplay() {
+  unsigned long drawStart = micros();
+
+  if (compositorActive()) {
+    composeAppleRings(true);
+    fullRedrawDone = true;
+    LOG_INFO("Apple Rings full draw: %lu us (%s, compositor)", micros() - drawStart, ringsUseAA() ? "anti-aliased" : "aliased");
+    return;
+  }
+
   // Force all rings to update on first display
   prevRingHours = -1;
   prevRingMinutes = -1;
   prevRingSeconds = -1;
   
   // Clear the screen
-  tft.fillScreen(APPLE_RINGS_BG);
+  tft->fillScreen(APPLE_RINGS_BG);
   
   // Draw background rings only
   drawRing(screenCenterX, screenCenterY, HOURS_RING_RADIUS, RING_THICKNESS, 
-           0, 360, APPLE_BLUE_BG);
+           0, 360, APPLE_BLUE_BG, false);
   drawRing(screenCenterX, screenCenterY, MINUTES_RING_RADIUS, RING_THICKNESS, 
-           0, 360, APPLE_GREEN_BG);
+           0, 360, APPLE_GREEN_BG, false);
   drawRing(screenCenterX, screenCenterY, SECONDS_RING_RADIUS, RING_THICKNESS, 
-           0, 360, APPLE_RED_BG);
+           0, 360, APPLE_RED_BG, false);
   
   // Mark full redraw as done
   fullRedrawDone = true;
@@ -175,23 +570,26 @@ void forceCorrectRingDisplay() {
   if (displayHours > 0) {
     float endAngle = -90 + (displayHours * hourDegrees);
     drawRing(screenCenterX, screenCenterY, HOURS_RING_RADIUS, RING_THICKNESS, 
-             -90, endAngle, APPLE_BLUE);
+             -90, endAngle, APPLE_BLUE, true);
   }
   
   // Minutes ring
   if (minutes > 0) {
     float minuteAngle = -90 + (minutes * 6.0);
     drawRing(screenCenterX, screenCenterY, MINUTES_RING_RADIUS, RING_THICKNESS, 
-             -90, minuteAngle, APPLE_GREEN);
+             -90, minuteAngle, APPLE_GREEN, true);
   }
   
   // Seconds ring
   if (seconds > 0) {
     float secondAngle = -90 + (seconds * 6.0);
     drawRing(screenCenterX, screenCenterY, SECONDS_RING_RADIUS, RING_THICKNESS, 
-             -90, secondAngle, APPLE_RED);
+             -90, secondAngle, APPLE_RED, true);
   }
   
+  // Send all queued ring geometry before the direct text drawing
+  flushDrawQueue();
+
   // Draw digital time
   drawTimeDigits();
   
@@ -199,6 +597,8 @@ void forceCorrectRingDisplay() {
   prevRingHours = hours;
   prevRingMinutes = minutes;
   prevRingSeconds = seconds;
+
+  LOG_INFO("Apple Rings full draw: %lu us (%s)", micros() - drawStart, ringsUseAA() ? "anti-aliased" : "aliased");
 }
 
 // Draw the Apple Rings interface - full initialization
@@ -209,8 +609,8 @@ void drawAppleRingsInterface() {
 
 // Draw digital time in the center - improved spacing
 void drawTimeDigits() {
-  // Clear the center area completely
-  tft.fillCircle(screenCenterX, screenCenterY, HOURS_RING_RADIUS - RING_THICKNESS/2, APPLE_RINGS_BG);
+  // Clear the center area, leaving the blended inner edge of the hours ring alone
+  tft->fillCircle(screenCenterX, screenCenterY, HOURS_RING_RADIUS - RING_THICKNESS/2 - 1, APPLE_RINGS_BG);
   
   // Display current time in digital format
   char timeStr[10];
@@ -226,22 +626,22 @@ void drawTimeDigits() {
   sprintf(ampmStr, "%s", (hours >= 12 ? "PM" : "AM"));
   
   // Draw seconds on top with more space
-  tft.setTextSize(1);
-  tft.setTextColor(TFT_WHITE);
-  tft.setCursor(screenCenterX - 6, screenCenterY - 22);
-  tft.print(secStr);
+  tft->setTextSize(1);
+  tft->setTextColor(TFT_WHITE);
+  tft->setCursor(screenCenterX - 6, screenCenterY - 22);
+  tft->print(secStr);
   
   // Draw hours:minutes in center with better spacing
-  tft.setTextSize(2);
+  tft->setTextSize(2);
   // Fix: Move text position to prevent overlap
-  tft.setCursor(screenCenterX - 30, screenCenterY - 8);
-  tft.print(timeStr);
+  tft->setCursor(screenCenterX - 30, screenCenterY - 8);
+  tft->print(timeStr);
   
   // Draw AM/PM at bottom with more space
   if (!is24Hour) {
-    tft.setTextSize(1);
-    tft.setCursor(screenCenterX - 6, screenCenterY + 16);
-    tft.print(ampmStr);
+    tft->setTextSize(1);
+    tft->setCursor(screenCenterX - 6, screenCenterY + 16);
+    tft->print(ampmStr);
   }
 }
 
@@ -262,6 +662,13 @@ void updateAppleRingsTime() {
   bool hoursChanged = (hours != prevRingHours);
   bool minutesChanged = (minutes != prevRingMinutes);
   bool secondsChanged = (seconds != prevRingSeconds);
+
+  if (compositorActive()) {
+    if (hoursChanged || minutesChanged || secondsChanged) {
+      composeAppleRings(false);
+    }
+    return;
+  }
   
   // Update hours ring (innermost) - COMPLETELY FIXED
   if (hoursChanged) {
@@ -281,11 +688,11 @@ void updateAppleRingsTime() {
   if (hours == 0 && (prevRingHours == 23 || prevRingHours == 11)) {
     // At midnight, clear everything to background color first
     drawRing(screenCenterX, screenCenterY, HOURS_RING_RADIUS, RING_THICKNESS + 2, 
-             0, 360, APPLE_RINGS_BG);
+             0, 360, APPLE_RINGS_BG, false);
              
     // Then draw ONLY the background - keep foreground transparent
     drawRing(screenCenterX, screenCenterY, HOURS_RING_RADIUS, RING_THICKNESS, 
-             0, 360, APPLE_BLUE_BG);
+             0, 360, APPLE_BLUE_BG, false);
              
     // DO NOT draw any foreground at hour 0 (midnight)
   }
@@ -294,12 +701,12 @@ void updateAppleRingsTime() {
     // Clear with background color for clean redraw if needed
     if (prevRingHours == -1) {
       drawRing(screenCenterX, screenCenterY, HOURS_RING_RADIUS, RING_THICKNESS + 2, 
-               0, 360, APPLE_RINGS_BG);
+               0, 360, APPLE_RINGS_BG, false);
     }
     
     // Draw background ring
     drawRing(screenCenterX, screenCenterY, HOURS_RING_RADIUS, RING_THICKNESS, 
-             0, 360, APPLE_BLUE_BG);
+             0, 360, APPLE_BLUE_BG, false);
     
     // Calculate end angle based on hours (start from 12 o'clock position)
     float endAngle = -90 + (displayHours * hourDegrees);
@@ -308,11 +715,11 @@ void updateAppleRingsTime() {
     if (displayHours > 0) {
       // Normal hour value - draw progress
       drawRing(screenCenterX, screenCenterY, HOURS_RING_RADIUS, RING_THICKNESS, 
-               -90, endAngle, APPLE_BLUE);
+               -90, endAngle, APPLE_BLUE, true);
     } else if (!is24Hour && displayHours == 12) {
       // Noon in 12-hour mode - draw full circle
       drawRing(screenCenterX, screenCenterY, HOURS_RING_RADIUS, RING_THICKNESS, 
-               -90, 270, APPLE_BLUE);
+               -90, 270, APPLE_BLUE, true);
     }
   }
   
@@ -331,11 +738,11 @@ void updateAppleRingsTime() {
     if (minuteReset) {
       // First clear with background color (slightly wider)
       drawRing(screenCenterX, screenCenterY, MINUTES_RING_RADIUS, RING_THICKNESS + 2, 
-               0, 360, APPLE_RINGS_BG);
+               0, 360, APPLE_RINGS_BG, false);
                
       // Then redraw the proper background
       drawRing(screenCenterX, screenCenterY, MINUTES_RING_RADIUS, RING_THICKNESS, 
-               0, 360, APPLE_GREEN_BG);
+               0, 360, APPLE_GREEN_BG, false);
                
       // Don't draw any foreground for minute 0 - this prevents artifacts
       // The minute hand will start drawing again at minute 1
@@ -343,13 +750,13 @@ void updateAppleRingsTime() {
       // Handle unusual case (time adjustment)
       // Clear and redraw background
       drawRing(screenCenterX, screenCenterY, MINUTES_RING_RADIUS, RING_THICKNESS, 
-               0, 360, APPLE_GREEN_BG);
+               0, 360, APPLE_GREEN_BG, false);
                
       // Draw proper segment for current minutes
       if (minutes > 0) {
         float endAngle = -90 + (minutes * minuteDegrees);
         drawRing(screenCenterX, screenCenterY, MINUTES_RING_RADIUS, RING_THICKNESS, 
-                 -90, endAngle, APPLE_GREEN);
+                 -90, endAngle, APPLE_GREEN, true);
       }
     } else {
       // Normal minute progression
@@ -358,14 +765,14 @@ void updateAppleRingsTime() {
       
       // Draw the proper segment for current minutes
       drawRing(screenCenterX, screenCenterY, MINUTES_RING_RADIUS, RING_THICKNESS, 
-               -90, endAngle, APPLE_GREEN);
+               -90, endAngle, APPLE_GREEN, true);
     }
     
     prevRingMinutes = minutes;
   }
   
   // Update seconds ring (outermost) - ENHANCED FIX FOR ARTIFACTS AND FLICKERING
-  if (secondsChanged) {
+  if (secondsChanged && governorAllowsSweep()) {
     // Each second = 6 degrees (360/60)
     float secondDegrees = 6.0;
     
@@ -374,11 +781,11 @@ void updateAppleRingsTime() {
       // Clear the entire screen area for the seconds ring with the background color
       // Use a slightly larger width to ensure all artifacts are removed
       drawRing(screenCenterX, screenCenterY, SECONDS_RING_RADIUS, RING_THICKNESS + 2, 
-               0, 360, APPLE_RINGS_BG);
+               0, 360, APPLE_RINGS_BG, false);
                
       // Then redraw the proper background
       drawRing(screenCenterX, screenCenterY, SECONDS_RING_RADIUS, RING_THICKNESS, 
-               0, 360, APPLE_RED_BG);
+               0, 360, APPLE_RED_BG, false);
                
       // Don't draw any foreground for second 0 - this prevents artifacts
       // The second hand will start drawing again at second 1
@@ -387,13 +794,13 @@ void updateAppleRingsTime() {
       // First draw case (initialization)
       // Draw the background ring
       drawRing(screenCenterX, screenCenterY, SECONDS_RING_RADIUS, RING_THICKNESS, 
-               0, 360, APPLE_RED_BG);
+               0, 360, APPLE_RED_BG, false);
                
       // Draw the initial arc
       if (seconds > 0) {
         float endAngle = -90 + (seconds * secondDegrees);
         drawRing(screenCenterX, screenCenterY, SECONDS_RING_RADIUS, RING_THICKNESS, 
-                 -90, endAngle, APPLE_RED);
+                 -90, endAngle, APPLE_RED, true);
       }
     } else {
       // Normal update for seconds 1-59
@@ -403,13 +810,13 @@ void updateAppleRingsTime() {
       // If seconds decreased (unusual case like time adjustment), redraw background
       if (seconds < prevRingSeconds) {
         drawRing(screenCenterX, screenCenterY, SECONDS_RING_RADIUS, RING_THICKNESS, 
-                 0, 360, APPLE_RED_BG);
+                 0, 360, APPLE_RED_BG, false);
       }
       
       // Draw just the new segment(s)
       if (seconds > 0) {
         drawRing(screenCenterX, screenCenterY, SECONDS_RING_RADIUS, RING_THICKNESS, 
-                 -90, endAngle, APPLE_RED);
+                 -90, endAngle, APPLE_RED, true);
       }
     }
     
@@ -417,6 +824,9 @@ void updateAppleRingsTime() {
     prevRingSeconds = seconds;
   }
   
+  // Send all queued ring geometry in one transaction
+  flushDrawQueue();
+
   // Update the digital time display if any time component changed
   if (hoursChanged || minutesChanged || secondsChanged) {
     updateTimeDigits();
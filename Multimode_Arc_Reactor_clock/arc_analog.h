@@ -11,8 +11,8 @@
 #include <TFT_eSPI.h>
 #include "utils.h"
 #include "led_controls.h"
+#include "draw_queue.h"
 
-extern bool needClockRefresh;
 
 // Track previous hand positions for clean updates
 int prevMinuteX = -1, prevMinuteY = -1;
@@ -49,6 +49,7 @@ void initAnalogClock() {
 
   // Draw the clock face (hour markers)
   drawClockFace();
+  flushDrawQueue();
 }
 
 // Draw the static clock face elements (hour markers)
@@ -59,7 +60,7 @@ void drawClockFace() {
     int x = screenCenterX + sin(angle) * (screenRadius * 0.95);  // Use 0.95 to push closer to edge
     int y = screenCenterY - cos(angle) * (screenRadius * 0.95);
 
-    tft.fillCircle(x, y, 3, HOUR_MARKER_COLOR);
+    queueFillCircle(x, y, 3, HOUR_MARKER_COLOR);
   }
 }
 
@@ -83,8 +84,8 @@ void drawSecondsArc(int x, int y, int start_angle, int end_angle, int r, int thi
   int y3 = y + sin(end_rad) * (r - thickness);
 
   // Draw the filled segment as two triangles
-  tft.fillTriangle(x0, y0, x1, y1, x2, y2, color);
-  tft.fillTriangle(x0, y0, x2, y2, x3, y3, color);
+  queueFillTriangle(x0, y0, x1, y1, x2, y2, color);
+  queueFillTriangle(x0, y0, x2, y2, x3, y3, color);
 }
 
 // Draw full analog clock (background is drawn separately)
@@ -104,7 +105,7 @@ void drawAnalogClock() {
   float hourRad = hourAngle * DEG_TO_RAD;
   int hourX = screenCenterX + sin(hourRad) * hourHandLength;
   int hourY = screenCenterY - cos(hourRad) * hourHandLength;
-  tft.drawLine(screenCenterX, screenCenterY, hourX, hourY, HOUR_HAND_COLOR);
+  queueDrawLine(screenCenterX, screenCenterY, hourX, hourY, HOUR_HAND_COLOR);
 
   // Save current hour hand position
   prevHourX = hourX;
@@ -115,7 +116,7 @@ void drawAnalogClock() {
   float minuteRad = minuteAngle * DEG_TO_RAD;
   int minuteX = screenCenterX + sin(minuteRad) * minuteHandLength;
   int minuteY = screenCenterY - cos(minuteRad) * minuteHandLength;
-  tft.drawLine(screenCenterX, screenCenterY, minuteX, minuteY, MINUTE_HAND_COLOR);
+  queueDrawLine(screenCenterX, screenCenterY, minuteX, minuteY, MINUTE_HAND_COLOR);
 
   // Save current minute hand position
   prevMinuteX = minuteX;
@@ -136,7 +137,8 @@ void drawAnalogClock() {
   prevSecond = seconds;
 
   // Draw center dot
-  tft.fillCircle(screenCenterX, screenCenterY, 5, CENTER_DOT_COLOR);
+  queueFillCircle(screenCenterX, screenCenterY, 5, CENTER_DOT_COLOR);
+  flushDrawQueue();
 }
 
 // Update analog clock - using incremental updates to reduce flicker
@@ -152,7 +154,7 @@ void updateAnalogClock() {
   // Check for periodic full refresh (every 15 minutes)
   if (seconds == 0 && minutes % 5 == 0) {
     // Signal for a full refresh - we'll use a global variable
-    needClockRefresh = true;
+    clockRequestRefresh();
     return;
   }
 
@@ -163,7 +165,7 @@ void updateAnalogClock() {
   if (seconds != prevSecond) {
     // Check for 15-minute mark to trigger full refresh
     if (seconds == 0 && minutes % 15 == 0) {
-      needClockRefresh = true;
+      clockRequestRefresh();
       prevSecond = seconds;
       return;  // Skip the rest of the update
     }
@@ -176,24 +178,14 @@ void updateAnalogClock() {
         drawSecondsArc(screenCenterX, screenCenterY, startAngle, endAngle, RING_RADIUS, RING_THICKNESS, TFT_BLACK);
       }
 
-      // Clean the minute hand with thicker lines
+      // Clean the minute hand with a thick erase line
       if (prevMinuteX != -1 && prevMinuteY != -1) {
-        for (int i = -2; i <= 2; i++) {
-          for (int j = -2; j <= 2; j++) {
-            tft.drawLine(screenCenterX + i, screenCenterY + j,
-                         prevMinuteX + i, prevMinuteY + j, TFT_BLACK);
-          }
-        }
+        queueThickLine(screenCenterX, screenCenterY, prevMinuteX, prevMinuteY, 2, TFT_BLACK);
       }
 
-      // Clean the hour hand with thicker lines
+      // Clean the hour hand with a thick erase line
       if (prevHourX != -1 && prevHourY != -1) {
-        for (int i = -2; i <= 2; i++) {
-          for (int j = -2; j <= 2; j++) {
-            tft.drawLine(screenCenterX + i, screenCenterY + j,
-                         prevHourX + i, prevHourY + j, TFT_BLACK);
-          }
-        }
+        queueThickLine(screenCenterX, screenCenterY, prevHourX, prevHourY, 2, TFT_BLACK);
       }
 
       // Redraw the clock face elements that might have been affected
@@ -209,19 +201,19 @@ void updateAnalogClock() {
       int minuteY = screenCenterY - cos(minuteRad) * minuteHandLength;
 
       // Draw hour hand
-      tft.drawLine(screenCenterX, screenCenterY, hourX, hourY, HOUR_HAND_COLOR);
+      queueDrawLine(screenCenterX, screenCenterY, hourX, hourY, HOUR_HAND_COLOR);
       prevHourX = hourX;
       prevHourY = hourY;
       prevHourAngle = hourAngle;
 
       // Draw minute hand
-      tft.drawLine(screenCenterX, screenCenterY, minuteX, minuteY, MINUTE_HAND_COLOR);
+      queueDrawLine(screenCenterX, screenCenterY, minuteX, minuteY, MINUTE_HAND_COLOR);
       prevMinuteX = minuteX;
       prevMinuteY = minuteY;
       prevMinuteAngle = minuteAngle;
 
       // Draw center dot
-      tft.fillCircle(screenCenterX, screenCenterY, 5, CENTER_DOT_COLOR);
+      queueFillCircle(screenCenterX, screenCenterY, 5, CENTER_DOT_COLOR);
     } else {
       // Normal case: just add one segment
       int startAngle = 270 + (seconds * 6) - 6;  // Previous second position
@@ -238,13 +230,8 @@ void updateAnalogClock() {
   if (minuteAngle != prevMinuteAngle) {
     // Draw over the old minute hand with black
     if (prevMinuteX != -1 && prevMinuteY != -1) {
-      // Draw a thicker black line to cover the old minute hand
-      for (int i = -2; i <= 2; i++) {
-        for (int j = -2; j <= 2; j++) {
-          tft.drawLine(screenCenterX + i, screenCenterY + j,
-                       prevMinuteX + i, prevMinuteY + j, TFT_BLACK);
-        }
-      }
+      // One thick erase instead of 25 offset lines
+      queueThickLine(screenCenterX, screenCenterY, prevMinuteX, prevMinuteY, 2, TFT_BLACK);
     }
 
     // Calculate new minute hand position
@@ -253,7 +240,7 @@ void updateAnalogClock() {
     int minuteY = screenCenterY - cos(minuteRad) * minuteHandLength;
 
     // Draw the new minute hand
-    tft.drawLine(screenCenterX, screenCenterY, minuteX, minuteY, MINUTE_HAND_COLOR);
+    queueDrawLine(screenCenterX, screenCenterY, minuteX, minuteY, MINUTE_HAND_COLOR);
 
     // Save new position
     prevMinuteX = minuteX;
@@ -265,13 +252,8 @@ void updateAnalogClock() {
   if (hourAngle != prevHourAngle) {
     // Draw over the old hour hand with black
     if (prevHourX != -1 && prevHourY != -1) {
-      // Draw a thicker black line to cover the old hour hand
-      for (int i = -2; i <= 2; i++) {
-        for (int j = -2; j <= 2; j++) {
-          tft.drawLine(screenCenterX + i, screenCenterY + j,
-                       prevHourX + i, prevHourY + j, TFT_BLACK);
-        }
-      }
+      // One thick erase instead of 25 offset lines
+      queueThickLine(screenCenterX, screenCenterY, prevHourX, prevHourY, 2, TFT_BLACK);
     }
 
     // Calculate new hour hand position
@@ -280,7 +262,7 @@ void updateAnalogClock() {
     int hourY = screenCenterY - cos(hourRad) * hourHandLength;
 
     // Draw the new hour hand
-    tft.drawLine(screenCenterX, screenCenterY, hourX, hourY, HOUR_HAND_COLOR);
+    queueDrawLine(screenCenterX, screenCenterY, hourX, hourY, HOUR_HAND_COLOR);
 
     // Save new position
     prevHourX = hourX;
@@ -289,7 +271,10 @@ void updateAnalogClock() {
   }
 
   // Redraw center dot (it might get partially erased by the hand updates)
-  tft.fillCircle(screenCenterX, screenCenterY, 5, CENTER_DOT_COLOR);
+  queueFillCircle(screenCenterX, screenCenterY, 5, CENTER_DOT_COLOR);
+
+  // Send the whole update in one transaction
+  flushDrawQueue();
 }
 
 #endif  // ARC_ANALOG_H
@@ -7,11 +7,19 @@
 
 #include <Arduino.h>
 #include <TFT_eSPI.h>
-#include <SPIFFS.h>
+#include "storage.h"
 #include <FS.h>
 #include <TJpg_Decoder.h>
 #include "utils.h"
 #include "led_controls.h"
+#include "frame_buffer.h"
+#include "strip_compositor.h"
+#include "image_analysis.h"
+#include "ambient_color.h"
+#include "mem_alloc.h"
+#include "asset_partition.h"
+#include "asset_reader.h"
+#include "theme_pack.h"
 
 extern int CLOCK_VERTICAL_OFFSET;
 
@@ -26,24 +34,57 @@ const char* DEFAULT_BACKGROUND = "/00_ironman.jpg";
 #define CYAN_COLOR 0x07FF  // Cyan for text elements
 #define TEXT_BACKGROUND_COLOR 0x0001  // Nearly black but not solid
 
+// Digit colors - cyan on near-black unless automatic placement picks others
+uint16_t arcDigitColor = CYAN_COLOR;
+uint16_t arcDigitBackground = TEXT_BACKGROUND_COLOR;
+
+// Current text of each clock field, read by the compositor widget layer
+struct ArcDigitalWidgets {
+  char hours[3];
+  char minutes[3];
+  char seconds[3];
+  const char* ampm;
+};
+
+ArcDigitalWidgets arcWidgets = { "", "", "", "" };
+
 // Function prototypes
 void drawArcReactorBackground();
 void updateDigitalTime();
 void updateArcDigitalColon();
 void resetArcDigitalVariables();
 bool displayJPEGBackground(const char* filename);
+void arcDigitalWidgetLayer(const StripTarget& strip);
+void composeDigitalTime();
 
 // Callback function for the TJpg_Decoder
 bool tft_output(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap) {
   // This function will clip the image block rendering automatically at the TFT boundaries
-  tft.pushImage(x, y, w, h, bitmap);
+  framePushImage(x, y, w, h, bitmap);
+
+  // Keep a copy for the compositor's background layer (if it has one)
+  compositorCaptureBackground(x, y, w, h, bitmap);
+
+  // Band statistics for automatic clock placement, from the same pixels
+  analyzeImageBlock(x, y, w, h, bitmap);
+  ambientSampleBlock(x, y, w, h, bitmap);
   return 1;  // Return 1 to decode next block
 }
 
 // Display JPEG background - simplified version
 bool displayJPEGBackground(const char* filename) {
-  // Check if file exists
-  if (!SPIFFS.exists(filename)) {
+  // Packed assets are decoded straight from mapped flash
+  uint32_t assetSize = 0;
+  const uint8_t* asset = assetFind(filename, &assetSize);
+
+  // Theme files bring their image position along
+  const ThemeHeader* theme = themeLookup(filename);
+  int16_t imageX = theme ? theme->imageX : 0;
+  int16_t imageY = theme ? theme->imageY : 0;
+
+  // Check if file exists (the lookup is remembered for the next time)
+  int assetId = (asset == NULL) ? assetResolve(filename) : -1;
+  if (asset == NULL && assetId < 0) {
     return false;
   }
 
@@ -58,60 +99,50 @@ bool displayJPEGBackground(const char* filename) {
   // Set theme based on filename
   setThemeFromFilename(justFilename.c_str());
 
-  // Try direct decoding method first (most efficient)
-  bool decoded = TJpgDec.drawFsJpg(0, 0, filename);
-
-  if (decoded) {
-    return true;
-  }
-
-  // If direct method failed, try buffer method
-  bool success = false;
-  {
-    File jpegFile = SPIFFS.open(filename, "r");
-    if (!jpegFile) {
-      return false;
+  // Analyze the image while it is decoded (skipped if already known)
+  imageAnalysisBegin(justFilename.c_str());
+  ambientBegin(justFilename.c_str());
+
+  bool decoded = false;
+  if (asset != NULL) {
+    decoded = TJpgDec.drawJpg(0, 0, asset, assetSize) == JDR_OK;
+  } else if (theme != NULL) {
+    // Header already known - one contiguous read of the image
+    uint32_t imageSize = 0;
+    uint8_t* image = themeLoadImage(filename, &imageSize);
+    if (image != NULL) {
+      decoded = TJpgDec.drawJpg(imageX, imageY, image, imageSize) == JDR_OK;
+      memFree(image, MEM_PSRAM);
     }
-
-    // Get file size
-    size_t fileSize = jpegFile.size();
-    if (fileSize == 0) {
-      jpegFile.close();
-      return false;
+  } else {
+    // Read the file in whole blocks and decode from memory; stream it if
+    // there is no room for the buffer
+    int32_t fileSize = assetFileSize(assetId);
+    uint8_t* jpegBuffer = (fileSize > 0) ? (uint8_t*)memAlloc(fileSize, MEM_PSRAM) : NULL;
+
+    bool buffered = (jpegBuffer != NULL);
+    if (buffered) {
+      decoded = assetReadAll(assetId, jpegBuffer) && TJpgDec.drawJpg(0, 0, jpegBuffer, fileSize) == JDR_OK;
+      memFree(jpegBuffer, MEM_PSRAM);
     }
-
-    // Use a smart pointer approach with std::unique_ptr
-    uint8_t* jpegBuffer = nullptr;
-
-    // Allocate buffer for the JPEG
-    jpegBuffer = (uint8_t*)malloc(fileSize);
-    if (!jpegBuffer) {
-      jpegFile.close();
-      return false;
-    }
-
-    // Read file into buffer
-    size_t bytesRead = jpegFile.read(jpegBuffer, fileSize);
-    jpegFile.close();
-
-    if (bytesRead != fileSize) {
-      free(jpegBuffer);
-      return false;
+    if (!decoded && fileSize > 0) {
+      // Start the analysis over so a failed buffered pass does not count
+      if (buffered) {
+        imageAnalysisBegin(justFilename.c_str());
+        ambientBegin(justFilename.c_str());
+      }
+      decoded = TJpgDec.drawFsJpg(0, 0, filename, clockFS()) == JDR_OK;
     }
-
-    // Try to decode from buffer
-    success = TJpgDec.drawJpg(0, 0, jpegBuffer, fileSize);
-
-    // Free buffer regardless of success/failure
-    free(jpegBuffer);
   }
 
-  return success;
+  imageAnalysisFinish(justFilename.c_str(), decoded);
+  ambientFinish(justFilename.c_str(), decoded);
+  return decoded;
 }
 
 void drawArcReactorBackground() {
   // Clear the display
-  tft.fillScreen(TFT_BLACK);
+  tft->fillScreen(TFT_BLACK);
 
   // Try to load JPEG background using the constant
   displayJPEGBackground(DEFAULT_BACKGROUND);
@@ -126,8 +157,74 @@ void resetArcDigitalVariables() {
   showColon = true;
 }
 
+// Compositor widget layer - the clock fields over the background
+void arcDigitalWidgetLayer(const StripTarget& strip) {
+  int offsetY = screenCenterY + CLOCK_VERTICAL_OFFSET;
+
+  // Hidden colon leaves a solid block under the digits
+  if (!showColon) {
+    stripFillRect(strip, screenCenterX - 15, offsetY - 25, 25, 45, arcDigitBackground);
+  }
+
+  stripDrawText(strip, screenCenterX - 10, offsetY - 40, arcWidgets.seconds, 2, arcDigitColor, arcDigitBackground, true);
+  stripDrawText(strip, screenCenterX - 58, offsetY - 20, arcWidgets.hours, 4, arcDigitColor, arcDigitBackground, true);
+  if (showColon) {
+    stripDrawText(strip, screenCenterX - 10, offsetY - 20, ":", 4, arcDigitColor, arcDigitBackground, true);
+  }
+  stripDrawText(strip, screenCenterX + 15, offsetY - 20, arcWidgets.minutes, 4, arcDigitColor, arcDigitBackground, true);
+
+  if (!is24Hour) {
+    stripDrawText(strip, screenCenterX - 10, offsetY + 20, arcWidgets.ampm, 2, arcDigitColor, arcDigitBackground, true);
+  }
+}
+
+// Compositor version of updateDigitalTime() - update fields and mark them dirty
+void composeDigitalTime() {
+  compositorSetLayer(LAYER_BACKGROUND, backgroundLayer);
+  compositorSetLayer(LAYER_WIDGETS, arcDigitalWidgetLayer);
+
+  int offsetY = screenCenterY + CLOCK_VERTICAL_OFFSET;
+
+  if (seconds != prevSeconds) {
+    sprintf(arcWidgets.seconds, "%02d", seconds);
+    compositorInvalidate(screenCenterX - 10, offsetY - 40, 24, 16);
+  }
+
+  if (hours != prevHours) {
+    int displayHours = is24Hour ? hours : (hours > 12 ? hours - 12 : (hours == 0 ? 12 : hours));
+    sprintf(arcWidgets.hours, "%02d", displayHours);
+    compositorInvalidate(screenCenterX - 58, offsetY - 20, 48, 32);
+
+    arcWidgets.ampm = (hours >= 12) ? "PM" : "AM";
+    compositorInvalidate(screenCenterX - 10, offsetY + 20, 24, 16);
+  }
+
+  if (minutes != prevMinutes) {
+    sprintf(arcWidgets.minutes, "%02d", minutes);
+    compositorInvalidate(screenCenterX + 15, offsetY - 20, 48, 32);
+  }
+
+  if (showColon != prevColonState) {
+    // Covers both the colon glyph and the block shown while it is hidden
+    compositorInvalidate(screenCenterX - 15, offsetY - 25, 25, 45);
+  }
+
+  prevHours = hours;
+  prevMinutes = minutes;
+  prevSeconds = seconds;
+  prevColonState = showColon;
+
+  compositorRender();
+}
+
 // Update digital time display - partial updates to improve performance
 void updateDigitalTime() {
+  // Without a captured background the compositor would paint over the JPEG
+  if (compositorActive() && compositorHasBackground()) {
+    composeDigitalTime();
+    return;
+  }
+
   // Only update parts that have changed
   bool hoursChanged = (hours != prevHours);
   bool minutesChanged = (minutes != prevMinutes);
@@ -137,7 +234,7 @@ void updateDigitalTime() {
   // Only update the display if the time or colon state has changed
   if (hoursChanged || minutesChanged || secondsChanged || colonChanged) {
     // Create backgrounds for text that preserve most of the underlying image
-    tft.setTextColor(CYAN_COLOR, TEXT_BACKGROUND_COLOR);
+    tft->setTextColor(arcDigitColor, arcDigitBackground);
 
     // Handle seconds update - at the top for symmetry
     if (seconds != prevSeconds) {
@@ -146,9 +243,9 @@ void updateDigitalTime() {
       sprintf(timeStr, seconds < 10 ? "0%d" : "%d", seconds);
 
       // Draw seconds with semi-transparent background
-      tft.setTextSize(2);
-      tft.setCursor(screenCenterX - 10, screenCenterY - 40 + CLOCK_VERTICAL_OFFSET);
-      tft.print(timeStr);
+      tft->setTextSize(2);
+      tft->setCursor(screenCenterX - 10, screenCenterY - 40 + CLOCK_VERTICAL_OFFSET);
+      tft->print(timeStr);
     }
 
     // Handle hours update
@@ -159,9 +256,9 @@ void updateDigitalTime() {
       sprintf(timeStr, displayHours < 10 ? "0%d" : "%d", displayHours);
 
       // Draw hours text with semi-transparent background
-      tft.setTextSize(4);
-      tft.setCursor(screenCenterX - 58, screenCenterY - 20 + CLOCK_VERTICAL_OFFSET);
-      tft.print(timeStr);
+      tft->setTextSize(4);
+      tft->setCursor(screenCenterX - 58, screenCenterY - 20 + CLOCK_VERTICAL_OFFSET);
+      tft->print(timeStr);
     }
 
     // Handle colon update (only if colon state changed)
@@ -174,12 +271,12 @@ void updateDigitalTime() {
 
       // Either draw the colon or clear its area by redrawing background
       if (showColon) {
-        tft.setTextSize(4);
-        tft.setCursor(screenCenterX - 10, screenCenterY - 20 + CLOCK_VERTICAL_OFFSET);
-        tft.print(":");
+        tft->setTextSize(4);
+        tft->setCursor(screenCenterX - 10, screenCenterY - 20 + CLOCK_VERTICAL_OFFSET);
+        tft->print(":");
       } else {
         // When colon needs to be hidden, draw a small rect with the background color
-        tft.fillRect(colonX, colonY, colonWidth, colonHeight, TEXT_BACKGROUND_COLOR);
+        tft->fillRect(colonX, colonY, colonWidth, colonHeight, arcDigitBackground);
       }
     }
 
@@ -190,9 +287,9 @@ void updateDigitalTime() {
       sprintf(timeStr, minutes < 10 ? "0%d" : "%d", minutes);
 
       // Draw minutes text with semi-transparent background - apply vertical offset
-      tft.setTextSize(4);
-      tft.setCursor(screenCenterX + 15, screenCenterY - 20 + CLOCK_VERTICAL_OFFSET);
-      tft.print(timeStr);
+      tft->setTextSize(4);
+      tft->setCursor(screenCenterX + 15, screenCenterY - 20 + CLOCK_VERTICAL_OFFSET);
+      tft->print(timeStr);
     }
 
     // Handle AM/PM indicator (only in 12-hour mode and if hour changed)
@@ -208,9 +305,9 @@ void updateDigitalTime() {
       }
 
       // Draw AM/PM indicator with semi-transparent background - apply vertical offset
-      tft.setTextSize(2);
-      tft.setCursor(screenCenterX - 10, screenCenterY + 20 + CLOCK_VERTICAL_OFFSET);
-      tft.println(isPM ? "PM" : "AM");
+      tft->setTextSize(2);
+      tft->setCursor(screenCenterX - 10, screenCenterY + 20 + CLOCK_VERTICAL_OFFSET);
+      tft->println(isPM ? "PM" : "AM");
     }
 
     // Save current state for next comparison
@@ -228,7 +325,9 @@ void updateArcDigitalColon() {
   showColon = !showColon;
 
   // Only call update if colon state changed
-  if (oldColonState != showColon) {
+  if (oldColonState != showColon && compositorActive() && compositorHasBackground()) {
+    composeDigitalTime();
+  } else if (oldColonState != showColon) {
     // Position for colon - apply vertical offset
     int colonX = screenCenterX - 15;
     int colonY = screenCenterY - 25 + CLOCK_VERTICAL_OFFSET;
@@ -237,13 +336,13 @@ void updateArcDigitalColon() {
 
     if (showColon) {
       // Draw colon with semi-transparent background
-      tft.setTextColor(CYAN_COLOR, TEXT_BACKGROUND_COLOR);
-      tft.setTextSize(4);
-      tft.setCursor(screenCenterX - 10, screenCenterY - 20 + CLOCK_VERTICAL_OFFSET);
-      tft.print(":");
+      tft->setTextColor(arcDigitColor, arcDigitBackground);
+      tft->setTextSize(4);
+      tft->setCursor(screenCenterX - 10, screenCenterY - 20 + CLOCK_VERTICAL_OFFSET);
+      tft->print(":");
     } else {
       // Clear the colon with background color
-      tft.fillRect(colonX, colonY, colonWidth, colonHeight, TEXT_BACKGROUND_COLOR);
+      tft->fillRect(colonX, colonY, colonWidth, colonHeight, arcDigitBackground);
     }
 
     // Update the state tracking
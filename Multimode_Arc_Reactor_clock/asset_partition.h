@@ -0,0 +1,186 @@
+/*
+ * asset_partition.h - Memory-mapped raw asset partition
+ * For Multi-Mode Digital Clock project
+ * tools/pack_assets.py packs the backgrounds into one image with a fixed
+ * directory at the start and every blob aligned. The image is flashed to
+ * the "assets" partition (tools/partitions_assets.csv), which is mapped
+ * into the address space once, so the JPEG and GIF decoders read straight
+ * from flash with no file system calls and no copy in RAM.
+ * Off the ESP32 the same image file is mapped with mmap() instead.
+ */
+
+#ifndef ASSET_PARTITION_H
+#define ASSET_PARTITION_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "utils.h"
+#include "log_buffer.h"
+
+#ifndef USE_ASSET_PARTITION
+#define USE_ASSET_PARTITION 0
+#endif
+
+#if USE_ASSET_PARTITION
+#ifdef ESP_PLATFORM
+#include <esp_partition.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#endif
+
+// Image layout - must match tools/pack_assets.py
+#define ASSET_PARTITION_NAME "assets"
+#define ASSET_HOST_IMAGE "assets.bin"  // Host builds: image file to map
+#define ASSET_MAGIC 0x4B505341         // "ASPK"
+#define ASSET_VERSION 1
+#define ASSET_NAME_LENGTH 36
+#define ASSET_ALIGN 32  // Blobs start on a flash cache line
+
+// Directory header, followed by 'count' entries
+struct AssetHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t imageSize;  // Header, directory and blobs
+  uint32_t reserved;
+};
+
+struct AssetEntry {
+  char name[ASSET_NAME_LENGTH];  // Without leading '/', NUL padded
+  uint32_t offset;               // From the start of the image
+  uint32_t size;
+  uint32_t nameHash;  // FNV-1a of name
+};
+
+const uint8_t* assetBase = NULL;
+const AssetHeader* assetHeader = NULL;
+const AssetEntry* assetDirectory = NULL;
+
+#if USE_ASSET_PARTITION && defined(ESP_PLATFORM)
+spi_flash_mmap_handle_t assetMapHandle;
+#endif
+
+// Function prototypes
+bool assetPartitionBegin();
+bool assetPartitionActive();
+int assetCount();
+const char* assetName(int index);
+const uint8_t* assetFind(const char* filename, uint32_t* size);
+
+// FNV-1a of an asset name, ignoring a leading '/'
+uint32_t assetNameHash(const char* name) {
+  if (*name == '/') name++;
+  uint32_t hash = FNV1A_OFFSET_BASIS;
+  while (*name) {
+    hash = (hash ^ (uint8_t)*name++) * FNV1A_PRIME;
+  }
+  return hash;
+}
+
+// Map the image and check its directory - call once at startup
+bool assetPartitionBegin() {
+#if USE_ASSET_PARTITION
+  size_t mappedSize = 0;
+
+#ifdef ESP_PLATFORM
+  const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, ASSET_PARTITION_NAME);
+  if (partition == NULL) {
+    LOG_WARN("No '%s' partition - backgrounds come from files", ASSET_PARTITION_NAME);
+    return false;
+  }
+
+  const void* mapped = NULL;
+  if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mapped, &assetMapHandle) != ESP_OK) {
+    LOG_ERROR("Mapping the asset partition failed");
+    return false;
+  }
+  mappedSize = partition->size;
+#else
+  int fd = open(ASSET_HOST_IMAGE, O_RDONLY);
+  if (fd < 0) {
+    LOG_WARN("No %s - backgrounds come from the file system", ASSET_HOST_IMAGE);
+    return false;
+  }
+
+  struct stat info;
+  void* mapped = (fstat(fd, &info) == 0) ? mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    LOG_ERROR("Mapping %s failed", ASSET_HOST_IMAGE);
+    return false;
+  }
+  mappedSize = info.st_size;
+#endif
+
+  // An erased or stale partition is simply ignored
+  const AssetHeader* header = (const AssetHeader*)mapped;
+  if (mappedSize < sizeof(AssetHeader) || header->magic != ASSET_MAGIC || header->version != ASSET_VERSION ||
+      header->imageSize > mappedSize ||
+      sizeof(AssetHeader) + (size_t)header->count * sizeof(AssetEntry) > header->imageSize) {
+    LOG_WARN("Asset partition holds no valid image");
+#ifdef ESP_PLATFORM
+    spi_flash_munmap(assetMapHandle);
+#else
+    munmap(mapped, mappedSize);
+#endif
+    return false;
+  }
+
+  assetBase = (const uint8_t*)mapped;
+  assetHeader = header;
+  assetDirectory = (const AssetEntry*)(assetBase + sizeof(AssetHeader));
+
+  LOG_INFO("Asset partition: %d assets, %u bytes", header->count, (unsigned int)header->imageSize);
+  return true;
+#else
+  return false;
+#endif
+}
+
+// True when backgrounds can be read from the mapped image
+bool assetPartitionActive() {
+  return assetBase != NULL;
+}
+
+int assetCount() {
+  return assetPartitionActive() ? assetHeader->count : 0;
+}
+
+// Name of an asset with a leading '/', like file paths
+const char* assetName(int index) {
+  static char path[ASSET_NAME_LENGTH + 2];
+  if (index < 0 || index >= assetCount()) return NULL;
+
+  path[0] = '/';
+  strncpy(path + 1, assetDirectory[index].name, ASSET_NAME_LENGTH);
+  path[ASSET_NAME_LENGTH + 1] = '\0';
+  return path;
+}
+
+// Pointer to an asset's bytes in mapped flash, or NULL if it is not packed
+const uint8_t* assetFind(const char* filename, uint32_t* size) {
+  if (!assetPartitionActive() || filename == NULL) return NULL;
+
+  const char* name = (*filename == '/') ? filename + 1 : filename;
+  uint32_t hash = assetNameHash(name);
+
+  for (int i = 0; i < assetHeader->count; i++) {
+    const AssetEntry& entry = assetDirectory[i];
+    if (entry.nameHash != hash || strncmp(entry.name, name, ASSET_NAME_LENGTH) != 0) continue;
+
+    // Never hand out a blob that runs past the image
+    if (entry.offset > assetHeader->imageSize || entry.size > assetHeader->imageSize - entry.offset) {
+      return NULL;
+    }
+    if (size != NULL) *size = entry.size;
+    return assetBase + entry.offset;
+  }
+
+  return NULL;
+}
+
+#endif  // ASSET_PARTITION_H
@@ -0,0 +1,276 @@
+/*
+ * asset_reader.h - Asset lookups with handle reuse
+ * For Multi-Mode Digital Clock project
+ * A path is looked up once and gets an asset ID; later uses of the same
+ * background need no file system lookup at all. A couple of open handles
+ * are kept (least recently used is closed first). The decoders work from
+ * RAM, so most reads are whole files, which go straight into the caller's
+ * buffer in block multiples. Only small or unaligned reads, such as theme
+ * file headers and the tail of a file, use the sector-aligned block.
+ * Bytes, read calls and time are kept per asset. When the table is full, the
+ * record of a missing or invalidated file is reused, or else the one
+ * resolved longest ago, so files coming and going never exhaust it.
+ */
+
+#ifndef ASSET_READER_H
+#define ASSET_READER_H
+
+#include <Arduino.h>
+#include "storage.h"
+#include "mem_alloc.h"
+#include "utils.h"
+#include "log_buffer.h"
+
+// Assets that have an ID at the same time (backgrounds plus a few extra files)
+#define ASSET_READER_MAX 104
+#define ASSET_PATH_LENGTH 40
+
+// Open handles kept between uses
+#define ASSET_HANDLE_SLOTS 2
+
+// Block for small reads - one flash sector, a whole number of file system pages
+#define ASSET_READ_BLOCK 4096
+
+// Record sizes before the file has been looked at
+#define ASSET_MISSING -1
+#define ASSET_UNCHECKED -2
+
+// One known asset
+struct AssetRecord {
+  uint32_t pathHash;
+  char path[ASSET_PATH_LENGTH];
+  int32_t size;  // Or ASSET_MISSING / ASSET_UNCHECKED
+  uint32_t bytesRead;
+  uint32_t readCalls;
+  uint32_t readMicros;
+  uint32_t lastUsed;
+};
+
+// An open file with its block for small reads
+struct AssetHandle {
+  int id;
+  File file;
+  uint8_t* block;
+  uint32_t blockOffset;
+  int32_t blockLength;
+  uint32_t lastUsed;
+};
+
+AssetRecord assetRecords[ASSET_READER_MAX];
+int assetRecordCount = 0;
+uint32_t assetRecordClock = 0;
+AssetHandle assetHandles[ASSET_HANDLE_SLOTS];
+uint32_t assetHandleClock = 0;
+bool assetHandlesReady = false;
+
+// Function prototypes
+int assetResolve(const char* path);
+int32_t assetFileSize(int id);
+int32_t assetRead(int id, uint32_t offset, uint8_t* dst, int32_t length);
+bool assetReadAll(int id, uint8_t* dst);
+void assetReaderInvalidate(const char* path);
+void assetReaderPrintStats();
+
+// FNV-1a of a path
+uint32_t assetPathHash(const char* path) {
+  uint32_t hash = FNV1A_OFFSET_BASIS;
+  while (*path) {
+    hash = (hash ^ (uint8_t)*path++) * FNV1A_PRIME;
+  }
+  return hash;
+}
+
+// Close a handle and forget its block
+void closeAssetHandle(AssetHandle& handle) {
+  if (handle.id >= 0) handle.file.close();
+  handle.id = -1;
+  handle.blockLength = 0;
+}
+
+// Handle for an asset - reuses an open one or replaces the least recently used
+AssetHandle* acquireAssetHandle(int id) {
+  if (!assetHandlesReady) {
+    for (int i = 0; i < ASSET_HANDLE_SLOTS; i++) {
+      assetHandles[i].id = -1;
+      assetHandles[i].block = NULL;
+      assetHandles[i].blockLength = 0;
+    }
+    assetHandlesReady = true;
+  }
+
+  AssetHandle* oldest = &assetHandles[0];
+
+  for (int i = 0; i < ASSET_HANDLE_SLOTS; i++) {
+    AssetHandle& handle = assetHandles[i];
+    if (handle.id == id) {
+      handle.lastUsed = ++assetHandleClock;
+      return &handle;
+    }
+    if (handle.id < 0 || (oldest->id >= 0 && handle.lastUsed < oldest->lastUsed)) {
+      oldest = &handle;
+    }
+  }
+
+  closeAssetHandle(*oldest);
+
+  if (oldest->block == NULL) {
+    oldest->block = (uint8_t*)memAlloc(ASSET_READ_BLOCK, MEM_FAST);
+  }
+
+  oldest->file = clockFS().open(assetRecords[id].path, "r");
+  if (!oldest->file) return NULL;
+
+  oldest->id = id;
+  oldest->lastUsed = ++assetHandleClock;
+  return oldest;
+}
+
+// Look at the file behind a record - the open doubles as the existence
+// check, and the handle is kept for the reads that follow
+void checkAssetRecord(int id) {
+  AssetHandle* handle = acquireAssetHandle(id);
+  assetRecords[id].size = handle ? (int32_t)handle->file.size() : ASSET_MISSING;
+}
+
+// Record to reuse when the table is full - a missing or invalidated file
+// first, otherwise the least recently resolved one. IDs are only held
+// within one load, so reusing one is safe between loads.
+int recycleAssetRecord() {
+  int victim = 0;
+  for (int i = 0; i < assetRecordCount; i++) {
+    if (assetRecords[i].size < 0) {
+      victim = i;
+      break;
+    }
+    if (assetRecords[i].lastUsed < assetRecords[victim].lastUsed) victim = i;
+  }
+
+  for (int i = 0; assetHandlesReady && i < ASSET_HANDLE_SLOTS; i++) {
+    if (assetHandles[i].id == victim) closeAssetHandle(assetHandles[i]);
+  }
+  return victim;
+}
+
+// Asset ID for a path, or -1 if there is no such file. Only the first call
+// for a path touches the file system.
+int assetResolve(const char* path) {
+  if (path == NULL || strlen(path) >= ASSET_PATH_LENGTH) return -1;
+
+  uint32_t hash = assetPathHash(path);
+  int id = -1;
+  for (int i = 0; i < assetRecordCount && id < 0; i++) {
+    if (assetRecords[i].pathHash == hash && strcmp(assetRecords[i].path, path) == 0) {
+      id = i;
+    }
+  }
+
+  if (id < 0) {
+    id = (assetRecordCount < ASSET_READER_MAX) ? assetRecordCount++ : recycleAssetRecord();
+    AssetRecord& record = assetRecords[id];
+    memset(&record, 0, sizeof(record));
+    record.pathHash = hash;
+    strcpy(record.path, path);
+    record.size = ASSET_UNCHECKED;
+  }
+  assetRecords[id].lastUsed = ++assetRecordClock;
+
+  if (assetRecords[id].size == ASSET_UNCHECKED) {
+    checkAssetRecord(id);
+  }
+  return (assetRecords[id].size >= 0) ? id : -1;
+}
+
+int32_t assetFileSize(int id) {
+  if (id < 0 || id >= assetRecordCount) return -1;
+  return assetRecords[id].size;
+}
+
+// Read part of an asset. Returns the number of bytes copied.
+int32_t assetRead(int id, uint32_t offset, uint8_t* dst, int32_t length) {
+  if (id < 0 || id >= assetRecordCount || assetRecords[id].size < 0) return 0;
+
+  unsigned long start = micros();
+  AssetRecord& record = assetRecords[id];
+  AssetHandle* handle = acquireAssetHandle(id);
+  if (handle == NULL) return 0;
+
+  if (offset >= (uint32_t)record.size) return 0;
+  length = min(length, (int32_t)(record.size - offset));
+
+  int32_t copied = 0;
+  while (copied < length) {
+    uint32_t position = offset + copied;
+    int32_t wanted = length - copied;
+
+    // Served from the current block
+    if (handle->blockLength > 0 && position >= handle->blockOffset &&
+        position < handle->blockOffset + handle->blockLength) {
+      int32_t available = handle->blockOffset + handle->blockLength - position;
+      int32_t chunk = min(wanted, available);
+      memcpy(dst + copied, handle->block + (position - handle->blockOffset), chunk);
+      copied += chunk;
+      continue;
+    }
+
+    // Large aligned reads (and reads without a block buffer) go straight to the caller
+    if (handle->block == NULL || (position % ASSET_READ_BLOCK == 0 && wanted >= ASSET_READ_BLOCK)) {
+      int32_t chunk = (handle->block == NULL) ? wanted : wanted - (wanted % ASSET_READ_BLOCK);
+      handle->file.seek(position);
+      int32_t got = handle->file.read(dst + copied, chunk);
+      if (got <= 0) break;
+      copied += got;
+      continue;
+    }
+
+    // Fill the block that holds this position
+    handle->blockOffset = position - (position % ASSET_READ_BLOCK);
+    handle->file.seek(handle->blockOffset);
+    handle->blockLength = handle->file.read(handle->block, ASSET_READ_BLOCK);
+    if (handle->blockLength <= 0) {
+      handle->blockLength = 0;
+      break;
+    }
+  }
+
+  record.bytesRead += copied;
+  record.readCalls++;
+  record.readMicros += micros() - start;
+  return copied;
+}
+
+// Read a whole asset into a buffer of assetFileSize() bytes
+bool assetReadAll(int id, uint8_t* dst) {
+  int32_t size = assetFileSize(id);
+  return size >= 0 && assetRead(id, 0, dst, size) == size;
+}
+
+// Forget a path after it was written, renamed or deleted (NULL = everything)
+void assetReaderInvalidate(const char* path) {
+  uint32_t hash = (path != NULL) ? assetPathHash(path) : 0;
+
+  for (int i = 0; i < ASSET_HANDLE_SLOTS; i++) {
+    AssetHandle& handle = assetHandles[i];
+    if (handle.id >= 0 && (path == NULL || assetRecords[handle.id].pathHash == hash)) {
+      closeAssetHandle(handle);
+    }
+  }
+
+  // Keep the IDs and statistics, look the files up again on next use
+  for (int i = 0; i < assetRecordCount; i++) {
+    if (path == NULL || (assetRecords[i].pathHash == hash && strcmp(assetRecords[i].path, path) == 0)) {
+      assetRecords[i].size = ASSET_UNCHECKED;
+    }
+  }
+}
+
+// Report reads per asset
+void assetReaderPrintStats() {
+  for (int i = 0; i < assetRecordCount; i++) {
+    const AssetRecord& record = assetRecords[i];
+    if (record.readCalls == 0) continue;
+    LOG_INFO("Asset %s: %u bytes in %u reads, %u us", record.path,
+             (unsigned int)record.bytesRead, (unsigned int)record.readCalls, (unsigned int)record.readMicros);
+  }
+}
+
+#endif  // ASSET_READER_H
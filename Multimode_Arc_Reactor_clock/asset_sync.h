@@ -0,0 +1,653 @@
+/*
+ * asset_sync.h - Background sync from a local content server
+ * For Multi-Mode Digital Clock project
+ * Every SYNC_INTERVAL_MINUTES the clock fetches /manifest.txt from
+ * SYNC_SERVER: one "<size> <fnv1a hex> <name>" line per background (see
+ * tools/make_manifest.py). Files whose size and hash already match are
+ * left alone, others are downloaded in the background; lines naming
+ * anything but a background are ignored. Hashes of verified files are kept
+ * in /sync.idx, saved after every stored or deleted file, so unchanged
+ * files are not read again on the next check; a file in that index that
+ * the manifest no longer lists is deleted. Backgrounds that arrived any
+ * other way (flashed or uploaded) are never deleted. Downloads go to
+ * /sync.part and resume with a Range request after a dropped connection
+ * or a reboot. The connect is polled (net_connect.h) and bytes are read at
+ * no more than SYNC_RATE_KBPS, a small chunk per loop pass and never in a
+ * pass that is already over its frame budget, so drawing does not wait
+ * for the network or the flash.
+ */
+
+#ifndef ASSET_SYNC_H
+#define ASSET_SYNC_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+#include "utils.h"
+#include "storage.h"
+#include "asset_reader.h"
+#include "fs_maintenance.h"
+#include "frame_governor.h"
+#include "image_analysis.h"
+#include "ambient_color.h"
+#include "net_connect.h"
+#include "gif_seek.h"
+#include "theme_pack.h"
+#include "log_buffer.h"
+
+#ifndef SYNC_SERVER
+#define SYNC_SERVER ""
+#define SYNC_PORT 8000
+#define SYNC_INTERVAL_MINUTES 30
+#define SYNC_RATE_KBPS 32
+#define SYNC_DELETE 1
+#endif
+
+// Enabled when a server is configured
+#define SYNC_ENABLED (sizeof(SYNC_SERVER) > 1)
+
+#define SYNC_MANIFEST_PATH "/manifest.txt"
+#define SYNC_INDEX_FILE "/sync.idx"      // Verified local files, same format as the manifest
+#define SYNC_PART_FILE "/sync.part"      // Download in progress
+#define SYNC_STATE_FILE "/sync.state"    // Manifest line of the download in progress
+
+#define SYNC_MAX_ENTRIES 99
+#define SYNC_NAME_LENGTH 32               // SPIFFS limit including the terminator
+#define SYNC_LINE_LENGTH 64
+#define SYNC_HEADER_SIZE 384
+#define SYNC_CHUNK 1024                   // Bytes read or hashed per step
+#define SYNC_CONNECT_TIMEOUT 5000         // ms for name lookup and TCP connect (polled)
+#define SYNC_IDLE_TIMEOUT 10000           // ms without data before a transfer is dropped
+#define SYNC_RETRY_MS 60000               // Next attempt after a failed check
+
+// Sync states
+#define SYNC_IDLE 0
+#define SYNC_HEADERS 1    // Waiting for a response status line and headers
+#define SYNC_MANIFEST 2   // Reading the manifest body
+#define SYNC_CHECK 3      // Comparing the next manifest entry with local storage
+#define SYNC_HASH 4       // Hashing a local file or a finished download
+#define SYNC_DOWNLOAD 5   // Writing a download body to the part file
+#define SYNC_PRUNE 6      // Deleting synced backgrounds the manifest no longer lists
+#define SYNC_CONNECTING 7 // Waiting for the TCP connect of a request
+
+// What a hash pass is for
+#define SYNC_HASH_LOCAL 0
+#define SYNC_HASH_PART 1
+
+struct SyncEntry {
+  char name[SYNC_NAME_LENGTH];  // With the leading '/'
+  uint32_t size;
+  uint32_t hash;
+};
+
+SyncEntry syncManifest[SYNC_MAX_ENTRIES];
+int syncManifestCount = 0;
+SyncEntry syncLocal[SYNC_MAX_ENTRIES];
+int syncLocalCount = 0;
+bool syncLocalDirty = false;
+
+WiFiClient syncClient;
+NetConnect syncConnecting = NET_CONNECT_INIT;
+int syncState = SYNC_IDLE;
+int syncNextState = SYNC_IDLE;   // Body state once the headers are in
+unsigned long syncNextCheck = 0;
+unsigned long syncLastData = 0;  // Last time data was waiting in the socket
+
+// Request waiting for its connection
+char syncRequestPath[SYNC_NAME_LENGTH];
+uint32_t syncRequestOffset = 0;
+
+// Response being read
+char syncHeaders[SYNC_HEADER_SIZE];
+int syncHeaderLength = 0;
+int syncStatus = 0;
+uint32_t syncBodyRemaining = 0;
+char syncLine[SYNC_LINE_LENGTH];
+int syncLineLength = 0;
+
+// Entry being checked or downloaded
+int syncCursor = 0;
+File syncFile;
+uint32_t syncOffset = 0;
+uint32_t syncHashValue = 0;
+int syncHashPurpose = SYNC_HASH_LOCAL;
+uint8_t syncBuffer[SYNC_CHUNK];
+
+// Rate limit
+unsigned long syncLastRefill = 0;
+long syncAllowance = 0;
+
+// Background added, replaced or deleted, waiting for the sketch
+char syncChangedPath[SYNC_NAME_LENGTH];
+bool syncChangeRemoved = false;
+bool syncChangeReady = false;
+
+// Statistics
+unsigned long syncDownloaded = 0;
+int syncFilesAdded = 0;
+int syncFilesDeleted = 0;
+
+// Function prototypes
+void syncBegin();
+void syncService();
+bool syncTakeChange(char* path, bool* removed);
+
+// Parse "<size> <hash> <name>", names without the leading '/' as served
+bool syncParseLine(const char* line, SyncEntry& entry) {
+  unsigned long size, hash;
+  char name[SYNC_LINE_LENGTH];
+  if (line[0] == '#' || sscanf(line, "%lu %lx %63s", &size, &hash, name) != 3) return false;
+  if (strlen(name) > SYNC_NAME_LENGTH - 2) return false;
+
+  for (const char* c = name; *c; c++) {
+    if (!isalnum(*c) && *c != '.' && *c != '_' && *c != '-') return false;
+  }
+  if (name[0] == '.') return false;
+
+  entry.name[0] = '/';
+  strcpy(entry.name + 1, name);
+  entry.size = size;
+  entry.hash = hash;
+  return true;
+}
+
+// Only backgrounds are synced, never settings or caches
+bool syncIsBackground(const char* path) {
+  String lowerName = path;
+  lowerName.toLowerCase();
+  return lowerName.endsWith(".jpg") || lowerName.endsWith(".jpeg") || lowerName.endsWith(".gif") ||
+         isThemeFile(lowerName);
+}
+
+SyncEntry* syncFind(SyncEntry* entries, int count, const char* path) {
+  for (int i = 0; i < count; i++) {
+    if (strcmp(entries[i].name, path) == 0) return &entries[i];
+  }
+  return NULL;
+}
+
+// Remember the hash of a verified local file
+void syncRemember(const SyncEntry& entry) {
+  SyncEntry* local = syncFind(syncLocal, syncLocalCount, entry.name);
+  if (local == NULL) {
+    if (syncLocalCount >= SYNC_MAX_ENTRIES) return;
+    local = &syncLocal[syncLocalCount++];
+  }
+  *local = entry;
+  syncLocalDirty = true;
+}
+
+void syncForget(const char* path) {
+  SyncEntry* local = syncFind(syncLocal, syncLocalCount, path);
+  if (local == NULL) return;
+  *local = syncLocal[--syncLocalCount];
+  syncLocalDirty = true;
+}
+
+void syncSaveIndex() {
+  if (!syncLocalDirty) return;
+
+  File file = clockFS().open(SYNC_INDEX_FILE, "w");
+  if (!file) {
+    LOG_ERROR("Failed to write %s", SYNC_INDEX_FILE);
+    return;
+  }
+  storageWriteBegin();
+  for (int i = 0; i < syncLocalCount; i++) {
+    file.printf("%lu %08lx %s\n", (unsigned long)syncLocal[i].size, (unsigned long)syncLocal[i].hash,
+                syncLocal[i].name + 1);
+  }
+  storageWriteEnd("sync index", file.size());
+  file.close();
+  syncLocalDirty = false;
+}
+
+// Load the local index - call once storage is mounted
+void syncBegin() {
+  if (!SYNC_ENABLED) return;
+
+  syncLocalCount = 0;
+  File file = clockFS().open(SYNC_INDEX_FILE, "r");
+  while (file && file.available() && syncLocalCount < SYNC_MAX_ENTRIES) {
+    String line = file.readStringUntil('\n');
+    if (syncParseLine(line.c_str(), syncLocal[syncLocalCount])) syncLocalCount++;
+  }
+  if (file) file.close();
+
+  // First check shortly after boot
+  syncNextCheck = millis() + 10000;
+  LOG_INFO("Sync: %d indexed files, server %s:%d", syncLocalCount, SYNC_SERVER, SYNC_PORT);
+}
+
+// Hand out one changed background at a time
+bool syncTakeChange(char* path, bool* removed) {
+  if (!syncChangeReady) return false;
+  strcpy(path, syncChangedPath);
+  *removed = syncChangeRemoved;
+  syncChangeReady = false;
+  return true;
+}
+
+void syncAnnounce(const char* path, bool removed) {
+  strcpy(syncChangedPath, path);
+  syncChangeRemoved = removed;
+  syncChangeReady = true;
+}
+
+// End this check; the next one follows after the interval, or sooner after an error
+void syncFinish(bool failed, const char* reason) {
+  netConnectCancel(syncConnecting);
+  syncClient.stop();
+  if (syncFile) syncFile.close();
+  syncSaveIndex();
+
+  syncState = SYNC_IDLE;
+  syncNextCheck = millis() + (failed ? SYNC_RETRY_MS : SYNC_INTERVAL_MINUTES * 60000UL);
+
+  if (failed) {
+    LOG_WARN("Sync: %s, retrying in %d s", reason, SYNC_RETRY_MS / 1000);
+  } else {
+    LOG_INFO("Sync: done, %d added, %d deleted, %lu bytes", syncFilesAdded, syncFilesDeleted, syncDownloaded);
+  }
+}
+
+// Start a GET, from 'offset' on if it is not zero; it is sent once connected
+void syncRequest(const char* path, uint32_t offset, int bodyState) {
+  syncClient.stop();
+  strcpy(syncRequestPath, path);
+  syncRequestOffset = offset;
+  syncNextState = bodyState;
+  netConnectStart(syncConnecting, SYNC_SERVER, SYNC_PORT);
+  syncState = SYNC_CONNECTING;
+}
+
+// Poll the connect, then send the request
+void syncConnectStep() {
+  int result = netConnectPoll(syncConnecting, syncClient, SYNC_CONNECT_TIMEOUT);
+  if (result == NET_PENDING) return;
+  if (result == NET_FAILED) {
+    syncFinish(true, "server unreachable");
+    return;
+  }
+
+  syncClient.printf("GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n", syncRequestPath, SYNC_SERVER);
+  if (syncRequestOffset > 0) syncClient.printf("Range: bytes=%lu-\r\n", (unsigned long)syncRequestOffset);
+  syncClient.print("\r\n");
+
+  syncHeaderLength = 0;
+  syncLastData = millis();
+  syncState = SYNC_HEADERS;
+}
+
+// Collect the response headers, then move on to the body
+void syncReadHeaders() {
+  while (syncClient.available() > 0 && syncHeaderLength < SYNC_HEADER_SIZE - 1) {
+    syncHeaders[syncHeaderLength++] = syncClient.read();
+    syncHeaders[syncHeaderLength] = '\0';
+    if (syncHeaderLength >= 4 && strcmp(syncHeaders + syncHeaderLength - 4, "\r\n\r\n") == 0) break;
+  }
+
+  if (syncHeaderLength < 4 || strcmp(syncHeaders + syncHeaderLength - 4, "\r\n\r\n") != 0) {
+    if (syncHeaderLength >= SYNC_HEADER_SIZE - 1) syncFinish(true, "response headers too large");
+    return;
+  }
+
+  syncStatus = 0;
+  sscanf(syncHeaders, "HTTP/%*s %d", &syncStatus);
+
+  const char* length = strcasestr(syncHeaders, "\r\nContent-Length:");
+  if (length == NULL) {
+    syncFinish(true, "no Content-Length");
+    return;
+  }
+  syncBodyRemaining = strtoul(length + 17, NULL, 10);
+  syncState = syncNextState;
+}
+
+// Leave passes that are already over budget to drawing
+bool syncPassHasTime() {
+  return micros() - frameStartMicros < FRAME_BUDGET_MS * 1000UL;
+}
+
+// Bytes that may be read now: the rate allowance and the body left
+int syncBudget() {
+  unsigned long now = millis();
+  syncAllowance = min(syncAllowance + (long)((now - syncLastRefill) * SYNC_RATE_KBPS * 1024UL / 1000), (long)SYNC_CHUNK * 4);
+  syncLastRefill = now;
+
+  if (!syncPassHasTime()) return 0;
+  return (int)min(min(syncAllowance, (long)SYNC_CHUNK), (long)syncBodyRemaining);
+}
+
+// Read at most 'budget' body bytes into the buffer
+int syncReadBody(int budget) {
+  if (budget <= 0 || syncClient.available() <= 0) return 0;
+
+  int received = syncClient.read(syncBuffer, min(budget, syncClient.available()));
+  if (received <= 0) return 0;
+
+  syncBodyRemaining -= received;
+  syncAllowance -= received;
+  return received;
+}
+
+// Keep a manifest line if it names a background; the server cannot
+// overwrite the sync index, settings or caches
+void syncAddManifestLine() {
+  if (syncManifestCount >= SYNC_MAX_ENTRIES) return;
+  SyncEntry& entry = syncManifest[syncManifestCount];
+  if (!syncParseLine(syncLine, entry)) return;
+  if (!syncIsBackground(entry.name)) {
+    LOG_WARN("Sync: manifest entry %s is not a background, ignored", entry.name);
+    return;
+  }
+  syncManifestCount++;
+}
+
+// Collect manifest lines
+void syncReadManifest() {
+  if (syncStatus != 200) {
+    syncFinish(true, "manifest not available");
+    return;
+  }
+
+  int received = syncReadBody(syncBudget());
+  for (int i = 0; i < received; i++) {
+    char c = syncBuffer[i];
+    if (c != '\n' && syncLineLength < SYNC_LINE_LENGTH - 1) {
+      if (c != '\r') syncLine[syncLineLength++] = c;
+      continue;
+    }
+    syncLine[syncLineLength] = '\0';
+    syncLineLength = 0;
+    syncAddManifestLine();
+  }
+
+  if (syncBodyRemaining == 0) {
+    // A last line without a newline
+    syncLine[syncLineLength] = '\0';
+    syncAddManifestLine();
+    syncClient.stop();
+    LOG_INFO("Sync: manifest lists %d files", syncManifestCount);
+    syncCursor = 0;
+    syncState = SYNC_CHECK;
+  }
+}
+
+// Start hashing a file a chunk at a time
+void syncStartHash(const char* path, int purpose) {
+  syncFile = clockFS().open(path, "r");
+  if (!syncFile) {
+    syncFinish(true, "cannot read file to hash");
+    return;
+  }
+  syncHashValue = FNV1A_OFFSET_BASIS;
+  syncHashPurpose = purpose;
+  syncState = SYNC_HASH;
+}
+
+// Fetch the current entry, continuing a part file left by an earlier attempt
+void syncStartDownload(const SyncEntry& entry) {
+  syncOffset = 0;
+
+  File state = clockFS().open(SYNC_STATE_FILE, "r");
+  SyncEntry resumed;
+  bool resume = state && syncParseLine(state.readStringUntil('\n').c_str(), resumed) &&
+                strcmp(resumed.name, entry.name) == 0 && resumed.size == entry.size && resumed.hash == entry.hash;
+  if (state) state.close();
+
+  if (resume && clockFS().exists(SYNC_PART_FILE)) {
+    File part = clockFS().open(SYNC_PART_FILE, "r");
+    syncOffset = part.size();
+    part.close();
+  } else {
+    clockFS().remove(SYNC_PART_FILE);
+    state = clockFS().open(SYNC_STATE_FILE, "w");
+    if (state) {
+      state.printf("%lu %08lx %s\n", (unsigned long)entry.size, (unsigned long)entry.hash, entry.name + 1);
+      state.close();
+    }
+  }
+
+  if (syncOffset >= entry.size) {
+    syncStartHash(SYNC_PART_FILE, SYNC_HASH_PART);
+    return;
+  }
+
+  if (syncOffset > 0) {
+    LOG_INFO("Sync: resuming %s at %lu of %lu bytes", entry.name, (unsigned long)syncOffset, (unsigned long)entry.size);
+  }
+  syncRequest(entry.name, syncOffset, SYNC_DOWNLOAD);
+}
+
+// Compare the next manifest entry with what is stored
+void syncCheckEntry() {
+  if (syncCursor >= syncManifestCount) {
+    syncCursor = 0;
+    syncState = SYNC_PRUNE;
+    return;
+  }
+
+  const SyncEntry& entry = syncManifest[syncCursor];
+  SyncEntry* local = syncFind(syncLocal, syncLocalCount, entry.name);
+
+  uint32_t size = 0;
+  bool exists = clockFS().exists(entry.name);
+  if (exists) {
+    File file = clockFS().open(entry.name, "r");
+    size = file.size();
+    file.close();
+  }
+
+  if (exists && size == entry.size) {
+    // Trust the stored hash of a file that has not changed size
+    if (local != NULL && local->size == size) {
+      if (local->hash == entry.hash) {
+        syncCursor++;
+        return;
+      }
+    } else {
+      syncStartHash(entry.name, SYNC_HASH_LOCAL);
+      return;
+    }
+  }
+
+  syncStartDownload(entry);
+}
+
+// Hash one chunk; once done, keep a matching file or fetch the entry again
+void syncHashStep() {
+  if (!syncPassHasTime()) return;
+
+  int length = syncFile.read(syncBuffer, SYNC_CHUNK);
+  for (int i = 0; i < length; i++) {
+    syncHashValue = (syncHashValue ^ syncBuffer[i]) * FNV1A_PRIME;
+  }
+  if (length == SYNC_CHUNK) return;
+  syncFile.close();
+
+  const SyncEntry& entry = syncManifest[syncCursor];
+  bool match = (syncHashValue == entry.hash);
+
+  if (syncHashPurpose == SYNC_HASH_LOCAL) {
+    SyncEntry verified = entry;
+    verified.hash = syncHashValue;
+    syncRemember(verified);
+    syncState = SYNC_CHECK;
+    if (match) syncCursor++;
+    return;
+  }
+
+  clockFS().remove(SYNC_STATE_FILE);
+  if (!match) {
+    clockFS().remove(SYNC_PART_FILE);
+    LOG_ERROR("Sync: %s failed verification, skipped", entry.name);
+    syncCursor++;
+    syncState = SYNC_CHECK;
+    return;
+  }
+
+  // Close cached handles before the old file goes away; a failed replace
+  // keeps the old file
+  assetReaderInvalidate(entry.name);
+  bool replaced = clockFS().exists(entry.name);
+  if (!storageReplace(SYNC_PART_FILE, entry.name)) {
+    syncFinish(true, "rename failed");
+    return;
+  }
+
+  // Placement summary, ambient color and GIF index describe the previous file
+  if (replaced) {
+    forgetImageSummary(entry.name);
+    forgetAmbientColor(entry.name);
+    gifSeekForget(assetPathHash(entry.name));
+  }
+
+  // Saved per file, so a reset mid-sync does not hash everything again
+  syncRemember(entry);
+  syncSaveIndex();
+  syncFilesAdded++;
+  LOG_INFO("Sync: stored %s (%lu bytes)", entry.name, (unsigned long)entry.size);
+  syncAnnounce(entry.name, false);
+  syncCursor++;
+  syncState = SYNC_CHECK;
+}
+
+// Append what arrived to the part file
+void syncDownloadStep() {
+  if (!syncFile) {
+    // 206 continues the part file, 200 sends the whole file again
+    if (syncStatus == 200) {
+      syncOffset = 0;
+      syncFile = clockFS().open(SYNC_PART_FILE, "w");
+    } else if (syncStatus == 206) {
+      syncFile = clockFS().open(SYNC_PART_FILE, "a");
+    } else {
+      clockFS().remove(SYNC_PART_FILE);
+      clockFS().remove(SYNC_STATE_FILE);
+      LOG_WARN("Sync: %s returned %d", syncManifest[syncCursor].name, syncStatus);
+      syncClient.stop();
+      syncCursor++;
+      syncState = SYNC_CHECK;
+      return;
+    }
+    if (!syncFile) {
+      syncFinish(true, "cannot write part file");
+      return;
+    }
+  }
+
+  int received = syncReadBody(syncBudget());
+  if (received > 0) {
+    storageWriteBegin();
+    size_t written = syncFile.write(syncBuffer, received);
+    storageWriteEnd("sync", written);
+    if ((int)written != received) {
+      syncFinish(true, "storage full");
+      return;
+    }
+    syncOffset += received;
+    syncDownloaded += received;
+  }
+
+  if (syncBodyRemaining == 0) {
+    syncFile.close();
+    syncClient.stop();
+    syncStartHash(SYNC_PART_FILE, SYNC_HASH_PART);
+  }
+}
+
+// Delete one indexed background the manifest does not list, or finish
+void syncPruneStep() {
+  // An empty or unreadable manifest never empties the clock
+  if (!SYNC_DELETE || syncManifestCount == 0) {
+    syncFinish(false, NULL);
+    return;
+  }
+
+  // Only files in the sync index came from the server
+  int index = 0;
+  while (index < syncLocalCount && syncFind(syncManifest, syncManifestCount, syncLocal[index].name) != NULL) {
+    index++;
+  }
+  if (index == syncLocalCount) {
+    syncFinish(false, NULL);
+    return;
+  }
+
+  // Leaves the index either way, so a file that cannot be removed is not picked again
+  char path[SYNC_NAME_LENGTH];
+  strcpy(path, syncLocal[index].name);
+  syncForget(path);
+
+  assetReaderInvalidate(path);
+  bool removed = !clockFS().exists(path) || clockFS().remove(path);
+  syncSaveIndex();
+  if (!removed) {
+    LOG_ERROR("Sync: cannot delete %s, left in place", path);
+    return;
+  }
+  forgetImageSummary(path);
+  forgetAmbientColor(path);
+  gifSeekForget(assetPathHash(path));
+  syncFilesDeleted++;
+  LOG_INFO("Sync: deleted %s", path);
+  syncAnnounce(path, true);
+}
+
+// Run the sync a step at a time - call once per loop
+void syncService() {
+  if (!SYNC_ENABLED) return;
+
+  // The sketch takes each change before the next one is made
+  if (syncChangeReady) return;
+
+  if (syncState == SYNC_IDLE) {
+    if ((long)(millis() - syncNextCheck) < 0 || WiFi.status() != WL_CONNECTED) return;
+
+    syncManifestCount = 0;
+    syncLineLength = 0;
+    syncFilesAdded = 0;
+    syncFilesDeleted = 0;
+    syncDownloaded = 0;
+    syncAllowance = 0;
+    syncLastRefill = millis();
+    syncRequest(SYNC_MANIFEST_PATH, 0, SYNC_MANIFEST);
+    return;
+  }
+
+  // Transfers with nothing arriving are dropped; a download resumes on the next check.
+  // Data left waiting because the rate or frame budget held the reader back is not a stall.
+  bool transferring = (syncState == SYNC_HEADERS || syncState == SYNC_MANIFEST || syncState == SYNC_DOWNLOAD);
+  if (transferring && syncClient.available() > 0) syncLastData = millis();
+  if (transferring && millis() - syncLastData > SYNC_IDLE_TIMEOUT) {
+    syncFinish(true, "transfer stalled");
+    return;
+  }
+
+  switch (syncState) {
+    case SYNC_CONNECTING:
+      syncConnectStep();
+      break;
+    case SYNC_HEADERS:
+      syncReadHeaders();
+      break;
+    case SYNC_MANIFEST:
+      syncReadManifest();
+      break;
+    case SYNC_CHECK:
+      syncCheckEntry();
+      break;
+    case SYNC_HASH:
+      syncHashStep();
+      break;
+    case SYNC_DOWNLOAD:
+      syncDownloadStep();
+      break;
+    case SYNC_PRUNE:
+      syncPruneStep();
+      break;
+  }
+}
+
+#endif  // ASSET_SYNC_H
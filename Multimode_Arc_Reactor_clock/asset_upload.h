@@ -0,0 +1,517 @@
+/*
+ * asset_upload.h - Streaming background upload over HTTP
+ * For Multi-Mode Digital Clock project
+ * New backgrounds can be sent to the clock instead of rebuilding and
+ * flashing the file system image:
+ *   PUT  /upload/<name>   raw body
+ *   POST /upload          multipart/form-data, one file part
+ * Bodies may use Content-Length or chunked transfer encoding. The body is
+ * streamed through one fixed buffer into a temporary file, a flash block at
+ * a time, and only a bounded number of bytes is taken per loop pass, so the
+ * clock keeps drawing while a file arrives. When the upload is complete the
+ * file replaces any old copy and the sketch adds it to the background list
+ * (see uploadTakeCompleted()). Built for tools/upload_asset.py.
+ */
+
+#ifndef ASSET_UPLOAD_H
+#define ASSET_UPLOAD_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+#include "config.h"
+#include "storage.h"
+#include "asset_reader.h"
+#include "fs_maintenance.h"
+#include "image_analysis.h"
+#include "ambient_color.h"
+#include "asset_sync.h"
+#include "gif_seek.h"
+#include "theme_pack.h"
+#include "log_buffer.h"
+
+#ifndef UPLOAD_PORT
+#define UPLOAD_PORT 8080
+#endif
+
+#define UPLOAD_WRITE_CHUNK 4096    // Bytes per flash write (one SPIFFS block)
+#define UPLOAD_SLICE_BYTES 16384   // Body bytes taken per loop pass at most
+#define UPLOAD_HEADER_SIZE 512     // Request line and headers
+#define UPLOAD_BOUNDARY_MAX 72     // RFC 2046 allows 70 characters
+#define UPLOAD_IDLE_TIMEOUT 5000   // ms without data before an upload is dropped
+#define UPLOAD_PATH_LENGTH 32      // SPIFFS limit including the terminator
+#define UPLOAD_TEMP_FILE "/upload.part"
+
+// Body data not yet written: a write chunk plus room to hold back a boundary
+#define UPLOAD_BUFFER_SIZE (UPLOAD_WRITE_CHUNK + UPLOAD_BOUNDARY_MAX + 8)
+
+// Request states
+#define UPLOAD_IDLE 0
+#define UPLOAD_HEADERS 1
+#define UPLOAD_PART_HEADERS 2  // Multipart: waiting for the file part headers
+#define UPLOAD_DATA 3
+
+// Chunked transfer decoder states
+#define CHUNK_SIZE 0
+#define CHUNK_EXTENSION 1
+#define CHUNK_DATA 2
+#define CHUNK_DATA_END 3
+#define CHUNK_TRAILER 4
+
+#if UPLOAD_PORT > 0
+WiFiServer uploadServer(UPLOAD_PORT);
+#endif
+WiFiClient uploadClient;
+
+int uploadState = UPLOAD_IDLE;
+char uploadHeaders[UPLOAD_HEADER_SIZE];
+int uploadHeaderLength = 0;
+uint8_t uploadBuffer[UPLOAD_BUFFER_SIZE];
+int uploadPending = 0;
+
+// Body framing
+bool uploadChunked = false;
+bool uploadMultipart = false;
+bool uploadBodyEnded = false;
+uint32_t uploadRemaining = 0;       // Content-Length bytes still to read
+char uploadDelimiter[UPLOAD_BOUNDARY_MAX + 8];  // "\r\n--" + boundary
+int uploadDelimiterLength = 0;
+
+// Chunked decoder
+int chunkState = CHUNK_SIZE;
+uint32_t chunkRemaining = 0;
+int chunkLineLength = 0;
+
+// Target file
+File uploadFile;
+char uploadPath[UPLOAD_PATH_LENGTH];
+uint32_t uploadWritten = 0;
+uint32_t uploadExpected = 0;        // Content-Length, 0 if unknown
+
+// Statistics for the response and the log
+unsigned long uploadStartMillis = 0;
+unsigned long uploadLastData = 0;
+size_t uploadHeapBefore = 0;
+size_t uploadHeapMin = 0;
+unsigned long uploadWriteWorst = 0;
+
+// Finished upload waiting to be indexed
+char uploadCompletedPath[UPLOAD_PATH_LENGTH];
+bool uploadCompleted = false;
+
+// Function prototypes
+void uploadBegin();
+void uploadService();
+bool uploadTakeCompleted(char* path);
+
+// Start listening - call once WiFi is up
+void uploadBegin() {
+#if UPLOAD_PORT > 0
+  uploadServer.begin();
+  uploadServer.setNoDelay(true);
+  LOG_INFO("Upload server on port %d", UPLOAD_PORT);
+#endif
+}
+
+// Hand out the path of a finished upload once
+bool uploadTakeCompleted(char* path) {
+  if (!uploadCompleted) return false;
+  strcpy(path, uploadCompletedPath);
+  uploadCompleted = false;
+  return true;
+}
+
+// Answer, close and forget the request
+void uploadRespond(int status, const char* reason, const char* body) {
+  uploadClient.printf("HTTP/1.1 %d %s\r\nContent-Type: text/plain\r\nConnection: close\r\nContent-Length: %d\r\n\r\n%s",
+                      status, reason, (int)strlen(body), body);
+  uploadClient.stop();
+
+  if (uploadFile) {
+    uploadFile.close();
+    clockFS().remove(UPLOAD_TEMP_FILE);
+  }
+  uploadState = UPLOAD_IDLE;
+
+  if (status >= 400) {
+    LOG_WARN("Upload rejected: %d %s", status, reason);
+  }
+}
+
+// Value of a request header (case-insensitive name), or NULL
+const char* uploadHeader(const char* name) {
+  size_t nameLength = strlen(name);
+  const char* line = strstr(uploadHeaders, "\r\n");
+
+  while (line != NULL && line[2] != '\r' && line[2] != '\0') {
+    line += 2;
+    if (strncasecmp(line, name, nameLength) == 0 && line[nameLength] == ':') {
+      const char* value = line + nameLength + 1;
+      while (*value == ' ') value++;
+      return value;
+    }
+    line = strstr(line, "\r\n");
+  }
+  return NULL;
+}
+
+// Copy a header value up to the end of its line or a separator
+void uploadHeaderValue(const char* value, char* dst, int size, const char* stop) {
+  int length = 0;
+  while (value[length] && value[length] != '\r' && strchr(stop, value[length]) == NULL && length < size - 1) {
+    dst[length] = value[length];
+    length++;
+  }
+  dst[length] = '\0';
+}
+
+// Turn an uploaded name into a storage path, refusing anything that is not a background
+bool uploadSetPath(const char* name) {
+  const char* slash = strrchr(name, '/');
+  if (slash) name = slash + 1;
+  const char* backslash = strrchr(name, '\\');
+  if (backslash) name = backslash + 1;
+
+  int length = strlen(name);
+  if (length == 0 || length > UPLOAD_PATH_LENGTH - 2 || name[0] == '.') return false;
+
+  for (int i = 0; i < length; i++) {
+    char c = name[i];
+    if (!isalnum(c) && c != '.' && c != '_' && c != '-') return false;
+  }
+
+  uploadPath[0] = '/';
+  strcpy(uploadPath + 1, name);
+
+  String lowerName = uploadPath;
+  lowerName.toLowerCase();
+  return lowerName.endsWith(".jpg") || lowerName.endsWith(".jpeg") || lowerName.endsWith(".gif") ||
+         isThemeFile(lowerName);
+}
+
+// Open the temporary file once the target is known
+bool uploadOpenFile() {
+  // Room for the new copy, counting the old one it replaces
+  if (uploadExpected > 0) {
+    size_t replaced = 0;
+    if (clockFS().exists(uploadPath)) {
+      File old = clockFS().open(uploadPath, "r");
+      replaced = old.size();
+      old.close();
+    }
+    if (uploadExpected > storageFreeBytes() + replaced) {
+      uploadRespond(507, "Insufficient Storage", "not enough free space\n");
+      return false;
+    }
+  }
+
+  clockFS().remove(UPLOAD_TEMP_FILE);
+  uploadFile = clockFS().open(UPLOAD_TEMP_FILE, "w");
+  if (!uploadFile) {
+    uploadRespond(500, "Internal Server Error", "cannot create file\n");
+    return false;
+  }
+  uploadWritten = 0;
+  return true;
+}
+
+// Write up to one chunk from the front of the buffer
+bool uploadWriteChunk(int length) {
+  storageWriteBegin();
+  unsigned long start = micros();
+  size_t written = uploadFile.write(uploadBuffer, length);
+  uploadWriteWorst = max(uploadWriteWorst, micros() - start);
+  storageWriteEnd("upload", written);
+
+  if ((int)written != length) {
+    uploadRespond(507, "Insufficient Storage", "write failed\n");
+    return false;
+  }
+
+  uploadWritten += length;
+  uploadPending -= length;
+  memmove(uploadBuffer, uploadBuffer + length, uploadPending);
+  return true;
+}
+
+// Write the first 'length' buffered bytes in full chunks, and the rest too if 'final'
+bool uploadWriteData(int length, bool final) {
+  while (length >= UPLOAD_WRITE_CHUNK || (final && length > 0)) {
+    int chunk = min(length, UPLOAD_WRITE_CHUNK);
+    if (!uploadWriteChunk(chunk)) return false;
+    length -= chunk;
+  }
+  return true;
+}
+
+// Move the finished file into place
+void uploadFinish() {
+  if (uploadWritten == 0) {
+    uploadRespond(400, "Bad Request", "empty file\n");
+    return;
+  }
+  uploadFile.close();
+
+  // Close cached handles before the old file goes away; a failed replace
+  // keeps the old file
+  assetReaderInvalidate(uploadPath);
+  bool replaced = clockFS().exists(uploadPath);
+  if (!storageReplace(UPLOAD_TEMP_FILE, uploadPath)) {
+    clockFS().remove(UPLOAD_TEMP_FILE);
+    uploadRespond(500, "Internal Server Error", "rename failed\n");
+    return;
+  }
+
+  // Placement summary, ambient color, GIF index and sync hash describe the
+  // previous file
+  if (replaced) {
+    forgetImageSummary(uploadPath);
+    forgetAmbientColor(uploadPath);
+    gifSeekForget(assetPathHash(uploadPath));
+  }
+  syncForget(uploadPath);
+  syncSaveIndex();
+
+  unsigned long elapsed = max(millis() - uploadStartMillis, 1UL);
+  char body[192];
+  snprintf(body, sizeof(body), "path=%s\nbytes=%u\nms=%lu\nheap_before=%u\nheap_min=%u\nwrite_worst_us=%lu\n",
+           uploadPath, (unsigned int)uploadWritten, elapsed, (unsigned int)uploadHeapBefore,
+           (unsigned int)uploadHeapMin, uploadWriteWorst);
+  LOG_INFO("Uploaded %s: %u bytes in %lu ms (%lu KB/s), heap low %u", uploadPath, (unsigned int)uploadWritten,
+           elapsed, uploadWritten / elapsed, (unsigned int)uploadHeapMin);
+
+  strcpy(uploadCompletedPath, uploadPath);
+  uploadCompleted = true;
+  uploadRespond(200, "OK", body);
+}
+
+// Decode chunked transfer encoding in place, returns the data bytes kept
+int uploadDechunk(uint8_t* data, int length) {
+  int in = 0;
+  int out = 0;
+
+  while (in < length && !uploadBodyEnded) {
+    if (chunkState == CHUNK_DATA) {
+      int take = min((uint32_t)(length - in), chunkRemaining);
+      memmove(data + out, data + in, take);
+      in += take;
+      out += take;
+      chunkRemaining -= take;
+      if (chunkRemaining == 0) chunkState = CHUNK_DATA_END;
+      continue;
+    }
+
+    char c = data[in++];
+    if (chunkState == CHUNK_SIZE && isxdigit(c)) {
+      chunkRemaining = chunkRemaining * 16 + (isdigit(c) ? c - '0' : (tolower(c) - 'a' + 10));
+    } else if ((chunkState == CHUNK_SIZE || chunkState == CHUNK_EXTENSION) && c == '\n') {
+      chunkState = (chunkRemaining > 0) ? CHUNK_DATA : CHUNK_TRAILER;
+      chunkLineLength = 0;
+    } else if (chunkState == CHUNK_SIZE && c == ';') {
+      chunkState = CHUNK_EXTENSION;
+    } else if (chunkState == CHUNK_DATA_END && c == '\n') {
+      chunkState = CHUNK_SIZE;
+    } else if (chunkState == CHUNK_TRAILER && c == '\n') {
+      // An empty line ends the trailer and the body
+      if (chunkLineLength == 0) uploadBodyEnded = true;
+      chunkLineLength = 0;
+    } else if (chunkState == CHUNK_TRAILER && c != '\r') {
+      chunkLineLength++;
+    }
+  }
+  return out;
+}
+
+// Read body data into the buffer, as much as fits and has arrived
+int uploadReadBody() {
+  int room = UPLOAD_BUFFER_SIZE - uploadPending;
+  if (!uploadChunked) room = min((uint32_t)room, uploadRemaining);
+
+  int available = uploadClient.available();
+  if (room <= 0 || available <= 0) return 0;
+
+  int received = uploadClient.read(uploadBuffer + uploadPending, min(room, available));
+  if (received <= 0) return 0;
+
+  if (uploadChunked) {
+    uploadPending += uploadDechunk(uploadBuffer + uploadPending, received);
+  } else {
+    uploadPending += received;
+    uploadRemaining -= received;
+    uploadBodyEnded = (uploadRemaining == 0);
+  }
+  return received;
+}
+
+// Multipart: find the file part headers and take the file name from them
+void uploadParsePartHeaders() {
+  uint8_t* end = (uint8_t*)memmem(uploadBuffer, uploadPending, "\r\n\r\n", 4);
+  if (end == NULL) {
+    if (uploadPending >= UPLOAD_BUFFER_SIZE || uploadBodyEnded) {
+      uploadRespond(400, "Bad Request", "no file part\n");
+    }
+    return;
+  }
+
+  *end = '\0';
+  const char* filename = strstr((const char*)uploadBuffer, "filename=\"");
+  char name[UPLOAD_PATH_LENGTH + 1];
+  if (filename == NULL) {
+    uploadRespond(400, "Bad Request", "no file name\n");
+    return;
+  }
+  uploadHeaderValue(filename + 10, name, sizeof(name), "\"");
+  if (!uploadSetPath(name)) {
+    uploadRespond(415, "Unsupported Media Type", "not a background file name\n");
+    return;
+  }
+  if (!uploadOpenFile()) return;
+
+  int headerLength = end + 4 - uploadBuffer;
+  uploadPending -= headerLength;
+  memmove(uploadBuffer, uploadBuffer + headerLength, uploadPending);
+  uploadState = UPLOAD_DATA;
+}
+
+// Store what arrived, holding back anything that could be the start of the closing boundary
+void uploadStoreData() {
+  if (!uploadMultipart) {
+    if (!uploadWriteData(uploadPending, uploadBodyEnded)) return;
+    if (uploadBodyEnded) uploadFinish();
+    return;
+  }
+
+  uint8_t* delimiter = (uint8_t*)memmem(uploadBuffer, uploadPending, uploadDelimiter, uploadDelimiterLength);
+  if (delimiter != NULL) {
+    if (uploadWriteData(delimiter - uploadBuffer, true)) uploadFinish();
+    return;
+  }
+
+  if (uploadBodyEnded) {
+    uploadRespond(400, "Bad Request", "body ended inside the file part\n");
+    return;
+  }
+  uploadWriteData(max(uploadPending - (uploadDelimiterLength - 1), 0), false);
+}
+
+// Read the request line and headers and decide how the body is framed
+void uploadParseHeaders() {
+  while (uploadClient.available() > 0 && uploadHeaderLength < UPLOAD_HEADER_SIZE - 1) {
+    uploadHeaders[uploadHeaderLength++] = uploadClient.read();
+    uploadHeaders[uploadHeaderLength] = '\0';
+    if (uploadHeaderLength >= 4 && strcmp(uploadHeaders + uploadHeaderLength - 4, "\r\n\r\n") == 0) break;
+  }
+
+  if (uploadHeaderLength < 4 || strcmp(uploadHeaders + uploadHeaderLength - 4, "\r\n\r\n") != 0) {
+    if (uploadHeaderLength >= UPLOAD_HEADER_SIZE - 1) {
+      uploadRespond(431, "Request Header Fields Too Large", "headers too large\n");
+    }
+    return;
+  }
+
+  bool put = strncmp(uploadHeaders, "PUT /upload/", 12) == 0;
+  bool post = strncmp(uploadHeaders, "POST /upload", 12) == 0 && (uploadHeaders[12] == ' ' || uploadHeaders[12] == '/');
+  if (!put && !post) {
+    uploadRespond(404, "Not Found", "use PUT /upload/<name> or POST /upload\n");
+    return;
+  }
+
+  const char* transfer = uploadHeader("Transfer-Encoding");
+  const char* length = uploadHeader("Content-Length");
+  uploadChunked = (transfer != NULL && strncasecmp(transfer, "chunked", 7) == 0);
+  uploadExpected = (!uploadChunked && length != NULL) ? strtoul(length, NULL, 10) : 0;
+  uploadRemaining = uploadExpected;
+  if (!uploadChunked && length == NULL) {
+    uploadRespond(411, "Length Required", "send Content-Length or chunked\n");
+    return;
+  }
+
+  // A multipart body names its file in the part headers
+  const char* type = uploadHeader("Content-Type");
+  const char* boundary = (type != NULL) ? strstr(type, "boundary=") : NULL;
+  uploadMultipart = (type != NULL && strncasecmp(type, "multipart/form-data", 19) == 0);
+  if (uploadMultipart) {
+    if (boundary == NULL) {
+      uploadRespond(400, "Bad Request", "no multipart boundary\n");
+      return;
+    }
+    boundary += 9;
+    if (*boundary == '"') boundary++;
+    strcpy(uploadDelimiter, "\r\n--");
+    uploadHeaderValue(boundary, uploadDelimiter + 4, UPLOAD_BOUNDARY_MAX, "\";");
+    uploadDelimiterLength = strlen(uploadDelimiter);
+  } else {
+    char name[UPLOAD_PATH_LENGTH + 1];
+    uploadHeaderValue(uploadHeaders + (put ? 12 : 13), name, sizeof(name), " ?");
+    if (!uploadSetPath(name)) {
+      uploadRespond(415, "Unsupported Media Type", "not a background file name\n");
+      return;
+    }
+    if (!uploadOpenFile()) return;
+  }
+
+  // curl waits for this before sending larger bodies
+  const char* expect = uploadHeader("Expect");
+  if (expect != NULL && strncasecmp(expect, "100-continue", 12) == 0) {
+    uploadClient.print("HTTP/1.1 100 Continue\r\n\r\n");
+  }
+
+  uploadPending = 0;
+  uploadBodyEnded = (!uploadChunked && uploadRemaining == 0);
+  chunkState = CHUNK_SIZE;
+  chunkRemaining = 0;
+  uploadState = uploadMultipart ? UPLOAD_PART_HEADERS : UPLOAD_DATA;
+}
+
+// Accept and move an upload along a slice at a time - call once per loop
+void uploadService() {
+#if UPLOAD_PORT > 0
+  if (uploadState == UPLOAD_IDLE) {
+    uploadClient = uploadServer.available();
+    if (!uploadClient) return;
+
+    uploadState = UPLOAD_HEADERS;
+    uploadHeaderLength = 0;
+    uploadStartMillis = millis();
+    uploadLastData = uploadStartMillis;
+    uploadHeapBefore = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uploadHeapMin = uploadHeapBefore;
+    uploadWriteWorst = 0;
+  }
+
+  if (millis() - uploadLastData > UPLOAD_IDLE_TIMEOUT) {
+    uploadRespond(408, "Request Timeout", "timed out\n");
+    return;
+  }
+
+  if (uploadState == UPLOAD_HEADERS) {
+    if (uploadClient.available() > 0) uploadLastData = millis();
+    uploadParseHeaders();
+  }
+
+  // Bounded work per pass so the display keeps its frame rate
+  int sliceBytes = 0;
+  while ((uploadState == UPLOAD_PART_HEADERS || uploadState == UPLOAD_DATA) && sliceBytes < UPLOAD_SLICE_BYTES) {
+    int received = uploadReadBody();
+    sliceBytes += received;
+    if (received > 0) uploadLastData = millis();
+
+    if (uploadState == UPLOAD_PART_HEADERS) {
+      uploadParsePartHeaders();
+    }
+    if (uploadState == UPLOAD_DATA) {
+      int pendingBefore = uploadPending;
+      uploadStoreData();
+      if (received == 0 && uploadState == UPLOAD_DATA && uploadPending == pendingBefore) break;
+    } else if (received == 0) {
+      break;
+    }
+  }
+
+  if (uploadState != UPLOAD_IDLE) {
+    uploadHeapMin = min(uploadHeapMin, heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  }
+#endif
+}
+
+#endif  // ASSET_UPLOAD_H
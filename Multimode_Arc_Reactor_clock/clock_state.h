@@ -0,0 +1,150 @@
+/*
+ * clock_state.h - Published clock state snapshot
+ * For Multi-Mode Digital Clock project
+ * Time, date, mode, LED color and the refresh request live in one
+ * ClockState published through a seqlock. Producers (time keeping,
+ * buttons, weather) write it in short serialized sections; readers copy it
+ * without ever blocking a writer and retry if a write overlapped the copy.
+ * The familiar globals (hours, currentMode, ...) are the loop task's
+ * per-frame view: clockStateSnapshot() refreshes them from one consistent
+ * copy, so a frame never mixes the minutes of one second with the hours of
+ * the next.
+ */
+
+#ifndef CLOCK_STATE_H
+#define CLOCK_STATE_H
+
+#include <Arduino.h>
+
+#define CLOCK_DAY_LENGTH 12  // "WEDNESDAY" plus terminator
+
+struct ClockState {
+  int hours;
+  int minutes;
+  int seconds;
+  int day;
+  int month;
+  int year;
+  char dayOfWeek[CLOCK_DAY_LENGTH];
+  int mode;      // MODE_xxx
+  int ledColor;  // COLOR_xxx
+  bool refresh;  // Full redraw requested
+};
+
+// Loop task view, defined in the main sketch and theme_manager.h
+extern int hours, minutes, seconds;
+extern int day, month, year;
+extern String dayOfWeek;
+extern int currentMode;
+extern int currentLedColor;
+
+ClockState clockShared;
+volatile uint32_t clockSequence = 0;  // Odd while a write is in progress
+portMUX_TYPE clockWriteMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Function prototypes
+void clockStateBegin();
+void clockStateRead(ClockState& state);
+void clockStateSnapshot();
+void clockSetMode(int mode);
+void clockSetLedColor(int color);
+void clockRequestRefresh();
+bool clockTakeRefresh();
+
+// Start a write - keep the section short, no I/O inside
+ClockState& clockWriteBegin() {
+  portENTER_CRITICAL(&clockWriteMux);
+  clockSequence++;
+  __sync_synchronize();
+  return clockShared;
+}
+
+void clockWriteEnd() {
+  __sync_synchronize();
+  clockSequence++;
+  portEXIT_CRITICAL(&clockWriteMux);
+}
+
+// Publish the initial view - call first thing in setup()
+void clockStateBegin() {
+  ClockState& state = clockWriteBegin();
+  state.hours = hours;
+  state.minutes = minutes;
+  state.seconds = seconds;
+  state.day = day;
+  state.month = month;
+  state.year = year;
+  strncpy(state.dayOfWeek, dayOfWeek.c_str(), CLOCK_DAY_LENGTH - 1);
+  state.mode = currentMode;
+  state.ledColor = currentLedColor;
+  state.refresh = false;
+  clockWriteEnd();
+}
+
+// Consistent copy of the published state, from any task or core
+void clockStateRead(ClockState& state) {
+  uint32_t before, after;
+  do {
+    before = clockSequence;
+    __sync_synchronize();
+    memcpy(&state, (const void*)&clockShared, sizeof(state));
+    __sync_synchronize();
+    after = clockSequence;
+  } while ((before & 1) || before != after);
+}
+
+// Refresh the loop task view - call at the start of a frame
+void clockStateSnapshot() {
+  ClockState state;
+  clockStateRead(state);
+
+  hours = state.hours;
+  minutes = state.minutes;
+  seconds = state.seconds;
+  day = state.day;
+  month = state.month;
+  year = state.year;
+  currentMode = state.mode;
+  currentLedColor = state.ledColor;
+
+  // Only touch the String when the day changed
+  if (strcmp(dayOfWeek.c_str(), state.dayOfWeek) != 0) {
+    dayOfWeek = state.dayOfWeek;
+  }
+}
+
+// Producers below update the caller's view too, so code that sets a value
+// and reads it straight back keeps working
+
+void clockSetMode(int mode) {
+  ClockState& state = clockWriteBegin();
+  state.mode = mode;
+  clockWriteEnd();
+  currentMode = mode;
+}
+
+void clockSetLedColor(int color) {
+  ClockState& state = clockWriteBegin();
+  state.ledColor = color;
+  clockWriteEnd();
+  currentLedColor = color;
+}
+
+void clockRequestRefresh() {
+  ClockState& state = clockWriteBegin();
+  state.refresh = true;
+  clockWriteEnd();
+}
+
+// Returns whether a redraw was requested and clears the request
+bool clockTakeRefresh() {
+  if (!((volatile ClockState&)clockShared).refresh) return false;
+
+  ClockState& state = clockWriteBegin();
+  bool requested = state.refresh;
+  state.refresh = false;
+  clockWriteEnd();
+  return requested;
+}
+
+#endif  // CLOCK_STATE_H
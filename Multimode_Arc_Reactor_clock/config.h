@@ -12,15 +12,57 @@
 // WiFi settings
 #define WIFI_SSID "your-wifi-ssid"        // Replace with your WiFi network name
 #define WIFI_PASSWORD "your-wifi-password" // Replace with your WiFi password
+#define WIFI_FAST_RECONNECT 1              // 1 = reconnect straight to the last access point, skipping the scan and DHCP
+#define WIFI_STATIC_IP ""                  // Fixed address like "192.168.1.50" ("" = DHCP)
+#define WIFI_GATEWAY ""                    // Used with WIFI_STATIC_IP
+#define WIFI_SUBNET "255.255.255.0"        // Used with WIFI_STATIC_IP
+#define WIFI_DNS ""                        // Used with WIFI_STATIC_IP ("" = the gateway)
 
 // OpenWeatherMap API settings
 #define WEATHER_API_KEY "your-api-key"     // Your OpenWeatherMap API key
 #define WEATHER_CITY_ID 5391959            // City ID for weather (default: San Francisco, CA)
 #define WEATHER_UNITS "imperial"           // Options: "imperial" for °F, "metric" for °C
 
+// MQTT settings (optional, see mqtt_link.h and tools/weather_aggregator.py)
+#define MQTT_BROKER ""                     // Broker address like "192.168.1.10" ("" = no MQTT, weather is polled)
+#define MQTT_PORT 1883
+#define MQTT_USER ""                       // Leave empty for brokers without authentication
+#define MQTT_PASSWORD ""
+#define MQTT_TOPIC_PREFIX "clock"          // Weather on <prefix>/weather, commands on <prefix>/all/cmd and <prefix>/<id>/cmd
+
+// Asset sync settings (optional, see asset_sync.h and tools/make_manifest.py)
+#define SYNC_SERVER ""                     // Content server like "192.168.1.10" ("" = no sync)
+#define SYNC_PORT 8000
+#define SYNC_INTERVAL_MINUTES 30           // How often the manifest is checked
+#define SYNC_RATE_KBPS 32                  // Download rate limit
+#define SYNC_DELETE 1                      // 1 = delete synced backgrounds the manifest no longer lists
+
 // NTP Server settings
 #define NTP_SERVER "pool.ntp.org"
 #define GMT_OFFSET_SEC -28800              // PST offset (-8 hours * 3600 seconds/hour)
 #define DAYLIGHT_OFFSET_SEC 3600           // Daylight saving time adjustment (1 hour)
 
+// Display rendering options
+#define USE_SHADOW_FRAMEBUFFER 0           // 1 = draw into a PSRAM canvas and push only changed tiles (PSRAM boards only)
+#define USE_STRIP_COMPOSITOR 0             // 1 = compose Arc Digital and Apple Rings in DMA strips
+#define DRAW_QUEUE_STATS 0                 // 1 = print estimated draw queue address-window/byte counts before and after coalescing
+#define SMOOTH_FONT_FILE "/font.vlw"       // TFT_eSPI smooth font for labels (built-in font if missing)
+#define APPLE_RINGS_AA 1                   // 1 = anti-aliased Apple Rings edges and caps (0 = triangle fans)
+#define FRAME_BUDGET_MS 50                 // Loop pass budget before the governor lowers animation quality
+#define USE_ASSET_PARTITION 0              // 1 = read backgrounds from the mapped "assets" partition (see tools/pack_assets.py)
+#define AMBIENT_LED 1                      // 1 = LEDs take their color from the background unless one was chosen for it
+#define METRICS_PORT 9100                  // Prometheus metrics at http://<clock>:9100/metrics (0 = off)
+#define UPLOAD_PORT 8080                   // Background uploads to http://<clock>:8080/upload (0 = off, see tools/upload_asset.py)
+#define GIF_SYNC_SECONDS 0                 // 0 = GIF backgrounds run freely, N = one loop every N seconds in step with the clock
+
+// Storage options
+#define USE_LITTLEFS 0                     // 1 = keep files on LittleFS, copied from SPIFFS on first boot (see tools/partitions_littlefs.csv)
+#define STORAGE_BENCHMARK 0                // 1 = run the file system I/O benchmark at startup and print it over Serial
+#define STORAGE_IDLE_GC 1                  // 1 = run SPIFFS garbage collection in idle time after settings are saved
+
+// Logging options
+#define LOG_LEVEL 3                        // 0 = off, 1 = errors, 2 = warnings, 3 = info, 4 = debug
+#define LOG_DRAIN_TASK 1                   // 1 = print log records from a low-priority task, 0 = from loop()
+#define LOG_CRASH_FLUSH 1                  // 1 = keep log records in RTC memory and print them after a crash
+
 #endif // CONFIG_H
@@ -0,0 +1,430 @@
+/*
+ * draw_queue.h - Coalescing draw command queue in front of TFT_eSPI
+ * For Multi-Mode Digital Clock project
+ * Records small primitives, merges adjacent fills, drops draws that a later
+ * opaque fill covers completely and replays the rest in one SPI transaction.
+ * The traffic statistics are estimates from a model of how TFT_eSPI draws
+ * each primitive, not measured bus traffic.
+ */
+
+#ifndef DRAW_QUEUE_H
+#define DRAW_QUEUE_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "config.h"
+#include "utils.h"
+#include "frame_buffer.h"
+#include "glyph_cache.h"
+
+// Print per-frame queue statistics every DRAW_QUEUE_STATS_INTERVAL ms
+#ifndef DRAW_QUEUE_STATS
+#define DRAW_QUEUE_STATS 0
+#endif
+#define DRAW_QUEUE_STATS_INTERVAL 10000
+
+// Queue capacity - the queue flushes itself when full
+#define DRAW_QUEUE_SIZE 96
+#define DRAW_QUEUE_TEXT_LENGTH 12
+
+// Recorded primitive types
+#define DRAW_CMD_FILL_RECT 0
+#define DRAW_CMD_LINE 1
+#define DRAW_CMD_THICK_LINE 2
+#define DRAW_CMD_TRIANGLE 3
+#define DRAW_CMD_FILL_CIRCLE 4
+#define DRAW_CMD_TEXT 5
+
+// One recorded primitive with its bounding box
+struct DrawCommand {
+  uint8_t type;
+  bool opaque;   // Paints every pixel of its bounding box
+  bool dropped;  // Covered by a later opaque draw
+  int16_t x0, y0, x1, y1, x2, y2;
+  int16_t boxX, boxY, boxW, boxH;
+  uint16_t color;
+  uint16_t bgColor;
+  uint8_t textSize;
+  char text[DRAW_QUEUE_TEXT_LENGTH];
+};
+
+// Estimated panel traffic (address window setups and pixel bytes), see estimateDrawTraffic()
+struct DrawTraffic {
+  uint32_t windows;
+  uint32_t bytes;
+};
+
+DrawCommand drawQueue[DRAW_QUEUE_SIZE];
+int drawQueueCount = 0;
+
+// Traffic as recorded by callers vs. actually issued after coalescing
+DrawTraffic drawTrafficRecorded = { 0, 0 };
+DrawTraffic drawTrafficIssued = { 0, 0 };
+DrawTraffic lastFrameRecorded = { 0, 0 };
+DrawTraffic lastFrameIssued = { 0, 0 };
+unsigned long lastDrawStatsPrint = 0;
+
+// Function prototypes
+void queueFillRect(int x, int y, int w, int h, uint16_t color);
+void queueDrawLine(int x0, int y0, int x1, int y1, uint16_t color);
+void queueThickLine(int x0, int y0, int x1, int y1, int radius, uint16_t color);
+void queueFillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color);
+void queueFillCircle(int x, int y, int r, uint16_t color);
+void queueText(int x, int y, const char* text, uint8_t size, uint16_t color);
+void queueTextOpaque(int x, int y, const char* text, uint8_t size, uint16_t color, uint16_t bgColor);
+void flushDrawQueue();
+void drawQueueEndFrame();
+
+// Estimate what a command costs on the panel, following how TFT_eSPI draws it
+DrawTraffic estimateDrawTraffic(const DrawCommand& cmd) {
+  DrawTraffic t = { 0, 0 };
+  int dx = abs(cmd.x1 - cmd.x0);
+  int dy = abs(cmd.y1 - cmd.y0);
+
+  switch (cmd.type) {
+    case DRAW_CMD_FILL_RECT:
+      t.windows = 1;
+      t.bytes = (uint32_t)cmd.boxW * cmd.boxH * 2;
+      break;
+
+    case DRAW_CMD_LINE:
+      // One window per straight run of pixels
+      t.windows = min(dx, dy) + 1;
+      t.bytes = (max(dx, dy) + 1) * 2;
+      break;
+
+    case DRAW_CMD_THICK_LINE:
+    case DRAW_CMD_TRIANGLE:
+    case DRAW_CMD_FILL_CIRCLE:
+      // Filled shapes are drawn as one horizontal span per row
+      t.windows = cmd.boxH;
+      t.bytes = (uint32_t)cmd.boxW * cmd.boxH;  // Roughly half the box is covered
+      break;
+
+    case DRAW_CMD_TEXT: {
+      int chars = strlen(cmd.text);
+      if (cmd.opaque) {
+        t.windows = (cmd.textSize == 1) ? chars : chars * 8 * cmd.textSize;
+        t.bytes = (uint32_t)cmd.boxW * cmd.boxH * 2;
+      } else {
+        // Transparent glyphs are drawn pixel block by pixel block (~20 per glyph)
+        t.windows = chars * 20;
+        t.bytes = t.windows * cmd.textSize * cmd.textSize * 2;
+      }
+      break;
+    }
+  }
+
+  return t;
+}
+
+// Check if box a lies completely inside box b
+bool drawBoxInside(const DrawCommand& a, const DrawCommand& b) {
+  return a.boxX >= b.boxX && a.boxY >= b.boxY && a.boxX + a.boxW <= b.boxX + b.boxW && a.boxY + a.boxH <= b.boxY + b.boxH;
+}
+
+// Drop every earlier command that the new opaque command hides completely
+void dropCoveredCommands(const DrawCommand& cover) {
+  for (int i = 0; i < drawQueueCount; i++) {
+    if (!drawQueue[i].dropped && drawBoxInside(drawQueue[i], cover)) {
+      drawQueue[i].dropped = true;
+    }
+  }
+}
+
+// Try to extend the previous fill with a new one of the same color
+bool mergeWithPreviousFill(const DrawCommand& cmd) {
+  if (drawQueueCount == 0) return false;
+
+  DrawCommand& prev = drawQueue[drawQueueCount - 1];
+  if (prev.dropped || prev.type != DRAW_CMD_FILL_RECT || prev.color != cmd.color) return false;
+
+  // Same rows, touching or overlapping columns
+  if (prev.boxY == cmd.boxY && prev.boxH == cmd.boxH && cmd.boxX <= prev.boxX + prev.boxW && prev.boxX <= cmd.boxX + cmd.boxW) {
+    int right = max(prev.boxX + prev.boxW, cmd.boxX + cmd.boxW);
+    prev.boxX = min(prev.boxX, cmd.boxX);
+    prev.boxW = right - prev.boxX;
+    return true;
+  }
+
+  // Same columns, touching or overlapping rows
+  if (prev.boxX == cmd.boxX && prev.boxW == cmd.boxW && cmd.boxY <= prev.boxY + prev.boxH && prev.boxY <= cmd.boxY + cmd.boxH) {
+    int bottom = max(prev.boxY + prev.boxH, cmd.boxY + cmd.boxH);
+    prev.boxY = min(prev.boxY, cmd.boxY);
+    prev.boxH = bottom - prev.boxY;
+    return true;
+  }
+
+  return false;
+}
+
+// Add a command to the queue, coalescing where possible. 'cost' is what
+// the caller's original drawing would have sent without the queue.
+void recordDrawCommand(DrawCommand& cmd, DrawTraffic cost) {
+  cmd.dropped = false;
+
+  drawTrafficRecorded.windows += cost.windows;
+  drawTrafficRecorded.bytes += cost.bytes;
+
+  if (cmd.opaque) {
+    dropCoveredCommands(cmd);
+  }
+
+  if (cmd.type == DRAW_CMD_FILL_RECT && mergeWithPreviousFill(cmd)) {
+    return;
+  }
+
+  if (drawQueueCount >= DRAW_QUEUE_SIZE) {
+    flushDrawQueue();
+  }
+
+  drawQueue[drawQueueCount++] = cmd;
+}
+
+void recordDrawCommand(DrawCommand& cmd) {
+  recordDrawCommand(cmd, estimateDrawTraffic(cmd));
+}
+
+// Fill the convex hull of a line swept by a square of the given radius
+void fillThickLine(const DrawCommand& cmd) {
+  int r = cmd.x2;
+  int px[8] = { cmd.x0 - r, cmd.x0 + r, cmd.x0 + r, cmd.x0 - r, cmd.x1 - r, cmd.x1 + r, cmd.x1 + r, cmd.x1 - r };
+  int py[8] = { cmd.y0 - r, cmd.y0 - r, cmd.y0 + r, cmd.y0 + r, cmd.y1 - r, cmd.y1 - r, cmd.y1 + r, cmd.y1 + r };
+
+  // Sort points by x then y (insertion sort, 8 points)
+  for (int i = 1; i < 8; i++) {
+    int x = px[i], y = py[i], j = i - 1;
+    while (j >= 0 && (px[j] > x || (px[j] == x && py[j] > y))) {
+      px[j + 1] = px[j];
+      py[j + 1] = py[j];
+      j--;
+    }
+    px[j + 1] = x;
+    py[j + 1] = y;
+  }
+
+  // Monotone chain convex hull
+  int hx[16], hy[16], k = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    int start = k;
+    for (int n = 0; n < 8; n++) {
+      int i = (pass == 0) ? n : 7 - n;
+      while (k >= start + 2) {
+        long cross = (long)(hx[k - 1] - hx[k - 2]) * (py[i] - hy[k - 2]) - (long)(hy[k - 1] - hy[k - 2]) * (px[i] - hx[k - 2]);
+        if (cross > 0) break;
+        k--;
+      }
+      hx[k] = px[i];
+      hy[k] = py[i];
+      k++;
+    }
+    k--;  // Last point repeats as the first point of the next chain
+  }
+
+  // Triangle fan over the hull
+  for (int i = 1; i + 1 < k; i++) {
+    tft->fillTriangle(hx[0], hy[0], hx[i], hy[i], hx[i + 1], hy[i + 1], cmd.color);
+  }
+}
+
+// Replay one command on the display
+void executeDrawCommand(const DrawCommand& cmd) {
+  switch (cmd.type) {
+    case DRAW_CMD_FILL_RECT:
+      tft->fillRect(cmd.boxX, cmd.boxY, cmd.boxW, cmd.boxH, cmd.color);
+      break;
+    case DRAW_CMD_LINE:
+      tft->drawLine(cmd.x0, cmd.y0, cmd.x1, cmd.y1, cmd.color);
+      break;
+    case DRAW_CMD_THICK_LINE:
+      fillThickLine(cmd);
+      break;
+    case DRAW_CMD_TRIANGLE:
+      tft->fillTriangle(cmd.x0, cmd.y0, cmd.x1, cmd.y1, cmd.x2, cmd.y2, cmd.color);
+      break;
+    case DRAW_CMD_FILL_CIRCLE:
+      tft->fillCircle(cmd.x0, cmd.y0, cmd.x2, cmd.color);
+      break;
+    case DRAW_CMD_TEXT:
+      drawText(cmd.x0, cmd.y0, cmd.text, cmd.textSize, cmd.color, cmd.bgColor, cmd.opaque);
+      break;
+  }
+}
+
+// Record a filled rectangle
+void queueFillRect(int x, int y, int w, int h, uint16_t color) {
+  if (w <= 0 || h <= 0) return;
+
+  DrawCommand cmd = {};
+  cmd.type = DRAW_CMD_FILL_RECT;
+  cmd.opaque = true;
+  cmd.boxX = x;
+  cmd.boxY = y;
+  cmd.boxW = w;
+  cmd.boxH = h;
+  cmd.color = color;
+  recordDrawCommand(cmd);
+}
+
+// Record a one pixel wide line
+void queueDrawLine(int x0, int y0, int x1, int y1, uint16_t color) {
+  DrawCommand cmd = {};
+  cmd.type = DRAW_CMD_LINE;
+  cmd.opaque = false;
+  cmd.x0 = x0;
+  cmd.y0 = y0;
+  cmd.x1 = x1;
+  cmd.y1 = y1;
+  cmd.boxX = min(x0, x1);
+  cmd.boxY = min(y0, y1);
+  cmd.boxW = abs(x1 - x0) + 1;
+  cmd.boxH = abs(y1 - y0) + 1;
+  cmd.color = color;
+  recordDrawCommand(cmd);
+}
+
+// Record a line widened by 'radius' pixels on every side. Replaces a bundle
+// of offset drawLine() calls with a single filled shape.
+void queueThickLine(int x0, int y0, int x1, int y1, int radius, uint16_t color) {
+  DrawCommand cmd = {};
+  cmd.type = DRAW_CMD_THICK_LINE;
+  cmd.opaque = false;
+  cmd.x0 = x0;
+  cmd.y0 = y0;
+  cmd.x1 = x1;
+  cmd.y1 = y1;
+  cmd.x2 = radius;
+  cmd.boxX = min(x0, x1) - radius;
+  cmd.boxY = min(y0, y1) - radius;
+  cmd.boxW = abs(x1 - x0) + 2 * radius + 1;
+  cmd.boxH = abs(y1 - y0) + 2 * radius + 1;
+  cmd.color = color;
+
+  // Without the queue this was (2r+1)^2 separate offset lines
+  DrawCommand line = cmd;
+  line.type = DRAW_CMD_LINE;
+  DrawTraffic cost = estimateDrawTraffic(line);
+  int lines = (2 * radius + 1) * (2 * radius + 1);
+  cost.windows *= lines;
+  cost.bytes *= lines;
+
+  recordDrawCommand(cmd, cost);
+}
+
+// Record a filled triangle
+void queueFillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color) {
+  DrawCommand cmd = {};
+  cmd.type = DRAW_CMD_TRIANGLE;
+  cmd.opaque = false;
+  cmd.x0 = x0;
+  cmd.y0 = y0;
+  cmd.x1 = x1;
+  cmd.y1 = y1;
+  cmd.x2 = x2;
+  cmd.y2 = y2;
+  cmd.boxX = min(x0, min(x1, x2));
+  cmd.boxY = min(y0, min(y1, y2));
+  cmd.boxW = max(x0, max(x1, x2)) - cmd.boxX + 1;
+  cmd.boxH = max(y0, max(y1, y2)) - cmd.boxY + 1;
+  cmd.color = color;
+  recordDrawCommand(cmd);
+}
+
+// Record a filled circle
+void queueFillCircle(int x, int y, int r, uint16_t color) {
+  DrawCommand cmd = {};
+  cmd.type = DRAW_CMD_FILL_CIRCLE;
+  cmd.opaque = false;
+  cmd.x0 = x;
+  cmd.y0 = y;
+  cmd.x2 = r;
+  cmd.boxX = x - r;
+  cmd.boxY = y - r;
+  cmd.boxW = 2 * r + 1;
+  cmd.boxH = 2 * r + 1;
+  cmd.color = color;
+  recordDrawCommand(cmd);
+}
+
+// Shared setup for text commands - the box uses the real font metrics
+void recordTextCommand(int x, int y, const char* text, uint8_t size, uint16_t color, uint16_t bgColor, bool opaque) {
+  DrawCommand cmd = {};
+  cmd.type = DRAW_CMD_TEXT;
+  cmd.opaque = opaque;
+  cmd.x0 = x;
+  cmd.y0 = y;
+  strncpy(cmd.text, text, DRAW_QUEUE_TEXT_LENGTH - 1);
+  cmd.text[DRAW_QUEUE_TEXT_LENGTH - 1] = '\0';
+  cmd.textSize = size;
+  cmd.boxX = x;
+  cmd.boxY = y;
+  cmd.boxW = textWidth(cmd.text, size);
+  cmd.boxH = textHeight(size);
+  cmd.color = color;
+  cmd.bgColor = bgColor;
+  recordDrawCommand(cmd);
+}
+
+// Record transparent text
+void queueText(int x, int y, const char* text, uint8_t size, uint16_t color) {
+  recordTextCommand(x, y, text, size, color, color, false);
+}
+
+// Record text that paints its own background
+void queueTextOpaque(int x, int y, const char* text, uint8_t size, uint16_t color, uint16_t bgColor) {
+  recordTextCommand(x, y, text, size, color, bgColor, true);
+}
+
+// Replay all surviving commands inside one write transaction
+void flushDrawQueue() {
+  if (drawQueueCount == 0) return;
+
+  // The shadow canvas lives in RAM - no bus transaction to batch
+  bool useTransaction = !frameBufferActive();
+  if (useTransaction) {
+    tft->startWrite();
+  }
+
+  for (int i = 0; i < drawQueueCount; i++) {
+    if (drawQueue[i].dropped) continue;
+
+    DrawTraffic t = estimateDrawTraffic(drawQueue[i]);
+    drawTrafficIssued.windows += t.windows;
+    drawTrafficIssued.bytes += t.bytes;
+    executeDrawCommand(drawQueue[i]);
+  }
+
+  if (useTransaction) {
+    tft->endWrite();
+  }
+
+  drawQueueCount = 0;
+}
+
+// Close the frame's statistics; prints a summary when DRAW_QUEUE_STATS is on
+void drawQueueEndFrame() {
+  flushDrawQueue();
+
+  if (drawTrafficRecorded.windows > 0) {
+    lastFrameRecorded = drawTrafficRecorded;
+    lastFrameIssued = drawTrafficIssued;
+  }
+  drawTrafficRecorded.windows = drawTrafficRecorded.bytes = 0;
+  drawTrafficIssued.windows = drawTrafficIssued.bytes = 0;
+
+#if DRAW_QUEUE_STATS
+  if (millis() - lastDrawStatsPrint >= DRAW_QUEUE_STATS_INTERVAL) {
+    lastDrawStatsPrint = millis();
+    Serial.print("Draw queue (estimated): windows ");
+    Serial.print(lastFrameRecorded.windows);
+    Serial.print(" -> ");
+    Serial.print(lastFrameIssued.windows);
+    Serial.print(", bytes ");
+    Serial.print(lastFrameRecorded.bytes);
+    Serial.print(" -> ");
+    Serial.println(lastFrameIssued.bytes);
+  }
+#endif
+}
+
+#endif  // DRAW_QUEUE_H
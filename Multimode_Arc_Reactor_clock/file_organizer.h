@@ -8,6 +8,9 @@
 #define FILE_ORGANIZER_H
 
 #include <Arduino.h>
+#include "log_buffer.h"
+#include "theme_pack.h"
+#include "theme_manager.h"
 
 // External references
 extern String backgroundImages[];
@@ -36,12 +39,16 @@ int getNumericPrefix(String filename) {
   return prefix.toInt();
 }
 
-// Helper function for file type identification
+// Helper function for file type identification (themes by their image)
 bool isJpegFile(const String& filename) {
+  const ThemeHeader* theme = themeLookup(filename.c_str());
+  if (theme != NULL) return theme->imageType == THEME_IMAGE_JPEG;
   return filename.endsWith(".jpg") || filename.endsWith(".jpeg");
 }
 
 bool isGifFile(const String& filename) {
+  const ThemeHeader* theme = themeLookup(filename.c_str());
+  if (theme != NULL) return theme->imageType == THEME_IMAGE_GIF;
   return filename.endsWith(".gif");
 }
 
@@ -66,6 +73,15 @@ bool isAppleRingsFile(const String& filename) {
 // Determine file category (for sorting priority)
 // 0: JPEG, 1: GIF, 2: Weather, 3: Vaultboy, 4: Apple Rings, 5: Other
 int getFileCategory(const String& filename) {
+  // Themes say which mode they belong to
+  const ThemeHeader* theme = themeLookup(filename.c_str());
+  if (theme != NULL) {
+    if (theme->mode == MODE_APPLE_RINGS) return 4;
+    if (theme->mode == MODE_PIPBOY) return 3;
+    if (theme->mode == MODE_WEATHER) return 2;
+    return (theme->imageType == THEME_IMAGE_GIF) ? 1 : 0;
+  }
+
   if (isAppleRingsFile(filename)) return 4;
   if (isVaultboyFile(filename)) return 3;
   if (isWeatherFile(filename)) return 2;
@@ -108,16 +124,10 @@ void sortBackgroundImages() {
   }
   
   // Debug print the sorted order
-  Serial.println("Sorted background order:");
+  LOG_INFO("Sorted %d backgrounds", numBgImages);
   for (int i = 0; i < numBgImages; i++) {
-    Serial.print(i);
-    Serial.print(": ");
-    Serial.print(backgroundImages[i]);
-    Serial.print(" (Category: ");
-    Serial.print(getFileCategory(backgroundImages[i]));
-    Serial.print(", Prefix: ");
-    Serial.print(getNumericPrefix(backgroundImages[i]));
-    Serial.println(")");
+    LOG_DEBUG("%d: %s (Category: %d, Prefix: %d)", i, backgroundImages[i],
+              getFileCategory(backgroundImages[i]), getNumericPrefix(backgroundImages[i]));
   }
   
   currentBgIndex = 0;
@@ -126,12 +136,7 @@ void sortBackgroundImages() {
 // Print current background info
 void printCurrentBackground() {
   if (currentBgIndex >= 0 && currentBgIndex < numBgImages) {
-    Serial.print("Current background (");
-    Serial.print(currentBgIndex + 1);
-    Serial.print("/");
-    Serial.print(numBgImages);
-    Serial.print("): ");
-    Serial.println(backgroundImages[currentBgIndex]);
+    LOG_INFO("Current background (%d/%d): %s", currentBgIndex + 1, numBgImages, backgroundImages[currentBgIndex]);
   }
 }
 
@@ -0,0 +1,299 @@
+/*
+ * frame_buffer.h - Optional PSRAM shadow framebuffer with tile diffing
+ * For Multi-Mode Digital Clock project
+ * All drawing goes into a 240x240 RAM canvas; at the end of each frame the
+ * 16x16 tiles that were drawn into are hashed and only tiles that changed
+ * are pushed. Untouched tiles are not read at all.
+ */
+
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "config.h"
+#include "utils.h"
+#include "mem_alloc.h"
+
+// Disabled unless enabled in config.h (needs a PSRAM board such as WROVER)
+#ifndef USE_SHADOW_FRAMEBUFFER
+#define USE_SHADOW_FRAMEBUFFER 0
+#endif
+
+// Canvas and tile geometry
+#define FRAME_WIDTH 240
+#define FRAME_HEIGHT 240
+#define FRAME_TILE_SIZE 16
+#define FRAME_TILES_X (FRAME_WIDTH / FRAME_TILE_SIZE)
+#define FRAME_TILES_Y (FRAME_HEIGHT / FRAME_TILE_SIZE)
+#define FRAME_TILE_COUNT (FRAME_TILES_X * FRAME_TILES_Y)
+
+// The physical display - 'tft' points at either this or the shadow canvas
+extern TFT_eSPI tftPanel;
+
+#if USE_SHADOW_FRAMEBUFFER
+// Hash of every tile as last pushed to the panel
+uint32_t frameTileHashes[FRAME_TILE_COUNT];
+
+// Tiles drawn into since the last flush, one bit each
+uint32_t frameDirtyMask[(FRAME_TILE_COUNT + 31) / 32];
+
+// Two tile-row buffers so one can be filled while the other is sent by DMA
+uint16_t* frameRunBuffer[2] = { NULL, NULL };
+
+bool frameBufferReady = false;
+bool frameForceFullPush = true;
+#endif
+
+// Statistics for the last flushed frame
+int frameDirtyTiles = 0;
+int frameDirtyRuns = 0;
+
+// Function prototypes
+bool frameBufferBegin();
+bool frameBufferActive();
+void framePushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t* data);
+void frameMarkDirty(int32_t x, int32_t y, int32_t w, int32_t h);
+void frameInvalidateAll();
+void frameFlush();
+
+#if USE_SHADOW_FRAMEBUFFER
+// The canvas notes which tiles every primitive touches. TFT_eSPI draws
+// shapes, lines and text through these virtual primitives, and image
+// pushes come through framePushImage().
+class ShadowCanvas : public TFT_eSprite {
+ public:
+  explicit ShadowCanvas(TFT_eSPI* panel) : TFT_eSprite(panel) {}
+
+  using TFT_eSprite::drawChar;
+
+  void drawPixel(int32_t x, int32_t y, uint32_t color) override {
+    frameMarkDirty(x, y, 1, 1);
+    TFT_eSprite::drawPixel(x, y, color);
+  }
+
+  void drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size) override {
+    frameMarkDirty(x, y, 6 * size, 8 * size);
+    TFT_eSprite::drawChar(x, y, c, color, bg, size);
+  }
+
+  int16_t drawChar(uint16_t uniCode, int32_t x, int32_t y, uint8_t font) override {
+    int16_t width = TFT_eSprite::drawChar(uniCode, x, y, font);
+    frameMarkDirty(x, y, width, fontHeight(font));
+    return width;
+  }
+
+  void drawLine(int32_t xs, int32_t ys, int32_t xe, int32_t ye, uint32_t color) override {
+    frameMarkDirty(min(xs, xe), min(ys, ye), abs(xe - xs) + 1, abs(ye - ys) + 1);
+    TFT_eSprite::drawLine(xs, ys, xe, ye, color);
+  }
+
+  void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) override {
+    frameMarkDirty(x, y, 1, h);
+    TFT_eSprite::drawFastVLine(x, y, h, color);
+  }
+
+  void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) override {
+    frameMarkDirty(x, y, w, 1);
+    TFT_eSprite::drawFastHLine(x, y, w, color);
+  }
+
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) override {
+    frameMarkDirty(x, y, w, h);
+    TFT_eSprite::fillRect(x, y, w, h, color);
+  }
+};
+
+extern ShadowCanvas shadowCanvas;
+#endif
+
+// Allocate the canvas in PSRAM - call once after the panel is initialized.
+// Drawing moves to the canvas only when everything was allocated.
+bool frameBufferBegin() {
+#if USE_SHADOW_FRAMEBUFFER
+  if (!psramFound()) {
+    Serial.println("Shadow framebuffer needs PSRAM - none found, drawing straight to the panel");
+    return false;
+  }
+
+  shadowCanvas.setColorDepth(16);
+  shadowCanvas.setAttribute(PSRAM_ENABLE, true);
+  if (shadowCanvas.createSprite(FRAME_WIDTH, FRAME_HEIGHT) == nullptr) {
+    Serial.println("Shadow framebuffer allocation failed, drawing straight to the panel");
+    return false;
+  }
+
+  shadowCanvas.fillSprite(TFT_BLACK);
+
+  for (int i = 0; i < 2; i++) {
+    frameRunBuffer[i] = (uint16_t*)memAlloc(FRAME_TILE_SIZE * FRAME_WIDTH * sizeof(uint16_t), MEM_DMA);
+    if (frameRunBuffer[i] == NULL) {
+      Serial.println("Shadow framebuffer: no DMA memory for tile runs, drawing straight to the panel");
+      for (int j = 0; j < i; j++) {
+        memFree(frameRunBuffer[j], MEM_DMA);
+        frameRunBuffer[j] = NULL;
+      }
+      shadowCanvas.deleteSprite();
+      return false;
+    }
+  }
+  tftPanel.initDMA();
+
+  frameBufferReady = true;
+  frameInvalidateAll();
+  tft = &shadowCanvas;
+
+  Serial.println("Shadow framebuffer enabled");
+  return true;
+#else
+  return false;
+#endif
+}
+
+// True when drawing is going to the RAM canvas instead of the panel
+bool frameBufferActive() {
+#if USE_SHADOW_FRAMEBUFFER
+  return frameBufferReady;
+#else
+  return false;
+#endif
+}
+
+// Image pushes from the decoders - pushImage() is not virtual in TFT_eSPI,
+// so callbacks must come through here to reach the canvas
+void framePushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t* data) {
+#if USE_SHADOW_FRAMEBUFFER
+  if (frameBufferReady) {
+    frameMarkDirty(x, y, w, h);
+    shadowCanvas.pushImage(x, y, w, h, data);
+    return;
+  }
+#endif
+  tftPanel.pushImage(x, y, w, h, data);
+}
+
+// Note the tiles a rectangle covers, so the next flush looks at them
+void frameMarkDirty(int32_t x, int32_t y, int32_t w, int32_t h) {
+#if USE_SHADOW_FRAMEBUFFER
+  int32_t x1 = min(x + w, (int32_t)FRAME_WIDTH) - 1;
+  int32_t y1 = min(y + h, (int32_t)FRAME_HEIGHT) - 1;
+  x = max(x, (int32_t)0);
+  y = max(y, (int32_t)0);
+  if (w <= 0 || h <= 0 || x > x1 || y > y1) return;
+
+  for (int tileY = y / FRAME_TILE_SIZE; tileY <= y1 / FRAME_TILE_SIZE; tileY++) {
+    for (int tileX = x / FRAME_TILE_SIZE; tileX <= x1 / FRAME_TILE_SIZE; tileX++) {
+      int index = tileY * FRAME_TILES_X + tileX;
+      frameDirtyMask[index >> 5] |= 1UL << (index & 31);
+    }
+  }
+#endif
+}
+
+// Force every tile to be pushed on the next flush
+void frameInvalidateAll() {
+#if USE_SHADOW_FRAMEBUFFER
+  frameForceFullPush = true;
+#endif
+}
+
+#if USE_SHADOW_FRAMEBUFFER
+// Hash one tile of the canvas, two pixels at a time
+uint32_t hashFrameTile(const uint16_t* canvas, int tileX, int tileY) {
+  const uint16_t* row = canvas + (tileY * FRAME_TILE_SIZE) * FRAME_WIDTH + tileX * FRAME_TILE_SIZE;
+  uint32_t hash = FNV1A_OFFSET_BASIS;
+
+  for (int y = 0; y < FRAME_TILE_SIZE; y++) {
+    const uint32_t* words = (const uint32_t*)row;
+    for (int i = 0; i < FRAME_TILE_SIZE / 2; i++) {
+      hash = (hash ^ words[i]) * FNV1A_PRIME;
+    }
+    row += FRAME_WIDTH;
+  }
+
+  return hash;
+}
+
+// Copy a horizontal run of tiles into a DMA buffer and start sending it
+void pushFrameTileRun(const uint16_t* canvas, int tileY, int firstTile, int lastTile, int bufferIndex) {
+  int x = firstTile * FRAME_TILE_SIZE;
+  int y = tileY * FRAME_TILE_SIZE;
+  int w = (lastTile - firstTile + 1) * FRAME_TILE_SIZE;
+  uint16_t* dst = frameRunBuffer[bufferIndex];
+
+  // Wait until DMA has finished with this buffer before refilling it
+  tftPanel.dmaWait();
+
+  const uint16_t* src = canvas + y * FRAME_WIDTH + x;
+  for (int row = 0; row < FRAME_TILE_SIZE; row++) {
+    memcpy(dst + row * w, src, w * sizeof(uint16_t));
+    src += FRAME_WIDTH;
+  }
+
+  tftPanel.pushImageDMA(x, y, w, FRAME_TILE_SIZE, dst);
+}
+#endif
+
+// End of frame - push only the tiles that changed since the last flush
+void frameFlush() {
+#if USE_SHADOW_FRAMEBUFFER
+  if (!frameBufferReady) return;
+
+  const uint16_t* canvas = (const uint16_t*)shadowCanvas.getPointer();
+  if (canvas == nullptr) return;
+
+  frameDirtyTiles = 0;
+  frameDirtyRuns = 0;
+  int bufferIndex = 0;
+  bool transactionOpen = false;
+
+  // Canvas already holds panel byte order
+  bool oldSwapBytes = tftPanel.getSwapBytes();
+  tftPanel.setSwapBytes(false);
+
+  for (int tileY = 0; tileY < FRAME_TILES_Y; tileY++) {
+    int runStart = -1;
+
+    for (int tileX = 0; tileX <= FRAME_TILES_X; tileX++) {
+      bool dirty = false;
+
+      if (tileX < FRAME_TILES_X) {
+        // Only tiles drawn into can have changed
+        int index = tileY * FRAME_TILES_X + tileX;
+        bool touched = frameDirtyMask[index >> 5] & (1UL << (index & 31));
+        if (touched || frameForceFullPush) {
+          uint32_t hash = hashFrameTile(canvas, tileX, tileY);
+          dirty = frameForceFullPush || (hash != frameTileHashes[index]);
+          frameTileHashes[index] = hash;
+        }
+      }
+
+      if (dirty) {
+        frameDirtyTiles++;
+        if (runStart < 0) runStart = tileX;
+      } else if (runStart >= 0) {
+        // Merge adjacent dirty tiles into one address window
+        if (!transactionOpen) {
+          tftPanel.startWrite();
+          transactionOpen = true;
+        }
+        pushFrameTileRun(canvas, tileY, runStart, tileX - 1, bufferIndex);
+        bufferIndex ^= 1;
+        frameDirtyRuns++;
+        runStart = -1;
+      }
+    }
+  }
+
+  if (transactionOpen) {
+    tftPanel.dmaWait();
+    tftPanel.endWrite();
+  }
+
+  tftPanel.setSwapBytes(oldSwapBytes);
+  frameForceFullPush = false;
+  memset(frameDirtyMask, 0, sizeof(frameDirtyMask));
+#endif
+}
+
+#endif  // FRAME_BUFFER_H
@@ -0,0 +1,131 @@
+/*
+ * frame_governor.h - Adaptive frame-budget governor
+ * For Multi-Mode Digital Clock project
+ * Tracks how long each working loop pass takes and steps quality down when
+ * the average goes over budget (GIF rate, anti-aliasing, seconds sweep,
+ * animation), then steps it back up once there is headroom again.
+ * Time digits and buttons are never degraded.
+ */
+
+#ifndef FRAME_GOVERNOR_H
+#define FRAME_GOVERNOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "log_buffer.h"
+
+// Budget for one loop pass
+#ifndef FRAME_BUDGET_MS
+#define FRAME_BUDGET_MS 50
+#endif
+
+// Loop passes shorter than this did no drawing and are not counted
+#define GOVERNOR_MIN_SAMPLE_US 500
+
+// Degrade when the average is over budget, restore below this percentage
+#define GOVERNOR_RESTORE_PERCENT 50
+
+// Minimum time between two degrade steps, and before the first restore attempt
+#define GOVERNOR_DEGRADE_HOLD_MS 1000
+#define GOVERNOR_RESTORE_HOLD_MS 5000
+#define GOVERNOR_MAX_RESTORE_HOLD_MS 60000
+
+// Quality levels, each one includes the ones before it
+#define GOVERNOR_FULL_QUALITY 0
+#define GOVERNOR_HALF_GIF_RATE 1
+#define GOVERNOR_NO_ANTIALIAS 2
+#define GOVERNOR_NO_SWEEP 3
+#define GOVERNOR_FREEZE_ANIMATION 4
+
+const char* governorLevelNames[] = { "full quality", "half GIF rate", "no anti-aliasing", "no seconds sweep", "animation frozen" };
+
+int governorLevel = GOVERNOR_FULL_QUALITY;
+unsigned long frameCostAverage = 0;  // Moving average in microseconds
+unsigned long frameStartMicros = 0;
+unsigned long lastGovernorChange = 0;
+unsigned long governorRestoreHold = GOVERNOR_RESTORE_HOLD_MS;
+bool governorJustRestored = false;
+
+// Function prototypes
+void governorBeginFrame();
+void governorEndFrame();
+bool governorAllowsAA();
+bool governorAllowsSweep();
+bool governorGifFrameDue(unsigned long nextFrameAt);
+unsigned long governorNextGifFrame(int frameDelayMs);
+
+// Call at the top of loop()
+void governorBeginFrame() {
+  frameStartMicros = micros();
+}
+
+// Change level and report why
+void setGovernorLevel(int level) {
+  LOG_INFO("Governor: %s -> %s (avg frame %lu us, budget %d ms)",
+           governorLevelNames[governorLevel], governorLevelNames[level],
+           frameCostAverage, FRAME_BUDGET_MS);
+  governorLevel = level;
+  lastGovernorChange = millis();
+}
+
+// Call at the end of loop() - updates the average and picks a level
+void governorEndFrame() {
+  unsigned long cost = micros() - frameStartMicros;
+  if (cost < GOVERNOR_MIN_SAMPLE_US) return;
+
+  // Exponential moving average, 1/8 weight for the new sample
+  if (frameCostAverage == 0) {
+    frameCostAverage = cost;
+  } else {
+    frameCostAverage = frameCostAverage - (frameCostAverage >> 3) + (cost >> 3);
+  }
+
+  unsigned long now = millis();
+  unsigned long budget = FRAME_BUDGET_MS * 1000UL;
+  unsigned long sinceChange = now - lastGovernorChange;
+
+  if (frameCostAverage > budget) {
+    if (governorLevel < GOVERNOR_FREEZE_ANIMATION && sinceChange >= GOVERNOR_DEGRADE_HOLD_MS) {
+      // Over budget straight after a restore - wait longer before the next try
+      if (governorJustRestored) {
+        governorRestoreHold = min(governorRestoreHold * 2, (unsigned long)GOVERNOR_MAX_RESTORE_HOLD_MS);
+      }
+      governorJustRestored = false;
+      setGovernorLevel(governorLevel + 1);
+    }
+  } else if (frameCostAverage < budget * GOVERNOR_RESTORE_PERCENT / 100) {
+    if (governorLevel > GOVERNOR_FULL_QUALITY && sinceChange >= governorRestoreHold) {
+      governorJustRestored = true;
+      setGovernorLevel(governorLevel - 1);
+    } else if (governorLevel == GOVERNOR_FULL_QUALITY && sinceChange >= GOVERNOR_MAX_RESTORE_HOLD_MS) {
+      // Stable at full quality - forget earlier backoff
+      governorRestoreHold = GOVERNOR_RESTORE_HOLD_MS;
+      governorJustRestored = false;
+    }
+  }
+}
+
+// Anti-aliased ring edges
+bool governorAllowsAA() {
+  return governorLevel < GOVERNOR_NO_ANTIALIAS;
+}
+
+// Animated seconds progress (the digits keep updating regardless)
+bool governorAllowsSweep() {
+  return governorLevel < GOVERNOR_NO_SWEEP;
+}
+
+// True when an animation should show its next frame
+bool governorGifFrameDue(unsigned long nextFrameAt) {
+  if (governorLevel >= GOVERNOR_FREEZE_ANIMATION) return false;
+  return (long)(millis() - nextFrameAt) >= 0;
+}
+
+// When the frame after this one is due, stretched at reduced quality
+unsigned long governorNextGifFrame(int frameDelayMs) {
+  if (frameDelayMs <= 0) frameDelayMs = 1;
+  if (governorLevel >= GOVERNOR_HALF_GIF_RATE) frameDelayMs *= 2;
+  return millis() + frameDelayMs;
+}
+
+#endif  // FRAME_GOVERNOR_H
@@ -0,0 +1,291 @@
+/*
+ * fs_benchmark.h - File system I/O benchmark
+ * For Multi-Mode Digital Clock project
+ * Runs at startup with STORAGE_BENCHMARK and prints its results over
+ * Serial for the file system in use (clockFS()). When LittleFS is in use
+ * and SPIFFS is still mounted as the migration source, SPIFFS gets the read
+ * tests only; it is never written. Read sizes follow what the clock
+ * really does: 512-byte TJpgDec input reads, whole-file GIF loads, root
+ * directory scans like the background list at boot and 100-byte settings
+ * writes. The largest .jpg and .gif in storage are used
+ * as read samples; the scratch files it creates are removed afterwards.
+ */
+
+#ifndef FS_BENCHMARK_H
+#define FS_BENCHMARK_H
+
+#include <Arduino.h>
+#include "storage.h"
+#include "mem_alloc.h"
+
+// TJpgDec input buffer (JD_SZBUF)
+#define BENCH_JPEG_READ 512
+
+// Block size used by asset_reader.h
+#define BENCH_BLOCK_READ 4096
+
+// Size of the settings file writes
+#define BENCH_SETTINGS_WRITE 100
+
+#define BENCH_ROUNDS 20
+#define BENCH_SCAN_ROUNDS 5
+#define BENCH_RANDOM_READS 100
+
+// exists() is timed with this many extra files present
+const int benchFileCounts[] = { 0, 16, 48, 96 };
+
+// Timing of a repeated operation
+struct BenchStat {
+  unsigned long total;
+  unsigned long worst;
+  int count;
+};
+
+// Function prototypes
+void storageBenchmark();
+void benchmarkFileSystem(fs::FS& fs, const char* name, bool writable);
+
+void benchAdd(BenchStat& stat, unsigned long elapsed) {
+  stat.total += elapsed;
+  stat.worst = max(stat.worst, elapsed);
+  stat.count++;
+}
+
+void benchPrint(const char* name, const char* test, const BenchStat& stat) {
+  if (stat.count == 0) return;
+  Serial.printf("%s: %-24s avg %6lu us  max %6lu us  (%d runs)\n",
+                name, test, stat.total / stat.count, stat.worst, stat.count);
+}
+
+// Throughput line for a read of the whole file
+void benchPrintRate(const char* name, const char* test, size_t bytes, unsigned long elapsed) {
+  unsigned long rate = (elapsed > 0) ? (unsigned long)((uint64_t)bytes * 1000000ULL / 1024 / elapsed) : 0;
+  Serial.printf("%s: %-24s %7u bytes in %6lu us  (%lu KB/s)\n", name, test, (unsigned int)bytes, elapsed, rate);
+}
+
+// Largest file with the given extension
+String benchFindSample(fs::FS& fs, const char* extension) {
+  String best;
+  size_t bestSize = 0;
+
+  File root = fs.open("/");
+  File file = root.openNextFile();
+  while (file) {
+    String path = file.name();
+    if (!path.startsWith("/")) path = "/" + path;
+    String lower = path;
+    lower.toLowerCase();
+    if (lower.endsWith(extension) && file.size() > bestSize) {
+      best = path;
+      bestSize = file.size();
+    }
+    file = root.openNextFile();
+  }
+  return best;
+}
+
+// Read a file front to back in pieces of one size
+void benchSequentialRead(fs::FS& fs, const char* name, const String& path, size_t chunk, const char* test, uint8_t* buffer) {
+  File file = fs.open(path, "r");
+  if (!file) return;
+
+  size_t total = 0;
+  unsigned long start = micros();
+  while (true) {
+    size_t got = file.read(buffer, chunk);
+    if (got == 0) break;
+    total += got;
+  }
+  unsigned long elapsed = micros() - start;
+  file.close();
+
+  benchPrintRate(name, test, total, elapsed);
+}
+
+// Whole-file load into one allocation, like the GIF players
+void benchWholeFileRead(fs::FS& fs, const char* name, const String& path, const char* test) {
+  unsigned long start = micros();
+  File file = fs.open(path, "r");
+  if (!file) return;
+
+  size_t size = file.size();
+  uint8_t* data = (uint8_t*)memAlloc(size, MEM_PSRAM);
+  if (data == NULL) {
+    file.close();
+    Serial.printf("%s: %-24s no memory for %u bytes\n", name, test, (unsigned int)size);
+    return;
+  }
+
+  size_t got = file.read(data, size);
+  file.close();
+  unsigned long elapsed = micros() - start;
+  memFree(data, MEM_PSRAM);
+
+  benchPrintRate(name, test, got, elapsed);
+}
+
+// Seek and read at random offsets
+void benchRandomRead(fs::FS& fs, const char* name, const String& path, uint8_t* buffer) {
+  File file = fs.open(path, "r");
+  if (!file || file.size() <= BENCH_JPEG_READ) return;
+
+  BenchStat stat = { 0, 0, 0 };
+  size_t range = file.size() - BENCH_JPEG_READ;
+  for (int i = 0; i < BENCH_RANDOM_READS; i++) {
+    size_t offset = random(range);
+    unsigned long start = micros();
+    file.seek(offset);
+    file.read(buffer, BENCH_JPEG_READ);
+    benchAdd(stat, micros() - start);
+  }
+  file.close();
+
+  benchPrint(name, "random 512 B read", stat);
+}
+
+// open()/close() of an existing file
+void benchOpen(fs::FS& fs, const char* name, const String& path) {
+  BenchStat stat = { 0, 0, 0 };
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    unsigned long start = micros();
+    File file = fs.open(path, "r");
+    file.close();
+    benchAdd(stat, micros() - start);
+  }
+  benchPrint(name, "open", stat);
+}
+
+// exists() for a present and a missing file, with more and more files around
+// (only the files already there when the file system must not be written)
+void benchExists(fs::FS& fs, const char* name, const String& present, bool writable) {
+  char path[16];
+  int created = 0;
+  unsigned int steps = writable ? sizeof(benchFileCounts) / sizeof(benchFileCounts[0]) : 1;
+
+  for (unsigned int step = 0; step < steps; step++) {
+    while (created < benchFileCounts[step]) {
+      snprintf(path, sizeof(path), "/.bench%03d", created);
+      File file = fs.open(path, "w");
+      if (!file) break;
+      file.write('x');
+      file.close();
+      created++;
+    }
+
+    BenchStat hit = { 0, 0, 0 }, miss = { 0, 0, 0 };
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+      unsigned long start = micros();
+      fs.exists(present);
+      benchAdd(hit, micros() - start);
+
+      start = micros();
+      fs.exists("/.bench-missing");
+      benchAdd(miss, micros() - start);
+    }
+
+    Serial.printf("%s: exists() with %3d extra files  hit avg %5lu us (max %5lu)  miss avg %5lu us (max %5lu)\n",
+                  name, created, hit.total / hit.count, hit.worst, miss.total / miss.count, miss.worst);
+  }
+
+  for (int i = 0; i < created; i++) {
+    snprintf(path, sizeof(path), "/.bench%03d", i);
+    fs.remove(path);
+  }
+}
+
+// Walk the root directory the way checkForImageFiles() builds the background list
+void benchScan(fs::FS& fs, const char* name) {
+  BenchStat stat = { 0, 0, 0 };
+  int files = 0;
+
+  for (int i = 0; i < BENCH_SCAN_ROUNDS; i++) {
+    files = 0;
+    unsigned long start = micros();
+    File root = fs.open("/");
+    File file = root.openNextFile();
+    while (file) {
+      String path = file.name();
+      file.size();
+      file.close();
+      files++;
+      file = root.openNextFile();
+    }
+    root.close();
+    benchAdd(stat, micros() - start);
+  }
+
+  char test[32];
+  snprintf(test, sizeof(test), "scan of %d files", files);
+  benchPrint(name, test, stat);
+}
+
+// 100-byte settings writes - first creating the file, then rewriting it
+void benchWrites(fs::FS& fs, const char* name) {
+  const char* testFile = "/.bench";
+  char payload[BENCH_SETTINGS_WRITE];
+  memset(payload, 'x', sizeof(payload));
+
+  BenchStat create = { 0, 0, 0 }, rewrite = { 0, 0, 0 };
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    fs.remove(testFile);
+
+    unsigned long start = micros();
+    File file = fs.open(testFile, "w");
+    file.write((const uint8_t*)payload, sizeof(payload));
+    file.close();
+    benchAdd(create, micros() - start);
+
+    start = micros();
+    file = fs.open(testFile, "w");
+    file.write((const uint8_t*)payload, sizeof(payload));
+    file.close();
+    benchAdd(rewrite, micros() - start);
+  }
+  fs.remove(testFile);
+
+  benchPrint(name, "create 100 B file", create);
+  benchPrint(name, "rewrite 100 B file", rewrite);
+}
+
+// Every test on one file system, or only the read tests
+void benchmarkFileSystem(fs::FS& fs, const char* name, bool writable) {
+  uint8_t* buffer = (uint8_t*)memAlloc(BENCH_BLOCK_READ, MEM_FAST);
+  if (buffer == NULL) return;
+
+  String jpeg = benchFindSample(fs, ".jpg");
+  String gif = benchFindSample(fs, ".gif");
+
+  if (jpeg.length() > 0) {
+    Serial.printf("%s: JPEG sample %s\n", name, jpeg.c_str());
+    benchSequentialRead(fs, name, jpeg, BENCH_JPEG_READ, "sequential 512 B reads", buffer);
+    benchSequentialRead(fs, name, jpeg, BENCH_BLOCK_READ, "sequential 4 KB reads", buffer);
+    benchRandomRead(fs, name, jpeg, buffer);
+    benchOpen(fs, name, jpeg);
+  }
+
+  if (gif.length() > 0) {
+    Serial.printf("%s: GIF sample %s\n", name, gif.c_str());
+    benchWholeFileRead(fs, name, gif, "whole-file GIF load");
+  }
+
+  String present = (jpeg.length() > 0) ? jpeg : gif;
+  if (present.length() > 0) {
+    benchExists(fs, name, present, writable);
+  }
+  benchScan(fs, name);
+  if (writable) benchWrites(fs, name);
+
+  memFree(buffer, MEM_FAST);
+}
+
+// Run the suite on the file system the clock uses, and read SPIFFS for
+// comparison while it is kept as the migration source
+void storageBenchmark() {
+  if (!littleFsMounted && !spiffsMounted) return;
+  benchmarkFileSystem(clockFS(), storageName(), true);
+  if (littleFsMounted && spiffsMounted) {
+    benchmarkFileSystem(SPIFFS, "SPIFFS (read only)", false);
+  }
+}
+
+#endif  // FS_BENCHMARK_H
@@ -0,0 +1,136 @@
+/*
+ * fs_maintenance.h - Idle SPIFFS garbage collection and write latency
+ * For Multi-Mode Digital Clock project
+ * SPIFFS erases blocks only when a write runs out of free pages, so a
+ * settings save after a button press can stall for a block erase. Bytes
+ * rewritten since the last collection are counted, and while the loop pass
+ * has time left over (and no write happened for a while) one block at a
+ * time is reclaimed until a reserve of erased space is ready. A slice
+ * cannot be cut short - it erases at least one block, about 45 ms on
+ * typical flash - so slow slices only make collection back off. Foreground
+ * writes are timed and the worst case is reported.
+ */
+
+#ifndef FS_MAINTENANCE_H
+#define FS_MAINTENANCE_H
+
+#include <Arduino.h>
+#include <esp_spiffs.h>
+#include "config.h"
+#include "storage.h"
+#include "frame_governor.h"
+#include "log_buffer.h"
+
+#ifndef STORAGE_IDLE_GC
+#define STORAGE_IDLE_GC 1
+#endif
+
+// SPIFFS logical block size on the Arduino core
+#define STORAGE_GC_BLOCK 4096
+
+// Erased space to keep ready for foreground writes
+#define STORAGE_GC_RESERVE (4 * STORAGE_GC_BLOCK)
+
+// Only collect this long after the last write, and not more often than this
+#define STORAGE_GC_QUIET_MS 3000
+#define STORAGE_GC_INTERVAL_MS 1000
+
+// Only start a slice when the loop pass has used less than this share of its budget
+#define STORAGE_GC_IDLE_PERCENT 25
+
+// esp_spiffs_gc() cannot be bounded; a slice that took longer than this
+// (measured afterwards) pauses collection for a while
+#define STORAGE_GC_SLOW_SLICE_US 20000
+#define STORAGE_GC_BACKOFF_MS 30000
+
+unsigned long storageDirtyBytes = 0;    // Rewritten since the last collection
+unsigned long storageGcTarget = 0;      // Erased space requested by the last slice
+unsigned long lastStorageWrite = 0;
+unsigned long lastStorageGc = 0;
+unsigned long storageGcPausedUntil = 0;
+unsigned long storageWriteStart = 0;
+unsigned long storageWriteWorst = 0;    // Microseconds
+unsigned long storageWriteTotal = 0;
+unsigned long storageWriteCount = 0;
+unsigned long storageGcSliceWorst = 0;
+
+// Function prototypes
+void storageWriteBegin();
+void storageWriteEnd(const char* what, size_t bytes);
+void storageMaintenance();
+void storagePrintWriteStats();
+
+// Call right before a foreground write
+void storageWriteBegin() {
+  storageWriteStart = micros();
+}
+
+// Call after the file is closed - times the write and marks the space dirty
+void storageWriteEnd(const char* what, size_t bytes) {
+  unsigned long elapsed = micros() - storageWriteStart;
+
+  storageWriteTotal += elapsed;
+  storageWriteCount++;
+  storageDirtyBytes += bytes;
+  storageGcTarget = 0;
+  lastStorageWrite = millis();
+
+  if (elapsed > storageWriteWorst) {
+    storageWriteWorst = elapsed;
+    LOG_INFO("Storage: new worst write %lu us (%s, %d bytes)", elapsed, what, (int)bytes);
+  }
+}
+
+// Call at the end of loop() - runs at most one collection slice
+void storageMaintenance() {
+#if STORAGE_IDLE_GC
+  // LittleFS reclaims space as it goes
+  if (littleFsMounted || !spiffsMounted) return;
+  if (storageDirtyBytes == 0) return;
+
+  unsigned long now = millis();
+  if (now - lastStorageWrite < STORAGE_GC_QUIET_MS) return;
+  if (now - lastStorageGc < STORAGE_GC_INTERVAL_MS) return;
+  if ((long)(now - storageGcPausedUntil) < 0) return;
+
+  // Only in the idle part of a render pass
+  unsigned long used = micros() - frameStartMicros;
+  if (used > FRAME_BUDGET_MS * 1000UL * STORAGE_GC_IDLE_PERCENT / 100) return;
+
+  size_t total = 0, inUse = 0;
+  if (esp_spiffs_info(NULL, &total, &inUse) != ESP_OK) return;
+
+  // Ask for one more erased block than last time, up to the reserve
+  // (less if the partition is nearly full)
+  unsigned long reserve = min((unsigned long)STORAGE_GC_RESERVE, (unsigned long)(total - inUse) / 2);
+  storageGcTarget = min(storageGcTarget + STORAGE_GC_BLOCK, reserve);
+
+  unsigned long start = micros();
+  esp_err_t result = esp_spiffs_gc(NULL, storageGcTarget);
+  unsigned long elapsed = micros() - start;
+  lastStorageGc = millis();
+
+  storageGcSliceWorst = max(storageGcSliceWorst, elapsed);
+  if (elapsed > STORAGE_GC_SLOW_SLICE_US) {
+    LOG_WARN("Storage: GC slice took %lu us, pausing", elapsed);
+    storageGcPausedUntil = lastStorageGc + STORAGE_GC_BACKOFF_MS;
+  }
+
+  // Done once the reserve is erased, or when nothing more can be reclaimed
+  if (result != ESP_OK || storageGcTarget >= reserve) {
+    LOG_DEBUG("Storage: GC finished, %d of %d bytes in use", (int)inUse, (int)total);
+    storageDirtyBytes = 0;
+    storageGcTarget = 0;
+    storagePrintWriteStats();
+  }
+#endif
+}
+
+// Report write latency and collection cost
+void storagePrintWriteStats() {
+  if (storageWriteCount == 0) return;
+  LOG_INFO("Storage writes: %lu, avg %lu us, worst %lu us, worst GC slice %lu us",
+           storageWriteCount, storageWriteTotal / storageWriteCount, storageWriteWorst, storageGcSliceWorst);
+}
+
+#endif  // FS_MAINTENANCE_H
@@ -9,16 +9,30 @@
 
 #include <Arduino.h>
 #include <TFT_eSPI.h>
-#include <SPIFFS.h>
+#include "storage.h"
 #include <FS.h>
 #include <AnimatedGIF.h>
 #include "utils.h"
 #include "led_controls.h"
+#include "frame_buffer.h"
+#include "frame_governor.h"
+#include "ambient_color.h"
+#include "mem_alloc.h"
+#include "asset_partition.h"
+#include "asset_reader.h"
+#include "theme_pack.h"
+#include "gif_seek.h"
 
 // GIF background handling
 AnimatedGIF gifDigitalClock;
 uint8_t *gifDigitalBuffer = NULL;
 int gifDigitalSize = 0;
+bool gifDigitalMapped = false;  // Buffer points into the asset partition
+unsigned long gifDigitalNextFrame = 0;  // When the next GIF frame is due
+
+// Where the last GIF was left, so coming back to it carries on from there
+uint32_t gifResumeHash = 0;
+int gifResumeFrame = 0;
 
 // Function prototypes
 void GIFDrawDigital(GIFDRAW *pDraw);
@@ -26,6 +40,7 @@ bool displayGIFDigitalBackground(const char *filename);
 void drawGifDigitalBackground(const char *gifFilename);
 void updateGifDigitalBackground();
 void cleanupGifDigitalMode();
+void releaseGifDigitalBuffer();
 
 // GIF drawing callback for digital clock mode with color correction
 void GIFDrawDigital(GIFDRAW *pDraw) {
@@ -40,9 +55,9 @@ void GIFDrawDigital(GIFDRAW *pDraw) {
   usPalette = pDraw->pPalette;
   y = pDraw->iY + pDraw->y;  // current line
 
-  // Calculate centering offsets for 240x240 screen
-  int xOffset = (240 - pDraw->iWidth) / 2;
-  int yOffset = (240 - pDraw->iHeight) / 2;
+  // Canvas origin on the 240x240 screen - the same one the seek mirror uses
+  int xOffset = gifCanvasX();
+  int yOffset = gifCanvasY();
 
   // Apply the vertical offset to the Y position
   int centeredY = y + yOffset;
@@ -65,8 +80,56 @@ void GIFDrawDigital(GIFDRAW *pDraw) {
   }
   d = usTemp;
 
+  // Keep the composed image for seeking; while catching up, that is all
+  gifSeekCaptureLine(pDraw->iX, y, iWidth, d);
+  ambientSampleBlock(xOffset + pDraw->iX, centeredY, iWidth, 1, d);
+  if (gifSeekSilent) return;
+
   // Draw the current line of the GIF at the centered position
-  tft.pushImage(xOffset + pDraw->iX, centeredY, iWidth, 1, d);
+  framePushImage(xOffset + pDraw->iX, centeredY, iWidth, 1, d);
+}
+
+// Free the GIF data unless it is mapped flash
+void releaseGifDigitalBuffer() {
+  gifSeekEnd();
+  if (!gifDigitalMapped) {
+    memFree(gifDigitalBuffer, MEM_PSRAM);
+  }
+  gifDigitalBuffer = NULL;
+  gifDigitalSize = 0;
+  gifDigitalMapped = false;
+}
+
+// Read a GIF file into a new buffer
+bool loadGifDigitalFile(const char *filename) {
+  // Theme files hold the GIF after their header
+  if (themeLookup(filename) != NULL) {
+    uint32_t size = 0;
+    gifDigitalBuffer = themeLoadImage(filename, &size);
+    gifDigitalSize = size;
+    return gifDigitalBuffer != NULL;
+  }
+
+  int assetId = assetResolve(filename);
+  if (assetId < 0 || assetFileSize(assetId) == 0) {
+    return false;
+  }
+
+  // Allocate memory for the GIF data
+  gifDigitalSize = assetFileSize(assetId);
+  gifDigitalBuffer = (uint8_t *)memAlloc(gifDigitalSize, MEM_PSRAM);
+  if (gifDigitalBuffer == NULL) {
+    gifDigitalSize = 0;
+    return false;
+  }
+
+  // Read the file into the buffer
+  if (!assetReadAll(assetId, gifDigitalBuffer)) {
+    releaseGifDigitalBuffer();
+    return false;
+  }
+
+  return true;
 }
 
 // Load and display a GIF background
@@ -76,17 +139,19 @@ bool displayGIFDigitalBackground(const char *filename) {
     return false;
   }
 
-  // Check if file exists
-  if (!SPIFFS.exists(filename)) {
+  // Packed assets are played straight from mapped flash
+  uint32_t assetSize = 0;
+  const uint8_t *asset = assetFind(filename, &assetSize);
+
+  // Check if file exists (the lookup is remembered for the load below)
+  if (asset == NULL && assetResolve(filename) < 0) {
     return false;
   }
 
   // Clean up previous GIF if any
   if (gifDigitalBuffer != NULL) {
     gifDigitalClock.close();
-    free(gifDigitalBuffer);
-    gifDigitalBuffer = NULL;
-    gifDigitalSize = 0;
+    releaseGifDigitalBuffer();
   }
 
   // Extract filename for theme detection
@@ -100,55 +165,43 @@ bool displayGIFDigitalBackground(const char *filename) {
   // Set theme based on filename
   setThemeFromFilename(justFilename.c_str());
 
-  // Open the file
-  File f = SPIFFS.open(filename, "r");
-  if (!f) {
+  if (asset != NULL) {
+    gifDigitalBuffer = (uint8_t *)asset;
+    gifDigitalSize = assetSize;
+    gifDigitalMapped = true;
+  } else if (!loadGifDigitalFile(filename)) {
     return false;
   }
 
-  // Get file size
-  gifDigitalSize = f.size();
-  if (gifDigitalSize == 0) {
-    f.close();
-    return false;
-  }
+  // Indexed playback can start at any frame; plain playback is the fallback
+  uint32_t nameHash = assetPathHash(filename);
+  if (!gifSeekBegin(gifDigitalClock, gifDigitalBuffer, gifDigitalSize, nameHash, GIFDrawDigital)) {
+    // Initialize the GIF decoder
+    gifDigitalClock.begin(GIF_PALETTE_RGB565_LE);
 
-  // Allocate memory for the GIF data
-  gifDigitalBuffer = (uint8_t *)malloc(gifDigitalSize);
-  if (gifDigitalBuffer == NULL) {
-    f.close();
-    gifDigitalSize = 0;
-    return false;
+    // Open the GIF from the buffer with our custom draw callback
+    if (!gifDigitalClock.open(gifDigitalBuffer, gifDigitalSize, GIFDrawDigital)) {
+      releaseGifDigitalBuffer();
+      return false;
+    }
+    gifSetCanvasSize(gifDigitalClock);
   }
 
-  // Read the file into the buffer
-  size_t bytesRead = f.read(gifDigitalBuffer, gifDigitalSize);
-  f.close();
-
-  if (bytesRead != gifDigitalSize) {
-    free(gifDigitalBuffer);
-    gifDigitalBuffer = NULL;
-    gifDigitalSize = 0;
-    return false;
+  // First frame: where the wall clock says, else where this GIF was left
+  int startFrame = gifWallClockFrame(NULL);
+  if (startFrame < 0) {
+    startFrame = (nameHash == gifResumeHash) ? gifResumeFrame : 0;
   }
 
-  // Initialize the GIF decoder
-  gifDigitalClock.begin(GIF_PALETTE_RGB565_LE);
+  // Display the first frame, taking the ambient LED color from it
+  ambientBegin(justFilename.c_str());
+  bool played = gifIndexed ? gifSeekTo(startFrame) : gifDigitalClock.playFrame(true, NULL);
+  ambientFinish(justFilename.c_str(), played);
+  gifDigitalNextFrame = millis();
 
-  // Open the GIF from the buffer with our custom draw callback
-  if (!gifDigitalClock.open(gifDigitalBuffer, gifDigitalSize, GIFDrawDigital)) {
-    free(gifDigitalBuffer);
-    gifDigitalBuffer = NULL;
-    gifDigitalSize = 0;
-    return false;
-  }
-
-  // Display the first frame
-  if (!gifDigitalClock.playFrame(true, NULL)) {
+  if (!played) {
     gifDigitalClock.close();
-    free(gifDigitalBuffer);
-    gifDigitalBuffer = NULL;
-    gifDigitalSize = 0;
+    releaseGifDigitalBuffer();
     return false;
   }
 
@@ -158,7 +211,7 @@ bool displayGIFDigitalBackground(const char *filename) {
 // Draw the GIF background with the specified file
 void drawGifDigitalBackground(const char *gifFilename) {
   // Clear the display
-  tft.fillScreen(TFT_BLACK);
+  tft->fillScreen(TFT_BLACK);
 
   // Try to load GIF background using the provided filename
   if (!displayGIFDigitalBackground(gifFilename)) {
@@ -170,21 +223,40 @@ void drawGifDigitalBackground(const char *gifFilename) {
 void updateGifDigitalBackground() {
   // Check if GIF exists and is loaded
   if (gifDigitalBuffer != NULL && gifDigitalSize > 0) {
-    // Try to play the next frame
-    if (!gifDigitalClock.playFrame(true, NULL)) {
-      // End of animation, reset to beginning
+    // The governor may slow or freeze the animation when frames run late
+    if (!governorGifFrameDue(gifDigitalNextFrame)) return;
+
+    int frameDelay = 0;
+    if (gifIndexed) {
+      // Follow the wall clock if it is set to, else just play on
+      int target = gifWallClockFrame(&frameDelay);
+      if (target < 0) {
+        gifPlayNext(&frameDelay);
+      } else if (target == (gifFrame + 1) % gifIndex->frameCount) {
+        int unused = 0;
+        gifPlayNext(&unused);
+      } else if (target != gifFrame) {
+        gifSeekTo(target);
+      }
+    } else if (!gifDigitalClock.playFrame(false, &frameDelay)) {
+      // Play the next frame without blocking for its delay;
+      // at the end of the animation, reset to beginning
       gifDigitalClock.reset();
     }
+    gifDigitalNextFrame = governorNextGifFrame(frameDelay);
   }
 }
 
 // Clean up resources when switching away from GIF Digital mode
 void cleanupGifDigitalMode() {
+  if (gifIndexed && gifFrame >= 0) {
+    gifResumeHash = gifIndex->nameHash;
+    gifResumeFrame = gifFrame;
+  }
+
   if (gifDigitalBuffer != NULL) {
     gifDigitalClock.close();
-    free(gifDigitalBuffer);
-    gifDigitalBuffer = NULL;
-    gifDigitalSize = 0;
+    releaseGifDigitalBuffer();
   }
 }
 
@@ -0,0 +1,405 @@
+/*
+ * gif_seek.h - Seekable GIF playback
+ * For Multi-Mode Digital Clock project
+ * AnimatedGIF can only play forward from the start. Each GIF is indexed
+ * once (file offset and delay of every frame), and the decoder is fed
+ * through a virtual file: the GIF header followed by the data from any
+ * frame on, so decoding can start at that frame. The composed canvas is
+ * mirrored in PSRAM and snapshotted at a few keyframes while playing, so
+ * a seek restores the nearest snapshot and only decodes the frames after
+ * it, off screen. Like the index, the snapshots of the last GIF are kept
+ * across mode switches, so resuming where playback left off decodes at
+ * most one keyframe interval. They are matched by path hash and size, so
+ * code that replaces or deletes a GIF calls gifSeekForget(). Seeking also
+ * lets playback follow the wall clock (GIF_SYNC_SECONDS). Without PSRAM
+ * there is no mirror and seeks decode on screen.
+ */
+
+#ifndef GIF_SEEK_H
+#define GIF_SEEK_H
+
+#include <Arduino.h>
+#include <AnimatedGIF.h>
+#include "config.h"
+#include "frame_buffer.h"
+#include "mem_alloc.h"
+#include "log_buffer.h"
+
+#ifndef GIF_SYNC_SECONDS
+#define GIF_SYNC_SECONDS 0
+#endif
+
+// Longer GIFs are played without an index
+#define GIF_MAX_FRAMES 512
+
+// Keyframe snapshots per GIF, and the memory they may use together
+#define GIF_MAX_KEYFRAMES 8
+#define GIF_KEYFRAME_BUDGET (512 * 1024)
+
+// Delays below this are stretched by most players - count them the same
+#define GIF_MIN_DELAY_MS 20
+
+#define GIF_SCREEN_SIZE 240
+
+// Time of day from the clock (NTP or counted)
+extern int hours, minutes, seconds;
+
+// Frame offsets and delays of the GIF being played
+struct GifIndex {
+  uint32_t nameHash;
+  uint32_t headerEnd;  // Header and global color table
+  uint32_t dataSize;
+  int frameCount;
+  uint32_t loopMs;
+  uint32_t offsets[GIF_MAX_FRAMES];
+  uint16_t delays[GIF_MAX_FRAMES];
+};
+
+// What the decoder reads: the header, then everything from one frame on
+struct GifView {
+  const uint8_t* data;
+  uint32_t headerEnd;
+  uint32_t bodyStart;
+  uint32_t size;
+};
+
+GifIndex* gifIndex = NULL;
+bool gifIndexed = false;
+GifView gifView;
+AnimatedGIF* gifSeekDecoder = NULL;
+GIF_DRAW_CALLBACK* gifSeekDraw = NULL;
+
+int gifFrame = -1;            // Frame currently on screen
+int gifViewFrame = 0;         // Frame the decoder will play next
+
+// Composed canvas and its snapshots, byte-swapped like the panel
+uint16_t* gifCanvas = NULL;
+int gifCanvasWidth = 0;
+int gifCanvasHeight = 0;
+uint16_t* gifKeyframes[GIF_MAX_KEYFRAMES];
+int gifKeyframeCount = 0;     // Slots that may be used for this GIF
+int gifKeyframeInterval = 1;
+bool gifSeekSilent = false;   // Catching up - draw into the canvas only
+
+int gifSyncLastSecond = -1;
+unsigned long gifSyncSecondStart = 0;
+
+// Function prototypes
+bool gifSeekBegin(AnimatedGIF& gif, const uint8_t* data, int32_t size, uint32_t nameHash, GIF_DRAW_CALLBACK* draw);
+void gifSeekEnd();
+void gifSeekForget(uint32_t nameHash);
+void gifSeekCaptureLine(int x, int y, int w, const uint16_t* pixels);
+bool gifSeekTo(int frame);
+bool gifPlayNext(int* delayMs);
+int gifWallClockFrame(int* delayMs);
+
+// Skip a chain of data sub-blocks
+uint32_t gifSkipSubBlocks(const uint8_t* data, uint32_t size, uint32_t pos) {
+  while (pos < size) {
+    uint8_t length = data[pos++];
+    if (length == 0) break;
+    pos += length;
+  }
+  return pos;
+}
+
+// Walk the GIF blocks once and note where each frame starts
+bool gifBuildIndex(const uint8_t* data, uint32_t size, GifIndex& index) {
+  index.frameCount = 0;
+  index.loopMs = 0;
+  if (size < 13 || memcmp(data, "GIF", 3) != 0) return false;
+
+  uint32_t pos = 13;
+  if (data[10] & 0x80) pos += 3 * (1 << ((data[10] & 0x07) + 1));
+  index.headerEnd = pos;
+  index.dataSize = size;
+
+  // A frame starts with the extensions before its image descriptor
+  uint32_t frameStart = pos;
+  uint16_t delay = 0;
+
+  while (pos < size && data[pos] != 0x3B) {
+    if (data[pos] == 0x21 && pos + 1 < size) {
+      if (data[pos + 1] == 0xF9 && pos + 5 < size) {
+        delay = data[pos + 4] | (data[pos + 5] << 8);
+      }
+      pos = gifSkipSubBlocks(data, size, pos + 2);
+    } else if (data[pos] == 0x2C && pos + 10 <= size) {
+      uint8_t flags = data[pos + 9];
+      pos += 10;
+      if (flags & 0x80) pos += 3 * (1 << ((flags & 0x07) + 1));
+      pos = gifSkipSubBlocks(data, size, pos + 1);  // After the LZW code size
+
+      if (index.frameCount >= GIF_MAX_FRAMES) return false;
+      index.offsets[index.frameCount] = frameStart;
+      index.delays[index.frameCount] = max(delay * 10, GIF_MIN_DELAY_MS);
+      index.loopMs += index.delays[index.frameCount];
+      index.frameCount++;
+
+      frameStart = pos;
+      delay = 0;
+    } else {
+      break;  // Damaged - keep the frames found so far
+    }
+  }
+
+  return index.frameCount > 0;
+}
+
+// AnimatedGIF file callbacks for the virtual file
+void* gifViewOpen(const char* name, int32_t* size) {
+  *size = gifView.headerEnd + (gifView.size - gifView.bodyStart);
+  return &gifView;
+}
+
+void gifViewClose(void* handle) {}
+
+int32_t gifViewRead(GIFFILE* file, uint8_t* dst, int32_t length) {
+  length = min(length, file->iSize - file->iPos);
+  if (length <= 0) return 0;
+
+  int32_t copied = 0;
+  while (copied < length) {
+    uint32_t pos = file->iPos + copied;
+    int32_t chunk;
+    if (pos < gifView.headerEnd) {
+      chunk = min(length - copied, (int32_t)(gifView.headerEnd - pos));
+      memcpy(dst + copied, gifView.data + pos, chunk);
+    } else {
+      chunk = length - copied;
+      memcpy(dst + copied, gifView.data + gifView.bodyStart + (pos - gifView.headerEnd), chunk);
+    }
+    copied += chunk;
+  }
+
+  file->iPos += length;
+  return length;
+}
+
+int32_t gifViewSeek(GIFFILE* file, int32_t position) {
+  file->iPos = constrain(position, 0, file->iSize);
+  return file->iPos;
+}
+
+// Reopen the decoder so that its next frame is this one
+bool gifOpenAt(int frame) {
+  gifSeekDecoder->close();
+
+  gifView.bodyStart = gifIndex->offsets[frame];
+  gifViewFrame = frame;
+  gifSeekDecoder->begin(GIF_PALETTE_RGB565_LE);
+  return gifSeekDecoder->open("gif-view", gifViewOpen, gifViewClose, gifViewRead, gifViewSeek, gifSeekDraw) != 0;
+}
+
+// Where the GIF canvas goes on screen (centred) - the draw callback and the
+// mirror both use this origin
+int gifCanvasX() {
+  return (GIF_SCREEN_SIZE - gifCanvasWidth) / 2;
+}
+
+int gifCanvasY() {
+  return (GIF_SCREEN_SIZE - gifCanvasHeight) / 2;
+}
+
+// Canvas size of the GIF just opened
+void gifSetCanvasSize(AnimatedGIF& gif) {
+  gifCanvasWidth = min(gif.getCanvasWidth(), GIF_SCREEN_SIZE);
+  gifCanvasHeight = min(gif.getCanvasHeight(), GIF_SCREEN_SIZE);
+}
+
+void gifFreeCanvas() {
+  for (int i = 0; i < GIF_MAX_KEYFRAMES; i++) {
+    memFree(gifKeyframes[i], MEM_PSRAM);
+    gifKeyframes[i] = NULL;
+  }
+  memFree(gifCanvas, MEM_PSRAM);
+  gifCanvas = NULL;
+  gifKeyframeCount = 0;
+}
+
+// Index a GIF held in memory and open it for playback. With a false result
+// the caller plays the buffer the usual way.
+bool gifSeekBegin(AnimatedGIF& gif, const uint8_t* data, int32_t size, uint32_t nameHash, GIF_DRAW_CALLBACK* draw) {
+  gifSeekEnd();
+
+  if (gifIndex == NULL) {
+    gifIndex = (GifIndex*)memAlloc(sizeof(GifIndex), MEM_PSRAM);
+    if (gifIndex == NULL) return false;
+    gifIndex->nameHash = 0;
+  }
+
+  // The index and snapshots are kept for the last GIF, so switching back
+  // needs no new walk and no decoding from the first frame
+  if (gifIndex->nameHash != nameHash || gifIndex->dataSize != (uint32_t)size) {
+    gifFreeCanvas();
+    unsigned long start = micros();
+    gifIndex->nameHash = 0;
+    if (!gifBuildIndex(data, size, *gifIndex)) {
+      LOG_WARN("GIF not indexed - playing it from the start only");
+      return false;
+    }
+    gifIndex->nameHash = nameHash;
+    LOG_INFO("GIF indexed: %d frames, %u ms loop, %lu us",
+             gifIndex->frameCount, (unsigned int)gifIndex->loopMs, micros() - start);
+  }
+
+  gifView.data = data;
+  gifView.headerEnd = gifIndex->headerEnd;
+  gifView.size = size;
+  gifSeekDecoder = &gif;
+  gifSeekDraw = draw;
+  gifFrame = -1;
+
+  if (!gifOpenAt(0)) return false;
+  gifIndexed = true;
+
+  // Mirror of the composed image, and room for the keyframes that fit.
+  // PSRAM only - internal RAM cannot spare a 115 KB copy of the screen.
+  gifSetCanvasSize(gif);
+  size_t canvasBytes = (size_t)gifCanvasWidth * gifCanvasHeight * 2;
+
+  if (gifCanvas == NULL && canvasBytes > 0 && psramFound()) {
+    gifCanvas = (uint16_t*)memAllocStrict(canvasBytes, MEM_PSRAM);
+    if (gifCanvas != NULL) {
+      memset(gifCanvas, 0, canvasBytes);
+      gifKeyframeCount = min((int)(GIF_KEYFRAME_BUDGET / canvasBytes), GIF_MAX_KEYFRAMES);
+      gifKeyframeInterval = max(1, (gifIndex->frameCount + gifKeyframeCount - 1) / max(gifKeyframeCount, 1));
+    } else {
+      LOG_WARN("GIF mirror off - no PSRAM for the canvas");
+    }
+  }
+  return true;
+}
+
+// Stop seekable playback (the index and snapshots stay for the next time)
+void gifSeekEnd() {
+  gifIndexed = false;
+  gifSeekSilent = false;
+  gifFrame = -1;
+}
+
+// A GIF was replaced or deleted - its kept index and snapshots no longer
+// match the file (nameHash as passed to gifSeekBegin(), the path hash)
+void gifSeekForget(uint32_t nameHash) {
+  if (gifIndex == NULL || gifIndex->nameHash != nameHash) return;
+
+  // Offsets stay valid for a buffer still playing; the next begin rebuilds
+  gifIndex->nameHash = 0;
+  for (int i = 0; i < GIF_MAX_KEYFRAMES; i++) {
+    memFree(gifKeyframes[i], MEM_PSRAM);
+    gifKeyframes[i] = NULL;
+  }
+}
+
+// Called by the draw callback for every line, in GIF canvas coordinates
+void gifSeekCaptureLine(int x, int y, int w, const uint16_t* pixels) {
+  if (gifCanvas == NULL || y < 0 || y >= gifCanvasHeight || x >= gifCanvasWidth) return;
+  w = min(w, gifCanvasWidth - x);
+  if (w > 0) memcpy(gifCanvas + y * gifCanvasWidth + x, pixels, w * 2);
+}
+
+// Decode the decoder's next frame and keep a keyframe if one is due here
+bool gifDecodeNext(int* delayMs) {
+  // 0 means no frames follow, which is only right after the last one
+  int result = gifSeekDecoder->playFrame(false, delayMs);
+  if (result < 0 || (result == 0 && gifViewFrame != gifIndex->frameCount - 1)) return false;
+  gifFrame = gifViewFrame++;
+
+  if (gifCanvas != NULL && gifFrame % gifKeyframeInterval == 0) {
+    int slot = gifFrame / gifKeyframeInterval;
+    if (slot < gifKeyframeCount && gifKeyframes[slot] == NULL) {
+      size_t canvasBytes = (size_t)gifCanvasWidth * gifCanvasHeight * 2;
+      gifKeyframes[slot] = (uint16_t*)memAllocStrict(canvasBytes, MEM_PSRAM);
+      if (gifKeyframes[slot] != NULL) memcpy(gifKeyframes[slot], gifCanvas, canvasBytes);
+    }
+  }
+  return true;
+}
+
+// Show any frame: restore the nearest keyframe at or before it and decode
+// the rest off screen (on screen when there is no canvas)
+bool gifSeekTo(int frame) {
+  if (!gifIndexed || frame < 0 || frame >= gifIndex->frameCount) return false;
+  if (frame == gifFrame) return true;
+
+  // Nearest snapshot - or carry on from here if that is closer
+  int from = -1;
+  if (gifCanvas != NULL) {
+    for (int slot = min(frame / gifKeyframeInterval, gifKeyframeCount - 1); slot >= 0 && from < 0; slot--) {
+      if (gifKeyframes[slot] != NULL) from = slot * gifKeyframeInterval;
+    }
+  }
+
+  if (gifFrame >= from && gifFrame < frame && gifViewFrame == gifFrame + 1) {
+    // Already on the way - just keep decoding
+  } else if (from >= 0) {
+    memcpy(gifCanvas, gifKeyframes[from / gifKeyframeInterval], (size_t)gifCanvasWidth * gifCanvasHeight * 2);
+    gifFrame = from;
+    if (!gifOpenAt(from + 1 < gifIndex->frameCount ? from + 1 : 0)) return false;
+  } else {
+    if (gifCanvas != NULL) memset(gifCanvas, 0, (size_t)gifCanvasWidth * gifCanvasHeight * 2);
+    gifFrame = -1;
+    if (!gifOpenAt(0)) return false;
+  }
+
+  gifSeekSilent = (gifCanvas != NULL);
+  bool ok = true;
+  while (ok && gifFrame < frame) {
+    ok = gifDecodeNext(NULL);
+  }
+  gifSeekSilent = false;
+
+  if (gifCanvas != NULL) {
+    framePushImage(gifCanvasX(), gifCanvasY(), gifCanvasWidth, gifCanvasHeight, gifCanvas);
+  }
+  return ok;
+}
+
+// Play the frame after the current one, going back to the first after the last
+bool gifPlayNext(int* delayMs) {
+  if (!gifIndexed) return false;
+
+  int next = (gifFrame + 1) % gifIndex->frameCount;
+  if (next == 0) {
+    if (!gifOpenAt(0)) return false;
+  } else if (gifViewFrame != next) {
+    // The decoder is somewhere else - a seek puts the frame on screen
+    if (!gifSeekTo(next)) return false;
+    if (delayMs) *delayMs = gifIndex->delays[next];
+    return true;
+  }
+
+  return gifDecodeNext(delayMs);
+}
+
+// Frame the wall clock asks for: one loop every GIF_SYNC_SECONDS, stretched
+// or squeezed to fit. delayMs is how long that frame should stay.
+int gifWallClockFrame(int* delayMs) {
+  if (!gifIndexed || GIF_SYNC_SECONDS <= 0) return -1;
+
+  // Milliseconds within the current second, from when it started
+  if (seconds != gifSyncLastSecond) {
+    gifSyncLastSecond = seconds;
+    gifSyncSecondStart = millis();
+  }
+  unsigned long subSecond = min(millis() - gifSyncSecondStart, 999UL);
+
+  unsigned long period = GIF_SYNC_SECONDS * 1000UL;
+  unsigned long phase = (((unsigned long)(hours * 3600 + minutes * 60 + seconds) * 1000UL + subSecond) % period);
+  unsigned long target = (unsigned long)((uint64_t)phase * gifIndex->loopMs / period);
+
+  int frame = 0;
+  unsigned long elapsed = 0;
+  while (frame < gifIndex->frameCount - 1 && elapsed + gifIndex->delays[frame] <= target) {
+    elapsed += gifIndex->delays[frame];
+    frame++;
+  }
+
+  if (delayMs) {
+    unsigned long remaining = elapsed + gifIndex->delays[frame] - target;
+    *delayMs = max(1, (int)((uint64_t)remaining * period / gifIndex->loopMs));
+  }
+  return frame;
+}
+
+#endif  // GIF_SEEK_H
@@ -0,0 +1,304 @@
+/*
+ * glyph_cache.h - Anti-aliased proportional font with an LRU glyph cache
+ * For Multi-Mode Digital Clock project
+ * Loads a TFT_eSPI smooth font (.vlw) from storage, keeps real per-glyph
+ * metrics in RAM and caches recently used coverage bitmaps, so repeated text
+ * (weekday names, dates) renders without touching the file. Only text drawn
+ * at SMOOTH_FONT_TEXT_SIZE uses it - smaller text such as the weather
+ * description keeps the GLCD font, which fits the 8-pixel rows it was laid
+ * out for. Falls back to the built-in GLCD font when no font file is present.
+ */
+
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include <FS.h>
+#include "storage.h"
+#include "config.h"
+#include "utils.h"
+#include "mem_alloc.h"
+
+// Font file created with the TFT_eSPI font creator (Processing sketch)
+#ifndef SMOOTH_FONT_FILE
+#define SMOOTH_FONT_FILE "/font.vlw"
+#endif
+
+// The smooth font replaces GLCD text drawn at this size (labels, day, date)
+#ifndef SMOOTH_FONT_TEXT_SIZE
+#define SMOOTH_FONT_TEXT_SIZE 2
+#endif
+
+// Number of glyph bitmaps kept in RAM
+#define GLYPH_CACHE_SLOTS 32
+
+// Printable ASCII range kept in the metrics table
+#define GLYPH_FIRST_CHAR 32
+#define GLYPH_LAST_CHAR 126
+#define GLYPH_TABLE_SIZE (GLYPH_LAST_CHAR - GLYPH_FIRST_CHAR + 1)
+
+// Metrics for one glyph, read from the .vlw header
+struct GlyphMetrics {
+  uint8_t width;
+  uint8_t height;
+  uint8_t xAdvance;
+  int8_t dX;          // Left side bearing
+  int8_t dY;          // Top of bitmap above the baseline
+  uint32_t offset;    // Bitmap position in the font file (0 = not in font)
+};
+
+// One cache slot holding a coverage bitmap (one byte per pixel)
+struct GlyphCacheSlot {
+  uint8_t code;       // 0 = empty
+  uint32_t lastUsed;
+  uint8_t* bitmap;
+};
+
+GlyphMetrics glyphTable[GLYPH_TABLE_SIZE];
+GlyphCacheSlot glyphCache[GLYPH_CACHE_SLOTS];
+uint8_t* glyphCachePool = NULL;
+uint16_t glyphSlotBytes = 0;
+uint32_t glyphCacheClock = 0;
+
+File glyphFontFile;
+bool smoothFontLoaded = false;
+bool smoothFontEnabled = true;  // Off for themes that ask for the built-in font
+int smoothFontAscent = 0;
+int smoothFontDescent = 0;
+int smoothFontSpaceAdvance = 0;
+
+// Cache statistics
+uint32_t glyphCacheHits = 0;
+uint32_t glyphCacheMisses = 0;
+
+// Function prototypes
+bool glyphFontBegin();
+bool useSmoothFont(uint8_t size);
+int textWidth(const char* text, uint8_t size);
+int textHeight(uint8_t size);
+void drawText(int x, int y, const char* text, uint8_t size, uint16_t color, uint16_t bgColor, bool opaque);
+void drawCenteredText(int y, const char* text, uint8_t size, uint16_t color, uint16_t bgColor, bool opaque);
+
+// .vlw files store 32-bit big-endian values
+uint32_t readFontValue(File& file) {
+  uint8_t b[4];
+  if (file.read(b, 4) != 4) return 0;
+  return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+// Load glyph metrics and allocate the cache - call after storage is mounted
+bool glyphFontBegin() {
+  if (!clockFS().exists(SMOOTH_FONT_FILE)) {
+    Serial.println("No smooth font file - using built-in font");
+    return false;
+  }
+
+  glyphFontFile = clockFS().open(SMOOTH_FONT_FILE, "r");
+  if (!glyphFontFile) {
+    Serial.println("Failed to open smooth font file");
+    return false;
+  }
+
+  // Header: glyph count, version, size, unused, ascent, descent
+  uint32_t glyphCount = readFontValue(glyphFontFile);
+  readFontValue(glyphFontFile);
+  readFontValue(glyphFontFile);
+  readFontValue(glyphFontFile);
+  smoothFontAscent = (int)readFontValue(glyphFontFile);
+  smoothFontDescent = (int)readFontValue(glyphFontFile);
+
+  memset(glyphTable, 0, sizeof(glyphTable));
+
+  // Bitmaps follow the glyph records in the same order
+  uint32_t bitmapOffset = 24 + glyphCount * 28;
+  uint16_t largestGlyph = 0;
+
+  for (uint32_t i = 0; i < glyphCount; i++) {
+    uint32_t code = readFontValue(glyphFontFile);
+    uint32_t height = readFontValue(glyphFontFile);
+    uint32_t width = readFontValue(glyphFontFile);
+    uint32_t xAdvance = readFontValue(glyphFontFile);
+    int32_t dY = (int32_t)readFontValue(glyphFontFile);
+    int32_t dX = (int32_t)readFontValue(glyphFontFile);
+    readFontValue(glyphFontFile);  // Padding
+
+    if (code >= GLYPH_FIRST_CHAR && code <= GLYPH_LAST_CHAR && width < 256 && height < 256) {
+      GlyphMetrics& m = glyphTable[code - GLYPH_FIRST_CHAR];
+      m.width = width;
+      m.height = height;
+      m.xAdvance = xAdvance;
+      m.dX = dX;
+      m.dY = dY;
+      m.offset = bitmapOffset;
+      largestGlyph = max(largestGlyph, (uint16_t)(width * height));
+    }
+
+    bitmapOffset += width * height;
+  }
+
+  // Space usually has no bitmap - fall back to a quarter of the font height
+  GlyphMetrics& space = glyphTable[' ' - GLYPH_FIRST_CHAR];
+  smoothFontSpaceAdvance = space.xAdvance ? space.xAdvance : (smoothFontAscent + smoothFontDescent) / 4;
+
+  // Every slot is sized for the largest glyph, so the pool never fragments
+  glyphSlotBytes = max(largestGlyph, (uint16_t)1);
+  glyphCachePool = (uint8_t*)memAlloc(GLYPH_CACHE_SLOTS * glyphSlotBytes, MEM_PSRAM);
+  if (glyphCachePool == NULL) {
+    Serial.println("Not enough memory for glyph cache");
+    glyphFontFile.close();
+    return false;
+  }
+
+  for (int i = 0; i < GLYPH_CACHE_SLOTS; i++) {
+    glyphCache[i].code = 0;
+    glyphCache[i].lastUsed = 0;
+    glyphCache[i].bitmap = glyphCachePool + i * glyphSlotBytes;
+  }
+
+  smoothFontLoaded = true;
+  Serial.printf("Smooth font loaded: %u glyphs, ascent %d, cache %d x %u bytes\n",
+                glyphCount, smoothFontAscent, GLYPH_CACHE_SLOTS, glyphSlotBytes);
+  return true;
+}
+
+// True when text of this GLCD size is drawn with the smooth font
+bool useSmoothFont(uint8_t size) {
+  return smoothFontLoaded && smoothFontEnabled && size == SMOOTH_FONT_TEXT_SIZE;
+}
+
+// Get a glyph bitmap, reading it from the font file on a cache miss
+const uint8_t* getGlyphBitmap(uint8_t code) {
+  const GlyphMetrics& m = glyphTable[code - GLYPH_FIRST_CHAR];
+  if (m.offset == 0 || m.width == 0 || m.height == 0) return NULL;
+
+  glyphCacheClock++;
+
+  int victim = 0;
+  for (int i = 0; i < GLYPH_CACHE_SLOTS; i++) {
+    if (glyphCache[i].code == code) {
+      glyphCache[i].lastUsed = glyphCacheClock;
+      glyphCacheHits++;
+      return glyphCache[i].bitmap;
+    }
+    // Least recently used slot (empty slots have lastUsed 0)
+    if (glyphCache[i].lastUsed < glyphCache[victim].lastUsed) {
+      victim = i;
+    }
+  }
+
+  glyphCacheMisses++;
+
+  GlyphCacheSlot& slot = glyphCache[victim];
+  size_t bytes = m.width * m.height;
+  if (!glyphFontFile.seek(m.offset) || glyphFontFile.read(slot.bitmap, bytes) != bytes) {
+    slot.code = 0;
+    slot.lastUsed = 0;
+    return NULL;
+  }
+
+  slot.code = code;
+  slot.lastUsed = glyphCacheClock;
+  return slot.bitmap;
+}
+
+// Width in pixels of a string as it will actually be drawn
+int textWidth(const char* text, uint8_t size) {
+  if (!useSmoothFont(size)) {
+    return strlen(text) * 6 * size;
+  }
+
+  int width = 0;
+  for (int i = 0; text[i] != '\0'; i++) {
+    uint8_t c = text[i];
+    if (c == ' ') {
+      width += smoothFontSpaceAdvance;
+    } else if (c >= GLYPH_FIRST_CHAR && c <= GLYPH_LAST_CHAR) {
+      width += glyphTable[c - GLYPH_FIRST_CHAR].xAdvance;
+    }
+  }
+  return width;
+}
+
+// Line height in pixels
+int textHeight(uint8_t size) {
+  if (!useSmoothFont(size)) {
+    return 8 * size;
+  }
+  return smoothFontAscent + smoothFontDescent;
+}
+
+// Draw one glyph - full-coverage runs as lines, edge pixels blended
+void drawSmoothGlyph(int x, int y, uint8_t code, uint16_t color, uint16_t bgColor, bool blend) {
+  const GlyphMetrics& m = glyphTable[code - GLYPH_FIRST_CHAR];
+  const uint8_t* bitmap = getGlyphBitmap(code);
+  if (bitmap == NULL) return;
+
+  int gx = x + m.dX;
+  int gy = y + smoothFontAscent - m.dY;
+
+  for (int row = 0; row < m.height; row++) {
+    const uint8_t* coverage = bitmap + row * m.width;
+    int col = 0;
+
+    while (col < m.width) {
+      uint8_t alpha = coverage[col];
+
+      if (alpha == 255) {
+        int start = col;
+        while (col < m.width && coverage[col] == 255) col++;
+        tft->drawFastHLine(gx + start, gy + row, col - start, color);
+        continue;
+      }
+
+      if (alpha > 0) {
+        if (blend) {
+          tft->drawPixel(gx + col, gy + row, tft->alphaBlend(alpha, color, bgColor));
+        } else if (alpha >= 128) {
+          // Unknown background - no blending possible
+          tft->drawPixel(gx + col, gy + row, color);
+        }
+      }
+      col++;
+    }
+  }
+}
+
+// Draw text with the smooth font when available, GLCD otherwise.
+// Transparent smooth text cannot blend its edges with an unknown background.
+void drawText(int x, int y, const char* text, uint8_t size, uint16_t color, uint16_t bgColor, bool opaque) {
+  if (!useSmoothFont(size)) {
+    tft->setTextSize(size);
+    if (opaque) {
+      tft->setTextColor(color, bgColor);
+    } else {
+      tft->setTextColor(color);
+    }
+    tft->setCursor(x, y);
+    tft->print(text);
+    return;
+  }
+
+  if (opaque) {
+    tft->fillRect(x, y, textWidth(text, size), textHeight(size), bgColor);
+  }
+
+  for (int i = 0; text[i] != '\0'; i++) {
+    uint8_t c = text[i];
+    if (c == ' ') {
+      x += smoothFontSpaceAdvance;
+      continue;
+    }
+    if (c < GLYPH_FIRST_CHAR || c > GLYPH_LAST_CHAR) continue;
+
+    drawSmoothGlyph(x, y, c, color, bgColor, opaque);
+    x += glyphTable[c - GLYPH_FIRST_CHAR].xAdvance;
+  }
+}
+
+// Draw text centered horizontally on the screen
+void drawCenteredText(int y, const char* text, uint8_t size, uint16_t color, uint16_t bgColor, bool opaque) {
+  drawText(screenCenterX - textWidth(text, size) / 2, y, text, size, color, bgColor, opaque);
+}
+
+#endif  // GLYPH_CACHE_H
@@ -0,0 +1,337 @@
+/*
+ * image_analysis.h - Background analysis for automatic clock placement
+ * For Multi-Mode Digital Clock project
+ * While a JPEG is decoded, tft_output() feeds every block through
+ * analyzeImageBlock(), which keeps luminance, variance and edge totals for
+ * 16-row bands under the clock. The summary is saved per asset in
+ * /bgmeta.txt, so later redraws of the same background skip the analysis.
+ * Lines of deleted backgrounds are dropped again at boot.
+ */
+
+#ifndef IMAGE_ANALYSIS_H
+#define IMAGE_ANALYSIS_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "storage.h"
+#include "config.h"
+#include "log_buffer.h"
+
+// File holding one summary line per background
+#define IMAGE_META_FILE "/bgmeta.txt"
+
+// Band geometry - JPEG blocks are 8 or 16 rows, so bands line up with them
+#define IMAGE_BAND_HEIGHT 16
+#define IMAGE_BANDS 15
+
+// Only the columns the digits cover are analyzed
+#define IMAGE_ANALYSIS_X0 56
+#define IMAGE_ANALYSIS_X1 184
+
+// Rows the digital clock covers around its vertical center
+#define CLOCK_AREA_ABOVE 40
+#define CLOCK_AREA_BELOW 36
+
+// Candidate placements - same offsets as POS_TOP, POS_CENTER and POS_BOTTOM,
+// center first so it wins ties
+#define PLACEMENT_COUNT 3
+const int placementOffsets[PLACEMENT_COUNT] = { 0, -80, 80 };
+
+// Running totals for one band while a JPEG streams by
+struct BandAccumulator {
+  uint32_t pixels;
+  uint32_t lumaSum;
+  uint32_t lumaSquareSum;
+  uint32_t edgeSum;
+  uint32_t edgeCount;
+  uint32_t redSum, greenSum, blueSum;
+};
+
+// Finished summary of one band
+struct BandSummary {
+  uint8_t luma;      // Mean luminance 0-255
+  uint8_t deviation; // Standard deviation of luminance
+  uint8_t edge;      // Mean luminance step between neighbouring pixels
+  uint16_t color;    // Mean color (RGB565)
+};
+
+BandAccumulator bandTotals[IMAGE_BANDS];
+BandSummary imageBands[IMAGE_BANDS];
+bool imageAnalysisRunning = false;
+
+// Result for the current background
+bool autoPlacementValid = false;
+int autoPlacementOffset = 0;
+uint16_t autoDigitColor = 0x07FF;
+uint16_t autoDigitBackground = 0x0001;
+
+// Function prototypes
+void imageAnalysisBegin(const char* filename);
+void analyzeImageBlock(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t* bitmap);
+void imageAnalysisFinish(const char* filename, bool decoded);
+bool loadImageSummary(const char* filename);
+void forgetImageSummary(const char* filename);
+void compactImageSummaries();
+void chooseAutoPlacement();
+
+// Luminance of an RGB565 pixel (0-255)
+uint8_t pixelLuma(uint16_t color) {
+  uint16_t r = (color >> 8) & 0xF8;
+  uint16_t g = (color >> 3) & 0xFC;
+  uint16_t b = (color << 3) & 0xF8;
+  return (r * 77 + g * 150 + b * 29) >> 8;
+}
+
+// Start a new analysis unless this background already has a summary
+void imageAnalysisBegin(const char* filename) {
+  autoPlacementValid = false;
+
+  if (loadImageSummary(filename)) {
+    imageAnalysisRunning = false;
+    chooseAutoPlacement();
+    return;
+  }
+
+  memset(bandTotals, 0, sizeof(bandTotals));
+  imageAnalysisRunning = true;
+}
+
+// Accumulate one decoded block (pixels are byte-swapped for the panel)
+void analyzeImageBlock(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t* bitmap) {
+  if (!imageAnalysisRunning) return;
+
+  int sx = max((int)x, IMAGE_ANALYSIS_X0);
+  int ex = min(x + w, IMAGE_ANALYSIS_X1);
+  if (sx >= ex) return;
+
+  for (int row = 0; row < h; row++) {
+    int band = (y + row) / IMAGE_BAND_HEIGHT;
+    if (band < 0 || band >= IMAGE_BANDS) continue;
+
+    BandAccumulator& totals = bandTotals[band];
+    const uint16_t* line = bitmap + row * w;
+
+    for (int col = sx; col < ex; col++) {
+      uint16_t color = __builtin_bswap16(line[col - x]);
+      uint8_t luma = pixelLuma(color);
+
+      totals.pixels++;
+      totals.lumaSum += luma;
+      totals.lumaSquareSum += luma * luma;
+      totals.redSum += (color >> 11) & 0x1F;
+      totals.greenSum += (color >> 5) & 0x3F;
+      totals.blueSum += color & 0x1F;
+
+      // Steps to the left and upper neighbours inside this block
+      if (col > sx) {
+        totals.edgeSum += abs(luma - pixelLuma(__builtin_bswap16(line[col - x - 1])));
+        totals.edgeCount++;
+      }
+      if (row > 0) {
+        totals.edgeSum += abs(luma - pixelLuma(__builtin_bswap16(line[col - x - w])));
+        totals.edgeCount++;
+      }
+    }
+  }
+}
+
+// Write one summary line: "name:luma,deviation,edge,color;..."
+void saveImageSummary(const char* filename) {
+  File file = clockFS().open(IMAGE_META_FILE, "a");
+  if (!file) {
+    LOG_ERROR("Failed to open %s", IMAGE_META_FILE);
+    return;
+  }
+
+  file.print(filename);
+  file.print(":");
+  for (int i = 0; i < IMAGE_BANDS; i++) {
+    if (i > 0) file.print(";");
+    file.printf("%d,%d,%d,%d", imageBands[i].luma, imageBands[i].deviation, imageBands[i].edge, imageBands[i].color);
+  }
+  file.println();
+  file.close();
+}
+
+// Find a stored summary for this background
+bool loadImageSummary(const char* filename) {
+  if (!clockFS().exists(IMAGE_META_FILE)) return false;
+
+  File file = clockFS().open(IMAGE_META_FILE, "r");
+  if (!file) return false;
+
+  size_t nameLength = strlen(filename);
+  bool found = false;
+
+  while (file.available() && !found) {
+    String line = file.readStringUntil('\n');
+    line.trim();
+
+    if (line.length() <= nameLength || line.charAt(nameLength) != ':' || !line.startsWith(filename)) {
+      continue;
+    }
+
+    // Parse the band values
+    const char* p = line.c_str() + nameLength + 1;
+    int band = 0;
+    while (band < IMAGE_BANDS && *p) {
+      int luma, deviation, edge, color;
+      if (sscanf(p, "%d,%d,%d,%d", &luma, &deviation, &edge, &color) != 4) break;
+
+      imageBands[band].luma = luma;
+      imageBands[band].deviation = deviation;
+      imageBands[band].edge = edge;
+      imageBands[band].color = color;
+      band++;
+
+      p = strchr(p, ';');
+      if (p == NULL) break;
+      p++;
+    }
+    found = (band == IMAGE_BANDS);
+  }
+
+  file.close();
+  return found;
+}
+
+// Drop the stored summary of a background that was replaced or deleted
+void forgetImageSummary(const char* filename) {
+  if (filename[0] == '/') filename++;  // Summaries are stored by bare name
+
+  File source = clockFS().open(IMAGE_META_FILE, "r");
+  if (!source) return;
+
+  String tempName = String(IMAGE_META_FILE) + ".tmp";
+  File target = clockFS().open(tempName, "w");
+  if (!target) {
+    source.close();
+    return;
+  }
+
+  size_t nameLength = strlen(filename);
+  bool dropped = false;
+  while (source.available()) {
+    String line = source.readStringUntil('\n');
+    line.trim();
+    if (line.length() == 0) continue;
+
+    if (line.length() > nameLength && line.charAt(nameLength) == ':' && line.startsWith(filename)) {
+      dropped = true;
+    } else {
+      target.println(line);
+    }
+  }
+  source.close();
+  target.close();
+
+  if (!dropped || !storageReplace(tempName, IMAGE_META_FILE)) {
+    clockFS().remove(tempName);
+  }
+}
+
+// Drop summaries of backgrounds that are gone - call once the asset partition is up
+void compactImageSummaries() {
+  compactNameIndex(IMAGE_META_FILE);
+}
+
+// Turn the running totals into band summaries and remember them
+void imageAnalysisFinish(const char* filename, bool decoded) {
+  if (!imageAnalysisRunning) return;
+  imageAnalysisRunning = false;
+
+  if (!decoded) return;
+
+  for (int i = 0; i < IMAGE_BANDS; i++) {
+    BandAccumulator& totals = bandTotals[i];
+    if (totals.pixels == 0) {
+      // Image did not reach this band - treat it as calm black
+      imageBands[i] = { 0, 0, 0, 0 };
+      continue;
+    }
+
+    uint32_t mean = totals.lumaSum / totals.pixels;
+    int32_t variance = (int32_t)(totals.lumaSquareSum / totals.pixels) - (int32_t)(mean * mean);
+
+    imageBands[i].luma = mean;
+    imageBands[i].deviation = min(255, (int)sqrt(max(variance, (int32_t)0)));
+    imageBands[i].edge = totals.edgeCount ? min(255, (int)(totals.edgeSum / totals.edgeCount)) : 0;
+    imageBands[i].color = ((totals.redSum / totals.pixels) << 11) | ((totals.greenSum / totals.pixels) << 5) | (totals.blueSum / totals.pixels);
+  }
+
+  saveImageSummary(filename);
+  chooseAutoPlacement();
+}
+
+// Approximate contrast between two luminances (WCAG-style ratio x 100)
+int lumaContrast(uint8_t a, uint8_t b) {
+  int light = max(a, b);
+  int dark = min(a, b);
+  return (light + 13) * 100 / (dark + 13);
+}
+
+// Pick the calmest clock position and a digit color that stands out from it
+void chooseAutoPlacement() {
+  int bestScore = 0x7FFFFFFF;
+  uint32_t bestLuma = 0, bestRed = 0, bestGreen = 0, bestBlue = 0;
+
+  for (int p = 0; p < PLACEMENT_COUNT; p++) {
+    int centerY = (IMAGE_BANDS * IMAGE_BAND_HEIGHT) / 2 + placementOffsets[p];
+    int top = centerY - CLOCK_AREA_ABOVE;
+    int bottom = centerY + CLOCK_AREA_BELOW;
+
+    // Weight each band by how many clock rows fall in it
+    int score = 0, rows = 0;
+    uint32_t luma = 0, red = 0, green = 0, blue = 0;
+    for (int i = 0; i < IMAGE_BANDS; i++) {
+      int overlap = min(bottom, (i + 1) * IMAGE_BAND_HEIGHT) - max(top, i * IMAGE_BAND_HEIGHT);
+      if (overlap <= 0) continue;
+
+      const BandSummary& band = imageBands[i];
+      score += overlap * (band.edge * 2 + band.deviation);
+      luma += overlap * band.luma;
+      red += overlap * ((band.color >> 11) & 0x1F);
+      green += overlap * ((band.color >> 5) & 0x3F);
+      blue += overlap * (band.color & 0x1F);
+      rows += overlap;
+    }
+    if (rows == 0) continue;
+
+    score /= rows;
+    if (score < bestScore) {
+      bestScore = score;
+      autoPlacementOffset = placementOffsets[p];
+      bestLuma = luma / rows;
+      bestRed = red / rows;
+      bestGreen = green / rows;
+      bestBlue = blue / rows;
+    }
+  }
+
+  // Digit colors, from the default cyan to black on a light box
+  const uint16_t digitColors[] = { 0x07FF, TFT_WHITE, TFT_YELLOW, TFT_BLACK };
+  int bestContrast = -1;
+  for (int i = 0; i < 4; i++) {
+    int contrast = lumaContrast(pixelLuma(digitColors[i]), bestLuma);
+
+    // Prefer a color that also differs in hue from the background
+    uint16_t c = digitColors[i];
+    int colorDistance = abs((int)((c >> 11) & 0x1F) - (int)bestRed) +
+                        abs((int)((c >> 5) & 0x3F) / 2 - (int)bestGreen / 2) +
+                        abs((int)(c & 0x1F) - (int)bestBlue);
+    contrast += colorDistance * 2;
+
+    if (contrast > bestContrast) {
+      bestContrast = contrast;
+      autoDigitColor = c;
+    }
+  }
+
+  // Dark digits get a light box behind them, bright digits the usual dark one
+  autoDigitBackground = (pixelLuma(autoDigitColor) < 128) ? TFT_WHITE : 0x0001;
+  autoPlacementValid = true;
+
+  LOG_INFO("Auto placement: offset %d, busy score %d, digit color 0x%04x", autoPlacementOffset, bestScore, autoDigitColor);
+}
+
+#endif  // IMAGE_ANALYSIS_H
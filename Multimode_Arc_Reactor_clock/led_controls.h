@@ -9,12 +9,13 @@
 #include <Arduino.h>
 #include <Adafruit_NeoPixel.h>
 #include "theme_manager.h"
+#include "glyph_cache.h"
+#include "metrics.h"
 
 // External references
 extern Adafruit_NeoPixel pixels;
 extern int currentMode;
-extern bool needClockRefresh;
-extern TFT_eSPI tft;
+extern TFT_eSPI* tft;
 extern int screenCenterX;
 extern int screenCenterY;
 
@@ -44,7 +45,8 @@ void updateLEDs() {
                               ledColors[currentLedColor].b));
   }
   
-  pixels.show(); 
+  pixels.show();
+  metricsLedShows++;
 }
 
 // Flash effect for the LED ring (used for notifications/transitions)
@@ -56,11 +58,13 @@ void flashEffect() {
     pixels.setPixelColor(i, pixels.Color(250, 250, 250));
   }
   pixels.show();
+  metricsLedShows++;
 
   // Fade down brightness
   for (int i = led_ring_brightness_flash; i > 10; i--) {
     pixels.setBrightness(i);
     pixels.show();
+    metricsLedShows++;
     delay(8);
   }
 
@@ -77,28 +81,25 @@ void showColorNameOverlay() {
   const char* colorName = ledColors[currentLedColor].name;
 
   // Create a semi-transparent background for text
-  int textWidth = strlen(colorName) * 12;  // Approximate width
-  int rectX = screenCenterX - (textWidth / 2) - 10;
+  int nameWidth = textWidth(colorName, 2);
+  int rectX = screenCenterX - (nameWidth / 2) - 10;
   int rectY = screenCenterY - 40;
-  int rectWidth = textWidth + 20;
+  int rectWidth = nameWidth + 20;
   int rectHeight = 30;
 
   // Draw background
-  tft.fillRoundRect(rectX, rectY, rectWidth, rectHeight, 5, TFT_BLACK);
-  tft.drawRoundRect(rectX, rectY, rectWidth, rectHeight, 5, ledColors[currentLedColor].tft_color);
+  tft->fillRoundRect(rectX, rectY, rectWidth, rectHeight, 5, TFT_BLACK);
+  tft->drawRoundRect(rectX, rectY, rectWidth, rectHeight, 5, ledColors[currentLedColor].tft_color);
 
   // Draw text
-  tft.setTextSize(2);
-  tft.setTextColor(ledColors[currentLedColor].tft_color);
-  tft.setCursor(screenCenterX - (textWidth / 2), screenCenterY - 35);
-  tft.println(colorName);
+  drawText(screenCenterX - (nameWidth / 2), screenCenterY - 35, colorName, 2, ledColors[currentLedColor].tft_color, TFT_BLACK, true);
 }
 
 // Check if color name overlay should be hidden
 void checkColorNameTimeout() {
   if (showColorName && (millis() - lastColorChangeTime > 2000)) {
     showColorName = false;
-    needClockRefresh = true;  // Trigger a redraw on the next clock update
+    clockRequestRefresh();  // Trigger a redraw on the next clock update
   }
 }
 
@@ -0,0 +1,370 @@
+/*
+ * log_buffer.h - Deferred ring-buffer logging
+ * For Multi-Mode Digital Clock project
+ * LOG_xxx() stores a compact binary record (format pointer, integer args,
+ * copied strings) in RAM and returns immediately. Records are formatted and
+ * written to Serial later by a low-priority task, only as fast as the UART
+ * can take them. Levels above LOG_LEVEL compile to nothing.
+ */
+
+#ifndef LOG_BUFFER_H
+#define LOG_BUFFER_H
+
+#include <Arduino.h>
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include "config.h"
+#include "utils.h"
+
+// Log levels
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// 1 = drain from a low-priority task, 0 = drain from loop() via logService()
+#ifndef LOG_DRAIN_TASK
+#define LOG_DRAIN_TASK 1
+#endif
+
+// 1 = keep the buffer in RTC memory so records survive a crash and are
+// printed on the next boot
+#ifndef LOG_CRASH_FLUSH
+#define LOG_CRASH_FLUSH 1
+#endif
+
+// Buffer geometry
+#define LOG_BUFFER_RECORDS 64
+#define LOG_MAX_ARGS 4
+#define LOG_TEXT_LENGTH 40
+#define LOG_LINE_LENGTH 160
+#define LOG_RING_MAGIC 0x4C4F4752  // "LOGR"
+
+// One log call - strings are copied back to back, NUL separated
+struct LogRecord {
+  uint32_t timestamp;
+  const char* format;  // Must be a string literal
+  int32_t args[LOG_MAX_ARGS];
+  char text[LOG_TEXT_LENGTH];
+  uint8_t level;
+  uint8_t argCount;
+  uint8_t textLength;
+};
+
+struct LogRing {
+  uint32_t magic;
+  uint32_t buildId;
+  uint16_t head;  // Next record to write
+  uint16_t tail;  // Next record to print
+  uint32_t dropped;
+  LogRecord records[LOG_BUFFER_RECORDS];
+};
+
+#if LOG_CRASH_FLUSH
+RTC_NOINIT_ATTR LogRing logRing;
+#else
+LogRing logRing;
+#endif
+
+portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+SemaphoreHandle_t logDrainLock = NULL;  // One printer at a time (drain task, loop, flush)
+bool logReady = false;
+
+// Function prototypes
+void logBegin();
+void logService();
+bool logDrain(bool blocking);
+void logFlushAll();
+
+// Level macros - disabled levels do not evaluate their arguments
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+// Argument packing - integers and floats go to args[], strings to text[]
+void packLogArg(LogRecord& record, long value) {
+  if (record.argCount < LOG_MAX_ARGS) {
+    record.args[record.argCount++] = value;
+  }
+}
+
+void packLogArg(LogRecord& record, int value) { packLogArg(record, (long)value); }
+void packLogArg(LogRecord& record, unsigned int value) { packLogArg(record, (long)value); }
+void packLogArg(LogRecord& record, unsigned long value) { packLogArg(record, (long)value); }
+
+// 64-bit values take two slots, low word first - format them with %lld/%llu
+void packLogArg(LogRecord& record, long long value) {
+  if (record.argCount + 2 > LOG_MAX_ARGS) {
+    record.argCount = LOG_MAX_ARGS;
+    return;
+  }
+  packLogArg(record, (long)(uint32_t)value);
+  packLogArg(record, (long)(uint32_t)((unsigned long long)value >> 32));
+}
+
+void packLogArg(LogRecord& record, unsigned long long value) { packLogArg(record, (long long)value); }
+
+// Floats keep their bit pattern in one slot; doubles are narrowed to float
+void packLogArg(LogRecord& record, float value) {
+  int32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  packLogArg(record, (long)bits);
+}
+
+void packLogArg(LogRecord& record, double value) { packLogArg(record, (float)value); }
+
+void packLogArg(LogRecord& record, const char* value) {
+  if (value == NULL) value = "";
+
+  // Always leave room for this string's terminator
+  while (*value && record.textLength < LOG_TEXT_LENGTH - 1) {
+    record.text[record.textLength++] = *value++;
+  }
+  if (record.textLength < LOG_TEXT_LENGTH) {
+    record.text[record.textLength++] = '\0';
+  }
+}
+
+void packLogArg(LogRecord& record, const String& value) { packLogArg(record, value.c_str()); }
+
+void packLogArgs(LogRecord& record) {}
+
+template <typename T, typename... Rest>
+void packLogArgs(LogRecord& record, const T& first, const Rest&... rest) {
+  packLogArg(record, first);
+  packLogArgs(record, rest...);
+}
+
+// Store a record, dropping it if the buffer is full
+void logPush(const LogRecord& record) {
+  if (!logReady) return;
+
+  portENTER_CRITICAL(&logMux);
+  uint16_t next = (logRing.head + 1) % LOG_BUFFER_RECORDS;
+  if (next == logRing.tail) {
+    logRing.dropped++;
+  } else {
+    logRing.records[logRing.head] = record;
+    logRing.head = next;
+  }
+  portEXIT_CRITICAL(&logMux);
+}
+
+// Build a record - called through the LOG_xxx() macros
+template <typename... Args>
+void logWrite(uint8_t level, const char* format, const Args&... args) {
+  LogRecord record;
+  record.timestamp = millis();
+  record.format = format;
+  record.level = level;
+  record.argCount = 0;
+  record.textLength = 0;
+  packLogArgs(record, args...);
+  logPush(record);
+}
+
+// Turn a record back into text, following its printf-style format
+size_t formatLogRecord(const LogRecord& record, char* line, size_t size) {
+  static const char levelTags[] = { ' ', 'E', 'W', 'I', 'D' };
+
+  int n = snprintf(line, size, "[%7lu] %c ", (unsigned long)record.timestamp, levelTags[record.level % 5]);
+  const char* f = record.format;
+  const char* text = record.text;
+  const char* textEnd = record.text + record.textLength;
+  int argIndex = 0;
+
+  while (*f && n < (int)size - 1) {
+    if (*f != '%') {
+      line[n++] = *f++;
+      continue;
+    }
+    if (f[1] == '%') {
+      line[n++] = '%';
+      f += 2;
+      continue;
+    }
+
+    // Copy flags/width/precision, dropping length modifiers except "ll"
+    char spec[12];
+    int specLength = 0;
+    int longCount = 0;
+    spec[specLength++] = *f++;
+    while (*f && strchr("0123456789-+ .lh", *f)) {
+      if (*f == 'l') longCount++;
+      if (*f != 'l' && *f != 'h' && specLength < 8) spec[specLength++] = *f;
+      f++;
+    }
+    char conversion = *f ? *f++ : 'd';
+    bool wide = longCount >= 2 && conversion != 's' && !strchr("fFeEgG", conversion);
+    if (wide) {
+      spec[specLength++] = 'l';
+      spec[specLength++] = 'l';
+    }
+    spec[specLength++] = conversion;
+    spec[specLength] = '\0';
+
+    int written;
+    if (conversion == 's') {
+      const char* value = (text < textEnd) ? text : "";
+      written = snprintf(line + n, size - n, spec, value);
+      if (text < textEnd) text += strlen(text) + 1;
+    } else if (strchr("fFeEgG", conversion)) {
+      float value = 0;
+      if (argIndex < record.argCount) memcpy(&value, &record.args[argIndex++], sizeof(value));
+      written = snprintf(line + n, size - n, spec, (double)value);
+    } else if (wide) {
+      uint32_t low = (argIndex < record.argCount) ? (uint32_t)record.args[argIndex++] : 0;
+      uint32_t high = (argIndex < record.argCount) ? (uint32_t)record.args[argIndex++] : 0;
+      written = snprintf(line + n, size - n, spec, (long long)(((uint64_t)high << 32) | low));
+    } else {
+      int value = (argIndex < record.argCount) ? record.args[argIndex++] : 0;
+      written = snprintf(line + n, size - n, spec, value);
+    }
+    n = min(n + max(written, 0), (int)size - 1);
+  }
+
+  line[n] = '\0';
+  return n;
+}
+
+// Print pending records. Non-blocking mode stops when the UART buffer is full
+// or another caller is already printing. Returns true when the buffer is empty.
+bool logDrainLocked(bool blocking) {
+  char line[LOG_LINE_LENGTH];
+
+  while (true) {
+    LogRecord record;
+    uint32_t dropped = 0;
+
+    portENTER_CRITICAL(&logMux);
+    bool empty = (logRing.tail == logRing.head);
+    if (!empty) {
+      record = logRing.records[logRing.tail];
+    }
+    dropped = logRing.dropped;
+    portEXIT_CRITICAL(&logMux);
+
+    if (dropped > 0) {
+      int n = snprintf(line, sizeof(line), "[log] %lu records dropped", (unsigned long)dropped);
+      if (!blocking && Serial.availableForWrite() < n + 2) return false;
+      Serial.println(line);
+
+      portENTER_CRITICAL(&logMux);
+      logRing.dropped -= dropped;
+      portEXIT_CRITICAL(&logMux);
+    }
+
+    if (empty) return true;
+
+    size_t length = formatLogRecord(record, line, sizeof(line));
+    if (!blocking && Serial.availableForWrite() < (int)length + 2) return false;
+    Serial.println(line);
+
+    portENTER_CRITICAL(&logMux);
+    logRing.tail = (logRing.tail + 1) % LOG_BUFFER_RECORDS;
+    portEXIT_CRITICAL(&logMux);
+  }
+}
+
+bool logDrain(bool blocking) {
+  // Before logBegin() there is only one caller
+  if (logDrainLock == NULL) return logDrainLocked(blocking);
+
+  if (xSemaphoreTake(logDrainLock, blocking ? portMAX_DELAY : 0) != pdTRUE) return false;
+  bool empty = logDrainLocked(blocking);
+  xSemaphoreGive(logDrainLock);
+  return empty;
+}
+
+// Print everything now and wait for the UART - used before a restart
+void logFlushAll() {
+  logDrain(true);
+  Serial.flush();
+}
+
+#if LOG_DRAIN_TASK
+// Low-priority task that empties the buffer whenever the UART has room
+void logDrainTask(void* parameter) {
+  while (true) {
+    logDrain(false);
+    vTaskDelay(pdMS_TO_TICKS(20));
+  }
+}
+#endif
+
+// Identifies the firmware build, so stale format pointers are never followed
+uint32_t logBuildId() {
+  const char* stamp = __DATE__ " " __TIME__;
+  uint32_t hash = FNV1A_OFFSET_BASIS;
+  while (*stamp) {
+    hash = (hash ^ (uint8_t)*stamp++) * FNV1A_PRIME;
+  }
+  return hash;
+}
+
+// Set up the buffer - call right after Serial.begin()
+void logBegin() {
+  uint32_t buildId = logBuildId();
+  if (logDrainLock == NULL) logDrainLock = xSemaphoreCreateMutex();
+  esp_reset_reason_t reason = esp_reset_reason();
+
+  bool survived = LOG_CRASH_FLUSH && logRing.magic == LOG_RING_MAGIC && logRing.buildId == buildId &&
+                  logRing.head < LOG_BUFFER_RECORDS && logRing.tail < LOG_BUFFER_RECORDS &&
+                  reason != ESP_RST_POWERON;
+
+  if (survived && logRing.head != logRing.tail) {
+    Serial.printf("Log records from before reset (reason %d):\n", (int)reason);
+    logFlushAll();
+    Serial.println("End of previous log");
+  }
+
+  logRing.magic = LOG_RING_MAGIC;
+  logRing.buildId = buildId;
+  logRing.head = 0;
+  logRing.tail = 0;
+  logRing.dropped = 0;
+  logReady = true;
+
+  // Orderly restarts print whatever is still queued
+  esp_register_shutdown_handler(logFlushAll);
+
+#if LOG_DRAIN_TASK
+  xTaskCreatePinnedToCore(logDrainTask, "logDrain", 3072, NULL, 1, NULL, 0);
+#endif
+}
+
+// Drain in idle time when no drain task is used - call at the end of loop()
+void logService() {
+#if !LOG_DRAIN_TASK
+  logDrain(false);
+#endif
+}
+
+#endif  // LOG_BUFFER_H
@@ -0,0 +1,131 @@
+/*
+ * mem_alloc.h - Capability-tagged buffer allocation
+ * For Multi-Mode Digital Clock project
+ * Large buffers say what they are for instead of calling malloc():
+ *   MEM_DMA   - internal, DMA-capable RAM for SPI strips and tile runs
+ *   MEM_PSRAM - file and cache buffers, internal RAM if there is no PSRAM
+ *   MEM_FAST  - small hot buffers that should stay in internal RAM
+ * Each tag keeps its own statistics, printed by memPrintStats().
+ */
+
+#ifndef MEM_ALLOC_H
+#define MEM_ALLOC_H
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include "log_buffer.h"
+
+// Allocation tags
+#define MEM_DMA 0
+#define MEM_PSRAM 1
+#define MEM_FAST 2
+#define MEM_POOL_COUNT 3
+
+const char* memPoolNames[MEM_POOL_COUNT] = { "DMA", "PSRAM", "fast" };
+
+// Usage of one tag
+struct MemPoolStats {
+  uint32_t allocs;
+  uint32_t frees;
+  uint32_t fallbacks;  // Served from a different heap than asked for
+  uint32_t failures;
+  size_t inUse;
+  size_t peak;
+};
+
+MemPoolStats memStats[MEM_POOL_COUNT];
+
+// Function prototypes
+void* memAlloc(size_t size, int pool);
+void* memAllocStrict(size_t size, int pool);
+void memFree(void* ptr, int pool);
+void memPrintStats();
+
+// Preferred heap for each tag, and where to go when it is full or missing
+uint32_t memPreferredCaps(int pool) {
+  switch (pool) {
+    case MEM_DMA: return MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    case MEM_PSRAM: return MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+    default: return MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+  }
+}
+
+uint32_t memFallbackCaps(int pool) {
+  switch (pool) {
+    case MEM_DMA: return 0;  // SPI DMA cannot read PSRAM - no fallback
+    case MEM_PSRAM: return MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    default: return MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+  }
+}
+
+// Allocate from the preferred heap, and from the fallback heap if allowed
+void* memAllocFrom(size_t size, int pool, bool allowFallback) {
+  if (pool < 0 || pool >= MEM_POOL_COUNT) pool = MEM_FAST;
+  MemPoolStats& stats = memStats[pool];
+
+  void* ptr = heap_caps_malloc(size, memPreferredCaps(pool));
+  if (ptr == NULL && allowFallback && memFallbackCaps(pool) != 0) {
+    ptr = heap_caps_malloc(size, memFallbackCaps(pool));
+    if (ptr != NULL) stats.fallbacks++;
+  }
+
+  if (ptr == NULL) {
+    stats.failures++;
+    LOG_WARN("%s allocation of %u bytes failed", memPoolNames[pool], (unsigned int)size);
+    return NULL;
+  }
+
+  stats.allocs++;
+  stats.inUse += heap_caps_get_allocated_size(ptr);
+  stats.peak = max(stats.peak, stats.inUse);
+  return ptr;
+}
+
+// Allocate a buffer for the given use. Returns NULL if no heap can hold it.
+void* memAlloc(size_t size, int pool) {
+  return memAllocFrom(size, pool, true);
+}
+
+// Preferred heap only - for optional caches that must not eat internal RAM
+void* memAllocStrict(size_t size, int pool) {
+  return memAllocFrom(size, pool, false);
+}
+
+// Free a buffer from memAlloc() - pass the same tag it was allocated with
+void memFree(void* ptr, int pool) {
+  if (ptr == NULL) return;
+  if (pool < 0 || pool >= MEM_POOL_COUNT) pool = MEM_FAST;
+  MemPoolStats& stats = memStats[pool];
+
+  size_t size = heap_caps_get_allocated_size(ptr);
+  stats.inUse = (stats.inUse > size) ? stats.inUse - size : 0;
+  stats.frees++;
+  heap_caps_free(ptr);
+}
+
+// Report usage per tag and the free space left in each heap
+void memPrintStats() {
+  for (int i = 0; i < MEM_POOL_COUNT; i++) {
+    const MemPoolStats& stats = memStats[i];
+    LOG_INFO("Mem %s: %u bytes in use, peak %u, %u allocs", memPoolNames[i],
+             (unsigned int)stats.inUse, (unsigned int)stats.peak, (unsigned int)stats.allocs);
+    if (stats.fallbacks > 0 || stats.failures > 0) {
+      LOG_INFO("Mem %s: %u fallbacks, %u failures", memPoolNames[i],
+               (unsigned int)stats.fallbacks, (unsigned int)stats.failures);
+    }
+  }
+
+  LOG_INFO("Heap internal: %u free, largest block %u",
+           (unsigned int)heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+           (unsigned int)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  LOG_INFO("Heap DMA: %u free, largest block %u",
+           (unsigned int)heap_caps_get_free_size(MALLOC_CAP_DMA),
+           (unsigned int)heap_caps_get_largest_free_block(MALLOC_CAP_DMA));
+  if (psramFound()) {
+    LOG_INFO("Heap PSRAM: %u free, largest block %u",
+             (unsigned int)heap_caps_get_free_size(MALLOC_CAP_SPIRAM),
+             (unsigned int)heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM));
+  }
+}
+
+#endif  // MEM_ALLOC_H
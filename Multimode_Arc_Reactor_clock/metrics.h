@@ -0,0 +1,307 @@
+/*
+ * metrics.h - Prometheus metrics endpoint
+ * For Multi-Mode Digital Clock project
+ * Counters and gauges are plain globals bumped where things happen (loop,
+ * buttons, LED updates, weather fetches, NTP syncs). A small HTTP server on
+ * METRICS_PORT serves them in the Prometheus text format at /metrics.
+ * The response is rendered into one static buffer and sent a chunk per loop
+ * pass from a non-blocking state machine, so a scrape costs no heap and
+ * never holds up a frame for long.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <stdarg.h>
+#include <sys/time.h>
+#include "config.h"
+#include "theme_manager.h"
+#include "fs_maintenance.h"
+
+#ifndef METRICS_PORT
+#define METRICS_PORT 9100
+#endif
+
+#define METRICS_BUFFER_SIZE 8192
+#define METRICS_REQUEST_SIZE 256
+#define METRICS_WRITE_CHUNK 1024   // Bytes sent per loop pass
+#define METRICS_TIMEOUT 3000       // ms for a whole request
+
+// Frame time histogram upper bounds in ms (plus +Inf)
+#define METRICS_FRAME_BUCKETS 8
+const uint16_t metricsFrameBounds[METRICS_FRAME_BUCKETS] = {5, 10, 20, 35, 50, 75, 100, 250};
+
+// Loop passes shorter than this did no drawing (as in frame_governor.h)
+#define METRICS_MIN_FRAME_US 500
+
+// Button labels
+#define METRICS_BUTTON_BACKGROUND 0
+#define METRICS_BUTTON_POSITION 1
+#define METRICS_BUTTON_COLOR 2
+#define METRICS_BUTTONS 3
+
+const char* metricsModeNames[MODE_TOTAL] = {"arc_digital", "arc_analog", "pipboy", "gif_digital", "weather", "apple_rings"};
+const char* metricsButtonNames[METRICS_BUTTONS] = {"background", "position", "color"};
+
+// Frame times per mode
+struct FrameHistogram {
+  unsigned long buckets[METRICS_FRAME_BUCKETS + 1];
+  unsigned long count;
+  uint64_t sumMicros;
+};
+
+FrameHistogram metricsFrames[MODE_TOTAL];
+unsigned long metricsLoops = 0;
+unsigned long metricsButtonEvents[METRICS_BUTTONS];
+unsigned long metricsLedShows = 0;
+
+// Weather fetches
+unsigned long metricsWeatherFetches = 0;
+unsigned long metricsWeatherErrors = 0;
+uint64_t metricsWeatherMillisSum = 0;
+unsigned long metricsWeatherLastMillis = 0;
+
+// NTP corrections, written from the SNTP task
+volatile unsigned long metricsNtpSyncs = 0;
+volatile int64_t metricsNtpOffsetMicros = 0;  // Step applied by the last sync
+volatile float metricsNtpDriftPpm = 0;
+volatile int64_t metricsNtpLastSyncTimer = 0;
+int64_t metricsNtpLastSyncWall = 0;
+
+// HTTP state
+#define METRICS_IDLE 0
+#define METRICS_READING 1
+#define METRICS_WRITING 2
+
+WiFiServer metricsServer(METRICS_PORT);
+WiFiClient metricsClient;
+int metricsHttpState = METRICS_IDLE;
+unsigned long metricsRequestStart = 0;
+char metricsRequest[METRICS_REQUEST_SIZE];
+int metricsRequestLength = 0;
+char metricsBuffer[METRICS_BUFFER_SIZE];
+int metricsLength = 0;
+int metricsSent = 0;
+unsigned long metricsScrapes = 0;
+
+// Function prototypes
+void metricsBegin();
+void metricsService();
+void metricsEndFrame(int mode, unsigned long frameMicros);
+void metricsWeatherFetch(unsigned long elapsedMillis, bool ok);
+
+// Call at the end of loop() with the pass duration
+void metricsEndFrame(int mode, unsigned long frameMicros) {
+  metricsLoops++;
+  if (frameMicros < METRICS_MIN_FRAME_US || mode < 0 || mode >= MODE_TOTAL) return;
+
+  FrameHistogram& histogram = metricsFrames[mode];
+  unsigned long ms = frameMicros / 1000;
+  int bucket = 0;
+  while (bucket < METRICS_FRAME_BUCKETS && ms >= metricsFrameBounds[bucket]) bucket++;
+
+  histogram.buckets[bucket]++;
+  histogram.count++;
+  histogram.sumMicros += frameMicros;
+}
+
+void metricsWeatherFetch(unsigned long elapsedMillis, bool ok) {
+  metricsWeatherFetches++;
+  if (!ok) metricsWeatherErrors++;
+  metricsWeatherMillisSum += elapsedMillis;
+  metricsWeatherLastMillis = elapsedMillis;
+}
+
+// SNTP just set the clock to tv. Compare with where the local clock would
+// have been, counted on from the previous sync.
+void metricsNtpSynced(struct timeval* tv) {
+  int64_t timer = esp_timer_get_time();
+  int64_t wall = (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec;
+
+  if (metricsNtpSyncs > 0) {
+    int64_t elapsed = timer - metricsNtpLastSyncTimer;
+    int64_t expected = metricsNtpLastSyncWall + elapsed;
+    metricsNtpOffsetMicros = wall - expected;
+    if (elapsed > 0) metricsNtpDriftPpm = (float)metricsNtpOffsetMicros * 1e6f / (float)elapsed;
+  }
+
+  metricsNtpLastSyncTimer = timer;
+  metricsNtpLastSyncWall = wall;
+  metricsNtpSyncs++;
+}
+
+// Start listening - call after WiFi is up (or being retried)
+void metricsBegin() {
+  sntp_set_time_sync_notification_cb(metricsNtpSynced);
+
+#if METRICS_PORT > 0
+  metricsServer.begin();
+  metricsServer.setNoDelay(true);
+  Serial.printf("Metrics: http://%s:%d/metrics\n", WiFi.localIP().toString().c_str(), METRICS_PORT);
+#endif
+}
+
+// Append to metricsBuffer, dropping whatever does not fit
+void metricsAppend(const char* format, ...) {
+  if (metricsLength >= METRICS_BUFFER_SIZE - 1) return;
+
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(metricsBuffer + metricsLength, METRICS_BUFFER_SIZE - metricsLength, format, args);
+  va_end(args);
+
+  if (written > 0) metricsLength = min(metricsLength + written, METRICS_BUFFER_SIZE - 1);
+}
+
+void metricsHeader(const char* name, const char* type, const char* help) {
+  metricsAppend("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// Render the whole exposition into metricsBuffer, after the HTTP header
+void metricsRender() {
+  metricsLength = 0;
+
+  // Header with a fixed-width length, patched in at the end
+  metricsAppend("HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\nContent-Length: %06d\r\n\r\n", 0);
+  int bodyStart = metricsLength;
+
+  metricsHeader("clock_uptime_seconds", "gauge", "Seconds since boot");
+  metricsAppend("clock_uptime_seconds %lu\n", millis() / 1000);
+
+  metricsHeader("clock_loop_iterations_total", "counter", "Main loop passes");
+  metricsAppend("clock_loop_iterations_total %lu\n", metricsLoops);
+
+  metricsHeader("clock_mode", "gauge", "Current clock mode");
+  metricsAppend("clock_mode{mode=\"%s\"} 1\n", currentMode >= 0 && currentMode < MODE_TOTAL ? metricsModeNames[currentMode] : "unknown");
+
+  metricsHeader("clock_frame_seconds", "histogram", "Duration of loop passes that drew something, per mode");
+  for (int mode = 0; mode < MODE_TOTAL; mode++) {
+    const FrameHistogram& histogram = metricsFrames[mode];
+    if (histogram.count == 0) continue;
+
+    unsigned long cumulative = 0;
+    for (int b = 0; b < METRICS_FRAME_BUCKETS; b++) {
+      cumulative += histogram.buckets[b];
+      metricsAppend("clock_frame_seconds_bucket{mode=\"%s\",le=\"%.3f\"} %lu\n", metricsModeNames[mode],
+                    metricsFrameBounds[b] / 1000.0, cumulative);
+    }
+    metricsAppend("clock_frame_seconds_bucket{mode=\"%s\",le=\"+Inf\"} %lu\n", metricsModeNames[mode], histogram.count);
+    metricsAppend("clock_frame_seconds_sum{mode=\"%s\"} %.6f\n", metricsModeNames[mode], histogram.sumMicros / 1e6);
+    metricsAppend("clock_frame_seconds_count{mode=\"%s\"} %lu\n", metricsModeNames[mode], histogram.count);
+  }
+
+  metricsHeader("clock_heap_free_bytes", "gauge", "Free internal heap");
+  metricsAppend("clock_heap_free_bytes %u\n", (unsigned int)heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  metricsHeader("clock_heap_largest_block_bytes", "gauge", "Largest free internal heap block");
+  metricsAppend("clock_heap_largest_block_bytes %u\n", (unsigned int)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  metricsHeader("clock_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+  metricsAppend("clock_heap_min_free_bytes %u\n", (unsigned int)ESP.getMinFreeHeap());
+
+  metricsHeader("clock_weather_fetches_total", "counter", "OpenWeatherMap requests");
+  metricsAppend("clock_weather_fetches_total %lu\n", metricsWeatherFetches);
+  metricsHeader("clock_weather_fetch_errors_total", "counter", "Failed OpenWeatherMap requests");
+  metricsAppend("clock_weather_fetch_errors_total %lu\n", metricsWeatherErrors);
+  metricsHeader("clock_weather_fetch_seconds", "summary", "OpenWeatherMap request latency");
+  metricsAppend("clock_weather_fetch_seconds_sum %.3f\n", metricsWeatherMillisSum / 1000.0);
+  metricsAppend("clock_weather_fetch_seconds_count %lu\n", metricsWeatherFetches);
+  metricsHeader("clock_weather_fetch_last_seconds", "gauge", "Latency of the last OpenWeatherMap request");
+  metricsAppend("clock_weather_fetch_last_seconds %.3f\n", metricsWeatherLastMillis / 1000.0);
+
+  metricsHeader("clock_ntp_syncs_total", "counter", "SNTP time updates");
+  metricsAppend("clock_ntp_syncs_total %lu\n", metricsNtpSyncs);
+  if (metricsNtpSyncs > 1) {
+    metricsHeader("clock_ntp_offset_seconds", "gauge", "Correction applied by the last SNTP update (NTP minus local)");
+    metricsAppend("clock_ntp_offset_seconds %.6f\n", metricsNtpOffsetMicros / 1e6);
+    metricsHeader("clock_ntp_drift_ppm", "gauge", "Local clock drift between the last two SNTP updates");
+    metricsAppend("clock_ntp_drift_ppm %.2f\n", metricsNtpDriftPpm);
+  }
+  if (metricsNtpSyncs > 0) {
+    metricsHeader("clock_ntp_last_sync_age_seconds", "gauge", "Seconds since the last SNTP update");
+    metricsAppend("clock_ntp_last_sync_age_seconds %lld\n", (long long)((esp_timer_get_time() - metricsNtpLastSyncTimer) / 1000000LL));
+  }
+
+  metricsHeader("clock_storage_writes_total", "counter", "Foreground file system writes");
+  metricsAppend("clock_storage_writes_total %lu\n", storageWriteCount);
+
+  metricsHeader("clock_button_events_total", "counter", "Accepted button presses");
+  for (int i = 0; i < METRICS_BUTTONS; i++) {
+    metricsAppend("clock_button_events_total{button=\"%s\"} %lu\n", metricsButtonNames[i], metricsButtonEvents[i]);
+  }
+
+  metricsHeader("clock_led_shows_total", "counter", "LED ring updates sent");
+  metricsAppend("clock_led_shows_total %lu\n", metricsLedShows);
+
+  metricsHeader("clock_wifi_rssi_dbm", "gauge", "WiFi signal strength");
+  metricsAppend("clock_wifi_rssi_dbm %d\n", (int)WiFi.RSSI());
+
+  metricsHeader("clock_metrics_scrapes_total", "counter", "Requests served by this endpoint");
+  metricsAppend("clock_metrics_scrapes_total %lu\n", metricsScrapes);
+
+  // Patch the real body length into the header
+  char length[8];
+  snprintf(length, sizeof(length), "%06d", metricsLength - bodyStart);
+  memcpy(metricsBuffer + bodyStart - 10, length, 6);
+}
+
+void metricsRenderNotFound() {
+  metricsLength = 0;
+  metricsAppend("HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nConnection: close\r\nContent-Length: 10\r\n\r\nnot found\n");
+}
+
+void metricsCloseClient() {
+  metricsClient.stop();
+  metricsHttpState = METRICS_IDLE;
+}
+
+// Accept, read and answer scrapes a step at a time - call once per loop
+void metricsService() {
+#if METRICS_PORT > 0
+  if (metricsHttpState == METRICS_IDLE) {
+    metricsClient = metricsServer.available();
+    if (!metricsClient) return;
+
+    metricsHttpState = METRICS_READING;
+    metricsRequestStart = millis();
+    metricsRequestLength = 0;
+  }
+
+  if (millis() - metricsRequestStart > METRICS_TIMEOUT || !metricsClient.connected()) {
+    metricsCloseClient();
+    return;
+  }
+
+  if (metricsHttpState == METRICS_READING) {
+    while (metricsClient.available() > 0 && metricsRequestLength < METRICS_REQUEST_SIZE - 1) {
+      metricsRequest[metricsRequestLength++] = metricsClient.read();
+    }
+    metricsRequest[metricsRequestLength] = '\0';
+
+    // Only the request line matters; wait for the end of the headers
+    if (strstr(metricsRequest, "\r\n\r\n") == NULL && metricsRequestLength < METRICS_REQUEST_SIZE - 1) return;
+
+    if (strncmp(metricsRequest, "GET /metrics ", 13) == 0 || strncmp(metricsRequest, "GET / ", 6) == 0) {
+      metricsScrapes++;
+      metricsRender();
+    } else {
+      metricsRenderNotFound();
+    }
+    metricsSent = 0;
+    metricsHttpState = METRICS_WRITING;
+  }
+
+  if (metricsHttpState == METRICS_WRITING) {
+    int chunk = min(METRICS_WRITE_CHUNK, metricsLength - metricsSent);
+    if (chunk > 0) {
+      metricsSent += metricsClient.write((const uint8_t*)metricsBuffer + metricsSent, chunk);
+    }
+    if (metricsSent >= metricsLength) metricsCloseClient();
+  }
+#endif
+}
+
+#endif  // METRICS_H
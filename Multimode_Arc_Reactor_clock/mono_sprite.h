@@ -0,0 +1,170 @@
+/*
+ * mono_sprite.h - Packed monochrome sprite animations (.spr)
+ * For Multi-Mode Digital Clock project
+ * Single-color artwork like the Pip-Boy Vault Boy does not need a GIF:
+ * every frame is stored fully composed at 1 or 2 bits per pixel, and
+ * drawing is a table lookup from those bits to shades of one color. A
+ * frame of the 51x95 figure is 1.2 KB at 2 bpp and there is no decoder
+ * state. Built from a GIF by tools/gif_to_sprite.py.
+ */
+
+#ifndef MONO_SPRITE_H
+#define MONO_SPRITE_H
+
+#include <Arduino.h>
+#include "frame_buffer.h"
+#include "ambient_color.h"
+#include "asset_partition.h"
+#include "asset_reader.h"
+#include "mem_alloc.h"
+#include "log_buffer.h"
+
+#define SPRITE_MAGIC 0x31525053  // "SPR1"
+#define SPRITE_MAX_WIDTH 240
+
+// Pixels expanded and pushed at a time (whole rows, on the stack)
+#define SPRITE_BAND_PIXELS 1024
+
+// File header, little endian (must match tools/gif_to_sprite.py).
+// A u16 delay in ms per frame follows, then the frames, each row padded
+// to a whole byte, most significant bits first.
+struct __attribute__((packed)) SpriteHeader {
+  uint32_t magic;
+  uint16_t width;
+  uint16_t height;
+  uint8_t bpp;  // 1 or 2
+  uint8_t frameCount;
+  uint16_t reserved;
+};
+
+// A loaded animation
+struct MonoSprite {
+  const uint8_t* data;  // Whole file
+  bool mapped;          // Points into the asset partition
+  const SpriteHeader* header;
+  const uint8_t* delays;
+  const uint8_t* frames;
+  uint32_t rowBytes;
+  uint32_t frameBytes;
+  uint16_t shades[4];   // Byte-swapped panel colors per pixel value
+  int frame;            // Frame drawn last
+};
+
+// Function prototypes
+bool spriteLoad(MonoSprite& sprite, const char* path, uint16_t color);
+void spriteRelease(MonoSprite& sprite);
+void spriteDrawFrame(MonoSprite& sprite, int frame, int x, int y, int skipRows);
+int spriteFrameDelay(const MonoSprite& sprite, int frame);
+
+// Black to full color in even steps, byte-swapped for pushing
+void spriteSetColor(MonoSprite& sprite, uint16_t color) {
+  int levels = (1 << sprite.header->bpp) - 1;
+  int r = (color >> 11) & 0x1F, g = (color >> 5) & 0x3F, b = color & 0x1F;
+
+  for (int i = 0; i <= levels; i++) {
+    uint16_t shade = ((r * i / levels) << 11) | ((g * i / levels) << 5) | (b * i / levels);
+    sprite.shades[i] = (shade >> 8) | (shade << 8);
+  }
+}
+
+// Load a .spr file (mapped in place when it is a packed asset)
+bool spriteLoad(MonoSprite& sprite, const char* path, uint16_t color) {
+  memset(&sprite, 0, sizeof(sprite));
+  sprite.frame = -1;
+
+  uint32_t size = 0;
+  const uint8_t* data = assetFind(path, &size);
+  sprite.mapped = (data != NULL);
+
+  if (data == NULL) {
+    int id = assetResolve(path);
+    if (id < 0 || assetFileSize(id) < (int32_t)sizeof(SpriteHeader)) return false;
+
+    size = assetFileSize(id);
+    uint8_t* buffer = (uint8_t*)memAlloc(size, MEM_FAST);
+    if (buffer == NULL) return false;
+
+    if (!assetReadAll(id, buffer)) {
+      memFree(buffer, MEM_FAST);
+      return false;
+    }
+    data = buffer;
+  }
+  sprite.data = data;
+
+  const SpriteHeader* header = (const SpriteHeader*)data;
+  sprite.header = header;
+  if (size < sizeof(SpriteHeader) || header->magic != SPRITE_MAGIC || (header->bpp != 1 && header->bpp != 2) ||
+      header->frameCount == 0 || header->width == 0 || header->width > SPRITE_MAX_WIDTH) {
+    LOG_WARN("Not a sprite file: %s", path);
+    spriteRelease(sprite);
+    return false;
+  }
+
+  sprite.rowBytes = (header->width * header->bpp + 7) / 8;
+  sprite.frameBytes = sprite.rowBytes * header->height;
+  sprite.delays = data + sizeof(SpriteHeader);
+  sprite.frames = sprite.delays + header->frameCount * 2;
+
+  if (sizeof(SpriteHeader) + header->frameCount * (2 + sprite.frameBytes) > size) {
+    LOG_WARN("Sprite file is truncated: %s", path);
+    spriteRelease(sprite);
+    return false;
+  }
+
+  spriteSetColor(sprite, color);
+  LOG_INFO("Sprite %s: %dx%d, %d frames at %d bpp, %u bytes", path, header->width, header->height,
+           header->frameCount, header->bpp, (unsigned int)size);
+  return true;
+}
+
+void spriteRelease(MonoSprite& sprite) {
+  if (sprite.data != NULL && !sprite.mapped) {
+    memFree((void*)sprite.data, MEM_FAST);
+  }
+  sprite.data = NULL;
+  sprite.header = NULL;
+}
+
+int spriteFrameDelay(const MonoSprite& sprite, int frame) {
+  return sprite.delays[frame * 2] | (sprite.delays[frame * 2 + 1] << 8);
+}
+
+// Expand one frame into panel pixels, a band of rows at a time. The first
+// skipRows rows are left out and the rest drawn from (x, y).
+void spriteDrawFrame(MonoSprite& sprite, int frame, int x, int y, int skipRows) {
+  if (sprite.data == NULL) return;
+
+  const SpriteHeader& header = *sprite.header;
+  const uint8_t* pixels = sprite.frames + frame * sprite.frameBytes;
+  uint16_t band[SPRITE_BAND_PIXELS];
+  int width = header.width;
+  int bandRows = SPRITE_BAND_PIXELS / width;
+
+  for (int row = skipRows; row < header.height; row += bandRows) {
+    int rows = min(bandRows, header.height - row);
+
+    for (int r = 0; r < rows; r++) {
+      const uint8_t* src = pixels + (row + r) * sprite.rowBytes;
+      uint16_t* dst = band + r * width;
+
+      if (header.bpp == 2) {
+        for (int col = 0; col < width; col++) {
+          dst[col] = sprite.shades[(src[col >> 2] >> (6 - ((col & 3) << 1))) & 0x03];
+        }
+      } else {
+        for (int col = 0; col < width; col++) {
+          dst[col] = sprite.shades[(src[col >> 3] >> (7 - (col & 7))) & 0x01];
+        }
+      }
+    }
+
+    int top = y + row - skipRows;
+    framePushImage(x, top, width, rows, band);
+    ambientSampleBlock(x, top, width, rows, band);
+  }
+
+  sprite.frame = frame;
+}
+
+#endif  // MONO_SPRITE_H
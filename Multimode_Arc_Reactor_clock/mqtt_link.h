@@ -0,0 +1,491 @@
+/*
+ * mqtt_link.h - Optional MQTT link for weather, commands and telemetry
+ * For Multi-Mode Digital Clock project
+ * Instead of every clock polling OpenWeatherMap, one aggregator on the
+ * local network (tools/weather_aggregator.py) publishes the weather as a
+ * retained 36-byte message and clocks subscribe to it: new data arrives by
+ * push, and a freshly connected clock gets the last report at once. The
+ * same link takes commands (mode, theme, color, brightness) and publishes
+ * a short telemetry line.
+ *
+ * Only the MQTT 3.1.1 subset needed here is implemented: QoS 0, clean
+ * session, fixed buffers and a non-blocking receive state machine. The
+ * TCP connect is polled too (net_connect.h), so a broker that is down
+ * never stalls loop().
+ *
+ * Topics (MQTT_TOPIC_PREFIX "clock", id = last 6 hex digits of the MAC):
+ *   clock/weather       retained WeatherPacket from the aggregator
+ *   clock/all/cmd       command for every clock
+ *   clock/<id>/cmd      command for this clock
+ *   clock/<id>/state    retained "mode,bg,led,brightness,heap,rssi,uptime"
+ *   clock/<id>/online   retained "1", "0" as the will when the link drops
+ * Commands are text: "mode 2", "theme next", "theme 4", "color 3",
+ * "brightness 80".
+ */
+
+#ifndef MQTT_LINK_H
+#define MQTT_LINK_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+#include "weather_data.h"
+#include "log_buffer.h"
+#include "net_connect.h"
+
+#ifndef MQTT_BROKER
+#define MQTT_BROKER ""
+#define MQTT_PORT 1883
+#define MQTT_USER ""
+#define MQTT_PASSWORD ""
+#define MQTT_TOPIC_PREFIX "clock"
+#endif
+
+// Enabled when a broker is configured
+#define MQTT_ENABLED (sizeof(MQTT_BROKER) > 1)
+
+#define MQTT_KEEPALIVE 60                 // Seconds
+#define MQTT_CONNECT_TIMEOUT 5000         // ms for name lookup and TCP connect (polled)
+#define MQTT_CONNACK_TIMEOUT 3000
+#define MQTT_RETRY_MIN 5000               // Reconnect backoff, doubling
+#define MQTT_RETRY_MAX 300000
+#define MQTT_TELEMETRY_INTERVAL 60000
+#define MQTT_WEATHER_MAX_AGE 1800000UL    // Fall back to polling without a push for 30 minutes
+#define MQTT_BUFFER_SIZE 256
+#define MQTT_TOPIC_LENGTH 48
+
+// Packet types (upper nibble of the fixed header)
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH 0x30
+#define MQTT_SUBSCRIBE 0x82  // With the required flags
+#define MQTT_SUBACK 0x90
+#define MQTT_PINGREQ 0xC0
+#define MQTT_PINGRESP 0xD0
+#define MQTT_DISCONNECT 0xE0
+
+// Link states
+#define MQTT_STATE_IDLE 0
+#define MQTT_STATE_CONNECTING 1
+#define MQTT_STATE_WAIT_CONNACK 2
+#define MQTT_STATE_CONNECTED 3
+
+// Commands handed to the sketch
+#define MQTT_CMD_NONE 0
+#define MQTT_CMD_MODE 1
+#define MQTT_CMD_THEME 2        // value -1 = next background
+#define MQTT_CMD_COLOR 3
+#define MQTT_CMD_BRIGHTNESS 4
+
+// Weather message, little endian (must match tools/weather_aggregator.py)
+#define MQTT_WEATHER_VERSION 1
+struct __attribute__((packed)) WeatherPacket {
+  uint8_t version;
+  int8_t temperature;
+  int8_t feelsLike;
+  int8_t tempMin;
+  int8_t tempMax;
+  uint8_t humidity;
+  uint8_t windSpeed;
+  uint8_t reserved;
+  char iconCode[4];
+  char description[24];
+};
+
+// CONNECT carries the client name, will topic and credentials
+static_assert(sizeof(MQTT_USER) + sizeof(MQTT_PASSWORD) + 2 * MQTT_TOPIC_LENGTH + 32 <= MQTT_BUFFER_SIZE - 5,
+              "MQTT_USER and MQTT_PASSWORD do not fit in MQTT_BUFFER_SIZE");
+
+struct MqttCommand {
+  int type;  // MQTT_CMD_xxx
+  int value;
+};
+
+WiFiClient mqttClient;
+NetConnect mqttConnecting = NET_CONNECT_INIT;
+int mqttState = MQTT_STATE_IDLE;
+char mqttClientId[16] = "";
+uint8_t mqttBuffer[MQTT_BUFFER_SIZE];
+
+unsigned long mqttRetryAt = 0;
+unsigned long mqttRetryDelay = MQTT_RETRY_MIN;
+unsigned long mqttStateSince = 0;
+unsigned long mqttLastSent = 0;
+unsigned long mqttLastReceived = 0;
+unsigned long mqttLastTelemetry = 0;
+
+// Receive state machine
+int mqttRxStep = 0;          // 0 header, 1 length, 2 body
+uint8_t mqttRxHeader = 0;
+uint32_t mqttRxLength = 0;
+uint32_t mqttRxShift = 0;
+uint32_t mqttRxPos = 0;
+uint8_t mqttRxBody[MQTT_BUFFER_SIZE];
+
+// Received data waiting for the sketch
+WeatherPacket mqttWeather;
+bool mqttWeatherPending = false;
+unsigned long mqttWeatherTime = 0;
+bool mqttWeatherReceived = false;
+MqttCommand mqttPendingCommand = {MQTT_CMD_NONE, 0};
+
+// Statistics
+unsigned long mqttConnects = 0;
+unsigned long mqttMessages = 0;
+
+// Function prototypes
+void mqttService();
+bool mqttTakeWeather(WeatherData& weather);
+bool mqttWeatherFresh();
+bool mqttTakeCommand(MqttCommand& command);
+bool mqttTelemetryDue();
+void mqttPublishTelemetry(const char* line);
+
+// Variable-length remaining length, returns its size
+int mqttEncodeLength(uint8_t* out, uint32_t length) {
+  int count = 0;
+  do {
+    uint8_t digit = length % 128;
+    length /= 128;
+    if (length > 0) digit |= 0x80;
+    out[count++] = digit;
+  } while (length > 0);
+  return count;
+}
+
+// Append a length-prefixed string
+int mqttPutString(uint8_t* out, const char* text) {
+  int length = strlen(text);
+  out[0] = length >> 8;
+  out[1] = length & 0xFF;
+  memcpy(out + 2, text, length);
+  return length + 2;
+}
+
+// Send a packet whose body is already in mqttBuffer + 5
+bool mqttSend(uint8_t header, int bodyLength) {
+  uint8_t prefix[5];
+  prefix[0] = header;
+  int lengthBytes = mqttEncodeLength(prefix + 1, bodyLength);
+
+  // Move the fixed header right in front of the body and send it in one write
+  uint8_t* start = mqttBuffer + 5 - (1 + lengthBytes);
+  memcpy(start, prefix, 1 + lengthBytes);
+  int total = 1 + lengthBytes + bodyLength;
+
+  if (mqttClient.write(start, total) != (size_t)total) return false;
+  mqttLastSent = millis();
+  return true;
+}
+
+void mqttTopic(char* topic, const char* suffix) {
+  snprintf(topic, MQTT_TOPIC_LENGTH, "%s/%s/%s", MQTT_TOPIC_PREFIX, mqttClientId, suffix);
+}
+
+bool mqttPublish(const char* topic, const uint8_t* payload, int length, bool retain) {
+  if (mqttState != MQTT_STATE_CONNECTED) return false;
+
+  uint8_t* body = mqttBuffer + 5;
+  int size = mqttPutString(body, topic);
+  if (size + length > MQTT_BUFFER_SIZE - 5) return false;
+  memcpy(body + size, payload, length);
+
+  return mqttSend(MQTT_PUBLISH | (retain ? 0x01 : 0x00), size + length);
+}
+
+void mqttDisconnect(const char* reason) {
+  if (mqttState >= MQTT_STATE_WAIT_CONNACK) {
+    LOG_WARN("MQTT: link closed (%s)", reason);
+  }
+  netConnectCancel(mqttConnecting);
+  mqttClient.stop();
+  mqttState = MQTT_STATE_IDLE;
+  mqttRxStep = 0;
+  mqttRetryAt = millis() + mqttRetryDelay;
+  mqttRetryDelay = min(mqttRetryDelay * 2, (unsigned long)MQTT_RETRY_MAX);
+}
+
+// Start the TCP connection; mqttService() polls it
+void mqttConnect() {
+  if (mqttClientId[0] == '\0') {
+    String mac = WiFi.macAddress();
+    mac.replace(":", "");
+    snprintf(mqttClientId, sizeof(mqttClientId), "%s", mac.substring(6).c_str());
+    mqttClientId[sizeof(mqttClientId) - 1] = '\0';
+  }
+
+  mqttClient.stop();
+  netConnectStart(mqttConnecting, MQTT_BROKER, MQTT_PORT);
+  mqttState = MQTT_STATE_CONNECTING;
+  mqttStateSince = millis();
+}
+
+// TCP is up - send CONNECT with a retained "0" will
+void mqttSendConnect() {
+  mqttClient.setNoDelay(true);
+
+  char willTopic[MQTT_TOPIC_LENGTH];
+  mqttTopic(willTopic, "online");
+  char clientName[24];
+  snprintf(clientName, sizeof(clientName), "clock-%s", mqttClientId);
+
+  uint8_t* body = mqttBuffer + 5;
+  int size = mqttPutString(body, "MQTT");
+  uint8_t flags = 0x02 | 0x04 | 0x20;  // Clean session, will, will retain
+  if (strlen(MQTT_USER) > 0) flags |= 0x80 | (strlen(MQTT_PASSWORD) > 0 ? 0x40 : 0x00);
+  body[size++] = 4;  // Protocol level 3.1.1
+  body[size++] = flags;
+  body[size++] = MQTT_KEEPALIVE >> 8;
+  body[size++] = MQTT_KEEPALIVE & 0xFF;
+  size += mqttPutString(body + size, clientName);
+  size += mqttPutString(body + size, willTopic);
+  size += mqttPutString(body + size, "0");
+  if (flags & 0x80) size += mqttPutString(body + size, MQTT_USER);
+  if (flags & 0x40) size += mqttPutString(body + size, MQTT_PASSWORD);
+
+  if (!mqttSend(MQTT_CONNECT, size)) {
+    mqttDisconnect("connect failed");
+    return;
+  }
+
+  mqttState = MQTT_STATE_WAIT_CONNACK;
+  mqttStateSince = millis();
+}
+
+// Connection accepted - subscribe and announce
+void mqttOnConnected() {
+  mqttState = MQTT_STATE_CONNECTED;
+  mqttRetryDelay = MQTT_RETRY_MIN;
+  mqttConnects++;
+  LOG_INFO("MQTT: connected as clock-%s", mqttClientId);
+
+  char topic[MQTT_TOPIC_LENGTH];
+  uint8_t* body = mqttBuffer + 5;
+  int size = 0;
+  body[size++] = 0;
+  body[size++] = 1;  // Packet id
+
+  snprintf(topic, sizeof(topic), "%s/weather", MQTT_TOPIC_PREFIX);
+  size += mqttPutString(body + size, topic);
+  body[size++] = 0;  // QoS 0
+  snprintf(topic, sizeof(topic), "%s/all/cmd", MQTT_TOPIC_PREFIX);
+  size += mqttPutString(body + size, topic);
+  body[size++] = 0;
+  mqttTopic(topic, "cmd");
+  size += mqttPutString(body + size, topic);
+  body[size++] = 0;
+  mqttSend(MQTT_SUBSCRIBE, size);
+
+  mqttTopic(topic, "online");
+  mqttPublish(topic, (const uint8_t*)"1", 1, true);
+  mqttLastTelemetry = 0;  // Publish state right away
+}
+
+// Parse "mode 2", "theme next", ...
+void mqttParseCommand(const uint8_t* payload, int length) {
+  char text[24];
+  length = min(length, (int)sizeof(text) - 1);
+  memcpy(text, payload, length);
+  text[length] = '\0';
+
+  char* space = strchr(text, ' ');
+  if (space == NULL) return;
+  *space = '\0';
+  const char* arg = space + 1;
+
+  MqttCommand command = {MQTT_CMD_NONE, atoi(arg)};
+  if (strcmp(text, "mode") == 0) {
+    command.type = MQTT_CMD_MODE;
+  } else if (strcmp(text, "theme") == 0) {
+    command.type = MQTT_CMD_THEME;
+    if (strcmp(arg, "next") == 0) command.value = -1;
+  } else if (strcmp(text, "color") == 0) {
+    command.type = MQTT_CMD_COLOR;
+  } else if (strcmp(text, "brightness") == 0) {
+    command.type = MQTT_CMD_BRIGHTNESS;
+  }
+
+  if (command.type == MQTT_CMD_NONE) {
+    LOG_WARN("MQTT: unknown command %s", text);
+    return;
+  }
+  mqttPendingCommand = command;
+}
+
+// A complete packet is in mqttRxBody
+void mqttHandlePacket() {
+  mqttLastReceived = millis();
+  uint8_t type = mqttRxHeader & 0xF0;
+
+  if (type == MQTT_CONNACK) {
+    if (mqttRxLength >= 2 && mqttRxBody[1] == 0) {
+      mqttOnConnected();
+    } else {
+      mqttDisconnect("connection refused");
+    }
+    return;
+  }
+
+  if (type != MQTT_PUBLISH || mqttRxPos < 2) return;
+
+  int topicLength = (mqttRxBody[0] << 8) | mqttRxBody[1];
+  int offset = 2 + topicLength;
+  if ((mqttRxHeader & 0x06) != 0) offset += 2;  // Packet id (QoS > 0)
+  if (offset > (int)mqttRxPos) return;
+
+  char topic[MQTT_TOPIC_LENGTH];
+  int copy = min(topicLength, MQTT_TOPIC_LENGTH - 1);
+  memcpy(topic, mqttRxBody + 2, copy);
+  topic[copy] = '\0';
+
+  const uint8_t* payload = mqttRxBody + offset;
+  int length = mqttRxPos - offset;
+  mqttMessages++;
+
+  const char* leaf = strrchr(topic, '/');
+  if (leaf != NULL && strcmp(leaf, "/weather") == 0) {
+    if (length == sizeof(WeatherPacket) && payload[0] == MQTT_WEATHER_VERSION) {
+      memcpy(&mqttWeather, payload, sizeof(mqttWeather));
+      mqttWeatherPending = true;
+      mqttWeatherReceived = true;
+      mqttWeatherTime = millis();
+      LOG_DEBUG("MQTT: weather %d, %s", mqttWeather.temperature, mqttWeather.iconCode);
+    } else {
+      LOG_WARN("MQTT: weather message of %d bytes ignored", length);
+    }
+  } else if (leaf != NULL && strcmp(leaf, "/cmd") == 0) {
+    mqttParseCommand(payload, length);
+  }
+}
+
+// Feed received bytes through the packet state machine
+void mqttReceive() {
+  while (mqttClient.available() > 0) {
+    uint8_t b = mqttClient.read();
+
+    if (mqttRxStep == 0) {
+      mqttRxHeader = b;
+      mqttRxLength = 0;
+      mqttRxShift = 0;
+      mqttRxPos = 0;
+      mqttRxStep = 1;
+    } else if (mqttRxStep == 1) {
+      mqttRxLength |= (uint32_t)(b & 0x7F) << mqttRxShift;
+      mqttRxShift += 7;
+      if (!(b & 0x80)) {
+        mqttRxStep = 2;
+        if (mqttRxLength == 0) {
+          mqttHandlePacket();
+          mqttRxStep = 0;
+        }
+      } else if (mqttRxShift > 21) {
+        mqttDisconnect("bad packet");
+        return;
+      }
+    } else {
+      // Oversized packets are read and dropped
+      if (mqttRxPos < MQTT_BUFFER_SIZE) mqttRxBody[mqttRxPos] = b;
+      mqttRxPos++;
+      if (mqttRxPos == mqttRxLength) {
+        if (mqttRxLength <= MQTT_BUFFER_SIZE) mqttHandlePacket();
+        mqttRxStep = 0;
+      }
+    }
+  }
+}
+
+// Keep the link up and process traffic - call once per loop
+void mqttService() {
+  if (!MQTT_ENABLED) return;
+
+  unsigned long now = millis();
+  if (WiFi.status() != WL_CONNECTED) {
+    if (mqttState != MQTT_STATE_IDLE) mqttDisconnect("WiFi down");
+    return;
+  }
+
+  if (mqttState == MQTT_STATE_IDLE) {
+    if ((long)(now - mqttRetryAt) >= 0) mqttConnect();
+    return;
+  }
+
+  if (mqttState == MQTT_STATE_CONNECTING) {
+    int result = netConnectPoll(mqttConnecting, mqttClient, MQTT_CONNECT_TIMEOUT);
+    if (result == NET_CONNECTED) {
+      mqttSendConnect();
+    } else if (result == NET_FAILED) {
+      LOG_WARN("MQTT: broker %s unreachable", MQTT_BROKER);
+      mqttDisconnect("unreachable");
+    }
+    return;
+  }
+
+  if (!mqttClient.connected()) {
+    mqttDisconnect("closed by broker");
+    return;
+  }
+
+  mqttReceive();
+  if (mqttState == MQTT_STATE_IDLE) return;
+
+  if (mqttState == MQTT_STATE_WAIT_CONNACK) {
+    if (now - mqttStateSince > MQTT_CONNACK_TIMEOUT) mqttDisconnect("no CONNACK");
+    return;
+  }
+
+  // Keepalive: ping when quiet, give up when the broker went silent
+  if (now - mqttLastReceived > MQTT_KEEPALIVE * 1500UL) {
+    mqttDisconnect("keepalive timeout");
+    return;
+  }
+  if (now - mqttLastSent > MQTT_KEEPALIVE * 500UL) {
+    mqttSend(MQTT_PINGREQ, 0);
+  }
+}
+
+// New weather from the aggregator, if any arrived since the last call
+bool mqttTakeWeather(WeatherData& weather) {
+  if (!mqttWeatherPending) return false;
+  mqttWeatherPending = false;
+
+  weather.temperature = mqttWeather.temperature;
+  weather.feelsLike = mqttWeather.feelsLike;
+  weather.tempMin = mqttWeather.tempMin;
+  weather.tempMax = mqttWeather.tempMax;
+  weather.humidity = mqttWeather.humidity;
+  weather.windSpeed = mqttWeather.windSpeed;
+  strncpy(weather.iconCode, mqttWeather.iconCode, sizeof(weather.iconCode) - 1);
+  weather.iconCode[sizeof(weather.iconCode) - 1] = '\0';
+  strncpy(weather.description, mqttWeather.description, sizeof(weather.description) - 1);
+  weather.description[sizeof(weather.description) - 1] = '\0';
+  weather.lastUpdate = mqttWeatherTime;
+  weather.valid = true;
+  return true;
+}
+
+// Pushed weather is recent enough to skip polling
+bool mqttWeatherFresh() {
+  return mqttWeatherReceived && (millis() - mqttWeatherTime < MQTT_WEATHER_MAX_AGE);
+}
+
+bool mqttTakeCommand(MqttCommand& command) {
+  if (mqttPendingCommand.type == MQTT_CMD_NONE) return false;
+  command = mqttPendingCommand;
+  mqttPendingCommand.type = MQTT_CMD_NONE;
+  return true;
+}
+
+// Whether the sketch should build and publish its state line now
+bool mqttTelemetryDue() {
+  if (mqttState != MQTT_STATE_CONNECTED) return false;
+  return mqttLastTelemetry == 0 || millis() - mqttLastTelemetry >= MQTT_TELEMETRY_INTERVAL;
+}
+
+void mqttPublishTelemetry(const char* line) {
+  char topic[MQTT_TOPIC_LENGTH];
+  mqttTopic(topic, "state");
+  mqttPublish(topic, (const uint8_t*)line, strlen(line), true);
+  mqttLastTelemetry = millis();
+}
+
+#endif  // MQTT_LINK_H
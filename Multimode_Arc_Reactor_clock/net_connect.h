@@ -0,0 +1,148 @@
+/*
+ * net_connect.h - Non-blocking TCP connect
+ * For Multi-Mode Digital Clock project
+ * WiFiClient::connect() looks up the host name and waits for the TCP
+ * handshake inside the call, stopping loop() for up to its timeout on
+ * every retry while a broker or server is down. Here the lookup and the
+ * connect are started once and then polled from loop(); the finished
+ * socket is handed to a WiFiClient, which the caller uses as before.
+ */
+
+#ifndef NET_CONNECT_H
+#define NET_CONNECT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <lwip/dns.h>
+
+// Connect steps
+#define NET_CONNECT_IDLE 0
+#define NET_CONNECT_RESOLVING 1
+#define NET_CONNECT_OPENING 2
+
+// netConnectPoll() results
+#define NET_PENDING 0
+#define NET_CONNECTED 1
+#define NET_FAILED -1
+
+struct NetConnect {
+  int step;                // NET_CONNECT_xxx
+  int fd;
+  uint16_t port;
+  unsigned long started;
+  uint32_t address;        // IPv4, network byte order
+  volatile int lookup;     // 0 waiting, 1 found, -1 failed (set by the lwIP task)
+};
+
+#define NET_CONNECT_INIT {NET_CONNECT_IDLE, -1, 0, 0, 0, 0}
+
+// Function prototypes
+void netConnectStart(NetConnect& conn, const char* host, uint16_t port);
+int netConnectPoll(NetConnect& conn, WiFiClient& client, unsigned long timeoutMs);
+void netConnectCancel(NetConnect& conn);
+bool netConnectBusy(const NetConnect& conn);
+
+// DNS answer, called from the lwIP task
+void netConnectFound(const char* name, const ip_addr_t* ipaddr, void* arg) {
+  NetConnect* conn = (NetConnect*)arg;
+  if (ipaddr == NULL) {
+    conn->lookup = -1;
+    return;
+  }
+  conn->address = ip4_addr_get_u32(ip_2_ip4(ipaddr));
+  conn->lookup = 1;
+}
+
+void netConnectCancel(NetConnect& conn) {
+  if (conn.fd >= 0) close(conn.fd);
+  conn.fd = -1;
+  conn.step = NET_CONNECT_IDLE;
+}
+
+bool netConnectBusy(const NetConnect& conn) {
+  return conn.step != NET_CONNECT_IDLE;
+}
+
+// Begin the name lookup; literal addresses skip it
+void netConnectStart(NetConnect& conn, const char* host, uint16_t port) {
+  netConnectCancel(conn);
+  conn.port = port;
+  conn.started = millis();
+  conn.lookup = 0;
+  conn.step = NET_CONNECT_RESOLVING;
+
+  IPAddress literal;
+  if (literal.fromString(host)) {
+    conn.address = (uint32_t)literal;
+    conn.lookup = 1;
+    return;
+  }
+
+  ip_addr_t cached;
+  err_t err = dns_gethostbyname(host, &cached, netConnectFound, &conn);
+  if (err == ERR_OK) {
+    conn.address = ip4_addr_get_u32(ip_2_ip4(&cached));
+    conn.lookup = 1;
+  } else if (err != ERR_INPROGRESS) {
+    conn.lookup = -1;
+  }
+}
+
+// Open a non-blocking socket and start the handshake
+bool netConnectOpen(NetConnect& conn) {
+  conn.fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (conn.fd < 0) return false;
+  fcntl(conn.fd, F_SETFL, fcntl(conn.fd, F_GETFL, 0) | O_NONBLOCK);
+
+  struct sockaddr_in server;
+  memset(&server, 0, sizeof(server));
+  server.sin_family = AF_INET;
+  server.sin_addr.s_addr = conn.address;
+  server.sin_port = htons(conn.port);
+
+  if (connect(conn.fd, (struct sockaddr*)&server, sizeof(server)) < 0 && errno != EINPROGRESS) return false;
+  conn.step = NET_CONNECT_OPENING;
+  return true;
+}
+
+// Advance the connect without waiting; on NET_CONNECTED the socket is in client
+int netConnectPoll(NetConnect& conn, WiFiClient& client, unsigned long timeoutMs) {
+  if (conn.step == NET_CONNECT_IDLE) return NET_FAILED;
+  if (millis() - conn.started > timeoutMs) {
+    netConnectCancel(conn);
+    return NET_FAILED;
+  }
+
+  if (conn.step == NET_CONNECT_RESOLVING) {
+    if (conn.lookup == 0) return NET_PENDING;
+    if (conn.lookup < 0 || !netConnectOpen(conn)) {
+      netConnectCancel(conn);
+      return NET_FAILED;
+    }
+  }
+
+  // Writable once the handshake has finished, one way or the other
+  fd_set ready;
+  FD_ZERO(&ready);
+  FD_SET(conn.fd, &ready);
+  struct timeval noWait = {0, 0};
+  int result = select(conn.fd + 1, NULL, &ready, NULL, &noWait);
+  if (result == 0) return NET_PENDING;
+
+  int error = 0;
+  socklen_t length = sizeof(error);
+  if (result < 0 || getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+    netConnectCancel(conn);
+    return NET_FAILED;
+  }
+
+  // WiFiClient expects a blocking socket, as its own connect() leaves it
+  fcntl(conn.fd, F_SETFL, fcntl(conn.fd, F_GETFL, 0) & ~O_NONBLOCK);
+  client = WiFiClient(conn.fd);
+  conn.fd = -1;
+  conn.step = NET_CONNECT_IDLE;
+  return NET_CONNECTED;
+}
+
+#endif  // NET_CONNECT_H
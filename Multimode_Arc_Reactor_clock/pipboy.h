@@ -9,6 +9,15 @@
 #include <Arduino.h>
 #include <TFT_eSPI.h>
 #include "utils.h"
+#include "frame_buffer.h"
+#include "draw_queue.h"
+#include "frame_governor.h"
+#include "ambient_color.h"
+#include "mem_alloc.h"
+#include "asset_partition.h"
+#include "asset_reader.h"
+#include "theme_pack.h"
+#include "mono_sprite.h"
 #include <AnimatedGIF.h>
 #include <FS.h>
 
@@ -19,12 +28,100 @@ void updatePipBoyGif();
 void cleanupPipBoyMode();
 void GIFDraw(GIFDRAW *pDraw);
 bool loadAndInitGIF(const char *gifPath);
+void releasePipBoyGifBuffer();
+void resetPipBoyFields();
 
 // Global variables
 AnimatedGIF gif;
 const int figureX = 75;     // Position for Vault Boy figure
 uint8_t *gifBuffer = NULL;  // Buffer to hold GIF data
 int gifSize = 0;
+bool gifMapped = false;  // Buffer points into the asset partition
+unsigned long pipBoyNextFrame = 0;  // When the next GIF frame is due
+
+// Packed sprite version of the figure, used instead of the GIF when present
+#define VAULTBOY_SPRITE "/vaultboy.spr"
+MonoSprite vaultBoySprite;
+bool spriteLoaded = false;
+
+// Screen area owned by the figure animation - field clears never reach into it
+const int pipAnimX = figureX - 20;
+const int pipAnimY = 80;
+const int pipAnimW = 60;
+const int pipAnimH = 100;
+
+// One text field of the face and what was drawn there last
+struct PipBoyField {
+  int x;          // Left edge, or -1 to center on the screen
+  int y;
+  uint8_t size;
+  int32_t value;  // Value drawn last, -1 forces a redraw
+  int left;       // Extent of the text drawn last
+  int width;
+};
+
+// Time rows start at y 80, right of the figure
+PipBoyField pipDayField = {-1, 25, 2, -1, 0, 0};
+PipBoyField pipDateField = {-1, 50, 2, -1, 0, 0};
+PipBoyField pipHoursField = {120, 80, 5, -1, 0, 0};
+PipBoyField pipSecondsField = {195, 90, 2, -1, 0, 0};
+PipBoyField pipMinutesField = {120, 130, 5, -1, 0, 0};
+PipBoyField pipAmPmField = {195, 140, 2, -1, 0, 0};
+
+// Forget what the fields show so the next update draws all of them
+void resetPipBoyFields() {
+  PipBoyField* fields[] = {&pipDayField, &pipDateField, &pipHoursField, &pipSecondsField, &pipMinutesField, &pipAmPmField};
+  for (PipBoyField* field : fields) {
+    field->value = -1;
+    field->width = 0;
+  }
+}
+
+// Change key for a text field (non-negative, so it never matches -1)
+int32_t pipBoyTextKey(const char* text) {
+  uint32_t hash = FNV1A_OFFSET_BASIS;
+  while (*text) {
+    hash = (hash ^ (uint8_t)*text++) * FNV1A_PRIME;
+  }
+  return hash & 0x7FFFFFFF;
+}
+
+// Clear a rectangle, trimmed so it never overlaps the animation window
+void pipBoyClearRect(int x, int y, int w, int h) {
+  int right = x + w;
+  if (x < pipAnimX + pipAnimW && right > pipAnimX && y < pipAnimY + pipAnimH && y + h > pipAnimY) {
+    // Keep whichever side of the window is larger
+    if (right - (pipAnimX + pipAnimW) >= pipAnimX - x) {
+      x = pipAnimX + pipAnimW;
+    } else {
+      right = pipAnimX;
+    }
+  }
+  if (right > x) queueFillRect(x, y, right - x, h, PIP_BLACK);
+}
+
+// Draw a field if its value changed. The text is drawn opaque, so nothing
+// is erased underneath it; only what a wider previous text left outside
+// the new one is cleared.
+void pipBoyFieldDraw(PipBoyField& field, int32_t value, const char* text) {
+  if (value == field.value) return;
+
+  int width = textWidth(text, field.size);
+  int height = textHeight(field.size);
+  int left = field.x >= 0 ? field.x : screenCenterX - width / 2;
+
+  queueTextOpaque(left, field.y, text, field.size, PIP_GREEN, PIP_BLACK);
+
+  if (field.width > 0) {
+    int oldRight = field.left + field.width;
+    if (field.left < left) pipBoyClearRect(field.left, field.y, left - field.left, height);
+    if (oldRight > left + width) pipBoyClearRect(left + width, field.y, oldRight - (left + width), height);
+  }
+
+  field.value = value;
+  field.left = left;
+  field.width = width;
+}
 
 // GIF drawing callback for the AnimatedGIF library
 void GIFDraw(GIFDRAW *pDraw) {
@@ -33,8 +130,8 @@ void GIFDraw(GIFDRAW *pDraw) {
   int x, y, iWidth;
 
   iWidth = pDraw->iWidth;
-  if (iWidth > tft.width())
-    iWidth = tft.width();
+  if (iWidth > tft->width())
+    iWidth = tft->width();
 
   usPalette = pDraw->pPalette;
   y = pDraw->iY + pDraw->y;  // current line
@@ -56,7 +153,18 @@ void GIFDraw(GIFDRAW *pDraw) {
   d = usTemp;
 
   // Position the GIF
-  tft.pushImage(pDraw->iX + figureX - 20, (y - 5) + 80, iWidth, 1, d);
+  framePushImage(pDraw->iX + figureX - 20, (y - 5) + 80, iWidth, 1, d);
+  ambientSampleBlock(pDraw->iX + figureX - 20, (y - 5) + 80, iWidth, 1, d);
+}
+
+// Free the GIF data unless it is mapped flash
+void releasePipBoyGifBuffer() {
+  if (!gifMapped) {
+    memFree(gifBuffer, MEM_PSRAM);
+  }
+  gifBuffer = NULL;
+  gifSize = 0;
+  gifMapped = false;
 }
 
 // Improved GIF loading function
@@ -64,46 +172,52 @@ bool loadAndInitGIF(const char *gifPath) {
   // Clear any existing GIF resources
   if (gifBuffer != NULL) {
     gif.close();
-    free(gifBuffer);
-    gifBuffer = NULL;
-    gifSize = 0;
-  }
-
-  // Check if the file exists
-  if (!SPIFFS.exists(gifPath)) {
-    return false;
-  }
-
-  // Open the file
-  File f = SPIFFS.open(gifPath, "r");
-  if (!f) {
-    return false;
+    releasePipBoyGifBuffer();
   }
 
-  // Get file size
-  gifSize = f.size();
-  if (gifSize == 0) {
-    f.close();
-    return false;
+  // Packed assets are played straight from mapped flash
+  uint32_t assetSize = 0;
+  const uint8_t *asset = assetFind(gifPath, &assetSize);
+  if (asset != NULL) {
+    gifBuffer = (uint8_t *)asset;
+    gifSize = assetSize;
+    gifMapped = true;
+    gif.begin(GIF_PALETTE_RGB565_LE);
+    if (!gif.open(gifBuffer, gifSize, GIFDraw)) {
+      releasePipBoyGifBuffer();
+      return false;
+    }
+    return true;
   }
 
-  // Allocate memory for the GIF data
-  gifBuffer = (uint8_t *)malloc(gifSize);
-  if (gifBuffer == NULL) {
-    f.close();
-    gifSize = 0;
-    return false;
-  }
+  if (themeLookup(gifPath) != NULL) {
+    // Theme files hold the GIF after their header
+    uint32_t size = 0;
+    gifBuffer = themeLoadImage(gifPath, &size);
+    gifSize = size;
+    if (gifBuffer == NULL) {
+      return false;
+    }
+  } else {
+    // Look the file up (only the first time touches the file system)
+    int assetId = assetResolve(gifPath);
+    if (assetId < 0 || assetFileSize(assetId) == 0) {
+      return false;
+    }
 
-  // Read the file into the buffer
-  size_t bytesRead = f.read(gifBuffer, gifSize);
-  f.close();
+    // Allocate memory for the GIF data
+    gifSize = assetFileSize(assetId);
+    gifBuffer = (uint8_t *)memAlloc(gifSize, MEM_PSRAM);
+    if (gifBuffer == NULL) {
+      gifSize = 0;
+      return false;
+    }
 
-  if (bytesRead != gifSize) {
-    free(gifBuffer);
-    gifBuffer = NULL;
-    gifSize = 0;
-    return false;
+    // Read the file into the buffer
+    if (!assetReadAll(assetId, gifBuffer)) {
+      releasePipBoyGifBuffer();
+      return false;
+    }
   }
 
   // Initialize the GIF decoder
@@ -111,9 +225,7 @@ bool loadAndInitGIF(const char *gifPath) {
 
   // Open the GIF from the buffer
   if (!gif.open(gifBuffer, gifSize, GIFDraw)) {
-    free(gifBuffer);
-    gifBuffer = NULL;
-    gifSize = 0;
+    releasePipBoyGifBuffer();
     return false;
   }
 
@@ -123,168 +235,124 @@ bool loadAndInitGIF(const char *gifPath) {
 // Draw the initial Pip-Boy interface
 void drawPipBoyInterface() {
   // Clear the display
-  tft.fillScreen(PIP_BLACK);
-
-  // Draw day of week at top
-  tft.setTextSize(2);
-  tft.setTextColor(PIP_GREEN);
-  int dayWidth = dayOfWeek.length() * 12;
-  tft.setCursor(screenCenterX - (dayWidth / 2), 25);
-  tft.println(dayOfWeek);
-
-  // Draw date
-  tft.setTextSize(2);
-  char dateStr[20];
-  sprintf(dateStr, "%02d.%02d.%04d", month, day, year);
-  int dateWidth = strlen(dateStr) * 12;
-  tft.setCursor(screenCenterX - (dateWidth / 2), 50);
-  tft.println(dateStr);
-
-  // Try to load and display the GIF
-  bool gifLoaded = loadAndInitGIF("/vaultboy.gif");
-
-  // If GIF loaded successfully, display the first frame
-  if (gifLoaded) {
+  tft->fillScreen(PIP_BLACK);
+
+  // Packed sprite first, then the GIF
+  if (spriteLoaded) {
+    spriteRelease(vaultBoySprite);
+  }
+  spriteLoaded = spriteLoad(vaultBoySprite, VAULTBOY_SPRITE, PIP_GREEN);
+  bool gifLoaded = !spriteLoaded && (loadAndInitGIF("/vaultboy.gif") || loadAndInitGIF("/vaultboy.thm"));
+
+  if (spriteLoaded) {
+    // Same place as the GIF, which drops its first 5 rows
+    ambientBegin("vaultboy.gif");
+    spriteDrawFrame(vaultBoySprite, 0, figureX - 20, 80, 5);
+    ambientFinish("vaultboy.gif", true);
+    pipBoyNextFrame = governorNextGifFrame(spriteFrameDelay(vaultBoySprite, 0));
+  } else if (gifLoaded) {
+    // If GIF loaded successfully, display the first frame
+    ambientBegin("vaultboy.gif");
     gif.playFrame(true, NULL);
+    ambientFinish("vaultboy.gif", true);
   } else {
     // If GIF loading failed, draw static figure
     // Head - simple circle with face
-    tft.fillCircle(figureX, 100, 15, PIP_GREEN);
+    tft->fillCircle(figureX, 100, 15, PIP_GREEN);
 
     // Eyes
-    tft.fillCircle(figureX - 5, 97, 2, PIP_BLACK);
-    tft.fillCircle(figureX + 5, 97, 2, PIP_BLACK);
+    tft->fillCircle(figureX - 5, 97, 2, PIP_BLACK);
+    tft->fillCircle(figureX + 5, 97, 2, PIP_BLACK);
 
     // Mouth - simple line for neutral/sad expression
-    tft.drawFastHLine(figureX - 5, 105, 10, PIP_BLACK);
+    tft->drawFastHLine(figureX - 5, 105, 10, PIP_BLACK);
 
     // Body - simple rectangle
-    tft.fillRect(figureX - 10, 115, 20, 30, PIP_GREEN);
+    tft->fillRect(figureX - 10, 115, 20, 30, PIP_GREEN);
 
     // Arms - simple lines
-    tft.drawLine(figureX - 10, 120, figureX - 20, 130, PIP_GREEN);
-    tft.drawLine(figureX + 10, 120, figureX + 20, 130, PIP_GREEN);
+    tft->drawLine(figureX - 10, 120, figureX - 20, 130, PIP_GREEN);
+    tft->drawLine(figureX + 10, 120, figureX + 20, 130, PIP_GREEN);
 
     // Legs - simple lines
-    tft.drawLine(figureX - 5, 145, figureX - 5, 165, PIP_GREEN);
-    tft.drawLine(figureX + 5, 145, figureX + 5, 165, PIP_GREEN);
+    tft->drawLine(figureX - 5, 145, figureX - 5, 165, PIP_GREEN);
+    tft->drawLine(figureX + 5, 145, figureX + 5, 165, PIP_GREEN);
   }
 
-  // Draw time with larger font size
-  tft.setTextSize(5);
-  char timeStr[6];
-
-  // Define time position
-  int timeY = 80;
-
-  // Hours
-  int displayHours = is24Hour ? hours : (hours > 12 ? hours - 12 : (hours == 0 ? 12 : hours));
-  sprintf(timeStr, "%02d", displayHours);
-  tft.setCursor(120, timeY);
-  tft.println(timeStr);
-
-  // Seconds (next to hours)
-  tft.setTextSize(2);
-  sprintf(timeStr, "%02d", seconds);
-  tft.setCursor(195, timeY + 10);
-  tft.println(timeStr);
+  // Draw PIP-BOY 3000 and ROBCO INDUSTRIES, centered on their real width
+  drawCenteredText(180, "PIP-BOY 3000", 2, PIP_GREEN, PIP_BLACK, true);
+  drawCenteredText(200, "ROBCO IND", 2, PIP_GREEN, PIP_BLACK, true);
 
-  // Minutes
-  tft.setTextSize(5);
-  sprintf(timeStr, "%02d", minutes);
-  tft.setCursor(120, timeY + 50);
-  tft.println(timeStr);
-
-  // AM/PM indicator (right of minutes)
-  tft.setTextSize(2);
-  tft.setCursor(195, timeY + 60);
-  tft.println(hours >= 12 ? "PM" : "AM");
-
-  // Draw PIP-BOY 3000 and ROBCO INDUSTRIES
-  tft.setTextSize(2);
-
-  // Calculate width to center text
-  int pipBoyWidth = 11 * 12;  // "PIP-BOY 3000" is 11 chars
-  int robcoWidth = 8 * 12;    // "ROBCO IND" is 8 chars
-
-  tft.setCursor(screenCenterX - (pipBoyWidth / 2), 180);
-  tft.println("PIP-BOY 3000");
-
-  tft.setCursor(screenCenterX - (robcoWidth / 2), 200);
-  tft.println("ROBCO IND");
+  // Date and time fields
+  resetPipBoyFields();
+  updatePipBoyTime();
 }
 
-// Function to update Pip-Boy time display
+// Function to update Pip-Boy time display - only changed fields are drawn
 void updatePipBoyTime() {
-  // Day of week at top
-  tft.fillRect(screenCenterX - 70, 25, 140, 20, PIP_BLACK);
-  tft.setTextSize(2);
-  tft.setTextColor(PIP_GREEN);
-  int dayWidth = dayOfWeek.length() * 12;
-  tft.setCursor(screenCenterX - (dayWidth / 2), 25);
-  tft.println(dayOfWeek);
-
-  // Date
-  tft.fillRect(screenCenterX - 70, 50, 140, 20, PIP_BLACK);
-  tft.setTextSize(2);
-  char dateStr[20];
-  sprintf(dateStr, "%02d.%02d.%04d", month, day, year);
-  int dateWidth = strlen(dateStr) * 12;
-  tft.setCursor(screenCenterX - (dateWidth / 2), 50);
-  tft.println(dateStr);
-
-  // Define time position
-  int timeY = 80;
-  char timeStr[6];
+  // Day of week and date, centered
+  pipBoyFieldDraw(pipDayField, pipBoyTextKey(dayOfWeek.c_str()), dayOfWeek.c_str());
+
+  char text[20];
+  sprintf(text, "%02d.%02d.%04d", month, day, year);
+  pipBoyFieldDraw(pipDateField, (year * 16 + month) * 32 + day, text);
 
   // Hours
-  tft.fillRect(120, timeY, 70, 40, PIP_BLACK);
-  tft.setTextSize(5);
   int displayHours = is24Hour ? hours : (hours > 12 ? hours - 12 : (hours == 0 ? 12 : hours));
-  sprintf(timeStr, "%02d", displayHours);
-  tft.setCursor(120, timeY);
-  tft.println(timeStr);
+  sprintf(text, "%02d", displayHours);
+  pipBoyFieldDraw(pipHoursField, displayHours, text);
 
-  // Seconds (next to hours)
-  tft.fillRect(195, timeY + 10, 30, 20, PIP_BLACK);
-  tft.setTextSize(2);
-  sprintf(timeStr, "%02d", seconds);
-  tft.setCursor(195, timeY + 10);
-  tft.println(timeStr);
+  // Seconds (next to hours) - usually the only field that changed
+  sprintf(text, "%02d", seconds);
+  pipBoyFieldDraw(pipSecondsField, seconds, text);
 
   // Minutes
-  tft.fillRect(120, timeY + 50, 70, 40, PIP_BLACK);
-  tft.setTextSize(5);
-  sprintf(timeStr, "%02d", minutes);
-  tft.setCursor(120, timeY + 50);
-  tft.println(timeStr);
+  sprintf(text, "%02d", minutes);
+  pipBoyFieldDraw(pipMinutesField, minutes, text);
 
   // AM/PM (next to minutes)
-  tft.fillRect(195, timeY + 60, 30, 20, PIP_BLACK);
-  tft.setTextSize(2);
-  tft.setCursor(195, timeY + 60);
-  tft.println(hours >= 12 ? "PM" : "AM");
+  pipBoyFieldDraw(pipAmPmField, hours >= 12, hours >= 12 ? "PM" : "AM");
+
+  // Send the changed fields in one transaction
+  flushDrawQueue();
 }
 
 // Function to update the GIF animation
 void updatePipBoyGif() {
+  if (spriteLoaded) {
+    if (!governorGifFrameDue(pipBoyNextFrame)) return;
+
+    int frame = (vaultBoySprite.frame + 1) % vaultBoySprite.header->frameCount;
+    spriteDrawFrame(vaultBoySprite, frame, figureX - 20, 80, 5);
+    pipBoyNextFrame = governorNextGifFrame(spriteFrameDelay(vaultBoySprite, frame));
+    return;
+  }
+
   // Check if GIF exists and is loaded
   if (gifBuffer != NULL && gifSize > 0) {
-    // Try to play the next frame
-    if (!gif.playFrame(true, NULL)) {
+    // The governor may slow or freeze the animation when frames run late
+    if (!governorGifFrameDue(pipBoyNextFrame)) return;
+
+    // Play the next frame without blocking for its delay
+    int frameDelay = 0;
+    if (!gif.playFrame(false, &frameDelay)) {
       // End of animation, reset to beginning
       gif.reset();
     }
+    pipBoyNextFrame = governorNextGifFrame(frameDelay);
   }
 }
 
 // Clean up resources when switching away from Pip-Boy mode
 void cleanupPipBoyMode() {
+  if (spriteLoaded) {
+    spriteRelease(vaultBoySprite);
+    spriteLoaded = false;
+  }
+
   if (gifBuffer != NULL) {
     gif.close();
-    free(gifBuffer);
-    gifBuffer = NULL;
-    gifSize = 0;
+    releasePipBoyGifBuffer();
   }
 }
 
@@ -7,7 +7,8 @@
 #define SIMPLE_STORAGE_H
 
 #include <Arduino.h>
-#include <SPIFFS.h>
+#include "storage.h"
+#include "fs_maintenance.h"
 
 // Settings file path
 #define SETTINGS_FILE "/settings.txt"
@@ -19,7 +20,8 @@ bool saveSettingsToFile(int bgIndex, int clockMode, int vertPos, int ledColor) {
   sprintf(buffer, "%d,%d,%d,%d", bgIndex, clockMode, vertPos, ledColor);
 
   // Open file for writing
-  File file = SPIFFS.open(SETTINGS_FILE, "w");
+  storageWriteBegin();
+  File file = clockFS().open(SETTINGS_FILE, "w");
   if (!file) {
     return false;
   }
@@ -27,6 +29,7 @@ bool saveSettingsToFile(int bgIndex, int clockMode, int vertPos, int ledColor) {
   // Write settings
   size_t written = file.print(buffer);
   file.close();
+  storageWriteEnd(SETTINGS_FILE, written);
 
   return (written > 0);
 }
@@ -34,12 +37,12 @@ bool saveSettingsToFile(int bgIndex, int clockMode, int vertPos, int ledColor) {
 // Function to load settings from file
 bool loadSettingsFromFile(int *bgIndex, int *clockMode, int *vertPos, int *ledColor) {
   // Check if settings file exists
-  if (!SPIFFS.exists(SETTINGS_FILE)) {
+  if (!clockFS().exists(SETTINGS_FILE)) {
     return false;
   }
 
   // Open file for reading
-  File file = SPIFFS.open(SETTINGS_FILE, "r");
+  File file = clockFS().open(SETTINGS_FILE, "r");
   if (!file) {
     return false;
   }
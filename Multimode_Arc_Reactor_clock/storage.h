@@ -0,0 +1,264 @@
+/*
+ * storage.h - File system selection and SPIFFS migration
+ * For Multi-Mode Digital Clock project
+ * Everything that reads or writes files goes through clockFS(). With
+ * USE_LITTLEFS the files live on a LittleFS partition (directories, fast
+ * lookups, no long garbage collection stalls). On the first boot every file
+ * is copied over from SPIFFS. SPIFFS stays untouched and is used instead
+ * whenever LittleFS cannot be mounted.
+ */
+
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SPIFFS.h>
+#include "config.h"
+#include "log_buffer.h"
+#include "mem_alloc.h"
+#include "asset_partition.h"
+
+#ifndef USE_LITTLEFS
+#define USE_LITTLEFS 0
+#endif
+
+#if USE_LITTLEFS
+#include <LittleFS.h>
+#endif
+
+// LittleFS partition label (see tools/partitions_littlefs.csv)
+#define LITTLEFS_PARTITION "littlefs"
+
+// Written once all SPIFFS files have been copied
+#define MIGRATION_MARKER "/.migrated"
+
+// Each file is copied here and renamed once complete, so a copy cut short
+// by a power loss is never mistaken for a migrated file
+#define MIGRATION_TEMP_FILE "/.migrating"
+
+#define STORAGE_COPY_BUFFER 4096
+
+// Most distinct names compactNameIndex() can tell apart
+#define NAME_INDEX_MAX_ENTRIES 128
+#define NAME_INDEX_NAME_LENGTH 32
+
+// Old copy kept by storageReplace() until the new file is in place
+#define STORAGE_ASIDE_FILE "/replace.old"
+
+bool spiffsMounted = false;
+bool littleFsMounted = false;
+
+// Function prototypes
+bool storageBegin();
+fs::FS& clockFS();
+const char* storageName();
+size_t storageFreeBytes();
+bool storageAssetExists(const char* name);
+bool storageReplace(const String& from, const String& path);
+int compactNameIndex(const char* path);
+
+// The file system in use
+fs::FS& clockFS() {
+#if USE_LITTLEFS
+  if (littleFsMounted) return LittleFS;
+#endif
+  return SPIFFS;
+}
+
+const char* storageName() {
+  return littleFsMounted ? "LittleFS" : "SPIFFS";
+}
+
+// Space left for new files
+size_t storageFreeBytes() {
+#if USE_LITTLEFS
+  if (littleFsMounted) return LittleFS.totalBytes() - LittleFS.usedBytes();
+#endif
+  return SPIFFS.totalBytes() - SPIFFS.usedBytes();
+}
+
+// True when a background is on storage or packed in the asset partition
+bool storageAssetExists(const char* name) {
+  if (assetFind(name, NULL) != NULL) return true;
+  if (*name == '/') return clockFS().exists(name);
+  return clockFS().exists(String("/") + name);
+}
+
+// Move a finished temporary file onto 'path'. LittleFS renames over the old
+// file in one step; SPIFFS refuses an existing name, so there the old file is
+// moved aside first and put back if the rename fails.
+bool storageReplace(const String& from, const String& path) {
+  if (clockFS().rename(from, path)) return true;
+  if (!clockFS().exists(path)) return false;
+
+  clockFS().remove(STORAGE_ASIDE_FILE);
+  if (!clockFS().rename(path, STORAGE_ASIDE_FILE)) return false;
+  if (!clockFS().rename(from, path)) {
+    clockFS().rename(STORAGE_ASIDE_FILE, path);
+    return false;
+  }
+  clockFS().remove(STORAGE_ASIDE_FILE);
+  return true;
+}
+
+// Rewrite a "name:values" index, keeping the first line of every name whose
+// asset still exists. Returns the number of lines dropped.
+int compactNameIndex(const char* path) {
+  File source = clockFS().open(path, "r");
+  if (!source) return 0;
+
+  String tempName = String(path) + ".tmp";
+  File target = clockFS().open(tempName, "w");
+  if (!target) {
+    source.close();
+    return 0;
+  }
+
+  // Names kept so far, with their hashes for a quick first comparison
+  uint32_t seen[NAME_INDEX_MAX_ENTRIES];
+  char (*seenNames)[NAME_INDEX_NAME_LENGTH] =
+      (char (*)[NAME_INDEX_NAME_LENGTH])memAlloc(NAME_INDEX_MAX_ENTRIES * NAME_INDEX_NAME_LENGTH, MEM_FAST);
+  if (seenNames == NULL) {
+    source.close();
+    target.close();
+    clockFS().remove(tempName);
+    return 0;
+  }
+  int seenCount = 0;
+  int dropped = 0;
+
+  while (source.available()) {
+    String line = source.readStringUntil('\n');
+    line.trim();
+    if (line.length() == 0) continue;
+
+    int colon = line.indexOf(':');
+    String name = line.substring(0, max(colon, 0));
+    if (colon <= 0 || !storageAssetExists(name.c_str())) {
+      dropped++;
+      continue;
+    }
+
+    uint32_t hash = FNV1A_OFFSET_BASIS;
+    for (unsigned int i = 0; i < name.length(); i++) {
+      hash = (hash ^ (uint8_t)name[i]) * FNV1A_PRIME;
+    }
+    // Hashes can collide - only a matching name makes a duplicate
+    bool duplicate = false;
+    for (int i = 0; i < seenCount && !duplicate; i++) {
+      duplicate = (seen[i] == hash && strcmp(seenNames[i], name.c_str()) == 0);
+    }
+    if (duplicate) {
+      dropped++;
+      continue;
+    }
+    if (seenCount < NAME_INDEX_MAX_ENTRIES && name.length() < NAME_INDEX_NAME_LENGTH) {
+      seen[seenCount] = hash;
+      strcpy(seenNames[seenCount++], name.c_str());
+    }
+
+    target.println(line);
+  }
+  source.close();
+  target.close();
+  memFree(seenNames, MEM_FAST);
+
+  if (dropped > 0 && storageReplace(tempName, path)) {
+    LOG_INFO("Compacted %s: %d stale lines dropped", path, dropped);
+  } else {
+    clockFS().remove(tempName);
+  }
+  return dropped;
+}
+
+#if USE_LITTLEFS
+// Copy one file, a buffer at a time, through MIGRATION_TEMP_FILE
+bool copyFile(fs::FS& from, fs::FS& to, const String& path, uint8_t* buffer) {
+  File source = from.open(path, "r");
+  if (!source) return false;
+
+  File target = to.open(MIGRATION_TEMP_FILE, "w");
+  if (!target) {
+    source.close();
+    return false;
+  }
+
+  bool ok = true;
+  size_t remaining = source.size();
+  while (remaining > 0 && ok) {
+    size_t chunk = source.read(buffer, min(remaining, (size_t)STORAGE_COPY_BUFFER));
+    ok = (chunk > 0) && (target.write(buffer, chunk) == chunk);
+    remaining -= chunk;
+  }
+
+  source.close();
+  target.close();
+  ok = ok && to.rename(MIGRATION_TEMP_FILE, path);
+  if (!ok) to.remove(MIGRATION_TEMP_FILE);
+  return ok;
+}
+
+// Copy every SPIFFS file that LittleFS does not have yet
+void migrateFromSpiffs() {
+  if (LittleFS.exists(MIGRATION_MARKER)) return;
+
+  uint8_t* buffer = (uint8_t*)memAlloc(STORAGE_COPY_BUFFER, MEM_FAST);
+  if (buffer == NULL) return;
+
+  unsigned long start = millis();
+  int copied = 0, failed = 0;
+
+  File root = SPIFFS.open("/");
+  File file = root.openNextFile();
+  while (file) {
+    String path = file.name();
+    if (!path.startsWith("/")) path = "/" + path;
+    file.close();
+
+    if (!LittleFS.exists(path)) {
+      if (copyFile(SPIFFS, LittleFS, path, buffer)) {
+        copied++;
+      } else {
+        failed++;
+        LOG_WARN("Migration: could not copy %s", path);
+      }
+    }
+    file = root.openNextFile();
+  }
+  memFree(buffer, MEM_FAST);
+
+  // Try again on the next boot if anything is missing
+  if (failed == 0) {
+    File marker = LittleFS.open(MIGRATION_MARKER, "w");
+    marker.print(copied);
+    marker.close();
+  }
+
+  LOG_INFO("Migrated %d files from SPIFFS in %lu ms (%d failed)", copied, millis() - start, failed);
+}
+#endif
+
+// Mount the file systems - call once in setup()
+bool storageBegin() {
+#if USE_LITTLEFS
+  littleFsMounted = LittleFS.begin(true, "/littlefs", 10, LITTLEFS_PARTITION);
+  spiffsMounted = SPIFFS.begin(!littleFsMounted);
+
+  if (littleFsMounted && spiffsMounted) {
+    migrateFromSpiffs();
+  } else if (!littleFsMounted) {
+    Serial.println("LittleFS mount failed - using SPIFFS");
+  }
+#else
+  spiffsMounted = SPIFFS.begin(true);
+#endif
+
+  if (littleFsMounted || spiffsMounted) {
+    Serial.printf("Storage: %s\n", storageName());
+  }
+
+  return littleFsMounted || spiffsMounted;
+}
+
+#endif  // STORAGE_H
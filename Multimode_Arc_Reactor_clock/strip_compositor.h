@@ -0,0 +1,300 @@
+/*
+ * strip_compositor.h - Strip-based layered compositor
+ * For Multi-Mode Digital Clock project
+ * A mode registers up to four layers (background, static face, widgets,
+ * overlay). Dirty regions are composed bottom layer first into N-line strips
+ * and pushed with double-buffered DMA, so each pixel is sent once per update.
+ */
+
+#ifndef STRIP_COMPOSITOR_H
+#define STRIP_COMPOSITOR_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "config.h"
+#include "utils.h"
+#include "mem_alloc.h"
+#include "frame_buffer.h"
+
+// Disabled unless enabled in config.h
+#ifndef USE_STRIP_COMPOSITOR
+#define USE_STRIP_COMPOSITOR 0
+#endif
+
+// Strip geometry
+#define STRIP_WIDTH 240
+#define STRIP_HEIGHT 240
+#define STRIP_LINES 16
+
+// Layer slots, composed in this order
+#define LAYER_BACKGROUND 0
+#define LAYER_FACE 1
+#define LAYER_WIDGETS 2
+#define LAYER_OVERLAY 3
+#define MAX_COMPOSITOR_LAYERS 4
+
+// Strip pixels are stored in panel byte order
+#define STRIP_COLOR(c) ((uint16_t)(((c) >> 8) | ((c) << 8)))
+
+// The part of the screen a layer is asked to paint
+struct StripTarget {
+  uint16_t* pixels;  // STRIP_WIDTH pixels per row, row 0 is screen row y0
+  int y0;            // First screen row in this strip
+  int lines;         // Rows in this strip
+  int x0, x1;        // Dirty columns [x0, x1)
+};
+
+// A layer paints its own pixels for the strip and leaves the rest untouched
+typedef void (*LayerRenderFunc)(const StripTarget& strip);
+
+LayerRenderFunc compositorLayers[MAX_COMPOSITOR_LAYERS] = { NULL, NULL, NULL, NULL };
+
+#if USE_STRIP_COMPOSITOR
+uint16_t* compositorStrips[2] = { NULL, NULL };
+#endif
+
+// Optional full-screen copy of the last decoded background (PSRAM only)
+uint16_t* compositorBackground = NULL;
+
+bool compositorReady = false;
+bool compositorDirty = false;
+int dirtyX0 = STRIP_WIDTH, dirtyY0 = STRIP_HEIGHT, dirtyX1 = 0, dirtyY1 = 0;
+
+// Function prototypes
+bool compositorBegin();
+bool compositorActive();
+bool compositorHasBackground();
+void compositorSetLayer(int slot, LayerRenderFunc render);
+void compositorClearLayers();
+void compositorInvalidate(int x, int y, int w, int h);
+void compositorInvalidateAll();
+void compositorRender();
+void compositorCaptureBackground(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t* bitmap);
+void backgroundLayer(const StripTarget& strip);
+void stripFillRect(const StripTarget& strip, int x, int y, int w, int h, uint16_t color);
+void stripDrawText(const StripTarget& strip, int x, int y, const char* text, uint8_t size, uint16_t color, uint16_t bgColor, bool opaque);
+
+// Set up DMA and the optional background capture - call after the panel is initialized
+bool compositorBegin() {
+#if USE_STRIP_COMPOSITOR
+  for (int i = 0; i < 2; i++) {
+    compositorStrips[i] = (uint16_t*)memAlloc(STRIP_WIDTH * STRIP_LINES * sizeof(uint16_t), MEM_DMA);
+    if (compositorStrips[i] == NULL) {
+      Serial.println("Strip compositor: no DMA memory for strips");
+      for (int j = 0; j < i; j++) {
+        memFree(compositorStrips[j], MEM_DMA);
+        compositorStrips[j] = NULL;
+      }
+      return false;
+    }
+  }
+  tftPanel.initDMA();
+
+  // Keeping a copy of the background needs 115KB - only try with PSRAM
+  if (psramFound()) {
+    compositorBackground = (uint16_t*)memAlloc(STRIP_WIDTH * STRIP_HEIGHT * sizeof(uint16_t), MEM_PSRAM);
+  }
+  if (compositorBackground == NULL) {
+    Serial.println("Compositor: no background capture, image modes draw directly");
+  }
+
+  compositorReady = true;
+  Serial.println("Strip compositor enabled");
+  return true;
+#else
+  return false;
+#endif
+}
+
+// True when modes should render through the compositor
+bool compositorActive() {
+  return compositorReady;
+}
+
+// True when the background layer can repaint the decoded image - without it,
+// modes drawn over a JPEG must not be composited or the image is painted over
+bool compositorHasBackground() {
+  return compositorBackground != NULL;
+}
+
+// Register a layer for the current mode
+void compositorSetLayer(int slot, LayerRenderFunc render) {
+  if (slot < 0 || slot >= MAX_COMPOSITOR_LAYERS) return;
+  compositorLayers[slot] = render;
+}
+
+// Remove all layers - called when switching modes
+void compositorClearLayers() {
+  for (int i = 0; i < MAX_COMPOSITOR_LAYERS; i++) {
+    compositorLayers[i] = NULL;
+  }
+  compositorDirty = false;
+  dirtyX0 = STRIP_WIDTH;
+  dirtyY0 = STRIP_HEIGHT;
+  dirtyX1 = dirtyY1 = 0;
+}
+
+// Grow the dirty region to include a rectangle
+void compositorInvalidate(int x, int y, int w, int h) {
+  int x1 = min(x + w, STRIP_WIDTH);
+  int y1 = min(y + h, STRIP_HEIGHT);
+  x = max(x, 0);
+  y = max(y, 0);
+  if (x >= x1 || y >= y1) return;
+
+  dirtyX0 = min(dirtyX0, x);
+  dirtyY0 = min(dirtyY0, y);
+  dirtyX1 = max(dirtyX1, x1);
+  dirtyY1 = max(dirtyY1, y1);
+  compositorDirty = true;
+}
+
+void compositorInvalidateAll() {
+  compositorInvalidate(0, 0, STRIP_WIDTH, STRIP_HEIGHT);
+}
+
+// Copy decoded JPEG blocks so the background layer can repaint them later
+void compositorCaptureBackground(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t* bitmap) {
+  if (compositorBackground == NULL) return;
+
+  for (int row = 0; row < h; row++) {
+    int sy = y + row;
+    if (sy < 0 || sy >= STRIP_HEIGHT) continue;
+
+    int sx = max((int)x, 0);
+    int ex = min(x + w, STRIP_WIDTH);
+    if (sx >= ex) continue;
+    memcpy(compositorBackground + sy * STRIP_WIDTH + sx, bitmap + row * w + (sx - x), (ex - sx) * sizeof(uint16_t));
+  }
+}
+
+// Standard background layer - the captured image (see compositorHasBackground)
+void backgroundLayer(const StripTarget& strip) {
+  if (compositorBackground == NULL) return;
+
+  int w = strip.x1 - strip.x0;
+  for (int row = 0; row < strip.lines; row++) {
+    uint16_t* dst = strip.pixels + row * STRIP_WIDTH + strip.x0;
+    memcpy(dst, compositorBackground + (strip.y0 + row) * STRIP_WIDTH + strip.x0, w * sizeof(uint16_t));
+  }
+}
+
+// Fill the part of a rectangle that falls inside the strip
+void stripFillRect(const StripTarget& strip, int x, int y, int w, int h, uint16_t color) {
+  int sx = max(x, strip.x0);
+  int ex = min(x + w, strip.x1);
+  int sy = max(y, strip.y0);
+  int ey = min(y + h, strip.y0 + strip.lines);
+  if (sx >= ex || sy >= ey) return;
+
+  uint16_t c = STRIP_COLOR(color);
+  for (int row = sy; row < ey; row++) {
+    uint16_t* dst = strip.pixels + (row - strip.y0) * STRIP_WIDTH;
+    for (int col = sx; col < ex; col++) {
+      dst[col] = c;
+    }
+  }
+}
+
+// Draw GLCD font text (6x8 cells scaled by size) into the strip
+void stripDrawText(const StripTarget& strip, int x, int y, const char* text, uint8_t size, uint16_t color, uint16_t bgColor, bool opaque) {
+  int cellW = 6 * size;
+  int cellH = 8 * size;
+
+  // Whole string is outside this strip
+  if (y >= strip.y0 + strip.lines || y + cellH <= strip.y0) return;
+
+  uint16_t fg = STRIP_COLOR(color);
+  uint16_t bg = STRIP_COLOR(bgColor);
+  int sy = max(y, strip.y0);
+  int ey = min(y + cellH, strip.y0 + strip.lines);
+
+  for (int i = 0; text[i] != '\0'; i++, x += cellW) {
+    if (x >= strip.x1 || x + cellW <= strip.x0) continue;
+
+    const uint8_t* glyph = font + (uint8_t)text[i] * 5;
+    for (int row = sy; row < ey; row++) {
+      int bit = (row - y) / size;
+      uint16_t* dst = strip.pixels + (row - strip.y0) * STRIP_WIDTH;
+
+      for (int col = max(x, strip.x0); col < min(x + cellW, strip.x1); col++) {
+        int glyphCol = (col - x) / size;
+        bool lit = glyphCol < 5 && (pgm_read_byte(glyph + glyphCol) & (1 << bit));
+        if (lit) {
+          dst[col] = fg;
+        } else if (opaque) {
+          dst[col] = bg;
+        }
+      }
+    }
+  }
+}
+
+#if USE_STRIP_COMPOSITOR
+// Send a composed strip - DMA to the panel, or a copy into the shadow canvas
+void pushCompositorStrip(uint16_t* pixels, int x, int y, int w, int h) {
+  if (frameBufferActive()) {
+    framePushImage(x, y, w, h, pixels);
+  } else {
+    // pushImageDMA waits for the previous strip, so the other buffer is free
+    tftPanel.pushImageDMA(x, y, w, h, pixels);
+  }
+}
+#endif
+
+// Compose and push every strip that touches the dirty region
+void compositorRender() {
+#if USE_STRIP_COMPOSITOR
+  if (!compositorReady || !compositorDirty) return;
+
+  int x0 = dirtyX0, x1 = dirtyX1;
+  int w = x1 - x0;
+  int bufferIndex = 0;
+
+  bool useDMA = !frameBufferActive();
+  bool oldSwapBytes = tftPanel.getSwapBytes();
+  if (useDMA) {
+    tftPanel.setSwapBytes(false);
+    tftPanel.startWrite();
+  }
+
+  for (int y0 = (dirtyY0 / STRIP_LINES) * STRIP_LINES; y0 < dirtyY1; y0 += STRIP_LINES) {
+    StripTarget strip;
+    strip.pixels = compositorStrips[bufferIndex];
+    strip.y0 = y0;
+    strip.lines = min(STRIP_LINES, STRIP_HEIGHT - y0);
+    strip.x0 = x0;
+    strip.x1 = x1;
+
+    // Bottom layer first, every layer paints over the previous ones
+    for (int i = 0; i < MAX_COMPOSITOR_LAYERS; i++) {
+      if (compositorLayers[i] != NULL) {
+        compositorLayers[i](strip);
+      }
+    }
+
+    // Only the dirty rows and columns go to the panel - pack them together
+    int rowStart = max(y0, dirtyY0);
+    int rowEnd = min(y0 + strip.lines, dirtyY1);
+    for (int row = rowStart; row < rowEnd; row++) {
+      memmove(strip.pixels + (row - rowStart) * w, strip.pixels + (row - y0) * STRIP_WIDTH + x0, w * sizeof(uint16_t));
+    }
+
+    pushCompositorStrip(strip.pixels, x0, rowStart, w, rowEnd - rowStart);
+    bufferIndex ^= 1;
+  }
+
+  if (useDMA) {
+    tftPanel.dmaWait();
+    tftPanel.endWrite();
+    tftPanel.setSwapBytes(oldSwapBytes);
+  }
+
+  compositorDirty = false;
+  dirtyX0 = STRIP_WIDTH;
+  dirtyY0 = STRIP_HEIGHT;
+  dirtyX1 = dirtyY1 = 0;
+#endif
+}
+
+#endif  // STRIP_COMPOSITOR_H
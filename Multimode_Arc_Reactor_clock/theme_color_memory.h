@@ -8,8 +8,12 @@
 #define THEME_COLOR_MEMORY_H
 
 #include <Arduino.h>
-#include <SPIFFS.h>
+#include "storage.h"
+#include "fs_maintenance.h"
 #include "theme_manager.h"
+#include "ambient_color.h"
+#include "theme_pack.h"
+#include "log_buffer.h"
 
 // File to store theme-color mappings
 #define THEME_COLOR_MAP_FILE "/bgcolors.txt"  // Changed to shorter name
@@ -55,9 +59,7 @@ String getFilenameFromPath(const String& path) {
   }
 
   // Debug output
-  Serial.print("Extracted filename: '");
-  Serial.print(result);
-  Serial.println("'");
+  LOG_DEBUG("Extracted filename: '%s'", result);
 
   return result;
 }
@@ -65,15 +67,15 @@ String getFilenameFromPath(const String& path) {
 // Load all theme-color mappings from file
 bool loadThemeColorMappings() {
   // Check if mapping file exists
-  if (!SPIFFS.exists(THEME_COLOR_MAP_FILE)) {
-    Serial.println("No color mappings file found");
+  if (!clockFS().exists(THEME_COLOR_MAP_FILE)) {
+    LOG_INFO("No color mappings file found");
     return false;
   }
 
   // Open file for reading
-  File file = SPIFFS.open(THEME_COLOR_MAP_FILE, "r");
+  File file = clockFS().open(THEME_COLOR_MAP_FILE, "r");
   if (!file) {
-    Serial.println("Failed to open color mappings file");
+    LOG_ERROR("Failed to open color mappings file");
     return false;
   }
 
@@ -112,10 +114,7 @@ bool loadThemeColorMappings() {
         numColorMappings++;
 
         // Debug output
-        Serial.print("Loaded mapping: '");
-        Serial.print(filename);
-        Serial.print("' -> ");
-        Serial.println(colorIndex);
+        LOG_DEBUG("Loaded mapping: '%s' -> %d", filename, colorIndex);
       }
     }
   }
@@ -123,13 +122,11 @@ bool loadThemeColorMappings() {
   file.close();
 
   // Debug output
-  Serial.print("Loaded ");
-  Serial.print(numColorMappings);
-  Serial.println(" color mappings");
+  LOG_INFO("Loaded %d color mappings", numColorMappings);
 
   // Validate the loaded mappings
   if (!validateColorMappings()) {
-    Serial.println("Some mappings were invalid and have been removed");
+    LOG_WARN("Some mappings were invalid and have been removed");
     saveThemeColorMappings();  // Re-save to clean up invalid entries
   }
 
@@ -142,9 +139,10 @@ bool loadThemeColorMappings() {
 // Save all theme-color mappings to file
 bool saveThemeColorMappings() {
   // Open file for writing (recreate it every time)
-  File file = SPIFFS.open(THEME_COLOR_MAP_FILE, "w");
+  storageWriteBegin();
+  File file = clockFS().open(THEME_COLOR_MAP_FILE, "w");
   if (!file) {
-    Serial.println("Failed to create color mappings file");
+    LOG_ERROR("Failed to create color mappings file");
     return false;
   }
 
@@ -159,11 +157,11 @@ bool saveThemeColorMappings() {
     }
   }
 
+  size_t written = file.size();
   file.close();
+  storageWriteEnd(THEME_COLOR_MAP_FILE, written);
 
-  Serial.print("Saved ");
-  Serial.print(count);
-  Serial.println(" color mappings");
+  LOG_INFO("Saved %d color mappings", count);
 
   return true;
 }
@@ -183,14 +181,13 @@ int findThemeColorMapping(const char* filename) {
 void saveThemeColorPreference(const char* filename, int colorIndex) {
   // Skip if filename is empty or too long
   if (filename == NULL || strlen(filename) == 0 || strlen(filename) >= MAX_FILENAME_LENGTH) {
-    Serial.println("Invalid filename for color preference");
+    LOG_WARN("Invalid filename for color preference");
     return;
   }
 
   // Validate color index
   if (colorIndex < 0 || colorIndex >= COLOR_TOTAL) {
-    Serial.print("Invalid color index: ");
-    Serial.println(colorIndex);
+    LOG_WARN("Invalid color index: %d", colorIndex);
     return;
   }
 
@@ -199,13 +196,7 @@ void saveThemeColorPreference(const char* filename, int colorIndex) {
     return;
   }
 
-  Serial.print("Saving color preference: File='");
-  Serial.print(filename);
-  Serial.print("', Color=");
-  Serial.print(colorIndex);
-  Serial.print(" (");
-  Serial.print(ledColors[colorIndex].name);
-  Serial.println(")");
+  LOG_INFO("Saving color preference: File='%s', Color=%d (%s)", filename, colorIndex, ledColors[colorIndex].name);
 
   // Look for existing mapping
   int index = findThemeColorMapping(filename);
@@ -215,9 +206,9 @@ void saveThemeColorPreference(const char* filename, int colorIndex) {
     if (colorMappings[index].colorIndex != colorIndex) {
       colorMappings[index].colorIndex = colorIndex;
       saveThemeColorMappings();  // Save only when changed
-      Serial.println("Updated existing mapping");
+      LOG_DEBUG("Updated existing mapping");
     } else {
-      Serial.println("No change to existing mapping");
+      LOG_DEBUG("No change to existing mapping");
     }
   } else if (numColorMappings < MAX_THEME_MAPPINGS) {
     // Add new mapping
@@ -227,9 +218,9 @@ void saveThemeColorPreference(const char* filename, int colorIndex) {
     colorMappings[numColorMappings].isValid = true;
     numColorMappings++;
     saveThemeColorMappings();  // Save when new entry added
-    Serial.println("Added new mapping");
+    LOG_DEBUG("Added new mapping");
   } else {
-    Serial.println("WARNING: Maximum number of mappings reached!");
+    LOG_WARN("Maximum number of mappings reached!");
   }
 }
 
@@ -237,7 +228,7 @@ void saveThemeColorPreference(const char* filename, int colorIndex) {
 int getThemeColorPreference(const char* filename) {
   // Skip if filename is empty
   if (filename == NULL || strlen(filename) == 0) {
-    Serial.println("Empty filename, using default color");
+    LOG_DEBUG("Empty filename, using default color");
     return getCurrentLedColor();
   }
 
@@ -249,46 +240,47 @@ int getThemeColorPreference(const char* filename) {
   // Look for existing mapping
   int index = findThemeColorMapping(filename);
 
-  if (index >= 0) {
-    Serial.print("Found color for '");
-    Serial.print(filename);
-    Serial.print("': ");
-    Serial.print(colorMappings[index].colorIndex);
-    Serial.print(" (");
-    Serial.print(ledColors[colorMappings[index].colorIndex].name);
-    Serial.println(")");
+  if (index >= 0 && colorMappings[index].colorIndex != COLOR_AMBIENT) {
+    LOG_DEBUG("Found color for '%s': %d (%s)", filename, colorMappings[index].colorIndex,
+              ledColors[colorMappings[index].colorIndex].name);
     return colorMappings[index].colorIndex;
   }
 
+  // Color packed into the theme file
+  const ThemeHeader* theme = themeLookup(filename);
+  if (index < 0 && theme != NULL && theme->ledColor >= 0 && theme->ledColor < COLOR_TOTAL) {
+    return theme->ledColor;
+  }
+
+#if AMBIENT_LED
+  // Use the color taken from the background when it has been analyzed before
+  if (loadAmbientColor(filename)) {
+    LOG_DEBUG("Using ambient color for '%s'", filename);
+    return COLOR_AMBIENT;
+  }
+#endif
+
   // Return current color if no preference is found
   int currentColor = getCurrentLedColor();
-  Serial.print("No color found for '");
-  Serial.print(filename);
-  Serial.print("', using current color: ");
-  Serial.println(currentColor);
+  LOG_DEBUG("No color found for '%s', using current color: %d", filename, currentColor);
   return currentColor;
 }
 
 // Debug function to print all theme-color mappings
 void printThemeColorMappings() {
-  Serial.println("Background Color Mappings:");
+  LOG_DEBUG("Background Color Mappings:");
 
   for (int i = 0; i < numColorMappings; i++) {
     if (colorMappings[i].isValid) {
-      Serial.print("  BG: '");
-      Serial.print(colorMappings[i].filename);
-      Serial.print("', Color: ");
-      Serial.print(colorMappings[i].colorIndex);
-      Serial.print(" (");
-      Serial.print(ledColors[colorMappings[i].colorIndex].name);
-      Serial.println(")");
+      LOG_DEBUG("  BG: '%s', Color: %d (%s)", colorMappings[i].filename, colorMappings[i].colorIndex,
+                ledColors[colorMappings[i].colorIndex].name);
     }
   }
 }
 
 // Reset all color mappings
 void resetAllColorMappings() {
-  Serial.println("Resetting all color mappings...");
+  LOG_INFO("Resetting all color mappings...");
 
   // Clear all mappings
   for (int i = 0; i < MAX_THEME_MAPPINGS; i++) {
@@ -299,7 +291,7 @@ void resetAllColorMappings() {
   // Save empty mappings file
   saveThemeColorMappings();
 
-  Serial.println("All color mappings reset.");
+  LOG_INFO("All color mappings reset.");
 }
 
 // Validate all color mappings
@@ -310,9 +302,7 @@ bool validateColorMappings() {
     if (colorMappings[i].isValid) {
       // Check that filename is not empty
       if (strlen(colorMappings[i].filename) == 0) {
-        Serial.print("Invalid mapping #");
-        Serial.print(i);
-        Serial.println(": Empty filename");
+        LOG_WARN("Invalid mapping #%d: Empty filename", i);
         colorMappings[i].isValid = false;
         isValid = false;
         continue;
@@ -320,10 +310,7 @@ bool validateColorMappings() {
 
       // Check that color index is valid
       if (colorMappings[i].colorIndex < 0 || colorMappings[i].colorIndex >= COLOR_TOTAL) {
-        Serial.print("Invalid mapping #");
-        Serial.print(i);
-        Serial.print(": Invalid color index ");
-        Serial.println(colorMappings[i].colorIndex);
+        LOG_WARN("Invalid mapping #%d: Invalid color index %d", i, colorMappings[i].colorIndex);
         colorMappings[i].isValid = false;
         isValid = false;
         continue;
@@ -9,6 +9,8 @@
 
 #include <Arduino.h>
 #include <TFT_eSPI.h>
+#include "config.h"
+#include "clock_state.h"
 
 // Clock modes
 #define MODE_ARC_DIGITAL 0
@@ -46,7 +48,10 @@
 #define COLOR_SNOW_WHITE 21     // Bright white for snow
 #define COLOR_FOG_GRAY 22       // Gray for fog/mist conditions
 
-#define COLOR_TOTAL 23  // Total number of available colors
+// Filled in from the current background (see ambient_color.h)
+#define COLOR_AMBIENT 23
+
+#define COLOR_TOTAL 24  // Total number of available colors
 
 // Extended LED color structure with name
 struct LEDColorDefinition {
@@ -84,7 +89,10 @@ LEDColorDefinition ledColors[COLOR_TOTAL] = {
   { 130, 0, 220, 0x801B, "Storm" },         // Storm purple
   { 20, 80, 200, 0x14CD, "Rain" },          // Rain blue
   { 240, 240, 255, 0xF7FF, "Snow" },        // Snow white
-  { 140, 140, 160, 0x8DB4, "Fog" }          // Fog/mist gray
+  { 140, 140, 160, 0x8DB4, "Fog" },         // Fog/mist gray
+
+  // Background-derived color
+  { 0, 20, 255, 0x051F, "Ambient" }
 };
 
 // Track current LED color
@@ -92,10 +100,9 @@ int currentLedColor = COLOR_BLUE;  // Current LED color index
 
 // External references (to be defined in main sketch)
 extern int currentMode;
-extern TFT_eSPI tft;
+extern TFT_eSPI* tft;
 extern int screenCenterX;
 extern int screenCenterY;
-extern bool needClockRefresh;
 
 // Forward declarations
 void setThemeFromFilename(const char* filename);
@@ -116,7 +123,7 @@ void updateModeColorsFromLedColor(int colorIndex) {
     colorIndex = COLOR_BLUE;  // Default to blue if invalid
   }
 
-  currentLedColor = colorIndex;
+  clockSetLedColor(colorIndex);
 }
 
 // Get color name
@@ -130,12 +137,17 @@ const char* getColorName(int colorIndex) {
 // Cycle through available LED colors
 void cycleLedColor() {
   // Skip the weather-specific colors in manual cycling
-  currentLedColor = (currentLedColor + 1) % COLOR_TOTAL;
+  int nextColor = (currentLedColor + 1) % COLOR_TOTAL;
 
   // Skip the weather colors when cycling manually
-  if (currentLedColor >= COLOR_FREEZING_BLUE && currentLedColor <= COLOR_FOG_GRAY) {
-    currentLedColor = COLOR_IRONMAN_RED;  // Wrap back to first color
+  if (nextColor >= COLOR_FREEZING_BLUE && nextColor <= COLOR_FOG_GRAY) {
+#if AMBIENT_LED
+    nextColor = COLOR_AMBIENT;  // Follow the background after White
+#else
+    nextColor = COLOR_IRONMAN_RED;  // Wrap back to first color
+#endif
   }
+  clockSetLedColor(nextColor);
 
   // Show color name overlay - function defined in led_controls.h
   showColorNameOverlay();
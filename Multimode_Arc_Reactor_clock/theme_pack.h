@@ -0,0 +1,185 @@
+/*
+ * theme_pack.h - Theme container files (.thm)
+ * For Multi-Mode Digital Clock project
+ * A .thm file holds everything a background needs: a fixed 64-byte header
+ * (clock mode, LED color, clock position, font, image position) followed by
+ * the JPEG or GIF itself. Headers are read once when storage is scanned, so
+ * picking the mode for a background needs no name parsing, and showing it
+ * is a single open plus one contiguous read. Built by tools/pack_themes.py.
+ */
+
+#ifndef THEME_PACK_H
+#define THEME_PACK_H
+
+#include <Arduino.h>
+#include "storage.h"
+#include "asset_reader.h"
+#include "mem_alloc.h"
+#include "utils.h"
+#include "log_buffer.h"
+#include "theme_manager.h"
+
+#define THEME_MAGIC 0x314D4854  // "THM1"
+#define THEME_VERSION 1
+#define THEME_EXTENSION ".thm"
+#define THEME_SOURCE_LENGTH 36
+#define THEME_NAME_LENGTH 32
+
+// Headers kept in memory (one per background at most)
+#define MAX_THEMES 99
+
+// Header field values
+#define THEME_IMAGE_JPEG 0
+#define THEME_IMAGE_GIF 1
+#define THEME_FONT_DEFAULT 0  // Smooth font if one is installed
+#define THEME_FONT_BUILTIN 1
+#define THEME_UNSET -1        // No LED color / keep the current clock position
+
+// Accepted clock positions - POS_TOP, POS_CENTER, POS_BOTTOM, POS_AUTO and
+// POS_HIDDEN in the main sketch
+#define THEME_POSITION_COUNT 5
+const int16_t themePositions[THEME_POSITION_COUNT] = { -80, 0, 80, 998, 999 };
+
+// On-disk header, little endian (must match tools/pack_themes.py)
+struct __attribute__((packed)) ThemeHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t headerSize;
+  uint8_t mode;                       // MODE_xxx
+  uint8_t imageType;                  // THEME_IMAGE_xxx
+  uint8_t font;                       // THEME_FONT_xxx
+  uint8_t reserved;
+  int16_t ledColor;                   // COLOR_xxx or THEME_UNSET
+  int16_t clockPosition;              // POS_xxx or THEME_UNSET
+  int16_t imageX;                     // Where the image is drawn
+  int16_t imageY;
+  uint32_t imageOffset;               // Payload position in the file
+  uint32_t imageSize;
+  char source[THEME_SOURCE_LENGTH];  // File the theme was built from
+};
+
+// A scanned theme, found by its file name (hash first)
+struct ThemeEntry {
+  uint32_t nameHash;
+  char name[THEME_NAME_LENGTH];
+  ThemeHeader header;
+};
+
+ThemeEntry themeEntries[MAX_THEMES];
+int themeCount = 0;
+
+// Function prototypes
+bool isThemeFile(const String& filename);
+bool themeScan(const char* path);
+const ThemeHeader* themeLookup(const char* filename);
+uint8_t* themeLoadImage(const char* path, uint32_t* size);
+
+bool isThemeFile(const String& filename) {
+  return filename.endsWith(THEME_EXTENSION);
+}
+
+// File name without its directory
+const char* themeBaseName(const char* filename) {
+  const char* slash = strrchr(filename, '/');
+  return slash ? slash + 1 : filename;
+}
+
+// FNV-1a of the file name without its directory
+uint32_t themeNameHash(const char* filename) {
+  const char* name = themeBaseName(filename);
+
+  uint32_t hash = FNV1A_OFFSET_BASIS;
+  while (*name) {
+    hash = (hash ^ (uint8_t)*name++) * FNV1A_PRIME;
+  }
+  return hash;
+}
+
+bool themePositionValid(int16_t position) {
+  if (position == THEME_UNSET) return true;
+  for (int i = 0; i < THEME_POSITION_COUNT; i++) {
+    if (themePositions[i] == position) return true;
+  }
+  return false;
+}
+
+// Layout and every field the sketch acts on must be in range
+bool themeHeaderValid(const ThemeHeader& header, int32_t fileSize) {
+  if (header.magic != THEME_MAGIC || header.version != THEME_VERSION) return false;
+  if (header.headerSize < sizeof(ThemeHeader) || header.imageOffset < header.headerSize) return false;
+  if (header.imageSize == 0 || header.imageOffset > (uint32_t)fileSize ||
+      header.imageSize > (uint32_t)fileSize - header.imageOffset) {
+    return false;
+  }
+
+  return header.mode < MODE_TOTAL &&
+         (header.imageType == THEME_IMAGE_JPEG || header.imageType == THEME_IMAGE_GIF) &&
+         header.font <= THEME_FONT_BUILTIN &&
+         (header.ledColor == THEME_UNSET || (header.ledColor >= 0 && header.ledColor < COLOR_TOTAL)) &&
+         themePositionValid(header.clockPosition);
+}
+
+// Read and remember the header of a .thm file - call while scanning storage
+bool themeScan(const char* path) {
+  if (themeCount >= MAX_THEMES || strlen(themeBaseName(path)) >= THEME_NAME_LENGTH) return false;
+
+  int id = assetResolve(path);
+  ThemeHeader header;
+  if (id < 0 || assetRead(id, 0, (uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+      !themeHeaderValid(header, assetFileSize(id))) {
+    LOG_WARN("Not a valid theme file: %s", path);
+    return false;
+  }
+  header.source[THEME_SOURCE_LENGTH - 1] = '\0';
+
+  uint32_t hash = themeNameHash(path);
+  const char* name = themeBaseName(path);
+  for (int i = 0; i < themeCount; i++) {
+    if (themeEntries[i].nameHash == hash && strcmp(themeEntries[i].name, name) == 0) {
+      themeEntries[i].header = header;
+      return true;
+    }
+  }
+
+  themeEntries[themeCount].nameHash = hash;
+  strcpy(themeEntries[themeCount].name, name);
+  themeEntries[themeCount].header = header;
+  themeCount++;
+
+  LOG_DEBUG("Theme %s: mode %d, from %s", path, header.mode, header.source);
+  return true;
+}
+
+// Header of a scanned theme (path or bare file name), or NULL
+const ThemeHeader* themeLookup(const char* filename) {
+  if (filename == NULL || !isThemeFile(String(filename))) return NULL;
+
+  uint32_t hash = themeNameHash(filename);
+  const char* name = themeBaseName(filename);
+  for (int i = 0; i < themeCount; i++) {
+    if (themeEntries[i].nameHash == hash && strcmp(themeEntries[i].name, name) == 0) {
+      return &themeEntries[i].header;
+    }
+  }
+  return NULL;
+}
+
+// Read the image of a theme into a new MEM_PSRAM buffer (free with memFree)
+uint8_t* themeLoadImage(const char* path, uint32_t* size) {
+  const ThemeHeader* header = themeLookup(path);
+  int id = assetResolve(path);
+  if (header == NULL || id < 0) return NULL;
+
+  uint8_t* data = (uint8_t*)memAlloc(header->imageSize, MEM_PSRAM);
+  if (data == NULL) return NULL;
+
+  if (assetRead(id, header->imageOffset, data, header->imageSize) != (int32_t)header->imageSize) {
+    memFree(data, MEM_PSRAM);
+    return NULL;
+  }
+
+  *size = header->imageSize;
+  return data;
+}
+
+#endif  // THEME_PACK_H
@@ -8,13 +8,18 @@
 
 #include <Arduino.h>
 #include <TFT_eSPI.h>
+#include "clock_state.h"
 
 // Colors
 #define PIP_GREEN 0x07E0  // Bright green for Pip-Boy mode
 #define PIP_BLACK 0x0000
 
+// FNV-1a hash constants (used for change detection)
+#define FNV1A_OFFSET_BASIS 2166136261UL
+#define FNV1A_PRIME 16777619UL
+
 // References to external variables that are defined in the main sketch
-extern TFT_eSPI tft;
+extern TFT_eSPI* tft;  // Panel or shadow canvas, see frame_buffer.h
 extern int screenCenterX;
 extern int screenCenterY;
 extern int screenRadius;
@@ -23,47 +28,50 @@ extern int day, month, year;
 extern String dayOfWeek;
 extern bool is24Hour;
 
-// Update time and date from NTP or manual increment
+// Update time and date from NTP or manual increment, publish the result
+// and take it into the loop task view
 void updateTimeAndDate() {
+  static const char* dayNames[] = {"SUNDAY", "MONDAY", "TUESDAY", "WEDNESDAY", "THURSDAY", "FRIDAY", "SATURDAY"};
+
   // Get current time and date if WiFi is connected
-  if (WiFi.status() == WL_CONNECTED) {
-    struct tm timeinfo;
-    if (getLocalTime(&timeinfo)) {
-      hours = timeinfo.tm_hour;
-      minutes = timeinfo.tm_min;
-      seconds = timeinfo.tm_sec;
+  // (read before the write section - getLocalTime() can block)
+  bool connected = (WiFi.status() == WL_CONNECTED);
+  struct tm timeinfo;
+  if (connected && !getLocalTime(&timeinfo)) return;
 
-      day = timeinfo.tm_mday;
-      month = timeinfo.tm_mon + 1;     // tm_mon is 0-11
-      year = timeinfo.tm_year + 1900;  // tm_year is years since 1900
+  ClockState& state = clockWriteBegin();
+  if (connected) {
+    state.hours = timeinfo.tm_hour;
+    state.minutes = timeinfo.tm_min;
+    state.seconds = timeinfo.tm_sec;
 
-      // Get day of week
-      switch (timeinfo.tm_wday) {
-        case 0: dayOfWeek = "SUNDAY"; break;
-        case 1: dayOfWeek = "MONDAY"; break;
-        case 2: dayOfWeek = "TUESDAY"; break;
-        case 3: dayOfWeek = "WEDNESDAY"; break;
-        case 4: dayOfWeek = "THURSDAY"; break;
-        case 5: dayOfWeek = "FRIDAY"; break;
-        case 6: dayOfWeek = "SATURDAY"; break;
-      }
+    state.day = timeinfo.tm_mday;
+    state.month = timeinfo.tm_mon + 1;     // tm_mon is 0-11
+    state.year = timeinfo.tm_year + 1900;  // tm_year is years since 1900
+
+    // Get day of week
+    if (timeinfo.tm_wday >= 0 && timeinfo.tm_wday < 7) {
+      strncpy(state.dayOfWeek, dayNames[timeinfo.tm_wday], CLOCK_DAY_LENGTH - 1);
     }
   } else {
     // Increment time manually if no WiFi
-    seconds++;
-    if (seconds >= 60) {
-      seconds = 0;
-      minutes++;
-      if (minutes >= 60) {
-        minutes = 0;
-        hours++;
-        if (hours >= 24) {
-          hours = 0;
+    state.seconds++;
+    if (state.seconds >= 60) {
+      state.seconds = 0;
+      state.minutes++;
+      if (state.minutes >= 60) {
+        state.minutes = 0;
+        state.hours++;
+        if (state.hours >= 24) {
+          state.hours = 0;
           // Here we could also increment the date, but keeping it simple
         }
       }
     }
   }
+  clockWriteEnd();
+
+  clockStateSnapshot();
 }
 
 #endif  // UTILS_H
@@ -13,8 +13,11 @@
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include "utils.h"
+#include "glyph_cache.h"
 #include "weather_data.h"
 #include "weather_led.h"
+#include "mqtt_link.h"
+#include "metrics.h"
 
 // Weather display mode ID
 #define MODE_WEATHER 4  // Weather mode is mode #4
@@ -135,9 +138,21 @@ bool fetchWeatherData() {
 void updateWeatherData() {
   unsigned long currentMillis = millis();
 
+  // Weather pushed by the aggregator replaces polling while it keeps coming
+  if (mqttTakeWeather(currentWeather)) {
+    lastWeatherUpdate = currentMillis;
+    setWeatherLEDColorDirectly();
+    return;
+  }
+  if (mqttWeatherFresh()) return;
+
   // Check if it's time for an update
   if (!currentWeather.valid || (currentMillis - lastWeatherUpdate >= weatherUpdateInterval)) {
+    unsigned long fetchStart = millis();
     bool dataUpdated = fetchWeatherData();
+    if (WiFi.status() == WL_CONNECTED) {
+      metricsWeatherFetch(millis() - fetchStart, dataUpdated);
+    }
 
     if (dataUpdated) {
       lastWeatherUpdate = currentMillis;
@@ -159,7 +174,7 @@ void cleanupWeatherMode() {
 // Draw a proper degree symbol
 void drawDegreeSymbol(int x, int y, int size, uint16_t color) {
   int radius = size * 2;
-  tft.drawCircle(x, y, radius, color);
+  tft->drawCircle(x, y, radius, color);
 }
 
 // Draw a static weather icon based on the icon code
@@ -169,7 +184,7 @@ void drawWeatherIcon() {
   int iconY = WEATHER_ICON_Y;
 
   // Clear area for the icon
-  tft.fillRect(iconX - 40, iconY - 40, 80, 80, WEATHER_BG);
+  tft->fillRect(iconX - 40, iconY - 40, 80, 80, WEATHER_BG);
 
   // Check if we have a valid icon code
   bool isDay = true;
@@ -183,11 +198,11 @@ void drawWeatherIcon() {
     // Clear sky
     if (isDay) {
       // Sun
-      tft.fillCircle(iconX, iconY, 20, TFT_YELLOW);
+      tft->fillCircle(iconX, iconY, 20, TFT_YELLOW);
     } else {
       // Moon
-      tft.fillCircle(iconX, iconY, 20, TFT_LIGHTGREY);
-      tft.fillCircle(iconX + 10, iconY - 10, 20, WEATHER_BG);  // Bite out of the moon
+      tft->fillCircle(iconX, iconY, 20, TFT_LIGHTGREY);
+      tft->fillCircle(iconX + 10, iconY - 10, 20, WEATHER_BG);  // Bite out of the moon
     }
   }
   // Few Clouds
@@ -195,88 +210,82 @@ void drawWeatherIcon() {
     // Few clouds
     if (isDay) {
       // Sun with cloud
-      tft.fillCircle(iconX - 10, iconY - 5, 12, TFT_YELLOW);          // Sun
-      tft.fillRoundRect(iconX - 5, iconY, 30, 15, 8, TFT_LIGHTGREY);  // Cloud
+      tft->fillCircle(iconX - 10, iconY - 5, 12, TFT_YELLOW);          // Sun
+      tft->fillRoundRect(iconX - 5, iconY, 30, 15, 8, TFT_LIGHTGREY);  // Cloud
     } else {
       // Moon with cloud
-      tft.fillCircle(iconX - 10, iconY - 5, 12, TFT_LIGHTGREY);       // Moon
-      tft.fillCircle(iconX - 5, iconY - 10, 8, WEATHER_BG);           // Bite out of moon
-      tft.fillRoundRect(iconX - 5, iconY, 30, 15, 8, TFT_LIGHTGREY);  // Cloud
+      tft->fillCircle(iconX - 10, iconY - 5, 12, TFT_LIGHTGREY);       // Moon
+      tft->fillCircle(iconX - 5, iconY - 10, 8, WEATHER_BG);           // Bite out of moon
+      tft->fillRoundRect(iconX - 5, iconY, 30, 15, 8, TFT_LIGHTGREY);  // Cloud
     }
   }
   // Clouds
   else if (strcmp(currentWeather.iconCode, "03d") == 0 || strcmp(currentWeather.iconCode, "03n") == 0 || 
            strcmp(currentWeather.iconCode, "04d") == 0 || strcmp(currentWeather.iconCode, "04n") == 0) {
     // Clouds
-    tft.fillRoundRect(iconX - 25, iconY - 10, 50, 20, 10, TFT_LIGHTGREY);  // Main cloud
-    tft.fillRoundRect(iconX - 15, iconY - 20, 40, 15, 8, TFT_WHITE);       // Top cloud
+    tft->fillRoundRect(iconX - 25, iconY - 10, 50, 20, 10, TFT_LIGHTGREY);  // Main cloud
+    tft->fillRoundRect(iconX - 15, iconY - 20, 40, 15, 8, TFT_WHITE);       // Top cloud
   }
   // Rain
   else if (strcmp(currentWeather.iconCode, "09d") == 0 || strcmp(currentWeather.iconCode, "09n") == 0 || 
            strcmp(currentWeather.iconCode, "10d") == 0 || strcmp(currentWeather.iconCode, "10n") == 0) {
     // Rain
-    tft.fillRoundRect(iconX - 25, iconY - 15, 50, 20, 10, TFT_LIGHTGREY);  // Cloud
+    tft->fillRoundRect(iconX - 25, iconY - 15, 50, 20, 10, TFT_LIGHTGREY);  // Cloud
     // Raindrops
     for (int i = -15; i <= 15; i += 10) {
-      tft.fillRoundRect(iconX + i, iconY + 10, 3, 15, 2, 0x5E9F);  // Light blue raindrops
+      tft->fillRoundRect(iconX + i, iconY + 10, 3, 15, 2, 0x5E9F);  // Light blue raindrops
     }
   }
   // Thunderstorm
   else if (strcmp(currentWeather.iconCode, "11d") == 0 || strcmp(currentWeather.iconCode, "11n") == 0) {
     // Thunderstorm
-    tft.fillRoundRect(iconX - 25, iconY - 15, 50, 20, 10, TFT_LIGHTGREY);  // Cloud
+    tft->fillRoundRect(iconX - 25, iconY - 15, 50, 20, 10, TFT_LIGHTGREY);  // Cloud
     // Lightning bolt
-    tft.fillTriangle(iconX - 5, iconY + 5, iconX + 10, iconY + 15, iconX - 10, iconY + 20, TFT_YELLOW);
-    tft.fillTriangle(iconX - 10, iconY + 20, iconX + 10, iconY + 15, iconX, iconY + 35, TFT_YELLOW);
+    tft->fillTriangle(iconX - 5, iconY + 5, iconX + 10, iconY + 15, iconX - 10, iconY + 20, TFT_YELLOW);
+    tft->fillTriangle(iconX - 10, iconY + 20, iconX + 10, iconY + 15, iconX, iconY + 35, TFT_YELLOW);
   }
   // Snow
   else if (strcmp(currentWeather.iconCode, "13d") == 0 || strcmp(currentWeather.iconCode, "13n") == 0) {
     // Snow
-    tft.fillRoundRect(iconX - 25, iconY - 15, 50, 20, 10, TFT_LIGHTGREY);  // Cloud
+    tft->fillRoundRect(iconX - 25, iconY - 15, 50, 20, 10, TFT_LIGHTGREY);  // Cloud
     // Snowflakes
     for (int i = -15; i <= 15; i += 10) {
-      tft.fillCircle(iconX + i, iconY + 15, 5, TFT_WHITE);
+      tft->fillCircle(iconX + i, iconY + 15, 5, TFT_WHITE);
     }
   }
   // Mist/Fog
   else if (strcmp(currentWeather.iconCode, "50d") == 0 || strcmp(currentWeather.iconCode, "50n") == 0) {
     // Mist/Fog
     for (int i = -15; i <= 15; i += 7) {
-      tft.drawLine(iconX - 25, iconY + i, iconX + 25, iconY + i, TFT_LIGHTGREY);
+      tft->drawLine(iconX - 25, iconY + i, iconX + 25, iconY + i, TFT_LIGHTGREY);
     }
   }
   // Unknown/Default
   else {
     // Unknown weather
-    tft.fillRoundRect(iconX - 25, iconY - 15, 50, 30, 8, TFT_LIGHTGREY);
+    tft->fillRoundRect(iconX - 25, iconY - 15, 50, 30, 8, TFT_LIGHTGREY);
 
     // Question mark
-    tft.setTextColor(WEATHER_TEXT);
-    tft.setTextSize(3);
-    tft.setCursor(iconX - 10, iconY - 10);
-    tft.print("?");
+    tft->setTextColor(WEATHER_TEXT);
+    tft->setTextSize(3);
+    tft->setCursor(iconX - 10, iconY - 10);
+    tft->print("?");
   }
 }
 
 // Draw the initial Weather interface
 void drawWeatherInterface() {
   // Clear the display
-  tft.fillScreen(WEATHER_BG);
+  tft->fillScreen(WEATHER_BG);
 
   // Draw day of week at top
-  tft.setTextSize(2);
-  tft.setTextColor(WEATHER_TEXT);
-  int dayWidth = dayOfWeek.length() * 12;
-  tft.setCursor(screenCenterX - (dayWidth / 2), 25);
-  tft.println(dayOfWeek);
+  tft->setTextColor(WEATHER_TEXT);
+  drawCenteredText(25, dayOfWeek.c_str(), 2, WEATHER_TEXT, WEATHER_BG, true);
 
   // Draw date
-  tft.setTextSize(2);
   char dateStr[20];
   sprintf(dateStr, "%02d.%02d.%04d", month, day, year);
-  int dateWidth = strlen(dateStr) * 12;
-  tft.setCursor(screenCenterX - (dateWidth / 2), 50);
-  tft.println(dateStr);
+  drawCenteredText(50, dateStr, 2, WEATHER_TEXT, WEATHER_BG, true);
 
   // Display weather information
   if (currentWeather.valid) {
@@ -284,7 +293,7 @@ void drawWeatherInterface() {
     drawWeatherIcon();
 
     // Draw weather description below day/date
-    tft.setTextSize(1);
+    tft->setTextSize(1);
     char desc[24];
     strncpy(desc, currentWeather.description, sizeof(desc));
     desc[sizeof(desc) - 1] = '\0';
@@ -293,19 +302,17 @@ void drawWeatherInterface() {
     }
 
     // Center and print description
-    int descWidth = strlen(desc) * 6;
-    tft.setCursor(screenCenterX - (descWidth / 2), 70);
-    tft.print(desc);
+    drawCenteredText(70, desc, 1, WEATHER_TEXT, WEATHER_BG, true);
 
     // Draw temperature information
-    tft.setTextSize(3);
+    tft->setTextSize(3);
 
     // Current temperature
     char tempStr[10];
     sprintf(tempStr, "%d", currentWeather.temperature);
     int tempX = 100;
-    tft.setCursor(tempX, 90);
-    tft.print(tempStr);
+    tft->setCursor(tempX, 90);
+    tft->print(tempStr);
 
     // Draw a custom degree symbol
     int digitWidth = 16;  // Approximate width of a digit
@@ -315,50 +322,46 @@ void drawWeatherInterface() {
     drawDegreeSymbol(degreeX, degreeY, 2, WEATHER_TEXT);
 
     // Draw the unit
-    tft.setTextSize(2);
-    tft.setCursor(degreeX + 11, 90);
-    tft.print(weatherUnits[0] == 'i' ? "F" : "C");
+    tft->setTextSize(2);
+    tft->setCursor(degreeX + 11, 90);
+    tft->print(weatherUnits[0] == 'i' ? "F" : "C");
 
     // "Feels like" temperature
-    tft.setTextSize(2);
+    tft->setTextSize(2);
     sprintf(tempStr, "Feels: %d", currentWeather.feelsLike);
-    tft.setCursor(100, 115);
-    tft.print(tempStr);
+    tft->setCursor(100, 115);
+    tft->print(tempStr);
     degreeX = 110 + strlen(tempStr) * 12 - 4;
     degreeY = 115 + 4;
     drawDegreeSymbol(degreeX, degreeY, 1, WEATHER_TEXT);
 
     // High temperature
     sprintf(tempStr, "High: %d", currentWeather.tempMax);
-    tft.setCursor(100, 135);
-    tft.print(tempStr);
+    tft->setCursor(100, 135);
+    tft->print(tempStr);
     degreeX = 110 + strlen(tempStr) * 12 - 4;
     degreeY = 135 + 4;
     drawDegreeSymbol(degreeX, degreeY, 1, WEATHER_TEXT);
 
     // Low temperature
     sprintf(tempStr, "Low: %d", currentWeather.tempMin);
-    tft.setCursor(100, 155);
-    tft.print(tempStr);
+    tft->setCursor(100, 155);
+    tft->print(tempStr);
     degreeX = 110 + strlen(tempStr) * 12 - 4;
     degreeY = 155 + 4;
     drawDegreeSymbol(degreeX, degreeY, 1, WEATHER_TEXT);
   } else {
     // If no weather data available yet
-    tft.setTextSize(2);
-    tft.setCursor(70, 110);
-    tft.println("Loading...");
+    tft->setTextSize(2);
+    tft->setCursor(70, 110);
+    tft->println("Loading...");
   }
 
-  tft.setTextSize(2);
-
   // Draw the time
   char timeStr[10];
   int displayHours = is24Hour ? hours : (hours > 12 ? hours - 12 : (hours == 0 ? 12 : hours));
   sprintf(timeStr, "%02d:%02d %s", displayHours, minutes, hours >= 12 ? "PM" : "AM");
-  int timeWidth = strlen(timeStr) * 12;
-  tft.setCursor(screenCenterX - (timeWidth / 2), 195);
-  tft.println(timeStr);
+  drawCenteredText(195, timeStr, 2, WEATHER_TEXT, WEATHER_BG, true);
 
   // Draw seconds indicator ring
   drawWeatherSecondsIndicator();
@@ -381,7 +384,7 @@ void drawWeatherSecondsIndicator() {
     int y2 = screenCenterY + sin(endAngle) * WEATHER_SECONDS_RADIUS;
 
     // Draw a line segment for each second
-    tft.drawLine(x1, y1, x2, y2, secondRingColor);
+    tft->drawLine(x1, y1, x2, y2, secondRingColor);
 
     // Make it thicker
     for (int t = 1; t < WEATHER_SECONDS_THICKNESS; t++) {
@@ -390,7 +393,7 @@ void drawWeatherSecondsIndicator() {
       int x2Inner = screenCenterX + cos(endAngle) * (WEATHER_SECONDS_RADIUS - t);
       int y2Inner = screenCenterY + sin(endAngle) * (WEATHER_SECONDS_RADIUS - t);
 
-      tft.drawLine(x1Inner, y1Inner, x2Inner, y2Inner, secondRingColor);
+      tft->drawLine(x1Inner, y1Inner, x2Inner, y2Inner, secondRingColor);
     }
   }
 }
@@ -407,7 +410,7 @@ void updateWeatherSecondsIndicator() {
   // If seconds reset to 0, clear screen and redraw everything
   if (seconds == 0) {
     // Signal a full refresh
-    needClockRefresh = true;
+    clockRequestRefresh();
     lastSecond = seconds;
     return;
   }
@@ -423,7 +426,7 @@ void updateWeatherSecondsIndicator() {
   int y2 = screenCenterY + sin(endAngle) * WEATHER_SECONDS_RADIUS;
 
   // Draw a line segment for the new second
-  tft.drawLine(x1, y1, x2, y2, secondRingColor);
+  tft->drawLine(x1, y1, x2, y2, secondRingColor);
 
   // Make it thicker
   for (int t = 1; t < WEATHER_SECONDS_THICKNESS; t++) {
@@ -432,7 +435,7 @@ void updateWeatherSecondsIndicator() {
     int x2Inner = screenCenterX + cos(endAngle) * (WEATHER_SECONDS_RADIUS - t);
     int y2Inner = screenCenterY + sin(endAngle) * (WEATHER_SECONDS_RADIUS - t);
 
-    tft.drawLine(x1Inner, y1Inner, x2Inner, y2Inner, secondRingColor);
+    tft->drawLine(x1Inner, y1Inner, x2Inner, y2Inner, secondRingColor);
   }
 
   lastSecond = seconds;
@@ -447,18 +450,13 @@ void updateWeatherTime() {
   // Only update the time display if hours or minutes changed AND clock is not hidden
   if ((hoursChanged || minutesChanged) && !isClockHidden) {
     // Clear the time area
-    tft.fillRect(screenCenterX - 70, 195, 140, 15, WEATHER_BG);
+    tft->fillRect(screenCenterX - 70, 195, 140, max(15, textHeight(2)), WEATHER_BG);
 
     // Draw updated time
-    tft.setTextSize(2);
-    tft.setTextColor(WEATHER_TEXT);
-
     char timeStr[10];
     int displayHours = is24Hour ? hours : (hours > 12 ? hours - 12 : (hours == 0 ? 12 : hours));
     sprintf(timeStr, "%02d:%02d %s", displayHours, minutes, hours >= 12 ? "PM" : "AM");
-    int timeWidth = strlen(timeStr) * 12;
-    tft.setCursor(screenCenterX - (timeWidth / 2), 195);
-    tft.println(timeStr);
+    drawCenteredText(195, timeStr, 2, WEATHER_TEXT, WEATHER_BG, true);
 
     // Update previous values
     prevWeatherHours = hours;
@@ -0,0 +1,300 @@
+/*
+ * wifi_manager.h - WiFi connection with fast reconnect
+ * For Multi-Mode Digital Clock project
+ * A cold WiFi.begin() scans every channel and then waits for DHCP. After a
+ * connection the channel, BSSID and address are remembered, and the next
+ * attempt associates directly with that access point and reuses the
+ * address. A direct attempt that fails falls back to a full scan. Dropped
+ * links are reconnected from the loop without blocking it.
+ *
+ * The cache lives in RTC memory (kept across resets and deep sleep) and in
+ * WIFI_CACHE_FILE (kept across power cycles). The file copy holds only the
+ * channel and BSSID - a lease from before a power cycle is not trusted.
+ */
+
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+#include "storage.h"
+#include "fs_maintenance.h"
+#include "utils.h"
+#include "log_buffer.h"
+
+#ifndef WIFI_FAST_RECONNECT
+#define WIFI_FAST_RECONNECT 1
+#endif
+
+#ifndef WIFI_STATIC_IP
+#define WIFI_STATIC_IP ""
+#define WIFI_GATEWAY ""
+#define WIFI_SUBNET "255.255.255.0"
+#define WIFI_DNS ""
+#endif
+
+#define WIFI_CACHE_FILE "/wifi.dat"
+#define WIFI_CACHE_MAGIC 0x49464957  // "WIFI"
+
+// Attempt timeouts in ms
+#define WIFI_FAST_TIMEOUT 3000   // Direct association with the cached access point
+#define WIFI_SCAN_TIMEOUT 10000  // Full scan plus DHCP
+
+// Background retry after a failed reconnect, doubling up to the maximum
+#define WIFI_RETRY_MIN 5000
+#define WIFI_RETRY_MAX 300000
+
+// Connection states
+#define WIFI_STATE_IDLE 0        // wifiBegin() not called yet
+#define WIFI_STATE_CONNECTING 1  // Attempt in progress
+#define WIFI_STATE_CONNECTED 2
+#define WIFI_STATE_WAITING 3     // Waiting to retry
+
+// Where the last connection went and how it was addressed
+struct WifiCache {
+  uint32_t magic;
+  uint32_t ssidHash;  // Network the entry belongs to
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t hasLease;   // Address fields are valid
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+};
+
+RTC_NOINIT_ATTR WifiCache wifiRtcCache;
+WifiCache wifiCache;
+bool wifiCacheValid = false;
+
+const char* wifiSsid = NULL;
+const char* wifiPassword = NULL;
+
+int wifiState = WIFI_STATE_IDLE;
+bool wifiAttemptFast = false;
+unsigned long wifiAttemptStart = 0;
+unsigned long wifiRetryAt = 0;
+unsigned long wifiRetryDelay = WIFI_RETRY_MIN;
+
+// Statistics
+unsigned long wifiFastConnects = 0;
+unsigned long wifiScanConnects = 0;
+unsigned long wifiFailedAttempts = 0;
+unsigned long wifiDrops = 0;
+
+// Function prototypes
+bool wifiBegin(const char* ssid, const char* password);
+void wifiService();
+void wifiPrintStats();
+
+uint32_t wifiSsidHash(const char* ssid) {
+  uint32_t hash = FNV1A_OFFSET_BASIS;
+  while (*ssid) {
+    hash = (hash ^ (uint8_t)*ssid++) * FNV1A_PRIME;
+  }
+  return hash;
+}
+
+// RTC copy first, then the file (without its address)
+void wifiLoadCache() {
+  uint32_t hash = wifiSsidHash(wifiSsid);
+  wifiCacheValid = false;
+
+  if (wifiRtcCache.magic == WIFI_CACHE_MAGIC && wifiRtcCache.ssidHash == hash && wifiRtcCache.channel > 0) {
+    wifiCache = wifiRtcCache;
+    wifiCacheValid = true;
+    return;
+  }
+
+  File file = clockFS().open(WIFI_CACHE_FILE, "r");
+  if (!file) return;
+
+  WifiCache stored;
+  bool complete = (file.read((uint8_t*)&stored, sizeof(stored)) == sizeof(stored));
+  file.close();
+
+  if (complete && stored.magic == WIFI_CACHE_MAGIC && stored.ssidHash == hash && stored.channel > 0) {
+    wifiCache = stored;
+    wifiCache.hasLease = 0;
+    wifiCacheValid = true;
+  }
+}
+
+// Remember the current connection - the file is only rewritten when the
+// access point changed
+void wifiSaveCache() {
+  WifiCache current;
+  memset(&current, 0, sizeof(current));
+  current.magic = WIFI_CACHE_MAGIC;
+  current.ssidHash = wifiSsidHash(wifiSsid);
+  memcpy(current.bssid, WiFi.BSSID(), sizeof(current.bssid));
+  current.channel = WiFi.channel();
+  current.hasLease = 1;
+  current.ip = WiFi.localIP();
+  current.gateway = WiFi.gatewayIP();
+  current.subnet = WiFi.subnetMask();
+  current.dns = WiFi.dnsIP();
+
+  bool moved = !wifiCacheValid || current.channel != wifiCache.channel ||
+               memcmp(current.bssid, wifiCache.bssid, sizeof(current.bssid)) != 0;
+
+  wifiRtcCache = current;
+  wifiCache = current;
+  wifiCacheValid = true;
+  if (!moved) return;
+
+  WifiCache stored = current;
+  stored.hasLease = 0;
+
+  storageWriteBegin();
+  File file = clockFS().open(WIFI_CACHE_FILE, "w");
+  if (!file) return;
+  size_t written = file.write((const uint8_t*)&stored, sizeof(stored));
+  file.close();
+  storageWriteEnd(WIFI_CACHE_FILE, written);
+}
+
+// Forget the cache after a direct attempt failed
+void wifiDropCache() {
+  wifiCacheValid = false;
+  wifiRtcCache.magic = 0;
+}
+
+// Address for the next attempt: configured static IP, cached lease or DHCP
+void wifiConfigureAddress(bool fast) {
+  IPAddress staticIp;
+  if (strlen(WIFI_STATIC_IP) > 0 && staticIp.fromString(WIFI_STATIC_IP)) {
+    IPAddress gateway, subnet, dns;
+    gateway.fromString(WIFI_GATEWAY);
+    subnet.fromString(WIFI_SUBNET);
+    if (!dns.fromString(WIFI_DNS)) dns = gateway;
+    WiFi.config(staticIp, gateway, subnet, dns);
+  } else if (fast && wifiCache.hasLease) {
+    WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway), IPAddress(wifiCache.subnet), IPAddress(wifiCache.dns));
+  } else {
+    // All zero turns DHCP back on
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+  }
+}
+
+void wifiStartAttempt(bool fast) {
+  fast = fast && WIFI_FAST_RECONNECT && wifiCacheValid;
+  wifiAttemptFast = fast;
+  wifiConfigureAddress(fast);
+
+  WiFi.disconnect();
+  if (fast) {
+    WiFi.begin(wifiSsid, wifiPassword, wifiCache.channel, wifiCache.bssid);
+  } else {
+    WiFi.begin(wifiSsid, wifiPassword);
+  }
+
+  wifiAttemptStart = millis();
+  wifiState = WIFI_STATE_CONNECTING;
+}
+
+// 1 when connected, -1 when the attempt failed, 0 while it is running
+int wifiPollAttempt() {
+  unsigned long elapsed = millis() - wifiAttemptStart;
+  wl_status_t status = WiFi.status();
+  const char* kind = wifiAttemptFast ? "direct" : "scan";
+
+  if (status == WL_CONNECTED) {
+    LOG_INFO("WiFi: %s connect in %lu ms, channel %d", kind, elapsed, (int)WiFi.channel());
+    if (wifiAttemptFast) {
+      wifiFastConnects++;
+    } else {
+      wifiScanConnects++;
+    }
+    wifiSaveCache();
+    wifiState = WIFI_STATE_CONNECTED;
+    wifiRetryDelay = WIFI_RETRY_MIN;
+    return 1;
+  }
+
+  unsigned long timeout = wifiAttemptFast ? WIFI_FAST_TIMEOUT : WIFI_SCAN_TIMEOUT;
+  if (elapsed >= timeout || status == WL_CONNECT_FAILED || status == WL_NO_SSID_AVAIL) {
+    LOG_WARN("WiFi: %s attempt failed after %lu ms (status %d)", kind, elapsed, (int)status);
+    wifiFailedAttempts++;
+    if (wifiAttemptFast) wifiDropCache();
+    return -1;
+  }
+
+  return 0;
+}
+
+// Connect at startup, blocking for at most one direct and one full attempt
+bool wifiBegin(const char* ssid, const char* password) {
+  wifiSsid = ssid;
+  wifiPassword = password;
+
+  // Credentials come from config.h - no need for the SDK to keep them in
+  // flash, and reconnecting is handled here
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false);
+
+  wifiLoadCache();
+
+  wifiStartAttempt(true);
+  int result;
+  while ((result = wifiPollAttempt()) == 0) {
+    delay(50);
+  }
+
+  if (result < 0 && wifiAttemptFast) {
+    wifiStartAttempt(false);
+    while ((result = wifiPollAttempt()) == 0) {
+      delay(50);
+    }
+  }
+
+  if (result < 0) {
+    wifiState = WIFI_STATE_WAITING;
+    wifiRetryAt = millis() + wifiRetryDelay;
+  }
+  return result > 0;
+}
+
+// Watch the link and reconnect in the background - call once per loop
+void wifiService() {
+  unsigned long now = millis();
+
+  switch (wifiState) {
+    case WIFI_STATE_CONNECTED:
+      if (WiFi.status() != WL_CONNECTED) {
+        LOG_WARN("WiFi: link lost");
+        wifiDrops++;
+        wifiStartAttempt(true);
+      }
+      break;
+
+    case WIFI_STATE_CONNECTING: {
+      int result = wifiPollAttempt();
+      if (result < 0) {
+        if (wifiAttemptFast) {
+          wifiStartAttempt(false);
+        } else {
+          wifiState = WIFI_STATE_WAITING;
+          wifiRetryAt = now + wifiRetryDelay;
+          wifiRetryDelay = min(wifiRetryDelay * 2, (unsigned long)WIFI_RETRY_MAX);
+        }
+      }
+      break;
+    }
+
+    case WIFI_STATE_WAITING:
+      if ((long)(now - wifiRetryAt) >= 0) {
+        wifiStartAttempt(true);
+      }
+      break;
+  }
+}
+
+void wifiPrintStats() {
+  Serial.printf("WiFi: %lu direct / %lu scan connects, %lu failed attempts, %lu drops\n",
+                wifiFastConnects, wifiScanConnects, wifiFailedAttempts, wifiDrops);
+}
+
+#endif  // WIFI_MANAGER_H
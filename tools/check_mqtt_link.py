@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""
+check_mqtt_link.py - Check the MQTT stand-in against a simulated clock
+For Multi-Mode Digital Clock project
+
+Starts the stand-in broker from weather_aggregator.py on a free local
+port and connects a simulated clock that sends the same packets as
+mqtt_link.h (CONNECT with a retained "0" will, one SUBSCRIBE for the
+weather and both command topics, a retained "1" online flag). Checks:
+  weather  a retained report published before the clock connects is
+           delivered on subscribe, 36 bytes laid out like WeatherPacket
+  command  commands sent with "send" reach the clock's own and the
+           "all" topic, use verbs the clock parses and fit its buffer,
+           and commands for another clock do not arrive
+  will     dropping the clock's connection publishes the retained "0"
+           on its online topic, also to a later subscriber
+The packet layout and command verbs are read from mqtt_link.h, so a
+change on one side that the other does not follow fails here.
+
+Usage:
+  python3 tools/check_mqtt_link.py
+Exit status 0 when every check passes.
+"""
+
+import os
+import re
+import socket
+import struct
+import sys
+import threading
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import weather_aggregator as wa  # noqa: E402
+
+HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..",
+                      "Multimode_Arc_Reactor_clock", "mqtt_link.h")
+CLOCK_ID = "a1b2c3"
+PREFIX = "clock"
+TIMEOUT = 5
+KEEPALIVE = wa.KEEPALIVE  # Replaced by the value in mqtt_link.h
+
+# C field types in WeatherPacket and their struct codes
+C_TYPES = {"uint8_t": "B", "int8_t": "b", "char": "s"}
+
+
+def read_header():
+    with open(HEADER) as source:
+        text = source.read()
+    fields = re.search(r"struct __attribute__\(\(packed\)\) WeatherPacket \{(.*?)\};", text, re.S).group(1)
+    layout = "<"
+    for kind, _, count in re.findall(r"(\w+)\s+\w+(\[(\d+)\])?;", fields):
+        layout += (count + C_TYPES[kind]) if count else C_TYPES[kind]
+    version = int(re.search(r"#define MQTT_WEATHER_VERSION (\d+)", text).group(1))
+    keepalive = int(re.search(r"#define MQTT_KEEPALIVE (\d+)", text).group(1))
+    verbs = re.findall(r'strcmp\(text, "(\w+)"\)', text)
+    text_size = int(re.search(r"void mqttParseCommand.*?char text\[(\d+)\];", text, re.S).group(1))
+    return layout, version, keepalive, verbs, text_size
+
+
+class Client:
+    """Blocking MQTT client speaking the mqtt_link.h subset."""
+
+    def __init__(self, port, client_id, will=None):
+        self.sock = socket.create_connection(("127.0.0.1", port), timeout=TIMEOUT)
+        self.stream = self.sock.makefile("rb")
+        flags = 0x02
+        body_tail = wa.encode_string(client_id)
+        if will:
+            flags |= 0x04 | 0x20  # Will, will retain - as in mqttSendConnect()
+            body_tail += wa.encode_string(will[0]) + wa.encode_string(will[1])
+        body = wa.encode_string("MQTT") + bytes([4, flags]) + struct.pack(">H", KEEPALIVE) + body_tail
+        self.sock.sendall(wa.packet(wa.CONNECT, 0, body))
+        kind, _, reply = self.expect()
+        check(kind == wa.CONNACK and reply[1:2] == b"\x00", "%s: CONNACK accepted" % client_id)
+
+    def expect(self):
+        packet = wa.read_packet(self.stream)
+        if packet is None:
+            raise ConnectionError("connection closed")
+        return packet
+
+    def subscribe(self, *patterns):
+        body = b"\x00\x01"  # Packet id 1
+        for pattern in patterns:
+            body += wa.encode_string(pattern) + b"\x00"
+        self.sock.sendall(bytes([0x82]) + wa.encode_length(len(body)) + body)
+        kind, _, _ = self.expect()
+        check(kind == wa.SUBACK, "SUBACK for %s" % ", ".join(patterns))
+
+    def publish(self, topic, payload, retain):
+        self.sock.sendall(wa.publish_packet(topic, payload, retain))
+
+    def next_publish(self):
+        """(topic, payload) of the next PUBLISH, or None after TIMEOUT seconds."""
+        try:
+            while True:
+                kind, _, body = self.expect()
+                if kind == wa.PUBLISH:
+                    length = struct.unpack(">H", body[:2])[0]
+                    return body[2:2 + length].decode("utf-8"), body[2 + length:]
+        except (socket.timeout, ConnectionError):
+            return None
+
+    def drop(self):
+        # Gone without DISCONNECT, as when the clock loses power
+        self.sock.shutdown(socket.SHUT_RDWR)
+        self.sock.close()
+
+
+failures = []
+
+
+def check(condition, label):
+    print("%s %s" % ("ok  " if condition else "FAIL", label))
+    if not condition:
+        failures.append(label)
+
+
+def check_weather(port, layout, version):
+    check(struct.calcsize(layout) == struct.calcsize(wa.WEATHER_FORMAT) == 36,
+          "WeatherPacket is 36 bytes on both sides")
+    check(layout == wa.WEATHER_FORMAT, "field layout %s matches the aggregator" % layout)
+    check(wa.WEATHER_VERSION == version, "weather version %d on both sides" % version)
+
+    report = wa.pack_weather(wa.SAMPLE)
+    wa.publish_once("127.0.0.1:%d" % port, "%s/weather" % PREFIX, report, True, "weather-aggregator")
+
+    clock = Client(port, "clock-" + CLOCK_ID, ("%s/%s/online" % (PREFIX, CLOCK_ID), "0"))
+    clock.subscribe("%s/weather" % PREFIX, "%s/all/cmd" % PREFIX, "%s/%s/cmd" % (PREFIX, CLOCK_ID))
+    clock.publish("%s/%s/online" % (PREFIX, CLOCK_ID), b"1", True)
+
+    message = clock.next_publish()
+    check(message is not None and message[0] == "%s/weather" % PREFIX, "retained weather delivered on subscribe")
+    if message is not None:
+        payload = message[1]
+        check(payload == report, "payload is the published report")
+        fields = struct.unpack(layout, payload) if len(payload) == struct.calcsize(layout) else None
+        check(fields is not None and fields[0] == version and fields[1] == 64 and
+              fields[8].rstrip(b"\0") == b"02d" and fields[9].rstrip(b"\0") == b"few clouds",
+              "fields decode as the clock reads them")
+    return clock
+
+
+def check_commands(port, clock, verbs, text_size):
+    check(verbs == ["mode", "theme", "color", "brightness"], "clock parses %s" % ", ".join(verbs))
+    broker = "127.0.0.1:%d" % port
+    for target, command in ((CLOCK_ID, "mode 4"), ("all", "theme next"), (CLOCK_ID, "brightness 80")):
+        wa.publish_once(broker, "%s/%s/cmd" % (PREFIX, target), command.encode(), False, "clock-command")
+        message = clock.next_publish()
+        check(message == ("%s/%s/cmd" % (PREFIX, target), command.encode()),
+              "%r for %s delivered" % (command, target))
+        verb = command.split(" ")[0]
+        check(verb in verbs and len(command) < text_size, "%r is a command the clock accepts" % command)
+
+    wa.publish_once(broker, "%s/ffffff/cmd" % PREFIX, b"mode 1", False, "clock-command")
+    clock.sock.settimeout(1)
+    check(clock.next_publish() is None, "command for another clock not delivered")
+    clock.sock.settimeout(TIMEOUT)
+
+
+def check_will(port, clock):
+    online = "%s/%s/online" % (PREFIX, CLOCK_ID)
+    watcher = Client(port, "watcher")
+    watcher.subscribe("%s/+/online" % PREFIX)
+    check(watcher.next_publish() == (online, b"1"), "retained online flag is 1 while connected")
+
+    clock.drop()
+    check(watcher.next_publish() == (online, b"0"), "will publishes 0 when the link drops")
+
+    late = Client(port, "late-watcher")
+    late.subscribe(online)
+    check(late.next_publish() == (online, b"0"), "will is retained for later subscribers")
+
+
+def main():
+    global KEEPALIVE
+    layout, version, KEEPALIVE, verbs, text_size = read_header()
+
+    # The stand-in logs its traffic between the check lines
+    standin = wa.Standin(0)
+    threading.Thread(target=standin.serve, daemon=True).start()
+
+    try:
+        clock = check_weather(standin.port, layout, version)
+        check_commands(standin.port, clock, verbs, text_size)
+        check_will(standin.port, clock)
+    except (OSError, ConnectionError) as error:
+        check(False, "connection: %s" % error)
+
+    print("%d checks failed" % len(failures) if failures else "all checks passed")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""
+gif_to_sprite.py - Convert a single-color GIF to a packed .spr sprite
+For Multi-Mode Digital Clock project
+
+Every GIF frame is composed (disposal and transparency applied), reduced
+to 2 or 4 brightness levels and packed 1 or 2 bits per pixel. The sketch
+draws the levels as shades of one color (PIP_GREEN for the Pip-Boy).
+
+Layout (little endian, must match mono_sprite.h):
+  header : magic "SPR1", u16 width, u16 height, u8 bpp, u8 frame count, u16 reserved
+  delays : frame count x u16 milliseconds
+  frames : frame count x height rows, each row padded to a whole byte,
+           most significant bits first
+
+Usage:
+  python3 tools/gif_to_sprite.py Multimode_Arc_Reactor_clock/data/vaultboy.gif \\
+      Multimode_Arc_Reactor_clock/data/vaultboy.spr
+The Pip-Boy mode uses /vaultboy.spr instead of /vaultboy.gif when it exists.
+"""
+
+import argparse
+import struct
+import sys
+
+SPRITE_MAGIC = 0x31525053
+HEADER_FORMAT = "<IHHBBH"
+MIN_DELAY_MS = 20
+
+
+def lzw_decode(data, min_code_size, pixel_count):
+    clear = 1 << min_code_size
+    end = clear + 1
+    code_size = min_code_size + 1
+    table = [bytes([i]) for i in range(clear)] + [b"", b""]
+    output = bytearray()
+    previous = None
+    bits = 0
+    bit_count = 0
+    position = 0
+
+    while len(output) < pixel_count:
+        while bit_count < code_size:
+            if position >= len(data):
+                return bytes(output)
+            bits |= data[position] << bit_count
+            bit_count += 8
+            position += 1
+        code = bits & ((1 << code_size) - 1)
+        bits >>= code_size
+        bit_count -= code_size
+
+        if code == clear:
+            code_size = min_code_size + 1
+            table = table[:clear + 2]
+            previous = None
+            continue
+        if code == end:
+            break
+
+        if code < len(table):
+            entry = table[code]
+            if previous is not None:
+                table.append(previous + entry[:1])
+        elif previous is not None:
+            entry = previous + previous[:1]
+            table.append(entry)
+        else:
+            sys.exit("damaged LZW data")
+
+        output += entry
+        previous = entry
+        if len(table) == (1 << code_size) and code_size < 12:
+            code_size += 1
+
+    return bytes(output[:pixel_count])
+
+
+def read_sub_blocks(data, position):
+    chunks = bytearray()
+    while True:
+        length = data[position]
+        position += 1
+        if length == 0:
+            return bytes(chunks), position
+        chunks += data[position:position + length]
+        position += length
+
+
+def read_palette(data, position, flags):
+    size = 3 * (1 << ((flags & 0x07) + 1))
+    raw = data[position:position + size]
+    return [tuple(raw[i:i + 3]) for i in range(0, size, 3)], position + size
+
+
+def decode_gif(path):
+    """Composed RGB frames and their delays in ms."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if not data.startswith(b"GIF"):
+        sys.exit("%s is not a GIF" % path)
+
+    width, height, flags = struct.unpack("<HHB", data[6:11])
+    position = 13
+    global_palette = []
+    if flags & 0x80:
+        global_palette, position = read_palette(data, position, flags)
+
+    canvas = [(0, 0, 0)] * (width * height)
+    frames = []
+    delay, transparent, disposal = 0, None, 0
+
+    while position < len(data) and data[position] != 0x3B:
+        block = data[position]
+        if block == 0x21:
+            label = data[position + 1]
+            payload, position = read_sub_blocks(data, position + 2)
+            if label == 0xF9 and len(payload) >= 4:
+                packed = payload[0]
+                disposal = (packed >> 2) & 0x07
+                delay = struct.unpack("<H", payload[1:3])[0] * 10
+                transparent = payload[3] if packed & 0x01 else None
+        elif block == 0x2C:
+            left, top, w, h, image_flags = struct.unpack("<HHHHB", data[position + 1:position + 10])
+            position += 10
+            palette = global_palette
+            if image_flags & 0x80:
+                palette, position = read_palette(data, position, image_flags)
+            min_code_size = data[position]
+            lzw, position = read_sub_blocks(data, position + 1)
+            indices = lzw_decode(lzw, min_code_size, w * h)
+
+            if image_flags & 0x40:
+                rows = list(range(0, h, 8)) + list(range(4, h, 8)) + list(range(2, h, 4)) + list(range(1, h, 2))
+            else:
+                rows = list(range(h))
+
+            previous = list(canvas)
+            for source_row, y in enumerate(rows):
+                for x in range(w):
+                    i = source_row * w + x
+                    if i >= len(indices) or indices[i] == transparent:
+                        continue
+                    cx, cy = left + x, top + y
+                    if cx < width and cy < height:
+                        canvas[cy * width + cx] = palette[indices[i]] if indices[i] < len(palette) else (0, 0, 0)
+
+            frames.append((list(canvas), max(delay, MIN_DELAY_MS)))
+
+            if disposal == 2:
+                for y in range(top, min(top + h, height)):
+                    for x in range(left, min(left + w, width)):
+                        canvas[y * width + x] = (0, 0, 0)
+            elif disposal == 3:
+                canvas = previous
+            delay, transparent, disposal = 0, None, 0
+        else:
+            break
+
+    return width, height, frames
+
+
+def pack(path, output, bpp):
+    width, height, frames = decode_gif(path)
+    if not frames:
+        sys.exit("no frames in %s" % path)
+    if len(frames) > 255:
+        sys.exit("too many frames (%d, max 255)" % len(frames))
+
+    # Brightest pixel of the whole animation becomes the full color
+    peak = max(max(pixel) for pixels, _ in frames for pixel in pixels) or 1
+    levels = (1 << bpp) - 1
+    row_bytes = (width * bpp + 7) // 8
+    per_byte = 8 // bpp
+
+    body = bytearray()
+    for pixels, _ in frames:
+        for y in range(height):
+            row = bytearray(row_bytes)
+            for x in range(width):
+                value = (max(pixels[y * width + x]) * levels + peak // 2) // peak
+                row[x // per_byte] |= value << (8 - bpp - (x % per_byte) * bpp)
+            body += row
+
+    delays = b"".join(struct.pack("<H", min(delay, 0xFFFF)) for _, delay in frames)
+    header = struct.pack(HEADER_FORMAT, SPRITE_MAGIC, width, height, bpp, len(frames), 0)
+
+    with open(output, "wb") as f:
+        f.write(header + delays + body)
+
+    gif_ram = width * height * 2
+    print("%s: %dx%d, %d frames at %d bpp, %d bytes (one RGB565 frame is %d bytes)" %
+          (output, width, height, len(frames), bpp, len(header) + len(delays) + len(body), gif_ram))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a single-color GIF to a packed sprite")
+    parser.add_argument("gif", help="GIF to convert (e.g. data/vaultboy.gif)")
+    parser.add_argument("output", help=".spr file to write")
+    parser.add_argument("--bpp", type=int, choices=(1, 2), default=2, help="bits per pixel (default 2)")
+    args = parser.parse_args()
+    pack(args.gif, args.output, args.bpp)
+
+
+if __name__ == "__main__":
+    main()
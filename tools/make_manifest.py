@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""
+make_manifest.py - Asset manifest and content server for clock sync
+For Multi-Mode Digital Clock project
+
+Clocks with SYNC_SERVER set (asset_sync.h) fetch /manifest.txt from the
+server, download the backgrounds they are missing or hold in an older
+version, and delete backgrounds they synced earlier that the manifest no
+longer lists (flashed or uploaded files are kept). Manifest
+format, one line per file (must match asset_sync.h):
+  # clock manifest v1
+  <size> <FNV-1a 32-bit hash, 8 hex digits> <name>
+
+Only .jpg/.jpeg/.gif/.thm files are listed, with names of at most 30
+characters from [A-Za-z0-9._-] (SPIFFS paths are 31 characters at most).
+
+build   writes manifest.txt into the folder
+serve   writes it and serves the folder over HTTP, with the Range support
+        the clocks need to resume interrupted downloads
+
+Usage:
+  python3 tools/make_manifest.py build Multimode_Arc_Reactor_clock/data
+  python3 tools/make_manifest.py serve themes/ --port 8000
+"""
+
+import argparse
+import functools
+import http.server
+import os
+import re
+import sys
+
+FNV1A_OFFSET_BASIS = 2166136261
+FNV1A_PRIME = 16777619
+EXTENSIONS = (".jpg", ".jpeg", ".gif", ".thm")
+MAX_NAME_LENGTH = 30
+MAX_ENTRIES = 99  # SYNC_MAX_ENTRIES
+NAME_PATTERN = re.compile(r"^[A-Za-z0-9_-][A-Za-z0-9._-]*$")
+MANIFEST_NAME = "manifest.txt"
+
+
+def fnv1a(path):
+    value = FNV1A_OFFSET_BASIS
+    with open(path, "rb") as source:
+        for block in iter(lambda: source.read(65536), b""):
+            for byte in block:
+                value = ((value ^ byte) * FNV1A_PRIME) & 0xFFFFFFFF
+    return value
+
+
+def build_manifest(folder):
+    lines = ["# clock manifest v1"]
+    for name in sorted(os.listdir(folder)):
+        path = os.path.join(folder, name)
+        if not os.path.isfile(path) or not name.lower().endswith(EXTENSIONS):
+            continue
+        if len(name) > MAX_NAME_LENGTH or not NAME_PATTERN.match(name):
+            print("%s: skipped (name too long or unsupported characters)" % name, file=sys.stderr)
+            continue
+        if len(lines) > MAX_ENTRIES:
+            print("%s: skipped (more than %d files)" % (name, MAX_ENTRIES), file=sys.stderr)
+            continue
+        lines.append("%d %08x %s" % (os.path.getsize(path), fnv1a(path), name))
+
+    with open(os.path.join(folder, MANIFEST_NAME), "w") as manifest:
+        manifest.write("\n".join(lines) + "\n")
+    print("%s: %d files" % (os.path.join(folder, MANIFEST_NAME), len(lines) - 1))
+
+
+class RangeHandler(http.server.SimpleHTTPRequestHandler):
+    """Static files with single 'bytes=N-' / 'bytes=N-M' ranges"""
+
+    def send_head(self):
+        self.range_left = None
+        match = re.match(r"bytes=(\d+)-(\d*)$", self.headers.get("Range", ""))
+        path = self.translate_path(self.path)
+        if match is None or not os.path.isfile(path):
+            return super().send_head()
+
+        size = os.path.getsize(path)
+        start = int(match.group(1))
+        end = min(int(match.group(2)), size - 1) if match.group(2) else size - 1
+        if start >= size or start > end:
+            self.send_response(416)
+            self.send_header("Content-Range", "bytes */%d" % size)
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+            return None
+
+        source = open(path, "rb")
+        source.seek(start)
+        self.send_response(206)
+        self.send_header("Content-Type", self.guess_type(path))
+        self.send_header("Content-Range", "bytes %d-%d/%d" % (start, end, size))
+        self.send_header("Content-Length", str(end - start + 1))
+        self.end_headers()
+        self.range_left = end - start + 1
+        return source
+
+    def copyfile(self, source, outputfile):
+        left = getattr(self, "range_left", None)
+        if left is None:
+            return super().copyfile(source, outputfile)
+        while left > 0:
+            block = source.read(min(65536, left))
+            if not block:
+                break
+            outputfile.write(block)
+            left -= len(block)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build a background manifest and serve it to clocks")
+    commands = parser.add_subparsers(dest="command", required=True)
+    build = commands.add_parser("build", help="Write manifest.txt into a folder")
+    build.add_argument("folder")
+    serve = commands.add_parser("serve", help="Write manifest.txt and serve the folder")
+    serve.add_argument("folder")
+    serve.add_argument("--port", type=int, default=8000, help="SYNC_PORT (default 8000)")
+    serve.add_argument("--bind", default="0.0.0.0")
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.folder):
+        parser.error("%s is not a folder" % args.folder)
+
+    build_manifest(args.folder)
+    if args.command == "serve":
+        handler = functools.partial(RangeHandler, directory=args.folder)
+        server = http.server.ThreadingHTTPServer((args.bind, args.port), handler)
+        print("Serving %s on port %d" % (args.folder, args.port))
+        try:
+            server.serve_forever()
+        except KeyboardInterrupt:
+            pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
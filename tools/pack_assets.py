@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""
+pack_assets.py - Pack backgrounds into an image for the "assets" partition
+For Multi-Mode Digital Clock project
+
+Layout (little endian, must match asset_partition.h):
+  header  : magic "ASPK", u16 version, u16 count, u32 image size, u32 reserved
+  entries : count x (char name[36], u32 offset, u32 size, u32 FNV-1a of name)
+  blobs   : file contents, each starting on a 32-byte boundary
+
+Usage:
+  python3 tools/pack_assets.py Multimode_Arc_Reactor_clock/data assets.bin
+  esptool.py --chip esp32 write_flash 0x200000 assets.bin
+
+The offset is the "assets" partition in tools/partitions_assets.csv. The same
+assets.bin can be mapped by host builds of the sketch.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+ASSET_MAGIC = 0x4B505341
+ASSET_VERSION = 1
+ASSET_NAME_LENGTH = 36
+ASSET_ALIGN = 32
+HEADER_FORMAT = "<IHHII"
+ENTRY_FORMAT = "<%dsIII" % ASSET_NAME_LENGTH
+EXTENSIONS = (".jpg", ".jpeg", ".gif")
+
+
+def fnv1a(data):
+    value = 2166136261
+    for byte in data:
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def align(value):
+    return (value + ASSET_ALIGN - 1) // ASSET_ALIGN * ASSET_ALIGN
+
+
+def pack(source, output, partition_size):
+    names = sorted(n for n in os.listdir(source) if n.lower().endswith(EXTENSIONS))
+    if not names:
+        sys.exit("no .jpg or .gif files in %s" % source)
+
+    directory_size = struct.calcsize(HEADER_FORMAT) + len(names) * struct.calcsize(ENTRY_FORMAT)
+    offset = align(directory_size)
+    entries = []
+    blobs = []
+
+    for name in names:
+        encoded = name.encode("utf-8")
+        if len(encoded) >= ASSET_NAME_LENGTH:
+            sys.exit("name too long (max %d bytes): %s" % (ASSET_NAME_LENGTH - 1, name))
+
+        with open(os.path.join(source, name), "rb") as f:
+            data = f.read()
+
+        entries.append(struct.pack(ENTRY_FORMAT, encoded, offset, len(data), fnv1a(encoded)))
+        blobs.append((offset, data))
+        offset = align(offset + len(data))
+
+    image_size = offset
+    if partition_size and image_size > partition_size:
+        sys.exit("image is %d bytes, partition holds %d" % (image_size, partition_size))
+
+    image = bytearray(image_size)
+    struct.pack_into(HEADER_FORMAT, image, 0, ASSET_MAGIC, ASSET_VERSION, len(names), image_size, 0)
+    position = struct.calcsize(HEADER_FORMAT)
+    for entry in entries:
+        image[position:position + len(entry)] = entry
+        position += len(entry)
+    for blob_offset, data in blobs:
+        image[blob_offset:blob_offset + len(data)] = data
+
+    with open(output, "wb") as f:
+        f.write(image)
+
+    print("%s: %d assets, %d bytes" % (output, len(names), image_size))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack backgrounds for the assets partition")
+    parser.add_argument("source", help="folder with .jpg and .gif files (usually the sketch data folder)")
+    parser.add_argument("output", help="image file to write")
+    parser.add_argument("--partition-size", type=lambda v: int(v, 0), default=0x200000,
+                        help="size of the assets partition (default 0x200000, 0 = no check)")
+    args = parser.parse_args()
+    pack(args.source, args.output, args.partition_size)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""
+pack_themes.py - Build .thm theme files from the sketch data folder
+For Multi-Mode Digital Clock project
+
+Each background becomes one <name>.thm: a 64-byte header followed by the
+unchanged JPEG or GIF. Header layout (little endian, must match theme_pack.h):
+  u32 magic "THM1", u16 version, u16 header size,
+  u8 mode, u8 image type (0 JPEG, 1 GIF), u8 font (0 default, 1 built-in), u8 reserved,
+  i16 LED color (-1 none), i16 clock position (-1 keep),
+  i16 image x, i16 image y, u32 image offset, u32 image size,
+  char source[36]
+
+The mode follows the same file name rules the sketch uses (vaultboy,
+weather, apple_rings, .gif vs .jpg). LED colors come from a bgcolors.txt
+in the source folder if there is one. Smaller JPEGs are centred on the
+240x240 panel.
+
+Usage:
+  python3 tools/pack_themes.py Multimode_Arc_Reactor_clock/data themes/
+  python3 tools/pack_themes.py data themes/ --position auto --builtin-font
+Upload the .thm files instead of the .jpg/.gif files they were built from.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+THEME_MAGIC = 0x314D4854
+THEME_VERSION = 1
+HEADER_FORMAT = "<IHHBBBBhhhhII36s"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+SOURCE_LENGTH = 36
+SCREEN_SIZE = 240
+EXTENSIONS = (".jpg", ".jpeg", ".gif")
+
+# Must match theme_manager.h
+MODE_ARC_DIGITAL = 0
+MODE_PIPBOY = 2
+MODE_GIF_DIGITAL = 3
+MODE_WEATHER = 4
+MODE_APPLE_RINGS = 5
+
+IMAGE_JPEG = 0
+IMAGE_GIF = 1
+FONT_DEFAULT = 0
+FONT_BUILTIN = 1
+UNSET = -1
+
+# POS_xxx in the sketch
+POSITIONS = {"keep": UNSET, "top": -80, "center": 0, "bottom": 80, "auto": 998, "hidden": 999}
+
+
+def mode_for(name):
+    lower = name.lower()
+    if "apple_rings" in lower:
+        return MODE_APPLE_RINGS
+    if "weather" in lower:
+        return MODE_WEATHER
+    if lower.endswith(".gif"):
+        return MODE_PIPBOY if "vaultboy" in lower else MODE_GIF_DIGITAL
+    return MODE_ARC_DIGITAL
+
+
+def jpeg_size(data):
+    """Width and height from the first SOF marker, or None."""
+    position = 2
+    while position + 9 < len(data):
+        if data[position] != 0xFF:
+            return None
+        marker = data[position + 1]
+        length = struct.unpack(">H", data[position + 2:position + 4])[0]
+        if marker in (0xC0, 0xC1, 0xC2):
+            height, width = struct.unpack(">HH", data[position + 5:position + 9])
+            return width, height
+        position += 2 + length
+    return None
+
+
+def gif_size(data):
+    if len(data) < 10 or not data.startswith(b"GIF"):
+        return None
+    return struct.unpack("<HH", data[6:10])
+
+
+def read_colors(source):
+    """name -> LED color index from bgcolors.txt ("name:index" lines)."""
+    colors = {}
+    path = os.path.join(source, "bgcolors.txt")
+    if not os.path.exists(path):
+        return colors
+    with open(path) as f:
+        for line in f:
+            name, _, value = line.strip().partition(":")
+            if name and value.strip().lstrip("-").isdigit():
+                colors[name] = int(value)
+    return colors
+
+
+def build(source, output, position, font):
+    names = sorted(n for n in os.listdir(source) if n.lower().endswith(EXTENSIONS))
+    if not names:
+        sys.exit("no .jpg or .gif files in %s" % source)
+
+    colors = read_colors(source)
+    os.makedirs(output, exist_ok=True)
+    written = {}
+
+    for name in names:
+        encoded = name.encode("utf-8")
+        if len(encoded) >= SOURCE_LENGTH:
+            sys.exit("name too long (max %d bytes): %s" % (SOURCE_LENGTH - 1, name))
+
+        theme_name = os.path.splitext(name)[0] + ".thm"
+        if theme_name in written:
+            sys.exit("%s and %s would both become %s" % (written[theme_name], name, theme_name))
+        written[theme_name] = name
+
+        with open(os.path.join(source, name), "rb") as f:
+            data = f.read()
+
+        is_gif = name.lower().endswith(".gif")
+        mode = mode_for(name)
+        size = gif_size(data) if is_gif else jpeg_size(data)
+
+        # Centre smaller JPEG backgrounds (GIF players place themselves)
+        x = y = 0
+        if not is_gif and mode == MODE_ARC_DIGITAL and size:
+            x = max(0, (SCREEN_SIZE - size[0]) // 2)
+            y = max(0, (SCREEN_SIZE - size[1]) // 2)
+
+        header = struct.pack(HEADER_FORMAT, THEME_MAGIC, THEME_VERSION, HEADER_SIZE,
+                             mode, IMAGE_GIF if is_gif else IMAGE_JPEG, font, 0,
+                             colors.get(name, UNSET), position, x, y,
+                             HEADER_SIZE, len(data), encoded)
+
+        with open(os.path.join(output, theme_name), "wb") as f:
+            f.write(header)
+            f.write(data)
+
+        print("%-24s mode %d, %s, LED %d, %d bytes" % (theme_name, mode, "GIF" if is_gif else "JPEG",
+                                                       colors.get(name, UNSET), len(data)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build .thm theme files")
+    parser.add_argument("source", help="folder with .jpg and .gif files (usually the sketch data folder)")
+    parser.add_argument("output", help="folder to write the .thm files to")
+    parser.add_argument("--position", choices=sorted(POSITIONS), default="keep",
+                        help="clock position stored in every theme (default: keep the current one)")
+    parser.add_argument("--builtin-font", action="store_true",
+                        help="draw labels with the built-in font even if a smooth font is installed")
+    args = parser.parse_args()
+    build(args.source, args.output, POSITIONS[args.position], FONT_BUILTIN if args.builtin_font else FONT_DEFAULT)
+
+
+if __name__ == "__main__":
+    main()
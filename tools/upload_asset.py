@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""
+upload_asset.py - Send backgrounds to a running clock and measure the upload
+For Multi-Mode Digital Clock project
+
+Talks to the upload server in asset_upload.h (UPLOAD_PORT, default 8080).
+Files are streamed from disk, never read whole, in one of three framings:
+  raw        PUT /upload/<name> with Content-Length
+  chunked    PUT /upload/<name> with Transfer-Encoding: chunked
+  multipart  POST /upload, multipart/form-data with one file part
+The clock answers with key=value lines (bytes, ms, heap_before, heap_min,
+write_worst_us). For every file the client-side throughput is printed next
+to the clock's own timing and the heap the upload took at its peak.
+
+Usage:
+  python3 tools/upload_asset.py 192.168.1.50 data/01_ironman.jpg
+  python3 tools/upload_asset.py clock.local themes/*.thm --framing chunked
+  python3 tools/upload_asset.py 192.168.1.50 big.gif --framing multipart --block 1460
+"""
+
+import argparse
+import http.client
+import os
+import sys
+import time
+import uuid
+
+EXTENSIONS = (".jpg", ".jpeg", ".gif", ".thm")
+MAX_NAME_LENGTH = 30  # UPLOAD_PATH_LENGTH - 2 in asset_upload.h
+
+
+def file_blocks(path, block_size):
+    with open(path, "rb") as source:
+        while True:
+            block = source.read(block_size)
+            if not block:
+                return
+            yield block
+
+
+def multipart_body(path, name, boundary, block_size):
+    head = ("--%s\r\nContent-Disposition: form-data; name=\"file\"; filename=\"%s\"\r\n"
+            "Content-Type: application/octet-stream\r\n\r\n" % (boundary, name)).encode()
+    tail = ("\r\n--%s--\r\n" % boundary).encode()
+
+    def blocks():
+        yield head
+        yield from file_blocks(path, block_size)
+        yield tail
+
+    return blocks(), len(head) + os.path.getsize(path) + len(tail)
+
+
+def upload(host, port, path, framing, block_size, timeout):
+    name = os.path.basename(path)
+    size = os.path.getsize(path)
+    connection = http.client.HTTPConnection(host, port, timeout=timeout)
+    start = time.monotonic()
+
+    if framing == "multipart":
+        boundary = "clock" + uuid.uuid4().hex
+        body, length = multipart_body(path, name, boundary, block_size)
+        connection.request("POST", "/upload", body=body, headers={
+            "Content-Type": "multipart/form-data; boundary=" + boundary,
+            "Content-Length": str(length)})
+    elif framing == "chunked":
+        connection.request("PUT", "/upload/" + name, body=file_blocks(path, block_size),
+                           headers={"Content-Type": "application/octet-stream"}, encode_chunked=True)
+    else:
+        connection.request("PUT", "/upload/" + name, body=file_blocks(path, block_size),
+                           headers={"Content-Type": "application/octet-stream", "Content-Length": str(size)})
+
+    response = connection.getresponse()
+    text = response.read().decode(errors="replace")
+    elapsed = time.monotonic() - start
+    connection.close()
+
+    if response.status != 200:
+        raise RuntimeError("%s: %d %s - %s" % (name, response.status, response.reason, text.strip()))
+
+    result = {}
+    for line in text.splitlines():
+        key, _, value = line.partition("=")
+        result[key] = value
+    return size, elapsed, result
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Upload backgrounds to the clock and report throughput and heap use")
+    parser.add_argument("host", help="Clock address")
+    parser.add_argument("files", nargs="+", help="JPEG, GIF or .thm files")
+    parser.add_argument("--port", type=int, default=8080, help="UPLOAD_PORT (default 8080)")
+    parser.add_argument("--framing", choices=("raw", "chunked", "multipart"), default="raw")
+    parser.add_argument("--block", type=int, default=4096, help="Bytes per send / chunk (default 4096)")
+    parser.add_argument("--timeout", type=float, default=30, help="Seconds to wait for the clock")
+    args = parser.parse_args()
+
+    failed = 0
+    total_bytes = 0
+    total_seconds = 0.0
+    for path in args.files:
+        name = os.path.basename(path)
+        if not name.lower().endswith(EXTENSIONS) or len(name) > MAX_NAME_LENGTH:
+            print("%s: skipped (needs a %s name of at most %d characters)" %
+                  (name, "/".join(EXTENSIONS), MAX_NAME_LENGTH), file=sys.stderr)
+            failed += 1
+            continue
+
+        try:
+            size, elapsed, result = upload(args.host, args.port, path, args.framing, args.block, args.timeout)
+        except (OSError, RuntimeError, http.client.HTTPException) as error:
+            print("%s: %s" % (name, error), file=sys.stderr)
+            failed += 1
+            continue
+
+        total_bytes += size
+        total_seconds += elapsed
+        device_ms = max(int(result.get("ms", "0")), 1)
+        heap_before = int(result.get("heap_before", "0"))
+        heap_min = int(result.get("heap_min", "0"))
+        print("%-30s %8d bytes  %6.1f KB/s (clock %6.1f KB/s)  heap peak %5d bytes  worst write %s us" %
+              (result.get("path", name), size, size / 1024 / max(elapsed, 1e-6), size / 1.024 / device_ms,
+               heap_before - heap_min, result.get("write_worst_us", "?")))
+
+    if total_seconds > 0:
+        print("total %d bytes in %.2f s, %.1f KB/s" % (total_bytes, total_seconds, total_bytes / 1024 / total_seconds))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,339 @@
+#!/usr/bin/env python3
+"""
+weather_aggregator.py - Publish weather to the clocks over MQTT
+For Multi-Mode Digital Clock project
+
+One process polls OpenWeatherMap and publishes a retained 36-byte report
+that every clock subscribes to (see mqtt_link.h), instead of each clock
+polling the API itself. Needs only the Python standard library.
+
+Weather message (little endian, must match WeatherPacket in mqtt_link.h):
+  u8 version, i8 temperature, i8 feels like, i8 min, i8 max,
+  u8 humidity, u8 wind speed, u8 reserved, char icon[4], char description[24]
+
+Commands:
+  run      poll OpenWeatherMap and publish every --interval seconds
+  standin  minimal local broker (QoS 0, retained messages, wills) that
+           prints all traffic - for bench tests without a real broker
+  send     publish one command to a clock ("all" or its id)
+
+tools/check_mqtt_link.py runs the stand-in against a simulated clock.
+
+Usage:
+  python3 tools/weather_aggregator.py run --broker 192.168.1.10 --api-key KEY --city-id 5391959
+  python3 tools/weather_aggregator.py standin --port 1883 --sample
+  python3 tools/weather_aggregator.py send --broker 192.168.1.10 all "mode 4"
+Clock telemetry on clock/<id>/state is "mode,bg,led,brightness,heap,rssi,uptime".
+"""
+
+import argparse
+import json
+import selectors
+import socket
+import struct
+import sys
+import time
+import urllib.request
+
+WEATHER_VERSION = 1
+WEATHER_FORMAT = "<BbbbbBBB4s24s"
+KEEPALIVE = 60
+
+# Packet types (upper nibble of the fixed header)
+CONNECT, CONNACK, PUBLISH, SUBSCRIBE, SUBACK = 1, 2, 3, 8, 9
+PINGREQ, PINGRESP, DISCONNECT = 12, 13, 14
+
+
+def clamp(value, low, high):
+    return max(low, min(high, int(round(value))))
+
+
+def pack_weather(report):
+    """36-byte message from an OpenWeatherMap /weather response."""
+    main = report.get("main", {})
+    weather = (report.get("weather") or [{}])[0]
+    return struct.pack(WEATHER_FORMAT, WEATHER_VERSION,
+                       clamp(main.get("temp", 0), -128, 127),
+                       clamp(main.get("feels_like", 0), -128, 127),
+                       clamp(main.get("temp_min", 0), -128, 127),
+                       clamp(main.get("temp_max", 0), -128, 127),
+                       clamp(main.get("humidity", 0), 0, 255),
+                       clamp(report.get("wind", {}).get("speed", 0), 0, 255), 0,
+                       weather.get("icon", "").encode("ascii", "replace")[:3],
+                       weather.get("description", "").encode("ascii", "replace")[:23])
+
+
+SAMPLE = {"main": {"temp": 64, "feels_like": 63, "temp_min": 58, "temp_max": 70, "humidity": 72},
+          "wind": {"speed": 9}, "weather": [{"icon": "02d", "description": "few clouds"}]}
+
+
+# --- MQTT encoding ---------------------------------------------------------
+
+def encode_length(length):
+    out = bytearray()
+    while True:
+        digit = length % 128
+        length //= 128
+        out.append(digit | (0x80 if length else 0))
+        if not length:
+            return bytes(out)
+
+
+def encode_string(text):
+    data = text.encode("utf-8") if isinstance(text, str) else text
+    return struct.pack(">H", len(data)) + data
+
+
+def packet(kind, flags, body):
+    return bytes([(kind << 4) | flags]) + encode_length(len(body)) + body
+
+
+def publish_packet(topic, payload, retain):
+    return packet(PUBLISH, 1 if retain else 0, encode_string(topic) + payload)
+
+
+def read_packet(stream):
+    """(type, flags, body) from a blocking socket file, or None at EOF."""
+    first = stream.read(1)
+    if not first:
+        return None
+    length, shift = 0, 0
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            return None
+        length |= (byte[0] & 0x7F) << shift
+        shift += 7
+        if not byte[0] & 0x80:
+            break
+    body = stream.read(length) if length else b""
+    return first[0] >> 4, first[0] & 0x0F, body
+
+
+def split_broker(address, default_port=1883):
+    host, _, port = address.partition(":")
+    return host, int(port) if port else default_port
+
+
+def publish_once(broker, topic, payload, retain, client_id):
+    """Connect, publish at QoS 0 and disconnect."""
+    host, port = split_broker(broker)
+    with socket.create_connection((host, port), timeout=10) as sock:
+        body = encode_string("MQTT") + bytes([4, 0x02]) + struct.pack(">H", KEEPALIVE) + encode_string(client_id)
+        sock.sendall(packet(CONNECT, 0, body))
+        reply = read_packet(sock.makefile("rb"))
+        if reply is None or reply[0] != CONNACK or reply[2][1:2] != b"\x00":
+            sys.exit("broker refused the connection")
+        sock.sendall(publish_packet(topic, payload, retain))
+        sock.sendall(packet(DISCONNECT, 0, b""))
+
+
+# --- Commands --------------------------------------------------------------
+
+def fetch_weather(api_key, city_id, units):
+    url = ("http://api.openweathermap.org/data/2.5/weather?id=%d&units=%s&appid=%s" %
+           (city_id, units, api_key))
+    with urllib.request.urlopen(url, timeout=15) as response:
+        return json.load(response)
+
+
+def run(args):
+    topic = "%s/weather" % args.prefix
+    while True:
+        try:
+            payload = pack_weather(fetch_weather(args.api_key, args.city_id, args.units))
+            publish_once(args.broker, topic, payload, True, "weather-aggregator")
+            print("%s: published %d bytes to %s" % (time.strftime("%H:%M:%S"), len(payload), topic))
+        except (OSError, ValueError) as error:
+            print("%s: %s" % (time.strftime("%H:%M:%S"), error), file=sys.stderr)
+        time.sleep(args.interval)
+
+
+def send(args):
+    topic = "%s/%s/cmd" % (args.prefix, args.clock)
+    publish_once(args.broker, topic, args.command.encode("utf-8"), False, "clock-command")
+    print("sent %r to %s" % (args.command, topic))
+
+
+def topic_matches(pattern, topic):
+    pattern_parts, topic_parts = pattern.split("/"), topic.split("/")
+    for i, part in enumerate(pattern_parts):
+        if part == "#":
+            return True
+        if i >= len(topic_parts) or (part != "+" and part != topic_parts[i]):
+            return False
+    return len(pattern_parts) == len(topic_parts)
+
+
+def show(topic, payload):
+    if topic.endswith("/weather") and len(payload) == struct.calcsize(WEATHER_FORMAT):
+        fields = struct.unpack(WEATHER_FORMAT, payload)
+        return "weather %d (feels %d, %d..%d), %d%%, wind %d, %s %s" % (
+            fields[1], fields[2], fields[3], fields[4], fields[5], fields[6],
+            fields[8].rstrip(b"\0").decode(), fields[9].rstrip(b"\0").decode())
+    return repr(payload.decode("utf-8", "replace"))
+
+
+class Standin:
+    """Single-threaded broker: QoS 0, retained messages and wills."""
+
+    def __init__(self, port):
+        self.selector = selectors.DefaultSelector()
+        self.clients = {}   # socket -> state dict
+        self.retained = {}  # topic -> payload
+        server = socket.socket()
+        server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        server.bind(("", port))
+        server.listen()
+        server.setblocking(False)
+        self.port = server.getsockname()[1]  # The one picked for port 0
+        self.selector.register(server, selectors.EVENT_READ, None)
+        print("stand-in broker listening on port %d" % self.port)
+
+    def deliver(self, topic, payload, retain, sender=None):
+        print("%s %-28s %s%s" % (time.strftime("%H:%M:%S"), topic, show(topic, payload), " (retained)" if retain else ""))
+        if retain:
+            if payload:
+                self.retained[topic] = payload
+            else:
+                self.retained.pop(topic, None)
+        for sock, client in list(self.clients.items()):
+            if any(topic_matches(f, topic) for f in client["filters"]):
+                self.send(sock, publish_packet(topic, payload, False))
+
+    def send(self, sock, data):
+        try:
+            sock.sendall(data)
+        except OSError:
+            self.drop(sock, clean=False)
+
+    def drop(self, sock, clean):
+        client = self.clients.pop(sock, None)
+        if client is None:
+            return
+        self.selector.unregister(sock)
+        sock.close()
+        print("%s %s disconnected%s" % (time.strftime("%H:%M:%S"), client["id"], "" if clean else " (will sent)"))
+        if not clean and client["will"]:
+            self.deliver(*client["will"])
+
+    def handle(self, sock, kind, flags, body):
+        client = self.clients[sock]
+        if kind == CONNECT:
+            pos = 2 + struct.unpack(">H", body[:2])[0]
+            connect_flags = body[pos + 1]
+            pos += 4
+
+            def take():
+                nonlocal pos
+                length = struct.unpack(">H", body[pos:pos + 2])[0]
+                value = body[pos + 2:pos + 2 + length]
+                pos += 2 + length
+                return value
+
+            client["id"] = take().decode("utf-8", "replace")
+            if connect_flags & 0x04:
+                will_topic = take().decode("utf-8")
+                client["will"] = (will_topic, take(), bool(connect_flags & 0x20))
+            print("%s %s connected" % (time.strftime("%H:%M:%S"), client["id"]))
+            self.send(sock, packet(CONNACK, 0, b"\x00\x00"))
+        elif kind == SUBSCRIBE:
+            packet_id, pos, granted = body[:2], 2, bytearray()
+            while pos < len(body):
+                length = struct.unpack(">H", body[pos:pos + 2])[0]
+                pattern = body[pos + 2:pos + 2 + length].decode("utf-8")
+                pos += 3 + length
+                client["filters"].append(pattern)
+                granted.append(0)
+                print("%s %s subscribed to %s" % (time.strftime("%H:%M:%S"), client["id"], pattern))
+            self.send(sock, packet(SUBACK, 0, packet_id + bytes(granted)))
+            for topic, payload in self.retained.items():
+                if any(topic_matches(f, topic) for f in client["filters"][-len(granted):]):
+                    self.send(sock, publish_packet(topic, payload, True))
+        elif kind == PUBLISH:
+            length = struct.unpack(">H", body[:2])[0]
+            topic = body[2:2 + length].decode("utf-8")
+            offset = 2 + length + (2 if flags & 0x06 else 0)
+            self.deliver(topic, body[offset:], bool(flags & 0x01), sock)
+        elif kind == PINGREQ:
+            self.send(sock, packet(PINGRESP, 0, b""))
+        elif kind == DISCONNECT:
+            client["will"] = None
+            self.drop(sock, clean=True)
+
+    def receive(self, sock):
+        client = self.clients[sock]
+        try:
+            data = sock.recv(4096)
+        except OSError:
+            data = b""
+        if not data:
+            self.drop(sock, clean=False)
+            return
+        client["buffer"] += data
+        while sock in self.clients:
+            buffer = client["buffer"]
+            length, shift, pos = 0, 0, 1
+            while True:
+                if pos >= len(buffer):
+                    return
+                length |= (buffer[pos] & 0x7F) << shift
+                shift += 7
+                pos += 1
+                if not buffer[pos - 1] & 0x80:
+                    break
+            if len(buffer) < pos + length:
+                return
+            client["buffer"] = buffer[pos + length:]
+            self.handle(sock, buffer[0] >> 4, buffer[0] & 0x0F, bytes(buffer[pos:pos + length]))
+
+    def serve(self):
+        while True:
+            for key, _ in self.selector.select():
+                if key.data is None:
+                    sock, _ = key.fileobj.accept()
+                    sock.setblocking(True)
+                    self.clients[sock] = {"id": "?", "filters": [], "will": None, "buffer": bytearray()}
+                    self.selector.register(sock, selectors.EVENT_READ, "client")
+                else:
+                    self.receive(key.fileobj)
+
+
+def standin(args):
+    broker = Standin(args.port)
+    if args.sample:
+        broker.retained["%s/weather" % args.prefix] = pack_weather(SAMPLE)
+        print("retained sample weather on %s/weather" % args.prefix)
+    broker.serve()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Publish weather to the clocks over MQTT")
+    parser.add_argument("--prefix", default="clock", help="MQTT_TOPIC_PREFIX of the clocks (default clock)")
+    commands = parser.add_subparsers(dest="command_name", required=True)
+
+    run_parser = commands.add_parser("run", help="poll OpenWeatherMap and publish")
+    run_parser.add_argument("--broker", required=True, help="host[:port]")
+    run_parser.add_argument("--api-key", required=True)
+    run_parser.add_argument("--city-id", type=int, required=True)
+    run_parser.add_argument("--units", default="imperial", choices=("imperial", "metric"))
+    run_parser.add_argument("--interval", type=int, default=600, help="seconds between reports (default 600)")
+    run_parser.set_defaults(handler=run)
+
+    standin_parser = commands.add_parser("standin", help="run a minimal local broker")
+    standin_parser.add_argument("--port", type=int, default=1883)
+    standin_parser.add_argument("--sample", action="store_true", help="start with a retained sample report")
+    standin_parser.set_defaults(handler=standin)
+
+    send_parser = commands.add_parser("send", help="send a command to a clock")
+    send_parser.add_argument("--broker", required=True, help="host[:port]")
+    send_parser.add_argument("clock", help='clock id (last 6 hex digits of its MAC) or "all"')
+    send_parser.add_argument("command", help='e.g. "mode 4", "theme next", "color 3", "brightness 80"')
+    send_parser.set_defaults(handler=send)
+
+    args = parser.parse_args()
+    args.handler(args)
+
+
+if __name__ == "__main__":
+    main()